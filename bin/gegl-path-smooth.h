@@ -0,0 +1,6 @@
+#ifndef _GEGL_PATH_SMOOTH__H
+#define _GEGL_PATH_SMOOTH__H
+
+void gegl_path_smooth_init (void);
+
+#endif
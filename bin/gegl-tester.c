@@ -0,0 +1,848 @@
+/* This file is an image processing operation for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2012 Ville Sokk <ville.sokk@gmail.com>
+ */
+
+/* The operations are tested concurrently, by a pool of --jobs threads.
+ * The render time, peak memory and a checksum of the output of every
+ * operation can be written to a file with --timings:
+ *
+ *   gegl-tester ... --timings=baseline.tsv
+ *
+ * and later runs compared against it, failing when an operation renders
+ * more than --tolerance percent slower, or needs that much more memory:
+ *
+ *   gegl-tester ... --baseline=baseline.tsv
+ *
+ * To measure the memory of every operation on its own, each one is then
+ * tested in a child process running gegl-tester with --measure, which
+ * prints its measurements after the output of the test.
+ */
+
+#include <glib.h>
+#include <gegl.h>
+#include <gegl-plugin.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib/gprintf.h>
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+/* differences in render time below this are noise */
+#define MIN_TIME_DIFFERENCE 0.005
+
+/* starts the line with the result and measurements of a --measure
+ * child, the exit status of gegl-tester doesn't tell whether it passed
+ */
+#define MEASURED_PREFIX "measured\t"
+
+typedef struct
+{
+  gchar    *name;
+  gchar    *image;      /* the reference image, NULL for none */
+  gchar    *xml;        /* the reference composition, NULL for the
+                           standard one */
+  GString  *log;        /* printed once the job is done */
+  gboolean  result;
+  gdouble   seconds;    /* the time rendering the composition took */
+  guint64   memory;     /* the peak memory of the process after rendering,
+                           0 if unknown */
+  gchar    *checksum;   /* of the output, NULL if nothing was rendered */
+} TestJob;
+
+static GRegex   *regex, *exc_regex;
+static gchar    *data_dir        = NULL;
+static gchar    *reference_dir   = NULL;
+static gchar    *output_dir      = NULL;
+static gchar    *pattern         = "";
+static gchar    *exclusion_pattern = "a^"; /* doesn't match anything by default */
+static gboolean *output_all      = FALSE;
+static gint      n_jobs          = 0;
+static gchar    *timings         = NULL;
+static gchar    *baseline        = NULL;
+static gdouble   tolerance       = 25.0;
+static gchar    *measure         = NULL;
+static gchar    *program         = NULL;
+
+static GMutex    output_mutex;
+
+static const GOptionEntry options[] =
+{
+  {"data-directory", 'd', 0, G_OPTION_ARG_FILENAME, &data_dir,
+   "Root directory of files used in the composition", NULL},
+
+  {"reference-directory", 'r', 0, G_OPTION_ARG_FILENAME, &reference_dir,
+   "Directory where reference images are located", NULL},
+
+  {"output-directory", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+   "Directory where composition output and diff files are saved", NULL},
+
+  {"pattern", 'p', 0, G_OPTION_ARG_STRING, &pattern,
+   "Regular expression used to match names of operations to be tested", NULL},
+
+  {"exclusion-pattern", 'e', 0, G_OPTION_ARG_STRING, &exclusion_pattern,
+   "Regular expression used to match names of operations not to be tested", NULL},
+
+  {"all", 'a', 0, G_OPTION_ARG_NONE, &output_all,
+   "Create output for all operations using a standard composition "
+   "if no composition is specified", NULL},
+
+  {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs,
+   "Number of operations tested at the same time (default: number of processors)", NULL},
+
+  {"timings", 't', 0, G_OPTION_ARG_FILENAME, &timings,
+   "File the render time, peak memory and checksum of every operation are written to", NULL},
+
+  {"baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline,
+   "File written with --timings by an earlier run, to fail on performance regressions", NULL},
+
+  {"tolerance", 0, 0, G_OPTION_ARG_DOUBLE, &tolerance,
+   "Allowed increase of render time and memory from the baseline in percent (default: 25)", NULL},
+
+  {"measure", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, &measure,
+   "Test only the named operation, and print its measurements", NULL},
+
+  { NULL }
+};
+
+/* convert operation name to output path */
+static gchar*
+operation_to_path (const gchar *op_name,
+                   gboolean     diff)
+{
+  gchar *cleaned = g_strdup (op_name);
+  gchar *filename, *output_path;
+
+  g_strdelimit (cleaned, ":", '-');
+  if (diff)
+    filename = g_strconcat (cleaned, "-diff.png", NULL);
+  else
+    filename = g_strconcat (cleaned, ".png", NULL);
+  output_path = g_build_path (G_DIR_SEPARATOR_S, output_dir, filename, NULL);
+
+  g_free (cleaned);
+  g_free (filename);
+
+  return output_path;
+}
+
+/* Returns the MD5 sum of the 8 bit pixels of buffer */
+static gchar *
+buffer_checksum (GeglBuffer *buffer)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  const Babl          *format = babl_format ("R'G'B'A u8");
+  guchar              *pixels;
+  gchar               *checksum;
+
+  pixels = g_malloc ((gsize) extent->width * extent->height * 4);
+  gegl_buffer_get (buffer, extent, 1.0, format, pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5, pixels,
+                                          (gsize) extent->width *
+                                          extent->height * 4);
+  g_free (pixels);
+
+  return checksum;
+}
+
+/* Returns the peak resident memory of the process in bytes, 0 if it is
+ * not known
+ */
+static guint64
+peak_memory (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+      return usage.ru_maxrss;
+#else
+      return (guint64) usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+
+  return 0;
+}
+
+/* Renders node, measuring the time it takes and the peak memory, and
+ * saves the result as a png at output_path.
+ */
+static void
+render_to_file (TestJob     *job,
+                GeglNode    *node,
+                const gchar *output_path)
+{
+  GeglBuffer *buffer = NULL;
+  GeglNode   *gegl, *sink, *source, *output;
+  gint64      start;
+
+  gegl = gegl_node_new ();
+  sink = gegl_node_new_child (gegl,
+                              "operation", "gegl:buffer-sink",
+                              "buffer", &buffer,
+                              NULL);
+  gegl_node_link (node, sink);
+
+  start = g_get_monotonic_time ();
+  gegl_node_process (sink);
+  job->seconds = (g_get_monotonic_time () - start) / 1000000.0;
+  job->memory  = peak_memory ();
+
+  g_object_unref (gegl);
+
+  if (!buffer)
+    return;
+
+  job->checksum = buffer_checksum (buffer);
+
+  gegl = gegl_node_new ();
+  source = gegl_node_new_child (gegl,
+                                "operation", "gegl:buffer-source",
+                                "buffer", buffer,
+                                NULL);
+  output = gegl_node_new_child (gegl,
+                                "operation", "gegl:png-save",
+                                "compression", 9,
+                                "path", output_path,
+                                NULL);
+  gegl_node_link (source, output);
+  gegl_node_process (output);
+
+  g_object_unref (gegl);
+  g_object_unref (buffer);
+}
+
+static gboolean
+test_operation (TestJob     *job,
+                gchar       *output_path)
+{
+  const gchar   *op_name = job->name;
+  const gchar   *image   = job->image;
+  GString       *log     = job->log;
+  gchar         *ref_path;
+  GeglNode      *img, *ref_img, *gegl;
+  GeglRectangle  ref_bounds, comp_bounds;
+  gint           ref_pixels;
+  gboolean       result = TRUE;
+
+  gegl = gegl_node_new ();
+
+  ref_path = g_build_path (G_DIR_SEPARATOR_S, reference_dir, image, NULL);
+  ref_img = gegl_node_new_child (gegl,
+                                 "operation", "gegl:load",
+                                 "path", ref_path,
+                                 NULL);
+  g_free (ref_path);
+
+  img = gegl_node_new_child (gegl,
+                             "operation", "gegl:load",
+                             "path", output_path,
+                             NULL);
+
+  ref_bounds  = gegl_node_get_bounding_box (ref_img);
+  comp_bounds = gegl_node_get_bounding_box (img);
+  ref_pixels  = ref_bounds.width * ref_bounds.height;
+
+  if (ref_bounds.width != comp_bounds.width ||
+      ref_bounds.height != comp_bounds.height)
+    {
+      g_string_append (log, "FAIL\n  Reference and composition differ in size\n");
+      result = FALSE;
+    }
+  else
+    {
+      GeglNode *comparison;
+      gdouble   max_diff;
+
+      comparison = gegl_node_create_child (gegl, "gegl:image-compare");
+      gegl_node_link (img, comparison);
+      gegl_node_connect_to (ref_img, "output", comparison, "aux");
+      gegl_node_process (comparison);
+      gegl_node_get (comparison, "max diff", &max_diff, NULL);
+
+      if (max_diff < 1.0)
+        {
+          g_string_append (log, "PASS\n");
+          result = TRUE;
+        }
+      else
+        {
+          GeglNode *output;
+          gchar    *diff_path;
+          gdouble   avg_diff_wrong, avg_diff_total;
+          gint      wrong_pixels;
+
+          gegl_node_get (comparison, "avg_diff_wrong", &avg_diff_wrong,
+                         "avg_diff_total", &avg_diff_total, "wrong_pixels",
+                         &wrong_pixels, NULL);
+
+          g_string_append_printf (log, "FAIL\n  Reference image and composition differ\n"
+                    "    wrong pixels : %i/%i (%2.2f%%)\n"
+                    "    max Δe       : %2.3f\n"
+                    "    avg Δe       : %2.3f (wrong) %2.3f (total)\n",
+                    wrong_pixels, ref_pixels,
+                    (wrong_pixels * 100.0 / ref_pixels),
+                    max_diff, avg_diff_wrong, avg_diff_total);
+
+          diff_path = operation_to_path (op_name, TRUE);
+          output = gegl_node_new_child (gegl,
+                                        "operation", "gegl:png-save",
+                                        "path", diff_path,
+                                        NULL);
+          gegl_node_link (comparison, output);
+          gegl_node_process (output);
+
+          g_free (diff_path);
+
+          result = FALSE;
+        }
+    }
+
+  g_object_unref (gegl);
+  return result;
+}
+
+static void
+standard_output (TestJob *job)
+{
+  const gchar *op_name = job->name;
+  GeglNode *composition, *input, *aux, *operation, *crop, *translate;
+  GeglNode *background,  *over;
+  gchar    *input_path  = g_build_path (G_DIR_SEPARATOR_S, data_dir,
+                                        "standard-input.png", NULL);
+  gchar    *aux_path    = g_build_path (G_DIR_SEPARATOR_S, data_dir,
+                                        "standard-aux.png", NULL);
+  gchar    *output_path = operation_to_path (op_name, FALSE);
+
+  composition = gegl_node_new ();
+  operation = gegl_node_create_child (composition, op_name);
+
+  if (gegl_node_has_pad (operation, "output"))
+    {
+      input = gegl_node_new_child (composition,
+                                   "operation", "gegl:load",
+                                   "path", input_path,
+                                   NULL);
+      translate  = gegl_node_new_child (composition,
+                                 "operation", "gegl:translate",
+                                 "x", 0.0,
+                                 "y", 80.0,
+                                 NULL);
+      aux = gegl_node_new_child (composition,
+                                 "operation", "gegl:load",
+                                 "path", aux_path,
+                                 NULL);
+      crop = gegl_node_new_child (composition,
+                                  "operation", "gegl:crop",
+                                  "width", 200.0,
+                                  "height", 200.0,
+                                  NULL);
+      background = gegl_node_new_child (composition,
+                                        "operation", "gegl:checkerboard",
+                                        "color1", gegl_color_new ("rgb(0.75,0.75,0.75)"),
+                                        "color2", gegl_color_new ("rgb(0.25,0.25,0.25)"),
+                                        NULL);
+      over = gegl_node_new_child (composition, "operation", "gegl:over", NULL);
+
+
+      if (gegl_node_has_pad (operation, "input"))
+        gegl_node_link (input, operation);
+
+      if (gegl_node_has_pad (operation, "aux"))
+      {
+        gegl_node_connect_to (aux, "output", translate, "input");
+        gegl_node_connect_to (translate, "output", operation, "aux");
+      }
+
+      gegl_node_connect_to (background, "output", over, "input");
+      gegl_node_connect_to (operation,  "output", over, "aux");
+      gegl_node_connect_to (over,       "output", crop, "input");
+
+      render_to_file (job, crop, output_path);
+    }
+
+  g_free (input_path);
+  g_free (aux_path);
+  g_free (output_path);
+  g_object_unref (composition);
+}
+
+static void
+test_composition (TestJob *job)
+{
+  GeglNode *composition;
+
+  if (output_all)
+    g_string_append_printf (job->log, "%s\n", job->name);
+  else if (job->image)
+    g_string_append_printf (job->log, "%s: ", job->name); /* more information
+                                                            will follow if
+                                                            we're testing */
+
+  composition = gegl_node_new_from_xml (job->xml, data_dir);
+  if (!composition)
+    {
+      g_string_append (job->log, "FAIL\n  Composition graph is flawed\n");
+      job->result = FALSE;
+    }
+  else if (job->image || output_all)
+    {
+      gchar *output_path = operation_to_path (job->name, FALSE);
+
+      render_to_file (job, composition, output_path);
+      g_object_unref (composition);
+
+      /* don't test if run with --all */
+      if (!output_all && job->image)
+        job->result = test_operation (job, output_path);
+
+      g_free (output_path);
+    }
+  else
+    {
+      g_object_unref (composition);
+    }
+}
+
+/* Tests the operation of job in a child process, so that the memory
+ * measured is its own
+ */
+static void
+run_job_in_child (TestJob *job)
+{
+  GPtrArray  *args   = g_ptr_array_new_with_free_func (g_free);
+  gchar      *output = NULL;
+  GError     *error  = NULL;
+  gchar     **lines;
+  gboolean    measured = FALSE;
+  gint        status;
+  gint        i;
+
+  g_ptr_array_add (args, g_strdup (program));
+  g_ptr_array_add (args, g_strdup_printf ("--measure=%s", job->name));
+  g_ptr_array_add (args, g_strdup_printf ("--data-directory=%s", data_dir));
+  g_ptr_array_add (args, g_strdup_printf ("--output-directory=%s", output_dir));
+  if (reference_dir)
+    g_ptr_array_add (args, g_strdup_printf ("--reference-directory=%s",
+                                            reference_dir));
+  if (output_all)
+    g_ptr_array_add (args, g_strdup ("--all"));
+  g_ptr_array_add (args, NULL);
+
+  if (!g_spawn_sync (NULL, (gchar **) args->pdata, NULL,
+                     G_SPAWN_SEARCH_PATH,
+                     NULL, NULL, &output, NULL, &status, &error))
+    {
+      g_string_append_printf (job->log, "%s: FAIL\n  %s\n",
+                              job->name, error->message);
+      g_error_free (error);
+      g_ptr_array_free (args, TRUE);
+      job->result = FALSE;
+      return;
+    }
+
+  lines = g_strsplit (output, "\n", -1);
+
+  for (i = 0; lines[i]; i++)
+    {
+      if (g_str_has_prefix (lines[i], MEASURED_PREFIX))
+        {
+          gchar **fields = g_strsplit (lines[i] + strlen (MEASURED_PREFIX),
+                                       "\t", -1);
+
+          if (g_strv_length (fields) == 4)
+            {
+              measured     = TRUE;
+              job->result  = !strcmp (fields[0], "pass");
+              job->seconds = g_ascii_strtod (fields[1], NULL);
+              job->memory  = g_ascii_strtoull (fields[2], NULL, 10);
+              if (fields[3][0])
+                job->checksum = g_strdup (fields[3]);
+            }
+
+          g_strfreev (fields);
+        }
+      else if (lines[i][0] || lines[i + 1])
+        {
+          g_string_append_printf (job->log, "%s\n", lines[i]);
+        }
+    }
+
+  /* the child crashed */
+  if (!measured)
+    {
+      g_spawn_check_exit_status (status, &error);
+      g_string_append_printf (job->log, "%s: FAIL\n  %s\n", job->name,
+                              error ? error->message : "no result");
+      g_clear_error (&error);
+      job->result = FALSE;
+    }
+
+  g_strfreev (lines);
+  g_free (output);
+  g_ptr_array_free (args, TRUE);
+}
+
+static void
+run_job (gpointer data,
+         gpointer unused)
+{
+  TestJob *job = data;
+
+  if (timings || baseline)
+    {
+      run_job_in_child (job);
+    }
+  else if (job->xml)
+    {
+      test_composition (job);
+    }
+  else
+    {
+      g_string_append_printf (job->log, "%s\n", job->name);
+      standard_output (job);
+    }
+
+  /* print the output of a job at once, not interleaved with others */
+  g_mutex_lock (&output_mutex);
+  g_printf ("%s", job->log->str);
+  fflush (stdout);
+  g_mutex_unlock (&output_mutex);
+}
+
+static TestJob *
+test_job_new (const gchar *name,
+              const gchar *image,
+              const gchar *xml)
+{
+  TestJob *job = g_slice_new0 (TestJob);
+
+  job->name   = g_strdup (name);
+  job->image  = g_strdup (image);
+  job->xml    = g_strdup (xml);
+  job->log    = g_string_new (NULL);
+  job->result = TRUE;
+
+  return job;
+}
+
+static void
+test_job_free (TestJob *job)
+{
+  g_free (job->name);
+  g_free (job->image);
+  g_free (job->xml);
+  g_string_free (job->log, TRUE);
+  g_free (job->checksum);
+  g_slice_free (TestJob, job);
+}
+
+/* Collects a job for every operation to test into jobs */
+static void
+process_operations (GType    type,
+                    GQueue  *jobs)
+{
+  GType    *operations;
+  guint     count;
+  gint      i;
+
+  operations = g_type_children (type, &count);
+
+  if (!operations)
+    {
+      g_free (operations);
+      return;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      GeglOperationClass *operation_class;
+      const gchar        *image, *xml, *name;
+      gboolean            matches;
+
+      operation_class = g_type_class_ref (operations[i]);
+      image           = gegl_operation_class_get_key (operation_class, "reference-image");
+      xml             = gegl_operation_class_get_key (operation_class, "reference-composition");
+      name            = gegl_operation_class_get_key (operation_class, "name");
+
+      if (name == NULL)
+        {
+          process_operations (operations[i], jobs);
+          continue;
+        }
+
+      matches = g_regex_match (regex, name, 0, NULL) &&
+        !g_regex_match (exc_regex, name, 0, NULL);
+
+      if (xml && matches)
+        {
+          g_queue_push_tail (jobs, test_job_new (name, image, xml));
+        }
+      /* if we are running with --all and the operation doesn't have a
+         composition, use standard composition and images, don't test */
+      else if (output_all && matches &&
+               !(g_type_is_a (operations[i], GEGL_TYPE_OPERATION_SINK) ||
+                 g_type_is_a (operations[i], GEGL_TYPE_OPERATION_TEMPORAL)))
+        {
+          g_queue_push_tail (jobs, test_job_new (name, NULL, NULL));
+        }
+
+      process_operations (operations[i], jobs);
+    }
+
+  g_free (operations);
+}
+
+static gboolean
+run_jobs (GQueue *jobs)
+{
+  GThreadPool *pool;
+  GList       *iter;
+  gboolean     result = TRUE;
+
+  if (n_jobs <= 0)
+    n_jobs = g_get_num_processors ();
+
+  pool = g_thread_pool_new (run_job, NULL, n_jobs, FALSE, NULL);
+
+  for (iter = jobs->head; iter; iter = iter->next)
+    g_thread_pool_push (pool, iter->data, NULL);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (iter = jobs->head; iter; iter = iter->next)
+    {
+      TestJob *job = iter->data;
+
+      result = job->result && result;
+    }
+
+  return result;
+}
+
+static gboolean
+write_timings (GQueue      *jobs,
+               const gchar *path)
+{
+  GString  *contents = g_string_new ("# operation\tseconds\tmemory\tchecksum\n");
+  GError   *error    = NULL;
+  GList    *iter;
+  gboolean  success;
+
+  for (iter = jobs->head; iter; iter = iter->next)
+    {
+      TestJob *job = iter->data;
+      gchar    seconds[G_ASCII_DTOSTR_BUF_SIZE];
+
+      if (!job->checksum)
+        continue;
+
+      g_ascii_formatd (seconds, sizeof (seconds), "%.6f", job->seconds);
+      g_string_append_printf (contents, "%s\t%s\t%" G_GUINT64_FORMAT "\t%s\n",
+                              job->name, seconds, job->memory, job->checksum);
+    }
+
+  success = g_file_set_contents (path, contents->str, contents->len, &error);
+  if (!success)
+    {
+      g_printf ("%s\n", error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (contents, TRUE);
+
+  return success;
+}
+
+/* Returns FALSE if any operation rendered more than tolerance percent
+ * slower, or needed that much more memory, than in the timings file at
+ * path.
+ */
+static gboolean
+check_baseline (GQueue      *jobs,
+                const gchar *path)
+{
+  GHashTable  *table;
+  gchar       *contents;
+  gchar      **lines;
+  GError      *error  = NULL;
+  GList       *iter;
+  gboolean     result = TRUE;
+  gint         i;
+
+  if (!g_file_get_contents (path, &contents, NULL, &error))
+    {
+      g_printf ("%s\n", error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  /* operation name -> its fields */
+  table = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                 (GDestroyNotify) g_strfreev);
+  lines = g_strsplit (contents, "\n", -1);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar **fields;
+
+      if (lines[i][0] == '#' || lines[i][0] == '\0')
+        continue;
+
+      fields = g_strsplit (lines[i], "\t", -1);
+
+      if (g_strv_length (fields) >= 4)
+        g_hash_table_insert (table, fields[0], fields);
+      else
+        g_strfreev (fields);
+    }
+
+  for (iter = jobs->head; iter; iter = iter->next)
+    {
+      TestJob  *job = iter->data;
+      gchar   **fields;
+      gdouble   seconds;
+      guint64   memory;
+
+      if (!job->checksum ||
+          !(fields = g_hash_table_lookup (table, job->name)))
+        continue;
+
+      seconds = g_ascii_strtod (fields[1], NULL);
+      memory  = g_ascii_strtoull (fields[2], NULL, 10);
+
+      if (job->seconds > seconds * (1.0 + tolerance / 100.0) &&
+          job->seconds - seconds > MIN_TIME_DIFFERENCE)
+        {
+          g_printf ("%s: SLOWER\n  %.3f seconds, baseline %.3f (%+.1f%%)\n",
+                    job->name, job->seconds, seconds,
+                    100.0 * (job->seconds - seconds) / MAX (seconds, 1e-6));
+          result = FALSE;
+        }
+
+      if (memory && job->memory > memory * (1.0 + tolerance / 100.0))
+        {
+          g_printf ("%s: MORE MEMORY\n  %" G_GUINT64_FORMAT " bytes, "
+                    "baseline %" G_GUINT64_FORMAT " (%+.1f%%)\n",
+                    job->name, job->memory, memory,
+                    100.0 * ((gdouble) job->memory - memory) / memory);
+          result = FALSE;
+        }
+
+      if (strcmp (job->checksum, fields[3]))
+        g_printf ("%s: output differs from the baseline\n", job->name);
+    }
+
+  g_strfreev (lines);
+  g_hash_table_unref (table);
+  g_free (contents);
+
+  return result;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gboolean        result;
+  GError         *error = NULL;
+  GOptionContext *context;
+  GQueue          jobs  = G_QUEUE_INIT;
+
+  program = argv[0];
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_add_group (context, gegl_get_option_group ());
+
+  g_object_set (gegl_config (),
+                "application-license", "GPL3",
+                NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printf ("%s\n", error->message);
+      g_error_free (error);
+      result = FALSE;
+    }
+  else if (output_all && !(data_dir && output_dir))
+    {
+      g_printf ("Data and output directories must be specified\n");
+      result = FALSE;
+    }
+  else if (!(output_all || (data_dir && output_dir && reference_dir)))
+    {
+      g_printf ("Data, reference and output directories must be specified\n");
+      result = FALSE;
+    }
+  else
+    {
+      /* a child testing one operation for its parent */
+      if (measure)
+        {
+          gchar *escaped = g_regex_escape_string (measure, -1);
+
+          pattern           = g_strdup_printf ("^%s$", escaped);
+          exclusion_pattern = "a^";
+          timings           = NULL;
+          baseline          = NULL;
+          g_free (escaped);
+        }
+
+      regex = g_regex_new (pattern, 0, 0, NULL);
+      exc_regex = g_regex_new (exclusion_pattern, 0, 0, NULL);
+
+      process_operations (GEGL_TYPE_OPERATION, &jobs);
+
+      result = run_jobs (&jobs);
+
+      if (measure && jobs.head)
+        {
+          TestJob *job = jobs.head->data;
+          gchar    seconds[G_ASCII_DTOSTR_BUF_SIZE];
+
+          g_ascii_formatd (seconds, sizeof (seconds), "%.6f", job->seconds);
+          g_printf (MEASURED_PREFIX "%s\t%s\t%" G_GUINT64_FORMAT "\t%s\n",
+                    job->result ? "pass" : "fail", seconds, job->memory,
+                    job->checksum ? job->checksum : "");
+        }
+
+      if (timings)
+        result = write_timings (&jobs, timings) && result;
+
+      if (baseline)
+        result = check_baseline (&jobs, baseline) && result;
+
+      g_queue_foreach (&jobs, (GFunc) test_job_free, NULL);
+      g_queue_clear (&jobs);
+
+      g_regex_unref (regex);
+      g_regex_unref (exc_regex);
+    }
+
+  gegl_exit ();
+
+  if (output_all)
+    return 0;
+  else
+    return result;
+}
@@ -0,0 +1,609 @@
+/* This file is part of GEGL editor -- a gtk frontend for GEGL
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2003, 2004, 2006, 2007, 2008 Øyvind Kolås
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gprintf.h>
+#include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+#include <gegl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "gegl-options.h"
+#ifdef HAVE_SPIRO
+#include "gegl-path-spiro.h"
+#endif
+#include "gegl-path-smooth.h"
+#include "operation/gegl-extension-handler.h"
+
+#ifdef G_OS_WIN32
+#include <direct.h>
+#define getcwd(b,n) _getcwd(b,n)
+#define realpath(a,b) _fullpath(b,a,_MAX_PATH)
+#endif
+
+#define DEFAULT_COMPOSITION \
+"<?xml version='1.0' encoding='UTF-8'?> <gegl> <node operation='gegl:crop'> <params> <param name='x'>0</param> <param name='y'>0</param> <param name='width'>395</param> <param name='height'>200</param> </params> </node> <node operation='gegl:over'> <node operation='gegl:translate'> <params> <param name='x'>80</param> <param name='y'>162</param> </params> </node> <node operation='gegl:opacity'> <params> <param name='value'>0.5</param> </params> </node> <node name='text' operation='gegl:text'> <params> <param name='string'>2000-2011 © Various contributors</param> <param name='font'>Sans</param> <param name='size'>12</param> <param name='color'>rgb(0.0000, 0.0000, 0.0000)</param> <param name='wrap'>628</param> <param name='alignment'>0</param> <param name='width'>622</param> <param name='height'>40</param> </params> </node> </node> <node operation='gegl:over'> <node operation='gegl:translate'> <params> <param name='x'>20</param> <param name='y'>50</param> </params> </node> <node operation='gegl:over'> <node operation='gegl:translate'> <params> <param name='x'>0</param> <param name='y'>0</param> </params> </node> <node operation='gegl:dropshadow'> <params> <param name='opacity'>1.2</param> <param name='x'>0</param> <param name='y'>0</param> <param name='radius'>8</param> </params> </node> <gegl:fill-path d='M0,50 C0,78 24,100 50,100 C77,100 100,78 100,50 C100,45 99,40 98,35 C82,35 66,35 50,35 C42,35 35,42 35,50 C35,58 42,65 50,65 C56,65 61,61 64,56 C67,51 75,55 73,60 C69,69 60,75 50,75 C36,75 25,64 25,50 C25,36 36,25 50,25 L93,25 C83,9 67,0 49,0 C25,0 0,20 0,50 z' color='white'/> </node> <node operation='gegl:over'> <node operation='gegl:translate'> <params> <param name='x'>88</param> <param name='y'>0</param> </params> </node> <node operation='gegl:dropshadow'> <params> <param name='opacity'>1.2</param> <param name='x'>0</param> <param name='y'>0</param> <param name='radius'>8</param> </params> </node> <node operation='gegl:fill-path'> <params> <param name='d'>M50,0 C23,0 0,22 0,50 C0,77 22,100 50,100 C68,100 85,90 93,75 L40,75 C35,75 35,65 40,65 L98,65 C100,55 100,45 98,35 L40,35 C35,35 35,25 40,25 L93,25 C84,10 68,0 50,0 z</param> <param name='color'>rgb(1.0000, 1.0000, 1.0000)</param> </params> </node> </node> <node operation='gegl:over'> <node operation='gegl:translate'> <params> <param name='x'>176</param> <param name='y'>0</param> </params> </node> <node operation='gegl:dropshadow'> <params> <param name='opacity'>1.2</param> <param name='x'>0</param> <param name='y'>0</param> <param name='radius'>8</param> </params> </node> <node operation='gegl:fill-path'> <params> <param name='d'>M0,50 C0,78 24,100 50,100 C77,100 100,78 100,50 C100,45 99,40 98,35 C82,35 66,35 50,35 C42,35 35,42 35,50 C35,58 42,65 50,65 C56,65 61,61 64,56 C67,51 75,55 73,60 C69,69 60,75 50,75 C36,75 25,64 25,50 C25,36 36,25 50,25 L93,25 C83,9 67,0 49,0 C25,0 0,20 0,50 z</param> <param name='color'>rgb(1.0000, 1.0000, 1.0000)</param> </params> </node> </node> <node operation='gegl:translate'> <params> <param name='x'>264</param> <param name='y'>0</param> </params> </node> <node operation='gegl:dropshadow'> <params> <param name='opacity'>1.2</param> <param name='x'>0</param> <param name='y'>0</param> <param name='radius'>8</param> </params> </node> <node operation='gegl:fill-path'> <params> <param name='d'>M30,4 C12,13 0,30 0,50 C0,78 23,100 50,100 C71,100 88,88 96,71 L56,71 C42,71 30,59 30,45 L30,4 z</param> <param name='color'>rgb(1.0000, 1.0000, 1.0000)</param> </params> </node> </node> <node operation='gegl:rotate'> <params> <param name='origin-x'>0</param> <param name='origin-y'>0</param> <param name='sampler'>linear</param>  <param name='degrees'>42</param> </params> </node> <node operation='gegl:checkerboard'> <params> <param name='x'>43</param> <param name='y'>44</param> <param name='x-offset'>0</param> <param name='y-offset'>0</param> <param name='color1'>rgb(0.7097, 0.7097, 0.7097)</param> <param name='color2'>rgb(0.7661, 0.7661, 0.7661)</param> </params> </node> </gegl>"
+
+#define STDIN_BUF_SIZE 128
+#define BATCH_LINE_SIZE 8192
+
+static void
+gegl_enable_fatal_warnings (void)
+{
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+
+  g_log_set_always_fatal (fatal_mask);
+}
+
+static gboolean file_is_gegl_xml (const gchar *path)
+{
+  gchar *extension;
+
+  extension = strrchr (path, '.');
+  if (!extension)
+    return FALSE;
+  extension++;
+  if (extension[0]=='\0')
+    return FALSE;
+  if (!strcmp (extension, "xml")||
+      !strcmp (extension, "XML")||
+      !strcmp (extension, "svg")
+      )
+    return TRUE;
+  return FALSE;
+}
+
+/* Chains the operations given after -- to the output of the graph */
+static void
+append_operations (GeglNode  *gegl,
+                   gchar    **operation)
+{
+  GeglNode *proxy;
+  GeglNode *iter;
+
+  proxy = gegl_node_get_output_proxy (gegl, "output");
+  iter = gegl_node_get_producer (proxy, "input", NULL);
+
+  while (*operation)
+    {
+      GeglNode *new;
+
+      new = gegl_node_new_child (gegl, "operation", *operation, NULL);
+      if (iter)
+        {
+          gegl_node_link_many (iter, new, proxy, NULL);
+        }
+      else
+        {
+          gegl_node_link_many (new, proxy, NULL);
+        }
+      iter = new;
+      operation++;
+    }
+}
+
+/* Returns the first node of the graph using operation, depth first */
+static GeglNode *
+find_operation (GeglNode    *node,
+                const gchar *operation)
+{
+  GSList   *children;
+  GSList   *iter;
+  GeglNode *found = NULL;
+
+  if (!g_strcmp0 (gegl_node_get_operation (node), operation))
+    return node;
+
+  children = gegl_node_get_children (node);
+  for (iter = children; iter && !found; iter = iter->next)
+    found = find_operation (iter->data, operation);
+  g_slist_free (children);
+
+  return found;
+}
+
+/* Batch mode: every worker thread builds the graph once, and then only
+ * changes the paths of its loader and saver for every image it takes
+ * from the queue. The reader of the manifest waits for a free slot
+ * before queueing an image, so that a long manifest read from stdin does
+ * not pile up in memory.
+ *
+ * The savers only warn when they fail, so an image is saved to a
+ * temporary file next to its output first, and renamed once it was
+ * written.
+ */
+
+typedef struct
+{
+  gchar *input;
+  gchar *output;
+} BatchItem;
+
+typedef struct
+{
+  GeglOptions  *o;
+  const gchar  *script;
+  const gchar  *path_root;
+  GAsyncQueue  *items;
+  GAsyncQueue  *slots;
+  gint          n_failed;
+  gint          invalid;   /* set when the composition can't be used */
+} Batch;
+
+static BatchItem batch_end;  /* pushed once for every worker to stop it */
+static gint      batch_tmp;  /* numbers the temporary files */
+
+/* Saves the output of the graph with its gegl:save node save to path,
+ * returns FALSE if nothing was written
+ */
+static gboolean
+batch_save (GeglNode    *save,
+            const gchar *path)
+{
+  gchar    *dirname  = g_path_get_dirname (path);
+  gchar    *basename = g_path_get_basename (path);
+  gchar    *tmp_name;
+  gchar    *tmp_path;
+  GStatBuf  stat_buf;
+  gboolean  saved;
+
+  /* ending in the basename keeps the extension that picks the saver */
+  tmp_name = g_strdup_printf (".gegl-batch-%08x-%d-%s", g_random_int (),
+                              g_atomic_int_add (&batch_tmp, 1), basename);
+  tmp_path = g_build_filename (dirname, tmp_name, NULL);
+
+  gegl_node_set (save, "path", tmp_path, NULL);
+  gegl_node_process (save);
+
+  /* renaming over an existing file fails on Windows */
+  saved = g_stat (tmp_path, &stat_buf) == 0 && stat_buf.st_size > 0 &&
+          (g_rename (tmp_path, path) == 0 ||
+           (g_unlink (path) == 0 && g_rename (tmp_path, path) == 0));
+
+  if (!saved)
+    g_unlink (tmp_path);
+
+  g_free (tmp_path);
+  g_free (tmp_name);
+  g_free (basename);
+  g_free (dirname);
+
+  return saved;
+}
+
+static gpointer
+batch_worker (gpointer data)
+{
+  Batch     *batch = data;
+  GeglNode  *gegl;
+  GeglNode  *load = NULL;
+  GeglNode  *save = NULL;
+  BatchItem *item;
+
+  gegl = gegl_node_new_from_xml (batch->script, batch->path_root);
+  if (gegl)
+    {
+      if (batch->o->rest)
+        append_operations (gegl, batch->o->rest);
+
+      load = find_operation (gegl, "gegl:load");
+      save = gegl_node_new_child (gegl, "operation", "gegl:save", NULL);
+      gegl_node_connect_from (save, "input", gegl, "output");
+    }
+
+  /* report a broken composition once, not once per worker */
+  if (!load && g_atomic_int_compare_and_exchange (&batch->invalid, 0, 1))
+    {
+      if (gegl)
+        g_print (_("The composition has no gegl:load for the batch, abort.\n"));
+      else
+        g_print (_("Invalid graph, abort.\n"));
+    }
+
+  while ((item = g_async_queue_pop (batch->items)) != &batch_end)
+    {
+      gint64   start  = g_get_monotonic_time ();
+      gboolean failed = TRUE;
+
+      if (load && item->output)
+        {
+          GeglRectangle bounds;
+
+          gegl_node_set (load, "path", item->input, NULL);
+          bounds = gegl_node_get_bounding_box (gegl);
+
+          if (bounds.width > 0 && bounds.height > 0)
+            failed = !batch_save (save, item->output);
+        }
+
+      if (failed)
+        g_atomic_int_inc (&batch->n_failed);
+
+      g_print ("%s\t%s\t%.3f\t%s\n",
+               item->input,
+               item->output ? item->output : "",
+               (g_get_monotonic_time () - start) / 1000000.0,
+               failed ? "failed" : "ok");
+
+      g_free (item->input);
+      g_free (item->output);
+      g_free (item);
+
+      g_async_queue_push (batch->slots, GINT_TO_POINTER (1));
+    }
+
+  if (gegl)
+    g_object_unref (gegl);
+
+  return NULL;
+}
+
+/* Returns the output path for a manifest line without one, from the %s
+ * template given with -o, or NULL if there is no such template.
+ */
+static gchar *
+batch_output_path (const gchar *template,
+                   const gchar *input)
+{
+  gchar  *basename;
+  gchar  *extension;
+  gchar **parts;
+  gchar  *output;
+
+  if (!template || !strstr (template, "%s"))
+    return NULL;
+
+  basename = g_path_get_basename (input);
+  extension = strrchr (basename, '.');
+  if (extension && extension != basename)
+    *extension = '\0';
+
+  parts = g_strsplit (template, "%s", -1);
+  output = g_strjoinv (basename, parts);
+
+  g_strfreev (parts);
+  g_free (basename);
+
+  return output;
+}
+
+static gint
+run_batch (GeglOptions *o,
+           const gchar *script,
+           const gchar *path_root)
+{
+  Batch     batch = { 0, };
+  GThread **workers;
+  FILE     *manifest;
+  gchar     line[BATCH_LINE_SIZE];
+  gint64    start = g_get_monotonic_time ();
+  gint      n_items = 0;
+  gint      n_lines = 0;
+  gint      i;
+
+  if (!strcmp (o->batch, "-"))
+    manifest = stdin;
+  else
+    manifest = fopen (o->batch, "r");
+
+  if (!manifest)
+    {
+      g_printerr (_("Unable to open batch file: %s\n"), o->batch);
+      return 1;
+    }
+
+  batch.o         = o;
+  batch.script    = script;
+  batch.path_root = path_root;
+  batch.items     = g_async_queue_new ();
+  batch.slots     = g_async_queue_new ();
+
+  for (i = 0; i < o->jobs * 2; i++)
+    g_async_queue_push (batch.slots, GINT_TO_POINTER (1));
+
+  workers = g_new (GThread *, o->jobs);
+  for (i = 0; i < o->jobs; i++)
+    workers[i] = g_thread_new ("gegl batch", batch_worker, &batch);
+
+  while (!g_atomic_int_get (&batch.invalid) &&
+         fgets (line, sizeof (line), manifest))
+    {
+      BatchItem *item;
+      gchar     *tab;
+      gsize      length = strlen (line);
+
+      /* fgets () splits longer lines, reject them instead of reading the
+       * rest as another image
+       */
+      if (length == sizeof (line) - 1 && line[length - 1] != '\n' &&
+          !feof (manifest))
+        {
+          g_printerr (_("Line %d of the batch file is longer than %d "
+                        "characters, skipped\n"),
+                      n_lines + 1, BATCH_LINE_SIZE - 2);
+
+          while (fgets (line, sizeof (line), manifest) &&
+                 line[strlen (line) - 1] != '\n');
+
+          g_atomic_int_inc (&batch.n_failed);
+          n_lines++;
+          n_items++;
+          continue;
+        }
+      n_lines++;
+
+      g_strchomp (line);
+      if (line[0] == '\0' || line[0] == '#')
+        continue;
+
+      item = g_new0 (BatchItem, 1);
+
+      tab = strchr (line, '\t');
+      if (tab)
+        {
+          *tab = '\0';
+          item->output = g_strdup (tab + 1);
+        }
+      else
+        {
+          item->output = batch_output_path (o->output, line);
+        }
+      item->input = g_strdup (line);
+
+      if (!item->output)
+        g_printerr (_("No output path for %s, give one in the batch file "
+                      "or a -o path containing %%s\n"), item->input);
+
+      g_async_queue_pop (batch.slots);
+      g_async_queue_push (batch.items, item);
+      n_items++;
+    }
+
+  if (manifest != stdin)
+    fclose (manifest);
+
+  for (i = 0; i < o->jobs; i++)
+    g_async_queue_push (batch.items, &batch_end);
+  for (i = 0; i < o->jobs; i++)
+    g_thread_join (workers[i]);
+
+  g_printerr (_("%d images, %d failed, %.3f seconds\n"),
+              n_items, batch.n_failed,
+              (g_get_monotonic_time () - start) / 1000000.0);
+
+  g_free (workers);
+  g_async_queue_unref (batch.items);
+  g_async_queue_unref (batch.slots);
+
+  return (batch.n_failed || batch.invalid) ? 1 : 0;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglOptions *o         = NULL;
+  GeglNode    *gegl      = NULL;
+  gchar       *script    = NULL;
+  GError      *err       = NULL;
+  gchar       *path_root = NULL;
+  gint         status    = 0;
+
+  g_object_set (gegl_config (),
+                "application-license", "GPL3",
+                NULL);
+
+  gegl_init (&argc, &argv);
+#ifdef HAVE_SPIRO
+  gegl_path_spiro_init ();
+#endif
+  gegl_path_smooth_init ();
+
+  o = gegl_options_parse (argc, argv);
+
+  if (o->fatal_warnings)
+    {
+      gegl_enable_fatal_warnings ();
+    }
+
+  if (o->xml)
+    {
+      path_root = g_get_current_dir ();
+    }
+  else if (o->file)
+    {
+      if (!strcmp (o->file, "-"))  /* read XML from stdin */
+        {
+          path_root = g_get_current_dir ();
+        }
+      else
+        {
+          gchar *tmp = g_path_get_dirname (o->file);
+          gchar *tmp2 = realpath (tmp, NULL);
+          path_root = g_strdup (tmp2);
+          g_free (tmp);
+          free (tmp2); /* don't use g_free - realpath isn't glib */
+        }
+    }
+
+  if (o->xml)
+    {
+      script = g_strdup (o->xml);
+    }
+  else if (o->file)
+    {
+      if (!strcmp (o->file, "-"))  /* read XML from stdin */
+        {
+          gchar buf[STDIN_BUF_SIZE];
+          GString *acc = g_string_new ("");
+
+          while (fgets (buf, STDIN_BUF_SIZE, stdin))
+            {
+              g_string_append (acc, buf);
+            }
+          script = g_string_free (acc, FALSE);
+        }
+      else if (file_is_gegl_xml (o->file))
+        {
+          g_file_get_contents (o->file, &script, NULL, &err);
+          if (err != NULL)
+            {
+              g_warning (_("Unable to read file: %s"), err->message);
+            }
+        }
+      else
+        {
+          gchar *file_basename = g_path_get_basename (o->file);
+
+          script = g_strconcat ("<gegl><gegl:load path='",
+                                file_basename,
+                                "'/></gegl>",
+                                NULL);
+
+          g_free (file_basename);
+        }
+    }
+  else
+    {
+      if (o->rest && o->mode == GEGL_RUN_MODE_BATCH)
+        {
+          /* the operations process the images of the batch */
+          script = g_strdup ("<gegl><gegl:load path=''/></gegl>");
+        }
+      else if (o->rest)
+        {
+          script = g_strdup ("<gegl></gegl>");
+        }
+      else
+        {
+          script = g_strdup (DEFAULT_COMPOSITION);
+        }
+    }
+
+  /* every batch worker builds its own graph from the script */
+  if (o->mode == GEGL_RUN_MODE_BATCH)
+    {
+      status = run_batch (o, script, path_root);
+      goto out;
+    }
+
+  gegl = gegl_node_new_from_xml (script, path_root);
+
+  if (!gegl)
+    {
+      g_print (_("Invalid graph, abort.\n"));
+      return 1;
+    }
+
+  if (o->rest)
+    {
+      append_operations (gegl, o->rest);
+    }
+
+  switch (o->mode)
+    {
+      case GEGL_RUN_MODE_DISPLAY:
+        {
+          GeglNode *output = gegl_node_new_child (gegl,
+                                                  "operation", "gegl:display",
+                                                  o->file ? "window-title" : NULL, o->file,
+                                                  NULL);
+          gegl_node_connect_from (output, "input", gegl_node_get_output_proxy (gegl, "output"), "output");
+          gegl_node_process (output);
+          g_main_loop_run (g_main_loop_new (NULL, TRUE));
+          g_object_unref (output);
+        }
+        break;
+      case GEGL_RUN_MODE_XML:
+        g_printf ("%s\n", gegl_node_to_xml (gegl, path_root));
+        return 0;
+        break;
+
+      case GEGL_RUN_MODE_OUTPUT:
+        {
+          GeglNode *output = gegl_node_new_child (gegl,
+                                                  "operation", "gegl:save",
+                                                  "path", o->output,
+                                                  NULL);
+
+          if (o->scale != 1.0){
+            GeglRectangle bounds = gegl_node_get_bounding_box (gegl);
+            GeglBuffer *tempb;
+            GeglNode *n0;
+
+            guchar *temp;
+            
+            bounds.x *= o->scale;
+            bounds.y *= o->scale;
+            bounds.width *= o->scale;
+            bounds.height *= o->scale;
+            temp = gegl_malloc (bounds.width * bounds.height * 4);
+            tempb = gegl_buffer_new (&bounds, babl_format("R'G'B'A u8"));
+            gegl_node_blit (gegl, o->scale, &bounds, babl_format("R'G'B'A u8"), temp, GEGL_AUTO_ROWSTRIDE,
+                            GEGL_BLIT_DEFAULT);
+
+            gegl_buffer_set (tempb, &bounds, 0.0, babl_format ("R'G'B'A u8"),
+                             temp, GEGL_AUTO_ROWSTRIDE);
+
+            n0 = gegl_node_new_child (gegl, "operation", "gegl:buffer-source",
+                                            "buffer", tempb,
+                                            NULL);
+            gegl_node_connect_from (output, "input", n0, "output");
+            gegl_node_process (output);
+            gegl_free (temp);
+            g_object_unref (tempb);
+          }
+          else
+          {
+            gegl_node_connect_from (output, "input", gegl, "output");
+            gegl_node_process (output);
+          }
+          
+          g_object_unref (output);
+        }
+        break;
+
+      case GEGL_RUN_MODE_HELP:
+        break;
+
+      default:
+        g_warning (_("Unknown GeglOption mode: %d"), o->mode);
+        break;
+    }
+
+  g_object_unref (gegl);
+
+ out:
+  g_list_free_full (o->files, g_free);
+  g_free (o);
+  g_free (script);
+  g_clear_error (&err);
+  g_free (path_root);
+  gegl_exit ();
+  return status;
+}
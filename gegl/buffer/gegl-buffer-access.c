@@ -38,6 +38,7 @@
 #include "gegl-buffer-iterator.h"
 #include "gegl-buffer-cl-cache.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
 
 static void gegl_buffer_iterate_read_fringed (GeglBuffer          *buffer,
                                               const GeglRectangle *roi,
@@ -431,6 +432,7 @@ gegl_buffer_iterate_write (GeglBuffer          *buffer,
 
           if (fish)
             {
+              GEGL_TRACE_START ();
               for (row = offsety;
                    row < tile_height &&
                      y < height &&
@@ -443,11 +445,14 @@ gegl_buffer_iterate_write (GeglBuffer          *buffer,
                     {
                       babl_process (fish, bp + lskip * bpx_size, tp + lskip * px_size,
                                     pixels - lskip - rskip);
+                      gegl_instrument_count (GEGL_INSTRUMENT_BYTES_CONVERTED,
+                                             (pixels - lskip - rskip) * px_size);
                     }
 
                   tp += tile_stride;
                   bp += buf_stride;
                 }
+              GEGL_TRACE_END ("babl", "convert");
             }
           else
             {
@@ -588,6 +593,7 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
           guchar   *bp, *tile_base, *tp;
           gint      pixels, row, y;
           GeglTile *tile;
+          long      convert_start = 0;
 
           bp = buf + bufy * buf_stride + bufx * bpx_size;
 
@@ -611,13 +617,20 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
           tile_base = gegl_tile_get_data (tile);
           tp        = ((guchar *) tile_base) + (offsety * tile_width + offsetx) * px_size;
 
+          if (fish && gegl_trace_enabled)
+            convert_start = gegl_ticks ();
+
           y = bufy;
           for (row = offsety;
                row < tile_height && y < height;
                row++, y++)
             {
               if (fish)
-                babl_process (fish, tp, bp, pixels);
+                {
+                  babl_process (fish, tp, bp, pixels);
+                  gegl_instrument_count (GEGL_INSTRUMENT_BYTES_CONVERTED,
+                                         pixels * bpx_size);
+                }
               else
                 memcpy (bp, tp, pixels * px_size);
 
@@ -625,6 +638,10 @@ gegl_buffer_iterate_read_simple (GeglBuffer          *buffer,
               bp += buf_stride;
             }
 
+          if (fish && gegl_trace_enabled)
+            real_gegl_trace ("babl", "convert", convert_start,
+                             gegl_ticks () - convert_start);
+
           gegl_tile_unref (tile);
           bufx += (tile_width - offsetx);
         }
@@ -86,6 +86,10 @@ struct _GeglBufferClass
 
 gint              gegl_buffer_leaks       (void);
 
+/* the number of buffers and tiles currently allocated */
+gint              gegl_buffer_get_n_alive (void);
+gint              gegl_tile_get_n_alive   (void);
+
 void              gegl_buffer_stats       (void);
 
 const gchar      *gegl_swap_dir           (void);
@@ -48,6 +48,7 @@
 #include "gegl-tile-backend-ram.h"
 #include "gegl-types-internal.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
 #include "gegl-buffer-cl-cache.h"
 
 #ifdef GEGL_ENABLE_DEBUG
@@ -320,6 +321,13 @@ gegl_buffer_stats (void)
              allocated_buffers, de_allocated_buffers, allocated_buffers - de_allocated_buffers);
 }
 
+gint
+gegl_buffer_get_n_alive (void)
+{
+  return g_atomic_int_get (&allocated_buffers) -
+         g_atomic_int_get (&de_allocated_buffers);
+}
+
 gint
 gegl_buffer_leaks (void)
 {
@@ -409,7 +417,7 @@ gegl_buffer_finalize (GObject *object)
 #endif
 
   g_free (GEGL_BUFFER (object)->path);
-  de_allocated_buffers++;
+  g_atomic_int_inc (&de_allocated_buffers);
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -917,7 +925,7 @@ gegl_buffer_init (GeglBuffer *buffer)
 
   ((GeglTileSource*)buffer)->command = gegl_buffer_command;
 
-  allocated_buffers++;
+  g_atomic_int_inc (&allocated_buffers);
 
 #ifdef GEGL_ENABLE_DEBUG
   if (DEBUG_ALLOCATIONS)
@@ -1217,12 +1225,14 @@ gegl_buffer_get_tile (GeglBuffer *buffer,
 
   g_assert (source);
 
+  gegl_instrument_count (GEGL_INSTRUMENT_TILES_FETCHED, 1);
+
   if (threaded)
   {
     GeglTileStorage *tile_storage = buffer->tile_storage;
     g_assert (tile_storage);
 
-    g_rec_mutex_lock (&tile_storage->mutex);
+    gegl_trace_rec_mutex_lock (&tile_storage->mutex, "tile storage");
 
     tile = gegl_tile_source_command (source, GEGL_TILE_GET,
                                      x, y, z, NULL);
@@ -42,6 +42,7 @@
 #include "gegl-tile-backend-swap.h"
 #include "gegl-debug.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
 
 
 #ifndef HAVE_FSYNC
@@ -151,30 +152,44 @@ static gint     in_fd      = -1;
 static gint     out_fd     = -1;
 static guint64  in_offset  = 0;
 static guint64  out_offset = 0;
+/* the gaps and the counters reported by GeglStats are guarded by mutex */
 static GList   *gap_list   = NULL;
+static gint     n_gaps     = 0;
 static guint64  total      = 0;
+static guint64  used       = 0; /* bytes of the swap file holding tiles */
 
 static GThread      *writer_thread = NULL;
 static GQueue       *queue         = NULL;
 static ThreadParams *in_progress   = NULL;
 static gboolean      exit_thread   = FALSE;
+static gint          queued_writes = 0;
+static guint64       queued_total  = 0;
 static GMutex        mutex;
 static GCond         queue_cond;
 
 
+/* must be called with mutex held */
 static void
-gegl_tile_backend_swap_push_queue (ThreadParams *params)
+gegl_tile_backend_swap_push_queue_unlocked (ThreadParams *params)
 {
-  g_mutex_lock (&mutex);
-
   g_queue_push_tail (queue, params);
 
   if (params->operation == OP_WRITE)
-    params->entry->link = g_queue_peek_tail_link (queue);
+    {
+      params->entry->link = g_queue_peek_tail_link (queue);
+      queued_writes++;
+      queued_total += params->length;
+    }
 
   /* wake up the writer thread */
   g_cond_signal (&queue_cond);
+}
 
+static void
+gegl_tile_backend_swap_push_queue (ThreadParams *params)
+{
+  g_mutex_lock (&mutex);
+  gegl_tile_backend_swap_push_queue_unlocked (params);
   g_mutex_unlock (&mutex);
 }
 
@@ -222,6 +237,7 @@ gegl_tile_backend_swap_writer_thread (gpointer ignored)
   while (TRUE)
     {
       ThreadParams *params;
+      guint64       size;
 
       g_mutex_lock (&mutex);
 
@@ -240,17 +256,22 @@ gegl_tile_backend_swap_writer_thread (gpointer ignored)
         {
           in_progress = params;
           params->entry->link = NULL;
+          queued_writes--;
+          queued_total -= params->length;
         }
+      size = total;
 
       g_mutex_unlock (&mutex);
 
       switch (params->operation)
         {
         case OP_WRITE:
+          GEGL_TRACE_START ();
           gegl_tile_backend_swap_write (params);
+          GEGL_TRACE_END ("swap", "write");
           break;
         case OP_TRUNCATE:
-          if (ftruncate (out_fd, total) != 0)
+          if (ftruncate (out_fd, size) != 0)
             g_warning ("failed to resize swap file: %s", g_strerror (errno));
           break;
         }
@@ -304,6 +325,8 @@ gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
       g_mutex_unlock (&mutex);
     }
 
+  GEGL_TRACE_START ();
+
   if (in_offset != offset)
     {
       if (lseek (in_fd, offset, SEEK_SET) < 0)
@@ -331,6 +354,8 @@ gegl_tile_backend_swap_entry_read (GeglTileBackendSwap *self,
       in_offset  += byte_read;
     }
 
+  GEGL_TRACE_END ("swap", "read");
+
   GEGL_NOTE(GEGL_DEBUG_TILE_BACKEND, "read entry %i, %i, %i from %i", entry->x, entry->y, entry->z, (gint)offset);
 }
 
@@ -393,45 +418,47 @@ static guint64
 gegl_tile_backend_swap_find_offset (gint tile_size)
 {
   SwapGap *gap;
-  guint64  offset;
+  GList   *link;
+  guint64  offset = 0;
 
-  if (gap_list)
-    {
-      GList *link = gap_list;
+  g_mutex_lock (&mutex);
 
-      while (link)
-        {
-          guint64 length;
+  for (link = gap_list; link; link = link->next)
+    {
+      guint64 length;
 
-          gap    = link->data;
-          length = gap->end - gap->start;
+      gap    = link->data;
+      length = gap->end - gap->start;
 
-          if (length > tile_size)
-            {
-              offset = gap->start;
-              gap->start += tile_size;
+      if (length > tile_size)
+        {
+          offset = gap->start;
+          gap->start += tile_size;
+          break;
+        }
+      else if (length == tile_size)
+        {
+          offset = gap->start;
+          g_slice_free (SwapGap, gap);
+          n_gaps--;
+          gap_list = g_list_delete_link (gap_list, link);
+          break;
+        }
+    }
 
-              return offset;
-            }
-          else if (length == tile_size)
-            {
-              offset = gap->start;
-              g_slice_free (SwapGap, gap);
-              gap_list = g_list_delete_link (gap_list, link);
+  if (!link)
+    {
+      offset = total;
 
-              return offset;
-            }
+      gegl_tile_backend_swap_resize (total + 32 * tile_size);
 
-          link = link->next;
-        }
+      gap = gegl_tile_backend_swap_gap_new (offset + tile_size, total);
+      gap_list = g_list_append (gap_list, gap);
     }
 
-  offset = total;
-
-  gegl_tile_backend_swap_resize (total + 32 * tile_size);
+  used += tile_size;
 
-  gap = gegl_tile_backend_swap_gap_new (offset + tile_size, total);
-  gap_list = g_list_append (gap_list, gap);
+  g_mutex_unlock (&mutex);
 
   return offset;
 }
@@ -445,6 +472,8 @@ gegl_tile_backend_swap_gap_new (guint64 start,
   gap->start = start;
   gap->end = end;
 
+  n_gaps++;
+
   return gap;
 }
 
@@ -455,26 +484,23 @@ gegl_tile_backend_swap_entry_destroy (GeglTileBackendSwap *self,
   guint64  start, end;
   gint     tile_size = gegl_tile_backend_get_tile_size (GEGL_TILE_BACKEND (self));
   GList   *hlink;
+  GList   *link;
 
-  if (entry->link)
-    {
-      GList *link;
-
-      g_mutex_lock (&mutex);
-
-      if ((link = entry->link))
-        {
-          ThreadParams *queued_op = link->data;
-          g_queue_delete_link (queue, link);
-          gegl_tile_unref (queued_op->tile);
-          g_slice_free (ThreadParams, queued_op);
-        }
+  g_mutex_lock (&mutex);
 
-      g_mutex_unlock (&mutex);
+  if ((link = entry->link))
+    {
+      ThreadParams *queued_op = link->data;
+      g_queue_delete_link (queue, link);
+      queued_writes--;
+      queued_total -= queued_op->length;
+      gegl_tile_unref (queued_op->tile);
+      g_slice_free (ThreadParams, queued_op);
     }
 
   start = entry->offset;
   end = start + tile_size;
+  used -= tile_size;
 
   if ((hlink = gap_list))
     while (hlink)
@@ -497,6 +523,7 @@ gegl_tile_backend_swap_entry_destroy (GeglTileBackendSwap *self,
             lgap->end = hgap->end;
 
             g_slice_free (SwapGap, hgap);
+            n_gaps--;
             hlink->next = NULL;
             hlink->prev = NULL;
             g_list_free (hlink);
@@ -550,10 +577,13 @@ gegl_tile_backend_swap_entry_destroy (GeglTileBackendSwap *self,
     gap_list = g_list_prepend (NULL,
                                gegl_tile_backend_swap_gap_new (start, end));
 
+  g_mutex_unlock (&mutex);
+
   g_hash_table_remove (self->index, entry);
   g_slice_free (SwapEntry, entry);
 }
 
+/* must be called with mutex held */
 static void
 gegl_tile_backend_swap_resize (guint64 size)
 {
@@ -563,7 +593,7 @@ gegl_tile_backend_swap_resize (guint64 size)
   params = g_slice_new0 (ThreadParams);
   params->operation = OP_TRUNCATE;
 
-  gegl_tile_backend_swap_push_queue (params);
+  gegl_tile_backend_swap_push_queue_unlocked (params);
 
   GEGL_NOTE (GEGL_DEBUG_TILE_BACKEND, "pushed resize to %i", (gint)total);
 }
@@ -849,6 +879,8 @@ gegl_tile_backend_swap_cleanup (void)
 
           g_slice_free (SwapGap, gap_list->data);
           g_list_free (gap_list);
+          gap_list = NULL;
+          n_gaps   = 0;
         }
       else
         g_warn_if_fail (total == 0);
@@ -860,6 +892,66 @@ gegl_tile_backend_swap_cleanup (void)
     }
 }
 
+guint64
+gegl_tile_backend_swap_get_total (void)
+{
+  guint64 value;
+
+  g_mutex_lock (&mutex);
+  value = total;
+  g_mutex_unlock (&mutex);
+
+  return value;
+}
+
+guint64
+gegl_tile_backend_swap_get_free (void)
+{
+  guint64 value;
+
+  g_mutex_lock (&mutex);
+  value = total - used;
+  g_mutex_unlock (&mutex);
+
+  return value;
+}
+
+gint
+gegl_tile_backend_swap_get_n_gaps (void)
+{
+  gint value;
+
+  g_mutex_lock (&mutex);
+  value = n_gaps;
+  g_mutex_unlock (&mutex);
+
+  return value;
+}
+
+gint
+gegl_tile_backend_swap_get_queued_writes (void)
+{
+  gint value;
+
+  g_mutex_lock (&mutex);
+  value = queued_writes;
+  g_mutex_unlock (&mutex);
+
+  return value;
+}
+
+guint64
+gegl_tile_backend_swap_get_queued_total (void)
+{
+  guint64 value;
+
+  g_mutex_lock (&mutex);
+  value = queued_total;
+  g_mutex_unlock (&mutex);
+
+  return value;
+}
+
 static void
 gegl_tile_backend_swap_init (GeglTileBackendSwap *self)
 {
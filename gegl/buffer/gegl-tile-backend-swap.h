@@ -48,6 +48,15 @@ struct _GeglTileBackendSwap
 
 GType gegl_tile_backend_swap_get_type (void) G_GNUC_CONST;
 
+/* State of the shared swap file, reported by GeglStats. The values are
+ * changed and read with the mutex of the swap file held.
+ */
+guint64 gegl_tile_backend_swap_get_total         (void);
+guint64 gegl_tile_backend_swap_get_free          (void);
+gint    gegl_tile_backend_swap_get_n_gaps        (void);
+gint    gegl_tile_backend_swap_get_queued_writes (void);
+guint64 gegl_tile_backend_swap_get_queued_total  (void);
+
 G_END_DECLS
 
 #endif
@@ -24,6 +24,7 @@
 #include "gegl.h"
 #include "gegl-types-internal.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
 #include "gegl-buffer.h"
 #include "gegl-buffer-private.h"
 #include "gegl-tile.h"
@@ -33,10 +34,6 @@
 
 #include "gegl-buffer-cl-cache.h"
 
-/*
-#define GEGL_DEBUG_CACHE_HITS
-*/
-
 typedef struct CacheItem
 {
   GeglTileHandlerCache *handler; /* The specific handler that cached this item*/
@@ -89,10 +86,12 @@ static GQueue      *cache_queue           = NULL;
 static GHashTable  *cache_ht              = NULL;
 static gint         cache_wash_percentage = 20;
 static guint64      cache_total           = 0; /* approximate amount of bytes stored */
-#ifdef GEGL_DEBUG_CACHE_HITS
-static gint         cache_hits            = 0;
-static gint         cache_misses          = 0;
-#endif
+/* counted atomically, without the mutex; GLib has no 64 bit atomics, so
+ * they are pointer sized
+ */
+static gsize        cache_hits            = 0;
+static gsize        cache_misses          = 0;
+static gsize        cache_evictions       = 0;
 
 
 G_DEFINE_TYPE (GeglTileHandlerCache, gegl_tile_handler_cache, GEGL_TYPE_TILE_HANDLER)
@@ -180,15 +179,9 @@ gegl_tile_handler_cache_get_tile_command (GeglTileSource *tile_store,
 
   tile = gegl_tile_handler_cache_get_tile (cache, x, y, z);
   if (tile)
-    {
-#ifdef GEGL_DEBUG_CACHE_HITS
-      cache_hits++;
-#endif
-      return tile;
-    }
-#ifdef GEGL_DEBUG_CACHE_HITS
-  cache_misses++;
-#endif
+    return tile;
+
+  GEGL_TRACE_START ();
 
   if (source)
     tile = gegl_tile_source_get_tile (source, x, y, z);
@@ -196,6 +189,8 @@ gegl_tile_handler_cache_get_tile_command (GeglTileSource *tile_store,
   if (tile)
     gegl_tile_handler_cache_insert (cache, tile, x, y, z);
 
+  GEGL_TRACE_END ("tile", "cache miss");
+
   return tile;
 }
 
@@ -334,12 +329,17 @@ gegl_tile_handler_cache_get_tile (GeglTileHandlerCache *cache,
   CacheItem *result;
 
   if (cache->count == 0)
-    return NULL;
+    {
+      g_atomic_pointer_add (&cache_misses, 1);
+      return NULL;
+    }
 
-  g_mutex_lock (&mutex);
+  gegl_trace_mutex_lock (&mutex, "tile cache");
   result = cache_lookup (cache, x, y, z);
   if (result)
     {
+      gegl_instrument_count (GEGL_INSTRUMENT_CACHE_HITS, 1);
+      g_atomic_pointer_add (&cache_hits, 1);
       g_queue_unlink (cache_queue, &result->link);
       g_queue_push_head_link (cache_queue, &result->link);
       g_mutex_unlock (&mutex);
@@ -352,24 +352,36 @@ gegl_tile_handler_cache_get_tile (GeglTileHandlerCache *cache,
       return gegl_tile_ref (result->tile);
     }
   g_mutex_unlock (&mutex);
+  g_atomic_pointer_add (&cache_misses, 1);
   return NULL;
 }
 
+/* like gegl_tile_handler_cache_get_tile (), without counting the lookup as
+ * a hit or miss of the cache
+ */
 static gboolean
 gegl_tile_handler_cache_has_tile (GeglTileHandlerCache *cache,
                                   gint                  x,
                                   gint                  y,
                                   gint                  z)
 {
-  GeglTile *tile = gegl_tile_handler_cache_get_tile (cache, x, y, z);
+  CacheItem *result;
+  gboolean   found = FALSE;
 
-  if (tile)
+  if (cache->count == 0)
+    return FALSE;
+
+  g_mutex_lock (&mutex);
+  result = cache_lookup (cache, x, y, z);
+  if (result)
     {
-      gegl_tile_unref (tile);
-      return TRUE;
+      g_queue_unlink (cache_queue, &result->link);
+      g_queue_push_head_link (cache_queue, &result->link);
+      found = result->tile != NULL;
     }
+  g_mutex_unlock (&mutex);
 
-  return FALSE;
+  return found;
 }
 
 static gboolean
@@ -388,6 +400,7 @@ gegl_tile_handler_cache_trim (GeglTileHandlerCache *cache)
       last_writable->handler->items = g_slist_remove (last_writable->handler->items, last_writable);
       g_hash_table_remove (cache_ht, last_writable);
       cache_total -= tile->size;
+      g_atomic_pointer_add (&cache_evictions, 1);
 
       if (storage && storage->hot_tile == tile)
         {
@@ -498,10 +511,8 @@ gegl_tile_handler_cache_insert (GeglTileHandlerCache *cache,
 
   while (cache_total > gegl_config()->tile_cache_size)
     {
-#ifdef GEGL_DEBUG_CACHE_HITS
-      GEGL_NOTE(GEGL_DEBUG_CACHE, "cache_total:"G_GUINT64_FORMAT" > cache_size:"G_GUINT64_FORMAT, cache_total, gegl_config()->tile_cache_size);
-      GEGL_NOTE(GEGL_DEBUG_CACHE, "%f%% hit:%i miss:%i  %i]", cache_hits*100.0/(cache_hits+cache_misses), cache_hits, cache_misses, g_queue_get_length (cache_queue));
-#endif
+      GEGL_NOTE(GEGL_DEBUG_CACHE, "cache_total:%"G_GUINT64_FORMAT" > cache_size:%"G_GUINT64_FORMAT, cache_total, gegl_config()->tile_cache_size);
+      GEGL_NOTE(GEGL_DEBUG_CACHE, "%f%% hit:%"G_GSIZE_FORMAT" miss:%"G_GSIZE_FORMAT"  %i]", cache_hits*100.0/MAX (cache_hits+cache_misses, 1), cache_hits, cache_misses, g_queue_get_length (cache_queue));
       gegl_tile_handler_cache_trim (cache);
     }
   g_mutex_unlock (&mutex);
@@ -577,3 +588,34 @@ gegl_tile_cache_destroy (void)
   cache_queue = NULL;
   cache_ht = NULL;
 }
+
+/* cache_total is changed with the mutex held, and read so too */
+guint64
+gegl_tile_handler_cache_get_total (void)
+{
+  guint64 value;
+
+  g_mutex_lock (&mutex);
+  value = cache_total;
+  g_mutex_unlock (&mutex);
+
+  return value;
+}
+
+guint64
+gegl_tile_handler_cache_get_hits (void)
+{
+  return (gsize) g_atomic_pointer_get (&cache_hits);
+}
+
+guint64
+gegl_tile_handler_cache_get_misses (void)
+{
+  return (gsize) g_atomic_pointer_get (&cache_misses);
+}
+
+guint64
+gegl_tile_handler_cache_get_evictions (void)
+{
+  return (gsize) g_atomic_pointer_get (&cache_evictions);
+}
@@ -58,4 +58,10 @@ void              gegl_tile_handler_cache_insert   (GeglTileHandlerCache *cache,
                                                     gint                  y,
                                                     gint                  z);
 
+/* counters of all caches, reported by GeglStats */
+guint64           gegl_tile_handler_cache_get_total     (void);
+guint64           gegl_tile_handler_cache_get_hits      (void);
+guint64           gegl_tile_handler_cache_get_misses    (void);
+guint64           gegl_tile_handler_cache_get_evictions (void);
+
 #endif
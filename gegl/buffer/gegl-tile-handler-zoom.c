@@ -78,6 +78,8 @@ static inline void set_half (GeglTile   * dst_tile,
   gegl_downscale_2x2 (format, width, height, src_data, width * bpp, dst_data, width * bpp);
 }
 
+static gint zoom_tiles = 0; /* mipmap tiles built by all zoom handlers */
+
 static GeglTile *
 get_tile (GeglTileSource *gegl_tile_source,
           gint            x,
@@ -150,9 +152,17 @@ get_tile (GeglTileSource *gegl_tile_source,
     gegl_tile_unlock (tile);
   }
 
+  g_atomic_int_inc (&zoom_tiles);
+
   return tile;
 }
 
+guint
+gegl_tile_handler_zoom_get_n_built (void)
+{
+  return g_atomic_int_get (&zoom_tiles);
+}
+
 static gpointer
 gegl_tile_handler_zoom_command (GeglTileSource  *tile_store,
                                 GeglTileCommand  command,
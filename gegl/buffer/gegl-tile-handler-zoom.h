@@ -55,6 +55,9 @@ GType             gegl_tile_handler_zoom_get_type (void) G_GNUC_CONST;
 
 GeglTileHandler * gegl_tile_handler_zoom_new      (GeglTileBackend *backend);
 
+/* the number of mipmap tiles built so far, reported by GeglStats */
+guint             gegl_tile_handler_zoom_get_n_built (void);
+
 G_END_DECLS
 
 #endif
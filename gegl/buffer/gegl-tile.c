@@ -47,6 +47,8 @@ GeglTile *gegl_tile_ref (GeglTile *tile)
 
 static int free_data_directly;
 
+static gint n_tiles = 0; /* tiles allocated and not freed yet */
+
 void gegl_tile_unref (GeglTile *tile)
 {
   if (!g_atomic_int_dec_and_test (&tile->ref_count))
@@ -84,6 +86,7 @@ void gegl_tile_unref (GeglTile *tile)
     g_mutex_unlock (&cowmutex);
 
   g_slice_free (GeglTile, tile);
+  g_atomic_int_add (&n_tiles, -1);
 }
 
 
@@ -104,9 +107,17 @@ gegl_tile_new_bare (void)
   tile->destroy_notify = (void*)&free_data_directly;
   tile->destroy_notify_data = NULL;
 
+  g_atomic_int_inc (&n_tiles);
+
   return tile;
 }
 
+gint
+gegl_tile_get_n_alive (void)
+{
+  return g_atomic_int_get (&n_tiles);
+}
+
 GeglTile *
 gegl_tile_dup (GeglTile *src)
 {
@@ -33,6 +33,7 @@
 #include "graph/gegl-visitor.h"
 #include "gegl-dot.h"
 #include "gegl-dot-visitor.h"
+#include "gegl-instrument.h"
 #include "gegl.h"
 
 void
@@ -75,6 +76,26 @@ gegl_dot_util_add_node (GString  *string,
   /* The second row is the operation name such as gegl:translate */
   g_string_append_printf (string, "%s |", gegl_node_get_debug_name (node));
 
+  /* When profiling, a row with where the time and work went */
+  if (gegl_instrument_enabled)
+    {
+      GeglInstrumentTotals totals;
+
+      if (gegl_instrument_get_node_totals (node, &totals))
+        g_string_append_printf (string,
+                                "%.3fms in %i calls, %i chunks\\n"
+                                "%" G_GINT64_FORMAT " px, "
+                                "%" G_GINT64_FORMAT " tiles, "
+                                "%" G_GINT64_FORMAT " cache hits, "
+                                "%" G_GINT64_FORMAT " bytes converted |",
+                                totals.usecs / 1000.0,
+                                totals.calls, totals.chunks,
+                                totals.pixels,
+                                totals.counters[GEGL_INSTRUMENT_TILES_FETCHED],
+                                totals.counters[GEGL_INSTRUMENT_CACHE_HITS],
+                                totals.counters[GEGL_INSTRUMENT_BYTES_CONVERTED]);
+    }
+
   /* The next rows are property names and their values */
   if (1)
     {
@@ -102,6 +102,7 @@ guint gegl_debug_flags = 0;
 #include "buffer/gegl-tile-backend-ram.h"
 #include "buffer/gegl-tile-backend-file.h"
 #include "gegl-config.h"
+#include "gegl-stats.h"
 #include "graph/gegl-node-private.h"
 #include "gegl-random-private.h"
 
@@ -113,6 +114,8 @@ static gboolean  gegl_post_parse_hook (GOptionContext *context,
 
 static GeglConfig   *config = NULL;
 
+static GeglStats    *stats = NULL;
+
 static GeglModuleDB *module_db   = NULL;
 
 static glong         global_time = 0;
@@ -401,6 +404,14 @@ GeglConfig *gegl_config (void)
   return config;
 }
 
+GeglStats *gegl_stats (void)
+{
+  if (!stats)
+    stats = g_object_new (GEGL_TYPE_STATS, NULL);
+
+  return stats;
+}
+
 static void swap_clean (void)
 {
   const gchar  *swap_dir = gegl_swap_dir ();
@@ -449,6 +460,8 @@ gegl_exit (void)
       return;
     }
 
+  gegl_trace_stop ();
+
   GEGL_INSTRUMENT_START()
 
   gegl_tile_backend_swap_cleanup ();
@@ -480,11 +493,25 @@ gegl_exit (void)
   global_time = gegl_ticks () - global_time;
   gegl_instrument ("gegl", "gegl", global_time);
 
-  if (gegl_instrument_enabled)
+  /* instrumentation is also enabled for GEGL_INSTRUMENT_JSON alone */
+  if (g_getenv ("GEGL_DEBUG_TIME") != NULL)
     {
-      g_printf ("\n%s", gegl_instrument_utf8 ());
+      gchar *utf8 = gegl_instrument_utf8 ();
+
+      g_printf ("\n%s", utf8);
+      g_free (utf8);
     }
 
+  if (g_getenv ("GEGL_INSTRUMENT_JSON") != NULL)
+    {
+      gchar *json = gegl_instrument_json ();
+
+      g_file_set_contents (g_getenv ("GEGL_INSTRUMENT_JSON"), json, -1, NULL);
+      g_free (json);
+    }
+
+  gegl_instrument_cleanup ();
+
   if (gegl_buffer_leaks ())
     {
       g_printf ("EEEEeEeek! %i GeglBuffers leaked\n", gegl_buffer_leaks ());
@@ -530,6 +557,13 @@ gegl_exit (void)
     }
   g_object_unref (config);
   config = NULL;
+
+  if (stats)
+    {
+      g_object_unref (stats);
+      stats = NULL;
+    }
+
   global_time = 0;
 }
 
@@ -604,6 +638,47 @@ load_module_path(gchar *path, GeglModuleDB *db)
   gegl_module_db_load (db, path);
 }
 
+static void
+module_db_add (GeglModuleDB *db,
+               GeglModule   *module,
+               gpointer      data)
+{
+  gegl_operations_add_module (G_TYPE_MODULE (module));
+}
+
+/* The registry cache of the operations in the modules found in paths,
+ * NULL if GEGL_MODULE_CACHE is set to an empty string.
+ */
+static gchar *
+gegl_module_cache_path (GSList *paths)
+{
+  const gchar *env = g_getenv ("GEGL_MODULE_CACHE");
+  GString     *key;
+  gchar       *checksum;
+  gchar       *basename;
+  gchar       *path;
+
+  if (env)
+    return *env ? g_strdup (env) : NULL;
+
+  /* each set of module paths gets a cache of its own */
+  key = g_string_new (NULL);
+  for (; paths; paths = paths->next)
+    g_string_append_printf (key, "%s%c", (gchar *) paths->data,
+                            G_SEARCHPATH_SEPARATOR);
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, key->str, -1);
+  basename = g_strdup_printf ("operations-%s.cache", checksum);
+  path     = g_build_filename (g_get_user_cache_dir (), GEGL_LIBRARY,
+                               basename, NULL);
+
+  g_string_free (key, TRUE);
+  g_free (checksum);
+  g_free (basename);
+
+  return path;
+}
+
 static gboolean
 gegl_post_parse_hook (GOptionContext *context,
                       GOptionGroup   *group,
@@ -615,9 +690,13 @@ gegl_post_parse_hook (GOptionContext *context,
   g_assert (global_time == 0);
   global_time = gegl_ticks ();
 
-  if (g_getenv ("GEGL_DEBUG_TIME") != NULL)
+  if (g_getenv ("GEGL_DEBUG_TIME") != NULL ||
+      g_getenv ("GEGL_INSTRUMENT_JSON") != NULL)
     gegl_instrument_enable ();
 
+  if (g_getenv ("GEGL_TRACE") != NULL)
+    gegl_trace_start (g_getenv ("GEGL_TRACE"));
+
   gegl_instrument ("gegl", "gegl_init", 0);
 
   config = gegl_config ();
@@ -679,9 +758,26 @@ gegl_post_parse_hook (GOptionContext *context,
   if (!module_db)
     {
       GSList *paths = gegl_get_default_module_paths ();
+      gchar  *cache = gegl_module_cache_path (paths);
+
       module_db = gegl_module_db_new (FALSE);
+
+      if (cache)
+        {
+          gegl_operations_cache_load (cache);
+          gegl_module_db_set_defer_func (module_db,
+                                         gegl_operations_cache_has_module,
+                                         NULL);
+          g_signal_connect (module_db, "add",
+                            G_CALLBACK (module_db_add), NULL);
+        }
+
       g_slist_foreach(paths, (GFunc)load_module_path, module_db);
       g_slist_free_full (paths, g_free);
+
+      if (cache)
+        gegl_operations_cache_save ();
+      g_free (cache);
     }
 
   GEGL_INSTRUMENT_END ("gegl_init", "load modules");
@@ -94,6 +94,41 @@ void          gegl_load_module_directory (const gchar *path);
  */
 GeglConfig   *gegl_config                (void);
 
+/**
+ * gegl_stats:
+ *
+ * Returns a GeglStats object with read-only properties reporting the size,
+ * hits, misses and evictions of the tile cache, the size, free space,
+ * fragmentation and pending writes of the swap file, the number of buffers
+ * and tiles alive, the number of mipmap tiles built and how busy the worker
+ * threads are. Reading the properties is cheap enough to poll them
+ * periodically while GEGL is processing.
+ *
+ * Return value: (transfer none): a #GeglStats
+ */
+GeglStats    *gegl_stats                 (void);
+
+/**
+ * gegl_trace_start:
+ * @path: the file to write the trace to
+ *
+ * Start recording a timeline of processor chunks, node process calls,
+ * thread pool tasks, waits for locks, tile cache misses, swap reads and
+ * writes and pixel format conversions. The timeline is written to @path
+ * in the trace event format loadable in chrome://tracing or Perfetto by
+ * #gegl_trace_stop, or by #gegl_exit. Setting the environment variable
+ * GEGL_TRACE to a path starts tracing when GEGL is initialized.
+ */
+void          gegl_trace_start           (const gchar *path);
+
+/**
+ * gegl_trace_stop:
+ *
+ * Stop recording the timeline started by #gegl_trace_start, and write it.
+ * Should not be called while graphs are processed.
+ */
+void          gegl_trace_stop            (void);
+
 G_END_DECLS
 
 #endif /* __GEGL_INIT_H__ */
@@ -17,8 +17,11 @@
  */
 
 #include "config.h"
-#include <glib.h>
+#include <glib-object.h>
 #include <string.h>
+#include "gegl.h"
+#include "gegl-types-internal.h"
+#include "operation/gegl-operation.h"
 #include "gegl-instrument.h"
 
 long babl_ticks (void);
@@ -39,9 +42,13 @@ struct _Timing
 };
 
 gboolean gegl_instrument_enabled = FALSE;
+gboolean gegl_trace_enabled      = FALSE;
 
 static Timing *root = NULL;
 
+/* protects the timing tree */
+static GMutex timing_mutex;
+
 static Timing *iter_next (Timing *iter)
 {
   if (iter->children)
@@ -104,10 +111,10 @@ gegl_instrument_enable (void)
   gegl_instrument_enabled = TRUE;
 }
 
-void
-real_gegl_instrument (const gchar *parent_name,
-                      const gchar *name,
-                      long         usecs)
+static void
+real_gegl_instrument_unlocked (const gchar *parent_name,
+                               const gchar *name,
+                               long         usecs)
 {
   Timing *iter;
   Timing *parent;
@@ -120,7 +127,7 @@ real_gegl_instrument (const gchar *parent_name,
   parent = timing_find (root, parent_name);
   if (!parent)
     {
-      real_gegl_instrument (root->name, parent_name, 0);
+      real_gegl_instrument_unlocked (root->name, parent_name, 0);
       parent = timing_find (root, parent_name);
     }
   g_assert (parent);
@@ -136,6 +143,16 @@ real_gegl_instrument (const gchar *parent_name,
   iter->usecs += usecs;
 }
 
+void
+real_gegl_instrument (const gchar *parent_name,
+                      const gchar *name,
+                      long         usecs)
+{
+  g_mutex_lock (&timing_mutex);
+  real_gegl_instrument_unlocked (parent_name, name, usecs);
+  g_mutex_unlock (&timing_mutex);
+}
+
 
 static glong timing_child_sum (Timing *timing)
 {
@@ -292,6 +309,583 @@ sort_children (Timing *parent)
     }
 }
 
+static const gchar *counter_names[GEGL_INSTRUMENT_N_COUNTERS] = {
+  "tiles_fetched",
+  "cache_hits",
+  "bytes_converted"
+};
+
+#define RECORDS_PER_BLOCK 1024
+
+typedef struct
+{
+  GeglInstrumentRecordType  type;
+  gconstpointer             node;
+  const gchar              *operation;
+  long                      start;
+  long                      usecs;
+  GeglRectangle             roi;
+  gint64                    counters[GEGL_INSTRUMENT_N_COUNTERS];
+} Record;
+
+typedef struct _RecordBlock RecordBlock;
+
+struct _RecordBlock
+{
+  RecordBlock *next;                        /* older records */
+  gint         n_records;
+  Record       records[RECORDS_PER_BLOCK];
+};
+
+#define EVENTS_PER_BLOCK 4096
+
+typedef struct
+{
+  const gchar *category;
+  const gchar *name;
+  long         start;
+  long         usecs;
+} TraceEvent;
+
+typedef struct _TraceBlock TraceBlock;
+
+struct _TraceBlock
+{
+  TraceBlock *next;                         /* older events */
+  gint        n_events;
+  TraceEvent  events[EVENTS_PER_BLOCK];
+};
+
+typedef struct _ThreadRecords ThreadRecords;
+
+/* Only the owning thread appends records, and publishes them by
+ * atomically updating the block list and counts; readers walk them
+ * without locking.
+ */
+struct _ThreadRecords
+{
+  ThreadRecords *next;
+  gint           thread;
+  RecordBlock   *blocks;                    /* newest first */
+  TraceBlock    *trace_blocks;              /* newest first */
+  gint64         counters[GEGL_INSTRUMENT_N_COUNTERS];
+};
+
+static ThreadRecords *thread_records_list = NULL;
+static gint           n_threads           = 0;
+static GPrivate       thread_records_key;
+
+/* blocks detached by gegl_instrument_reset () and gegl_trace_stop (),
+ * their threads may still be appending to them, they are freed at exit
+ */
+static GMutex       retired_mutex;
+static RecordBlock *retired_blocks       = NULL;
+static TraceBlock  *retired_trace_blocks = NULL;
+
+static ThreadRecords *
+get_thread_records (void)
+{
+  ThreadRecords *records = g_private_get (&thread_records_key);
+
+  if (!records)
+    {
+      records         = g_new0 (ThreadRecords, 1);
+      records->thread = g_atomic_int_add (&n_threads, 1);
+
+      do
+        records->next = g_atomic_pointer_get (&thread_records_list);
+      while (!g_atomic_pointer_compare_and_exchange (&thread_records_list,
+                                                     records->next, records));
+
+      g_private_set (&thread_records_key, records);
+    }
+
+  return records;
+}
+
+void
+real_gegl_instrument_count (GeglInstrumentCounter counter,
+                            gint64                n)
+{
+  get_thread_records ()->counters[counter] += n;
+}
+
+void
+gegl_instrument_span_start (GeglInstrumentSpan *span)
+{
+  ThreadRecords *records = get_thread_records ();
+
+  memcpy (span->counters, records->counters, sizeof (span->counters));
+  span->start = gegl_ticks ();
+}
+
+void
+real_gegl_trace (const gchar *category,
+                 const gchar *name,
+                 long         start,
+                 long         usecs)
+{
+  ThreadRecords *records = get_thread_records ();
+  TraceBlock    *block   = g_atomic_pointer_get (&records->trace_blocks);
+  TraceEvent    *event;
+
+  if (!block || block->n_events == EVENTS_PER_BLOCK)
+    {
+      block           = g_new (TraceBlock, 1);
+      block->n_events = 0;
+
+      /* gegl_trace_stop () may detach the list meanwhile */
+      do
+        block->next = g_atomic_pointer_get (&records->trace_blocks);
+      while (!g_atomic_pointer_compare_and_exchange (&records->trace_blocks,
+                                                     block->next, block));
+    }
+
+  event = &block->events[block->n_events];
+
+  event->category = category;
+  event->name     = name;
+  event->start    = start;
+  event->usecs    = usecs;
+
+  g_atomic_int_set (&block->n_events, block->n_events + 1);
+}
+
+void
+gegl_instrument_span_end (GeglInstrumentSpan       *span,
+                          GeglInstrumentRecordType  type,
+                          GeglOperation            *operation,
+                          const GeglRectangle      *roi)
+{
+  ThreadRecords *records = get_thread_records ();
+  RecordBlock   *block   = g_atomic_pointer_get (&records->blocks);
+  Record        *record;
+  gint           i;
+
+  if (gegl_trace_enabled)
+    real_gegl_trace (type == GEGL_INSTRUMENT_RECORD_PROCESS ? "process" : "task",
+                     GEGL_OPERATION_GET_CLASS (operation)->name,
+                     span->start, gegl_ticks () - span->start);
+
+  if (!gegl_instrument_enabled)
+    return;
+
+  if (!block || block->n_records == RECORDS_PER_BLOCK)
+    {
+      block            = g_new (RecordBlock, 1);
+      block->n_records = 0;
+
+      /* a reset may detach the list meanwhile */
+      do
+        block->next = g_atomic_pointer_get (&records->blocks);
+      while (!g_atomic_pointer_compare_and_exchange (&records->blocks,
+                                                     block->next, block));
+    }
+
+  record = &block->records[block->n_records];
+
+  record->type      = type;
+  record->node      = operation->node;
+  record->operation = GEGL_OPERATION_GET_CLASS (operation)->name;
+  record->start     = span->start;
+  record->usecs     = gegl_ticks () - span->start;
+  record->roi       = *roi;
+
+  /* the work of this span is not counted again in enclosing spans */
+  for (i = 0; i < GEGL_INSTRUMENT_N_COUNTERS; i++)
+    {
+      record->counters[i]  = records->counters[i] - span->counters[i];
+      records->counters[i] = span->counters[i];
+    }
+
+  g_atomic_int_set (&block->n_records, block->n_records + 1);
+}
+
+static void
+totals_add (GeglInstrumentTotals *totals,
+            const Record         *record)
+{
+  gint i;
+
+  if (record->type == GEGL_INSTRUMENT_RECORD_PROCESS)
+    {
+      totals->calls++;
+      totals->usecs  += record->usecs;
+      totals->pixels += (gint64) record->roi.width * record->roi.height;
+    }
+  else
+    {
+      totals->chunks++;
+    }
+
+  for (i = 0; i < GEGL_INSTRUMENT_N_COUNTERS; i++)
+    totals->counters[i] += record->counters[i];
+}
+
+typedef void (* RecordFunc) (const Record *record,
+                             gint          thread,
+                             gpointer      user_data);
+
+static void
+foreach_record (RecordFunc func,
+                gpointer   user_data)
+{
+  ThreadRecords *records;
+
+  for (records = g_atomic_pointer_get (&thread_records_list);
+       records;
+       records = records->next)
+    {
+      RecordBlock *block;
+
+      for (block = g_atomic_pointer_get (&records->blocks);
+           block;
+           block = block->next)
+        {
+          gint n_records = g_atomic_int_get (&block->n_records);
+          gint i;
+
+          for (i = 0; i < n_records; i++)
+            func (&block->records[i], records->thread, user_data);
+        }
+    }
+}
+
+typedef struct
+{
+  gconstpointer         node;
+  GeglInstrumentTotals *totals;
+  gboolean              found;
+} NodeTotalsData;
+
+static void
+node_totals_func (const Record *record,
+                  gint          thread,
+                  gpointer      user_data)
+{
+  NodeTotalsData *data = user_data;
+
+  if (record->node == data->node)
+    {
+      totals_add (data->totals, record);
+      data->found = TRUE;
+    }
+}
+
+gboolean
+gegl_instrument_get_node_totals (GeglNode             *node,
+                                 GeglInstrumentTotals *totals)
+{
+  NodeTotalsData data = { node, totals, FALSE };
+
+  memset (totals, 0, sizeof (GeglInstrumentTotals));
+  foreach_record (node_totals_func, &data);
+
+  return data.found;
+}
+
+typedef struct
+{
+  GString    *records;
+  GHashTable *nodes;     /* node -> NodeTotals */
+  GList      *order;     /* of nodes, as first seen */
+} JsonData;
+
+typedef struct
+{
+  const gchar          *operation;
+  GeglInstrumentTotals  totals;
+} NodeTotals;
+
+static void
+json_record_func (const Record *record,
+                  gint          thread,
+                  gpointer      user_data)
+{
+  JsonData   *data   = user_data;
+  NodeTotals *totals = g_hash_table_lookup (data->nodes, record->node);
+  gint        i;
+
+  if (!totals)
+    {
+      totals = g_new0 (NodeTotals, 1);
+      totals->operation = record->operation;
+      g_hash_table_insert (data->nodes, (gpointer) record->node, totals);
+      data->order = g_list_prepend (data->order, (gpointer) record->node);
+    }
+  totals_add (&totals->totals, record);
+
+  if (data->records->len)
+    g_string_append (data->records, ",\n");
+
+  g_string_append_printf (data->records,
+                          "    {\"type\": \"%s\", \"node\": \"%p\", "
+                          "\"operation\": \"%s\", \"thread\": %i, "
+                          "\"start\": %li, \"usecs\": %li, "
+                          "\"roi\": [%i, %i, %i, %i]",
+                          record->type == GEGL_INSTRUMENT_RECORD_PROCESS ?
+                            "process" : "chunk",
+                          record->node, record->operation, thread,
+                          record->start, record->usecs,
+                          record->roi.x, record->roi.y,
+                          record->roi.width, record->roi.height);
+
+  for (i = 0; i < GEGL_INSTRUMENT_N_COUNTERS; i++)
+    g_string_append_printf (data->records, ", \"%s\": %" G_GINT64_FORMAT,
+                            counter_names[i], record->counters[i]);
+
+  g_string_append (data->records, "}");
+}
+
+gchar *
+gegl_instrument_json (void)
+{
+  JsonData  data;
+  GString  *s = g_string_new ("{\n  \"nodes\": [\n");
+  GList    *iter;
+  gint      i;
+
+  data.records = g_string_new ("");
+  data.nodes   = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  data.order   = NULL;
+
+  foreach_record (json_record_func, &data);
+
+  data.order = g_list_reverse (data.order);
+
+  for (iter = data.order; iter; iter = iter->next)
+    {
+      NodeTotals *totals = g_hash_table_lookup (data.nodes, iter->data);
+
+      g_string_append_printf (s,
+                              "    {\"node\": \"%p\", \"operation\": \"%s\", "
+                              "\"calls\": %i, \"chunks\": %i, "
+                              "\"usecs\": %li, \"pixels\": %" G_GINT64_FORMAT,
+                              iter->data, totals->operation,
+                              totals->totals.calls, totals->totals.chunks,
+                              totals->totals.usecs, totals->totals.pixels);
+
+      for (i = 0; i < GEGL_INSTRUMENT_N_COUNTERS; i++)
+        g_string_append_printf (s, ", \"%s\": %" G_GINT64_FORMAT,
+                                counter_names[i], totals->totals.counters[i]);
+
+      g_string_append (s, iter->next ? "},\n" : "}\n");
+    }
+
+  g_string_append (s, "  ],\n  \"records\": [\n");
+  g_string_append (s, data.records->str);
+  g_string_append (s, "\n  ]\n}\n");
+
+  g_string_free (data.records, TRUE);
+  g_hash_table_destroy (data.nodes);
+  g_list_free (data.order);
+
+  return g_string_free (s, FALSE);
+}
+
+void
+gegl_instrument_reset (void)
+{
+  ThreadRecords *records;
+
+  for (records = g_atomic_pointer_get (&thread_records_list);
+       records;
+       records = records->next)
+    {
+      RecordBlock *block;
+      RecordBlock *last;
+
+      do
+        block = g_atomic_pointer_get (&records->blocks);
+      while (!g_atomic_pointer_compare_and_exchange (&records->blocks,
+                                                     block, NULL));
+
+      if (!block)
+        continue;
+
+      /* the owner may still fill the newest block, but no longer links
+       * blocks to the detached ones
+       */
+      last = block;
+      while (last->next)
+        last = last->next;
+
+      g_mutex_lock (&retired_mutex);
+      last->next     = retired_blocks;
+      retired_blocks = block;
+      g_mutex_unlock (&retired_mutex);
+    }
+}
+
+/* the events are written, start the next trace empty; like reset records,
+ * the blocks are only freed at exit
+ */
+static void
+trace_retire_events (void)
+{
+  ThreadRecords *records;
+
+  for (records = g_atomic_pointer_get (&thread_records_list);
+       records;
+       records = records->next)
+    {
+      TraceBlock *block;
+      TraceBlock *last;
+
+      do
+        block = g_atomic_pointer_get (&records->trace_blocks);
+      while (!g_atomic_pointer_compare_and_exchange (&records->trace_blocks,
+                                                     block, NULL));
+
+      if (!block)
+        continue;
+
+      last = block;
+      while (last->next)
+        last = last->next;
+
+      g_mutex_lock (&retired_mutex);
+      last->next           = retired_trace_blocks;
+      retired_trace_blocks = block;
+      g_mutex_unlock (&retired_mutex);
+    }
+}
+
+static void
+timing_free (Timing *timing)
+{
+  while (timing)
+    {
+      Timing *next = timing->next;
+
+      timing_free (timing->children);
+      g_free (timing->name);
+      g_slice_free (Timing, timing);
+      timing = next;
+    }
+}
+
+/* the ThreadRecords themselves are kept, the threads still refer to them */
+void
+gegl_instrument_cleanup (void)
+{
+  g_mutex_lock (&timing_mutex);
+  timing_free (root);
+  root = NULL;
+  g_mutex_unlock (&timing_mutex);
+
+  gegl_instrument_reset ();
+  trace_retire_events ();
+
+  g_mutex_lock (&retired_mutex);
+  while (retired_blocks)
+    {
+      RecordBlock *next = retired_blocks->next;
+
+      g_free (retired_blocks);
+      retired_blocks = next;
+    }
+  while (retired_trace_blocks)
+    {
+      TraceBlock *next = retired_trace_blocks->next;
+
+      g_free (retired_trace_blocks);
+      retired_trace_blocks = next;
+    }
+  g_mutex_unlock (&retired_mutex);
+}
+
+static gchar *trace_path  = NULL;
+static long   trace_start = 0;
+
+void
+gegl_trace_start (const gchar *path)
+{
+  g_return_if_fail (path != NULL);
+
+  if (gegl_trace_enabled)
+    gegl_trace_stop ();
+
+  trace_path         = g_strdup (path);
+  trace_start        = gegl_ticks ();
+  gegl_trace_enabled = TRUE;
+}
+
+static gchar *
+gegl_trace_json (void)
+{
+  GString       *s     = g_string_new ("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  gboolean       first = TRUE;
+  ThreadRecords *records;
+
+  for (records = g_atomic_pointer_get (&thread_records_list);
+       records;
+       records = records->next)
+    {
+      TraceBlock *block;
+
+      g_string_append_printf (s, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", "
+                                 "\"pid\": 1, \"tid\": %i, "
+                                 "\"args\": {\"name\": \"thread %i\"}}",
+                              first ? "" : ",\n",
+                              records->thread, records->thread);
+      first = FALSE;
+
+      for (block = g_atomic_pointer_get (&records->trace_blocks);
+           block;
+           block = block->next)
+        {
+          gint n_events = g_atomic_int_get (&block->n_events);
+          gint i;
+
+          for (i = 0; i < n_events; i++)
+            {
+              TraceEvent *event = &block->events[i];
+
+              /* spans started before the trace */
+              if (event->start < trace_start)
+                continue;
+
+              g_string_append_printf (s, ",\n  {\"name\": \"%s\", \"cat\": \"%s\", "
+                                         "\"ph\": \"X\", \"ts\": %li, \"dur\": %li, "
+                                         "\"pid\": 1, \"tid\": %i}",
+                                      event->name, event->category,
+                                      event->start, event->usecs,
+                                      records->thread);
+            }
+        }
+    }
+
+  g_string_append (s, "\n]}\n");
+
+  return g_string_free (s, FALSE);
+}
+
+void
+gegl_trace_stop (void)
+{
+  GError *error = NULL;
+  gchar  *json;
+
+  if (!gegl_trace_enabled)
+    return;
+
+  gegl_trace_enabled = FALSE;
+
+  json = gegl_trace_json ();
+  if (!g_file_set_contents (trace_path, json, -1, &error))
+    {
+      g_warning ("unable to write trace: %s", error->message);
+      g_error_free (error);
+    }
+
+  trace_retire_events ();
+
+  g_free (json);
+  g_free (trace_path);
+  trace_path = NULL;
+}
+
 gchar *
 gegl_instrument_utf8 (void)
 {
@@ -19,6 +19,7 @@
 #define GEGL_INSTRUMENT_H
 
 extern gboolean gegl_instrument_enabled;
+extern gboolean gegl_trace_enabled;
 
 /* return number of usecs since gegl was initialized */
 long gegl_ticks               (void);
@@ -52,4 +53,122 @@ void real_gegl_instrument     (const gchar *parent,
  */
 gchar * gegl_instrument_utf8 (void);
 
+/* Profiling of graph evaluation: every gegl_operation_process () of a
+ * node, and every part of it processed by one thread, is recorded with
+ * its wall time, region, and counters of the work done by the buffer
+ * code meanwhile. Counters are exclusive, work done in a nested record is
+ * only counted there. Records are appended to per thread storage, without
+ * locking.
+ */
+typedef enum
+{
+  GEGL_INSTRUMENT_TILES_FETCHED,
+  GEGL_INSTRUMENT_CACHE_HITS,
+  GEGL_INSTRUMENT_BYTES_CONVERTED,
+  GEGL_INSTRUMENT_N_COUNTERS
+} GeglInstrumentCounter;
+
+typedef enum
+{
+  GEGL_INSTRUMENT_RECORD_PROCESS, /* gegl_operation_process () */
+  GEGL_INSTRUMENT_RECORD_CHUNK    /* a part processed by one thread */
+} GeglInstrumentRecordType;
+
+typedef struct
+{
+  long   start;
+  gint64 counters[GEGL_INSTRUMENT_N_COUNTERS];
+} GeglInstrumentSpan;
+
+typedef struct
+{
+  gint   calls;
+  gint   chunks;
+  long   usecs;
+  gint64 pixels;
+  gint64 counters[GEGL_INSTRUMENT_N_COUNTERS];
+} GeglInstrumentTotals;
+
+/* spans are also traced, as "process" and "task" events */
+#define GEGL_INSTRUMENT_SPAN_START() \
+  { GeglInstrumentSpan _gegl_instrument_span; \
+    if (gegl_instrument_enabled || gegl_trace_enabled) { \
+      gegl_instrument_span_start (&_gegl_instrument_span); }
+
+#define GEGL_INSTRUMENT_SPAN_END(type, operation, roi) \
+    if (gegl_instrument_enabled || gegl_trace_enabled) { \
+      gegl_instrument_span_end (&_gegl_instrument_span, type, operation, roi); \
+                                                       } \
+  }
+
+/* add n to a counter of the calling thread */
+#define gegl_instrument_count(counter, n) \
+  { if (gegl_instrument_enabled) { \
+      real_gegl_instrument_count (counter, n); \
+    } }
+
+void real_gegl_instrument_count (GeglInstrumentCounter counter,
+                                 gint64                n);
+
+void gegl_instrument_span_start (GeglInstrumentSpan       *span);
+void gegl_instrument_span_end   (GeglInstrumentSpan       *span,
+                                 GeglInstrumentRecordType  type,
+                                 GeglOperation            *operation,
+                                 const GeglRectangle      *roi);
+
+/* sums up the records of node, returns FALSE if there are none */
+gboolean gegl_instrument_get_node_totals (GeglNode             *node,
+                                          GeglInstrumentTotals *totals);
+
+/* create a JSON document with the totals of every node and all records,
+ * not to be called while graphs are processed
+ */
+gchar * gegl_instrument_json (void);
+
+/* discard the records gathered so far, so that the next JSON document
+ * only covers what is processed after; records of graphs processed
+ * meanwhile may be lost. The memory is only freed at exit.
+ */
+void gegl_instrument_reset    (void);
+
+/* free the timings and records, at exit, once no thread appends records */
+void gegl_instrument_cleanup  (void);
+
+/* Tracing records a timeline of events, written by gegl_trace_stop () in
+ * the trace event format of chrome://tracing and Perfetto. Like records,
+ * events are appended to per thread storage without locking. Once the
+ * trace is written they are dropped, and freed at exit. category and name
+ * have to stay valid until the trace is written.
+ */
+#define GEGL_TRACE_START() \
+  { long _gegl_trace_ticks = 0; \
+    if (gegl_trace_enabled) { _gegl_trace_ticks = gegl_ticks (); }
+
+#define GEGL_TRACE_END(category, name) \
+    if (gegl_trace_enabled) { \
+      real_gegl_trace (category, name, _gegl_trace_ticks, \
+                       gegl_ticks () - _gegl_trace_ticks); \
+                            } \
+  }
+
+void real_gegl_trace (const gchar *category,
+                      const gchar *name,
+                      long         start,
+                      long         usecs);
+
+/* lock mutex, tracing the time waited for it if it was locked */
+#define gegl_trace_mutex_lock(mutex, name) \
+  { if (!gegl_trace_enabled || !g_mutex_trylock (mutex)) { \
+      GEGL_TRACE_START (); \
+      g_mutex_lock (mutex); \
+      GEGL_TRACE_END ("lock", name); \
+    } }
+
+#define gegl_trace_rec_mutex_lock(mutex, name) \
+  { if (!gegl_trace_enabled || !g_rec_mutex_trylock (mutex)) { \
+      GEGL_TRACE_START (); \
+      g_rec_mutex_lock (mutex); \
+      GEGL_TRACE_END ("lock", name); \
+    } }
+
 #endif
@@ -56,6 +56,19 @@ G_BEGIN_DECLS
  */
 gchar        **gegl_list_operations         (guint *n_operations_p);
 
+/**
+ * gegl_list_operations_in_category:
+ * @category: the name of a category, like "blur"
+ * @n_operations_p: (out caller-allocates): return location for number of operations.
+ *
+ * Return value: (transfer container) (array length=n_operations_p): An
+ * alphabetically sorted array of the available operations with @category
+ * among their "categories" key, or %NULL if there are none. The list should
+ * be freed with g_free after use.
+ */
+gchar        **gegl_list_operations_in_category (const gchar *category,
+                                                 guint       *n_operations_p);
+
 /**
  * gegl_has_operation:
  * @operation_type: the name of the operation
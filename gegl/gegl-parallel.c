@@ -0,0 +1,159 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+/* Helpers for operations that need to parallelize work inside a single
+ * process () call, for instance the passes of whole-image algorithms that
+ * cannot be expressed as independent output chunks.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gegl.h"
+#include "gegl-config.h"
+#include "gegl-instrument.h"
+#include "gegl-parallel.h"
+#include "gegl-stats.h"
+
+/* Completion of one gegl_parallel_distribute_range () call */
+typedef struct
+{
+  GMutex mutex;
+  GCond  cond;
+  gint   pending;
+} Completion;
+
+typedef struct ThreadData
+{
+  GeglParallelDistributeRangeFunc  func;
+  gpointer                         user_data;
+  gsize                            offset;
+  gsize                            size;
+  Completion                      *completion;
+} ThreadData;
+
+static GPrivate in_parallel;
+
+static void
+thread_process (gpointer thread_data,
+                gpointer unused)
+{
+  ThreadData *data = thread_data;
+
+  g_private_set (&in_parallel, GINT_TO_POINTER (TRUE));
+  GEGL_STATS_TASK_START ();
+  GEGL_TRACE_START ();
+  data->func (data->offset, data->size, data->user_data);
+  GEGL_TRACE_END ("task", "parallel range");
+  GEGL_STATS_TASK_END ();
+  g_private_set (&in_parallel, GINT_TO_POINTER (FALSE));
+
+  g_mutex_lock (&data->completion->mutex);
+  if (--data->completion->pending == 0)
+    g_cond_signal (&data->completion->cond);
+  g_mutex_unlock (&data->completion->mutex);
+}
+
+static GThreadPool *
+thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (thread_process, NULL, GEGL_MAX_THREADS,
+                                    FALSE, NULL);
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+gint
+gegl_parallel_get_n_threads (gsize size,
+                             gsize min_sub_size)
+{
+  gsize threads = CLAMP (gegl_config_threads (), 1, GEGL_MAX_THREADS);
+
+  if (GPOINTER_TO_INT (g_private_get (&in_parallel)))
+    return 1;
+
+  min_sub_size = MAX (min_sub_size, 1);
+  threads = MIN (threads, size / min_sub_size);
+
+  return MAX (threads, 1);
+}
+
+void
+gegl_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GeglParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  ThreadData  thread_data[GEGL_MAX_THREADS];
+  GThreadPool *pool;
+  Completion   completion;
+  gint         threads;
+  gsize        offset;
+  gint         i;
+
+  if (size == 0)
+    return;
+
+  threads = gegl_parallel_get_n_threads (size, min_sub_size);
+
+  if (threads == 1)
+    {
+      func (0, size, user_data);
+      return;
+    }
+
+  pool   = thread_pool ();
+  offset = 0;
+
+  g_mutex_init (&completion.mutex);
+  g_cond_init (&completion.cond);
+  completion.pending = threads;
+
+  for (i = 0; i < threads; i++)
+    {
+      thread_data[i].func       = func;
+      thread_data[i].user_data  = user_data;
+      thread_data[i].offset     = offset;
+      thread_data[i].size       = (size - offset) / (threads - i);
+      thread_data[i].completion = &completion;
+
+      offset += thread_data[i].size;
+    }
+
+  for (i = 1; i < threads; i++)
+    g_thread_pool_push (pool, &thread_data[i], NULL);
+  thread_process (&thread_data[0], NULL);
+
+  /* sleep rather than spin while the other threads finish their parts */
+  g_mutex_lock (&completion.mutex);
+  while (completion.pending)
+    g_cond_wait (&completion.cond, &completion.mutex);
+  g_mutex_unlock (&completion.mutex);
+
+  g_mutex_clear (&completion.mutex);
+  g_cond_clear (&completion.cond);
+}
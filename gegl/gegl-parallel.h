@@ -0,0 +1,65 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+#ifndef __GEGL_PARALLEL_H__
+#define __GEGL_PARALLEL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef void (*GeglParallelDistributeRangeFunc) (gsize    offset,
+                                                 gsize    size,
+                                                 gpointer user_data);
+
+/**
+ * gegl_parallel_distribute_range:
+ * @size: the total size of the range
+ * @min_sub_size: the minimal size of a sub-range handed to one thread
+ * @func: function called for each sub-range
+ * @user_data: user data passed to @func
+ *
+ * Splits the range [0, @size) into at most gegl_config_threads() contiguous
+ * sub-ranges, none smaller than @min_sub_size, and calls @func on each of
+ * them concurrently.  The calling thread processes the first sub-range
+ * itself, and the function returns once all sub-ranges are done.
+ *
+ * Calls made from within @func are processed serially in the calling
+ * thread, so it is safe to use from code that might itself already be
+ * running in parallel.
+ */
+void     gegl_parallel_distribute_range (gsize                           size,
+                                         gsize                           min_sub_size,
+                                         GeglParallelDistributeRangeFunc func,
+                                         gpointer                        user_data);
+
+/**
+ * gegl_parallel_get_n_threads:
+ * @size: the total size of a range
+ * @min_sub_size: the minimal size of a sub-range handed to one thread
+ *
+ * Returns the number of sub-ranges gegl_parallel_distribute_range() would
+ * split a range of @size into, useful for preallocating per-thread scratch
+ * memory.
+ */
+gint     gegl_parallel_get_n_threads    (gsize                           size,
+                                         gsize                           min_sub_size);
+
+G_END_DECLS
+
+#endif /* __GEGL_PARALLEL_H__ */
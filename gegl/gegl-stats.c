@@ -0,0 +1,281 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+/* GeglStats reports the state of the tile cache, the swap, the buffers and
+ * the worker threads as read-only properties. The values are read from
+ * counters the subsystems maintain anyway when a property is read, so
+ * polling them, e.g. once per second, costs next to nothing. Counters that
+ * only grow are totals since GEGL was initialized; a poller computes rates
+ * from the differences between two reads.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gegl.h"
+#include "gegl-types-internal.h"
+#include "gegl-stats.h"
+#include "buffer/gegl-buffer-private.h"
+#include "buffer/gegl-tile-handler-cache.h"
+#include "buffer/gegl-tile-handler-zoom.h"
+#include "buffer/gegl-tile-backend-swap.h"
+
+G_DEFINE_TYPE (GeglStats, gegl_stats, G_TYPE_OBJECT)
+
+enum
+{
+  PROP_0,
+  PROP_TILE_CACHE_TOTAL,
+  PROP_TILE_CACHE_HITS,
+  PROP_TILE_CACHE_MISSES,
+  PROP_TILE_CACHE_EVICTIONS,
+  PROP_SWAP_TOTAL,
+  PROP_SWAP_FREE,
+  PROP_SWAP_GAPS,
+  PROP_SWAP_QUEUED_WRITES,
+  PROP_SWAP_QUEUED_TOTAL,
+  PROP_BUFFERS,
+  PROP_TILES,
+  PROP_ZOOM_TILES,
+  PROP_THREADS_BUSY,
+  PROP_THREAD_TASKS,
+  PROP_THREAD_TIME
+};
+
+static GMutex  task_mutex;
+static gint    tasks_busy = 0;
+static guint64 tasks      = 0;
+static guint64 task_time  = 0; /* in microseconds */
+
+gint64
+gegl_stats_task_start (void)
+{
+  g_atomic_int_inc (&tasks_busy);
+
+  return g_get_monotonic_time ();
+}
+
+void
+gegl_stats_task_end (gint64 start)
+{
+  gint64 time = g_get_monotonic_time () - start;
+
+  g_mutex_lock (&task_mutex);
+  tasks++;
+  task_time += time;
+  g_mutex_unlock (&task_mutex);
+
+  g_atomic_int_add (&tasks_busy, -1);
+}
+
+static void
+gegl_stats_get_property (GObject    *gobject,
+                         guint       property_id,
+                         GValue     *value,
+                         GParamSpec *pspec)
+{
+  switch (property_id)
+    {
+      case PROP_TILE_CACHE_TOTAL:
+        g_value_set_uint64 (value, gegl_tile_handler_cache_get_total ());
+        break;
+
+      case PROP_TILE_CACHE_HITS:
+        g_value_set_uint64 (value, gegl_tile_handler_cache_get_hits ());
+        break;
+
+      case PROP_TILE_CACHE_MISSES:
+        g_value_set_uint64 (value, gegl_tile_handler_cache_get_misses ());
+        break;
+
+      case PROP_TILE_CACHE_EVICTIONS:
+        g_value_set_uint64 (value, gegl_tile_handler_cache_get_evictions ());
+        break;
+
+      case PROP_SWAP_TOTAL:
+        g_value_set_uint64 (value, gegl_tile_backend_swap_get_total ());
+        break;
+
+      case PROP_SWAP_FREE:
+        g_value_set_uint64 (value, gegl_tile_backend_swap_get_free ());
+        break;
+
+      case PROP_SWAP_GAPS:
+        g_value_set_int (value, gegl_tile_backend_swap_get_n_gaps ());
+        break;
+
+      case PROP_SWAP_QUEUED_WRITES:
+        g_value_set_int (value, gegl_tile_backend_swap_get_queued_writes ());
+        break;
+
+      case PROP_SWAP_QUEUED_TOTAL:
+        g_value_set_uint64 (value, gegl_tile_backend_swap_get_queued_total ());
+        break;
+
+      case PROP_BUFFERS:
+        g_value_set_int (value, gegl_buffer_get_n_alive ());
+        break;
+
+      case PROP_TILES:
+        g_value_set_int (value, gegl_tile_get_n_alive ());
+        break;
+
+      case PROP_ZOOM_TILES:
+        g_value_set_uint (value, gegl_tile_handler_zoom_get_n_built ());
+        break;
+
+      case PROP_THREADS_BUSY:
+        g_value_set_int (value, g_atomic_int_get (&tasks_busy));
+        break;
+
+      case PROP_THREAD_TASKS:
+        g_mutex_lock (&task_mutex);
+        g_value_set_uint64 (value, tasks);
+        g_mutex_unlock (&task_mutex);
+        break;
+
+      case PROP_THREAD_TIME:
+        g_mutex_lock (&task_mutex);
+        g_value_set_double (value, task_time / 1000000.0);
+        g_mutex_unlock (&task_mutex);
+        break;
+
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
+        break;
+    }
+}
+
+static void
+gegl_stats_class_init (GeglStatsClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->get_property = gegl_stats_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_TOTAL,
+                                   g_param_spec_uint64 ("tile-cache-total",
+                                                        "Tile cache total",
+                                                        "bytes of tiles held by the tile cache",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_HITS,
+                                   g_param_spec_uint64 ("tile-cache-hits",
+                                                        "Tile cache hits",
+                                                        "number of tiles fetched found in the tile cache",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_MISSES,
+                                   g_param_spec_uint64 ("tile-cache-misses",
+                                                        "Tile cache misses",
+                                                        "number of tiles fetched not found in the tile cache",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_CACHE_EVICTIONS,
+                                   g_param_spec_uint64 ("tile-cache-evictions",
+                                                        "Tile cache evictions",
+                                                        "number of tiles dropped to keep the tile cache within tile-cache-size",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_SWAP_TOTAL,
+                                   g_param_spec_uint64 ("swap-total",
+                                                        "Swap total",
+                                                        "size of the swap file in bytes",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_SWAP_FREE,
+                                   g_param_spec_uint64 ("swap-free",
+                                                        "Swap free",
+                                                        "bytes of the swap file not holding tiles",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_SWAP_GAPS,
+                                   g_param_spec_int ("swap-gaps",
+                                                     "Swap gaps",
+                                                     "number of free ranges the free bytes of the swap file are fragmented into",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_SWAP_QUEUED_WRITES,
+                                   g_param_spec_int ("swap-queued-writes",
+                                                     "Swap queued writes",
+                                                     "number of tiles waiting to be written to the swap file",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_SWAP_QUEUED_TOTAL,
+                                   g_param_spec_uint64 ("swap-queued-total",
+                                                        "Swap queued total",
+                                                        "bytes waiting to be written to the swap file",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_BUFFERS,
+                                   g_param_spec_int ("buffers",
+                                                     "Buffers",
+                                                     "number of buffers alive",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_TILES,
+                                   g_param_spec_int ("tiles",
+                                                     "Tiles",
+                                                     "number of tiles alive",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_ZOOM_TILES,
+                                   g_param_spec_uint ("zoom-tiles",
+                                                      "Zoom tiles",
+                                                      "number of mipmap tiles built, wraps around",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_THREADS_BUSY,
+                                   g_param_spec_int ("threads-busy",
+                                                     "Threads busy",
+                                                     "number of threads running thread pool tasks",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_THREAD_TASKS,
+                                   g_param_spec_uint64 ("thread-tasks",
+                                                        "Thread tasks",
+                                                        "number of thread pool tasks completed",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_THREAD_TIME,
+                                   g_param_spec_double ("thread-time",
+                                                        "Thread time",
+                                                        "seconds threads spent in completed thread pool tasks, divided by the elapsed time and the number of threads this gives the thread utilization",
+                                                        0.0, G_MAXDOUBLE, 0.0,
+                                                        G_PARAM_READABLE));
+}
+
+static void
+gegl_stats_init (GeglStats *self)
+{
+}
@@ -57,8 +57,181 @@ struct _ParseData
 
   GHashTable  *ids;
   GList       *refs;
+
+  GeglGraphTemplate *template; /*< the template being compiled, or NULL */
+  GHashTable        *indices;  /*< node -> index + 1 in template->nodes */
+};
+
+/* A graph template records what parsing a document does to the nodes of
+ * the graph it builds, with the operations resolved to types and the
+ * property values parsed, so that instantiating the graph again only
+ * creates and connects nodes.
+ */
+typedef enum
+{
+  TEMPLATE_NODE_GRAPH,        /* a node of its own, for <gegl> */
+  TEMPLATE_NODE_CHILD,        /* a child of the first node */
+  TEMPLATE_NODE_INPUT_PROXY,
+  TEMPLATE_NODE_OUTPUT_PROXY
+} TemplateNodeKind;
+
+typedef struct
+{
+  TemplateNodeKind  kind;
+  gint              parent;   /* the node proxies are of */
+  const gchar      *pad;      /* the pad proxies are for, interned */
+  GType             type;     /* of the operation, 0 for none */
+  gchar            *name;
+  GArray           *properties; /* of GParameter, names interned */
+} TemplateNode;
+
+typedef struct
+{
+  gint         sink;
+  const gchar *sink_pad;
+  gint         source;
+  const gchar *source_pad;
+} TemplateConnection;
+
+struct _GeglGraphTemplate
+{
+  GArray     *nodes;          /* of TemplateNode, in the order created */
+  GArray     *connections;    /* of TemplateConnection, in order */
+  GHashTable *ids;            /* id -> node index */
+  gboolean    valid;
 };
 
+static GQuark
+template_nodes_quark (void)
+{
+  static GQuark the_quark = 0;
+
+  if (G_UNLIKELY (the_quark == 0))
+    the_quark = g_quark_from_static_string ("gegl-graph-template-nodes");
+
+  return the_quark;
+}
+
+static gint
+template_node_index (ParseData *pd,
+                     GeglNode  *node)
+{
+  gint index = GPOINTER_TO_INT (g_hash_table_lookup (pd->indices, node)) - 1;
+
+  if (index < 0)
+    pd->template->valid = FALSE;
+
+  return index;
+}
+
+static TemplateNode *
+template_add_node (ParseData        *pd,
+                   GeglNode         *node,
+                   TemplateNodeKind  kind,
+                   GeglNode         *parent,
+                   const gchar      *pad)
+{
+  GeglOperation *operation = gegl_node_get_gegl_operation (node);
+  TemplateNode   template_node = { 0, };
+
+  template_node.kind       = kind;
+  template_node.parent     = parent ? template_node_index (pd, parent) : -1;
+  template_node.pad        = g_intern_string (pad);
+  template_node.type       = operation ? G_OBJECT_TYPE (operation) : 0;
+  template_node.properties = g_array_new (FALSE, FALSE, sizeof (GParameter));
+
+  g_array_append_val (pd->template->nodes, template_node);
+  g_hash_table_insert (pd->indices, node,
+                       GINT_TO_POINTER (pd->template->nodes->len));
+
+  return &g_array_index (pd->template->nodes, TemplateNode,
+                         pd->template->nodes->len - 1);
+}
+
+/* Records the value a property of node was parsed to */
+static void
+template_set_property (ParseData   *pd,
+                       GeglNode    *node,
+                       GParamSpec  *pspec)
+{
+  TemplateNode *template_node;
+  GParameter    property = { 0, };
+  gint          index = template_node_index (pd, node);
+  guint         i;
+
+  if (index < 0)
+    return;
+
+  template_node = &g_array_index (pd->template->nodes, TemplateNode, index);
+
+  property.name = g_intern_string (pspec->name);
+  g_value_init (&property.value, pspec->value_type);
+  gegl_node_get_property (node, pspec->name, &property.value);
+
+  for (i = 0; i < template_node->properties->len; i++)
+    {
+      GParameter *old = &g_array_index (template_node->properties,
+                                        GParameter, i);
+
+      if (old->name == property.name)
+        {
+          g_value_unset (&old->value);
+          *old = property;
+          return;
+        }
+    }
+
+  g_array_append_val (template_node->properties, property);
+}
+
+static GeglNode *
+parse_input_proxy (ParseData   *pd,
+                   GeglNode    *node,
+                   const gchar *pad)
+{
+  GeglNode *proxy = gegl_node_get_input_proxy (node, pad);
+
+  if (pd->template && !g_hash_table_contains (pd->indices, proxy))
+    template_add_node (pd, proxy, TEMPLATE_NODE_INPUT_PROXY, node, pad);
+
+  return proxy;
+}
+
+static GeglNode *
+parse_output_proxy (ParseData   *pd,
+                    GeglNode    *node,
+                    const gchar *pad)
+{
+  GeglNode *proxy = gegl_node_get_output_proxy (node, pad);
+
+  if (pd->template && !g_hash_table_contains (pd->indices, proxy))
+    template_add_node (pd, proxy, TEMPLATE_NODE_OUTPUT_PROXY, node, pad);
+
+  return proxy;
+}
+
+static void
+parse_connect (ParseData   *pd,
+               GeglNode    *sink,
+               const gchar *sink_pad,
+               GeglNode    *source,
+               const gchar *source_pad)
+{
+  gegl_node_connect_from (sink, sink_pad, source, source_pad);
+
+  if (pd->template && source)
+    {
+      TemplateConnection connection;
+
+      connection.sink       = template_node_index (pd, sink);
+      connection.sink_pad   = g_intern_string (sink_pad);
+      connection.source     = template_node_index (pd, source);
+      connection.source_pad = g_intern_string (source_pad);
+
+      g_array_append_val (pd->template->connections, connection);
+    }
+}
+
 
 /* Search a paired attribute name/value arrays for an entry with a specific
  * name, return the value or null if not found.
@@ -88,10 +261,24 @@ static void param_set (ParseData   *pd,
   if (!strcmp (param_name, "name"))
     {
       g_object_set (new, param_name, param_value, NULL);
+
+      if (pd->template && template_node_index (pd, new) >= 0)
+        {
+          TemplateNode *template_node;
+
+          template_node = &g_array_index (pd->template->nodes, TemplateNode,
+                                          template_node_index (pd, new));
+          g_free (template_node->name);
+          template_node->name = g_strdup (param_value);
+        }
     }
   else if (!strcmp (param_name, "id"))
     {
       g_hash_table_insert (pd->ids, g_strdup (param_value), new);
+
+      if (pd->template)
+        g_hash_table_insert (pd->template->ids, g_strdup (param_value),
+                             GINT_TO_POINTER (template_node_index (pd, new)));
     }
   else if (!strcmp (param_name, "ref"))
     {
@@ -251,6 +438,9 @@ set_clone_prop_as_well:
           g_warning ("operation desired unknown parapspec type for %s",
                      param_name);
         }
+
+      if (paramspec && pd->template)
+        template_set_property (pd, new, paramspec);
     }
 }
 
@@ -301,16 +491,19 @@ static void start_element (GMarkupParseContext *context,
         {
         }
 
+      if (pd->template)
+        template_add_node (pd, new, TEMPLATE_NODE_GRAPH, NULL, NULL);
+
       pd->state  = STATE_TREE_NORMAL;
       pd->parent = g_list_prepend (pd->parent, new);
 
       if (pd->iter)
 	{
-	  gegl_node_get_output_proxy (pd->iter, "output");
-	  gegl_node_connect_from (pd->iter, "input", new, "output");
+	  parse_output_proxy (pd, pd->iter, "output");
+	  parse_connect (pd, pd->iter, "input", new, "output");
 	}
 
-      pd->iter = gegl_node_get_output_proxy (new, "output");
+      pd->iter = parse_output_proxy (pd, new, "output");
     }
   else if (!strcmp (element_name, "graph"))
     {
@@ -411,6 +604,9 @@ static void start_element (GMarkupParseContext *context,
           return;
         }
 
+      if (pd->template)
+        template_add_node (pd, new, TEMPLATE_NODE_CHILD, pd->gegl, NULL);
+
       while (*a)
         {
           param_set (pd, new, *a, *v);
@@ -420,13 +616,13 @@ static void start_element (GMarkupParseContext *context,
 
       if (pd->state == STATE_TREE_FIRST_CHILD)
         {
-          gegl_node_connect_from (pd->iter, "aux", new, "output");
+          parse_connect (pd, pd->iter, "aux", new, "output");
         }
       else
         {
           if (pd->iter && gegl_node_has_pad(new, "output"))
 	    {
-	      gegl_node_connect_from (pd->iter, "input", new, "output");
+	      parse_connect (pd, pd->iter, "input", new, "output");
 	    }
         }
       pd->parent = g_list_prepend (pd->parent, new);
@@ -467,11 +663,11 @@ static void end_element (GMarkupParseContext *context,
     {
       if (gegl_node_get_producer (pd->iter, "input", NULL))
         {
-          gegl_node_connect_from (pd->iter, "input",
-                                  gegl_node_get_input_proxy (GEGL_NODE (pd->parent->data), "input"),
-                                  "output");
-          pd->iter = gegl_node_get_input_proxy (GEGL_NODE (pd->parent->data),
-                                                "input");
+          parse_connect (pd, pd->iter, "input",
+                         parse_input_proxy (pd, GEGL_NODE (pd->parent->data), "input"),
+                         "output");
+          pd->iter = parse_input_proxy (pd, GEGL_NODE (pd->parent->data),
+                                        "input");
         }
       else
         {
@@ -550,23 +746,30 @@ static void each_ref (gpointer value,
   gegl_node_get (dest_node, "ref", &ref, NULL);
   source_node = g_hash_table_lookup (pd->ids, ref);
   g_free (ref);
-  gegl_node_connect_from (dest_node, "input", source_node, "output");
+  parse_connect (pd, dest_node, "input", source_node, "output");
 }
 
-GeglNode *gegl_node_new_from_xml (const gchar *xmldata,
-                                  const gchar *path_root)
+/* Parses xmldata into a graph, recording what it does in template unless
+ * that is NULL.
+ */
+static GeglNode *
+gegl_xml_parse (const gchar       *xmldata,
+                const gchar       *path_root,
+                GeglGraphTemplate *template)
 {
   ParseData            pd   = { 0, };
   GMarkupParseContext *context;
   gboolean             success = FALSE;
 
-  g_return_val_if_fail (xmldata != NULL, NULL);
-
   GEGL_INSTRUMENT_START();
 
   pd.ids       = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   pd.refs      = NULL;
   pd.path_root = path_root;
+  pd.template  = template;
+
+  if (template)
+    pd.indices = g_hash_table_new (NULL, NULL);
 
   g_list_free (pd.refs);
   context = g_markup_parse_context_new   (&parser, 0, &pd, NULL);
@@ -593,45 +796,360 @@ GeglNode *gegl_node_new_from_xml (const gchar *xmldata,
   g_markup_parse_context_free (context);
   g_hash_table_destroy (pd.ids);
 
+  if (pd.indices)
+    g_hash_table_destroy (pd.indices);
+
   GEGL_INSTRUMENT_END ("gegl", "gegl_parse_xml");
 
   return success ? GEGL_NODE (pd.gegl) : NULL;
 }
 
+GeglNode *gegl_node_new_from_xml (const gchar *xmldata,
+                                  const gchar *path_root)
+{
+  g_return_val_if_fail (xmldata != NULL, NULL);
+
+  return gegl_xml_parse (xmldata, path_root, NULL);
+}
+
+/* Reads the document at path and resolves its directory, for relative
+ * paths in it.
+ */
+static gboolean
+gegl_xml_read_file (const gchar  *path,
+                    gchar       **script,
+                    gchar       **path_root)
+{
+  GError *err = NULL;
+  gchar  *dirname;
+
+  dirname = g_path_get_dirname (path);
+  *path_root = realpath (dirname, NULL);
+  g_free (dirname);
+
+  if (!*path_root)
+    return FALSE;
+
+  g_file_get_contents (path, script, NULL, &err);
+  if (err != NULL)
+    {
+      g_warning ("Unable to read file: %s", err->message);
+      g_error_free (err);
+      g_free (*path_root);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 GeglNode *
 gegl_node_new_from_file (const gchar   *path)
 {
   GeglNode *node = NULL;
-  GError   *err  = NULL;
   gchar    *script;
   gchar    *path_root;
-  gchar    *dirname;
 
   g_assert (path);
 
-  dirname = g_path_get_dirname (path);
-  path_root = realpath (dirname, NULL);
-  if (!path_root)
+  if (gegl_xml_read_file (path, &script, &path_root))
     {
-      goto cleanup;
+      node = gegl_node_new_from_xml (script, path_root);
+
+      g_free (script);
+      g_free (path_root);
     }
 
-  g_file_get_contents (path, &script, NULL, &err);
-  if (err != NULL)
+  return node;
+}
+
+/****/
+
+
+static void
+gegl_graph_template_init_value (const GValue *template_value,
+                                GValue       *value)
+{
+  GObject *object;
+
+  g_value_init (value, G_VALUE_TYPE (template_value));
+
+  if (!G_VALUE_HOLDS_OBJECT (template_value) ||
+      !(object = g_value_get_object (template_value)))
     {
-      g_warning ("Unable to read file: %s", err->message);
-      g_error_free (err);
-      goto cleanup;
+      g_value_copy (template_value, value);
+      return;
     }
 
-  node = gegl_node_new_from_xml (script, path_root);
+  /* every graph gets objects of its own, they can be changed */
+  if (GEGL_IS_COLOR (object))
+    {
+      g_value_take_object (value, gegl_color_duplicate (GEGL_COLOR (object)));
+    }
+  else if (GEGL_IS_CURVE (object))
+    {
+      g_value_take_object (value, gegl_curve_duplicate (GEGL_CURVE (object)));
+    }
+  else if (GEGL_IS_PATH (object))
+    {
+      gchar *string = gegl_path_to_string (GEGL_PATH (object));
+
+      g_value_take_object (value, gegl_path_new_from_string (string));
+      g_free (string);
+    }
+  else
+    {
+      g_value_copy (template_value, value);
+    }
+}
+
+static GeglGraphTemplate *
+gegl_graph_template_compile (const gchar *xmldata,
+                             const gchar *path_root)
+{
+  GeglGraphTemplate *template = g_slice_new0 (GeglGraphTemplate);
+  GeglNode          *graph;
+
+  template->nodes       = g_array_new (FALSE, FALSE, sizeof (TemplateNode));
+  template->connections = g_array_new (FALSE, FALSE, sizeof (TemplateConnection));
+  template->ids         = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  template->valid       = TRUE;
+
+  graph = gegl_xml_parse (xmldata, path_root, template);
+
+  if (!graph || !template->nodes->len || !template->valid)
+    {
+      if (graph && !template->valid)
+        g_warning ("Unable to compile a template of the graph");
+
+      gegl_graph_template_free (template);
+      template = NULL;
+    }
+
+  if (graph)
+    g_object_unref (graph);
+
+  return template;
+}
+
+GeglGraphTemplate *
+gegl_graph_template_new_from_xml (const gchar *xmldata,
+                                  const gchar *path_root)
+{
+  g_return_val_if_fail (xmldata != NULL, NULL);
+
+  return gegl_graph_template_compile (xmldata, path_root);
+}
+
+GeglGraphTemplate *
+gegl_graph_template_new_from_file (const gchar *path)
+{
+  GeglGraphTemplate *template = NULL;
+  gchar             *script;
+  gchar             *path_root;
+
+  g_return_val_if_fail (path != NULL, NULL);
+
+  if (gegl_xml_read_file (path, &script, &path_root))
+    {
+      template = gegl_graph_template_compile (script, path_root);
+
+      g_free (script);
+      g_free (path_root);
+    }
+
+  return template;
+}
+
+static GeglNode *
+gegl_graph_template_new_node (const TemplateNode *template_node)
+{
+  GeglNode   *node;
+  GObject    *operation;
+  GParameter *parameters;
+  guint       n_parameters = template_node->properties->len;
+  guint       i;
+
+  if (!template_node->type)
+    return g_object_new (GEGL_TYPE_NODE, NULL);
+
+  parameters = g_newa (GParameter, MAX (n_parameters, 1));
+
+  for (i = 0; i < n_parameters; i++)
+    {
+      const GParameter *property;
+
+      property = &g_array_index (template_node->properties,
+                                 GParameter, i);
+
+      parameters[i].name = property->name;
+      memset (&parameters[i].value, 0, sizeof (GValue));
+      gegl_graph_template_init_value (&property->value,
+                                      &parameters[i].value);
+    }
+
+  operation = g_object_newv (template_node->type, n_parameters, parameters);
+  node      = g_object_new (GEGL_TYPE_NODE, "gegl-operation", operation, NULL);
+  g_object_unref (operation);
+
+  for (i = 0; i < n_parameters; i++)
+    g_value_unset (&parameters[i].value);
 
-cleanup:
-  g_free (path_root);
-  g_free (dirname);
   return node;
 }
 
+GeglNode *
+gegl_graph_template_instantiate (const GeglGraphTemplate *template)
+{
+  GPtrArray *nodes;
+  guint      i;
+
+  g_return_val_if_fail (template != NULL, NULL);
+
+  nodes = g_ptr_array_sized_new (template->nodes->len);
+
+  for (i = 0; i < template->nodes->len; i++)
+    {
+      const TemplateNode *template_node;
+      GeglNode           *node = NULL;
+
+      template_node = &g_array_index (template->nodes, TemplateNode, i);
+
+      switch (template_node->kind)
+        {
+          case TEMPLATE_NODE_GRAPH:
+            node = gegl_graph_template_new_node (template_node);
+            break;
+
+          case TEMPLATE_NODE_CHILD:
+            node = gegl_graph_template_new_node (template_node);
+            gegl_node_add_child (nodes->pdata[template_node->parent], node);
+            g_object_unref (node);
+            break;
+
+          case TEMPLATE_NODE_INPUT_PROXY:
+            node = gegl_node_get_input_proxy (nodes->pdata[template_node->parent],
+                                              template_node->pad);
+            break;
+
+          case TEMPLATE_NODE_OUTPUT_PROXY:
+            node = gegl_node_get_output_proxy (nodes->pdata[template_node->parent],
+                                               template_node->pad);
+            break;
+        }
+
+      if (template_node->name)
+        g_object_set (node, "name", template_node->name, NULL);
+
+      g_ptr_array_add (nodes, node);
+    }
+
+  for (i = 0; i < template->connections->len; i++)
+    {
+      const TemplateConnection *connection;
+
+      connection = &g_array_index (template->connections,
+                                   TemplateConnection, i);
+
+      gegl_node_connect_from (nodes->pdata[connection->sink],
+                              connection->sink_pad,
+                              nodes->pdata[connection->source],
+                              connection->source_pad);
+    }
+
+  /* the nodes are owned by the first one, and kept for
+   * gegl_graph_template_rebind () and gegl_graph_template_get_node ()
+   */
+  g_object_set_qdata_full (nodes->pdata[0], template_nodes_quark (), nodes,
+                           (GDestroyNotify) g_ptr_array_unref);
+
+  return nodes->pdata[0];
+}
+
+void
+gegl_graph_template_rebind (const GeglGraphTemplate *template,
+                            GeglNode                *graph)
+{
+  GPtrArray *nodes;
+  guint      i, j;
+
+  g_return_if_fail (template != NULL);
+  g_return_if_fail (GEGL_IS_NODE (graph));
+
+  nodes = g_object_get_qdata (G_OBJECT (graph), template_nodes_quark ());
+
+  g_return_if_fail (nodes != NULL && nodes->len == template->nodes->len);
+
+  for (i = 0; i < template->nodes->len; i++)
+    {
+      const TemplateNode *template_node;
+
+      template_node = &g_array_index (template->nodes, TemplateNode, i);
+
+      for (j = 0; j < template_node->properties->len; j++)
+        {
+          const GParameter *property;
+          GValue                  value = G_VALUE_INIT;
+
+          property = &g_array_index (template_node->properties,
+                                     GParameter, j);
+
+          gegl_graph_template_init_value (&property->value, &value);
+          gegl_node_set_property (nodes->pdata[i], property->name,
+                                  &value);
+          g_value_unset (&value);
+        }
+    }
+}
+
+GeglNode *
+gegl_graph_template_get_node (const GeglGraphTemplate *template,
+                              GeglNode                *graph,
+                              const gchar             *id)
+{
+  GPtrArray *nodes;
+  gpointer   index;
+
+  g_return_val_if_fail (template != NULL, NULL);
+  g_return_val_if_fail (GEGL_IS_NODE (graph), NULL);
+  g_return_val_if_fail (id != NULL, NULL);
+
+  nodes = g_object_get_qdata (G_OBJECT (graph), template_nodes_quark ());
+
+  g_return_val_if_fail (nodes != NULL && nodes->len == template->nodes->len, NULL);
+
+  if (!g_hash_table_lookup_extended (template->ids, id, NULL, &index))
+    return NULL;
+
+  return nodes->pdata[GPOINTER_TO_INT (index)];
+}
+
+void
+gegl_graph_template_free (GeglGraphTemplate *template)
+{
+  guint i, j;
+
+  g_return_if_fail (template != NULL);
+
+  for (i = 0; i < template->nodes->len; i++)
+    {
+      TemplateNode *template_node;
+
+      template_node = &g_array_index (template->nodes, TemplateNode, i);
+
+      for (j = 0; j < template_node->properties->len; j++)
+        g_value_unset (&g_array_index (template_node->properties,
+                                       GParameter, j).value);
+
+      g_array_free (template_node->properties, TRUE);
+      g_free (template_node->name);
+    }
+
+  g_array_free (template->nodes, TRUE);
+  g_array_free (template->connections, TRUE);
+  g_hash_table_destroy (template->ids);
+  g_slice_free (GeglGraphTemplate, template);
+}
+
 /****/
 
 
@@ -25,4 +25,15 @@ GeglNode * gegl_node_new_from_xml  (const gchar *xmldata,
                                     const gchar *path_root);
 GeglNode * gegl_node_new_from_file (const gchar *path);
 
+GeglGraphTemplate * gegl_graph_template_new_from_xml  (const gchar             *xmldata,
+                                                       const gchar             *path_root);
+GeglGraphTemplate * gegl_graph_template_new_from_file (const gchar             *path);
+GeglNode          * gegl_graph_template_instantiate   (const GeglGraphTemplate *template);
+void                gegl_graph_template_rebind        (const GeglGraphTemplate *template,
+                                                       GeglNode                *graph);
+GeglNode          * gegl_graph_template_get_node      (const GeglGraphTemplate *template,
+                                                       GeglNode                *graph,
+                                                       const gchar             *id);
+void                gegl_graph_template_free          (GeglGraphTemplate       *template);
+
 #endif
@@ -1000,6 +1000,47 @@ gegl_node_blit_buffer (GeglNode            *self,
   gegl_node_blit_buffer2 (self, buffer, roi, 0);
 }
 
+void
+gegl_node_estimate_cost (GeglNode            *self,
+                         const GeglRectangle *roi,
+                         gint                 level,
+                         gdouble             *seconds,
+                         guint64             *memory,
+                         guint64             *swap)
+{
+  GeglEvalManager *eval;
+  GeglRectangle    request;
+  gdouble          time  = 0.0;
+  guint64          bytes = 0;
+
+  g_return_if_fail (GEGL_IS_NODE (self));
+
+  /* A separate evaluation, so that the request of the node's own one
+   * is left alone.
+   */
+  eval = gegl_eval_manager_new (self, "output");
+
+  if (roi)
+    request = *roi;
+  else
+    request = gegl_eval_manager_get_bounding_box (eval);
+
+  gegl_eval_manager_estimate_cost (eval, &request, level, &time, &bytes);
+  g_object_unref (eval);
+
+  if (seconds)
+    *seconds = time;
+  if (memory)
+    *memory = bytes;
+  if (swap)
+    {
+      guint64 cache_size = gegl_config ()->tile_cache_size;
+
+      *swap = gegl_config ()->swap && bytes > cache_size ? bytes - cache_size
+                                                         : 0;
+    }
+}
+
 static inline gboolean gegl_mipmap_rendering_enabled (void)
 {
   static int enabled = -1;
@@ -300,6 +300,33 @@ void          gegl_node_blit_buffer      (GeglNode            *node,
                                           GeglBuffer          *buffer,
                                           const GeglRectangle *roi);
 
+/**
+ * gegl_node_estimate_cost:
+ * @node: a #GeglNode
+ * @roi: (allow-none): the rectangle to render, or NULL for the bounding
+ * box of @node.
+ * @level: the mipmap level to render at.
+ * @seconds: (out) (allow-none): return location for the processing time,
+ * summed over all threads.
+ * @memory: (out) (allow-none): return location for the peak size in bytes
+ * of the tiles of intermediate buffers.
+ * @swap: (out) (allow-none): return location for the bytes of @memory that
+ * do not fit in the tile cache, and will be swapped out.
+ *
+ * Estimate how expensive rendering @roi of @node would be, without
+ * processing anything. Regions which are already cached are free. The
+ * cost of an operation per pixel is read from its "cost" key, in
+ * nanoseconds, and guessed from the kind of operation when it is not set;
+ * costs measured on the machine that is going to render can be set with
+ * gegl_operation_set_key().
+ */
+void          gegl_node_estimate_cost    (GeglNode            *node,
+                                          const GeglRectangle *roi,
+                                          gint                 level,
+                                          gdouble             *seconds,
+                                          guint64             *memory,
+                                          guint64             *swap);
+
 /**
  * gegl_node_process:
  * @sink_node: a #GeglNode without outputs.
@@ -652,6 +679,78 @@ GeglNode    * gegl_node_new_from_xml     (const gchar   *xmldata,
  */
 GeglNode    * gegl_node_new_from_file    (const gchar   *path);
 
+/**
+ * gegl_graph_template_new_from_xml:
+ * @xmldata: a \0 terminated string containing XML data to be parsed.
+ * @path_root: a file system path that relative paths in the XML will be
+ * resolved in relation to.
+ *
+ * Parses the XML once into a template of the graph, with the operations
+ * resolved and the property values parsed, from which graphs equal to the
+ * one #gegl_node_new_from_xml would return can be created repeatedly with
+ * #gegl_graph_template_instantiate. A template can be instantiated from
+ * several threads at once.
+ *
+ * Return value: (transfer full): a new #GeglGraphTemplate, or %NULL if the
+ * XML could not be parsed. Free it with #gegl_graph_template_free.
+ */
+GeglGraphTemplate * gegl_graph_template_new_from_xml  (const gchar   *xmldata,
+                                                       const gchar   *path_root);
+
+/**
+ * gegl_graph_template_new_from_file:
+ * @path: the path to a file on the local file system to be parsed.
+ *
+ * Like #gegl_graph_template_new_from_xml for the XML document in a file,
+ * relative paths in it are resolved in relation to its directory.
+ *
+ * Return value: (transfer full): a new #GeglGraphTemplate, or %NULL.
+ */
+GeglGraphTemplate * gegl_graph_template_new_from_file (const gchar   *path);
+
+/**
+ * gegl_graph_template_instantiate:
+ * @template: a #GeglGraphTemplate
+ *
+ * Creates a new graph from @template, without parsing or looking up
+ * operations by name.
+ *
+ * Return value: (transfer full): a GeglNode containing the graph.
+ */
+GeglNode    * gegl_graph_template_instantiate (const GeglGraphTemplate *template);
+
+/**
+ * gegl_graph_template_rebind:
+ * @template: a #GeglGraphTemplate
+ * @graph: a graph returned by #gegl_graph_template_instantiate for @template
+ *
+ * Sets the properties of the nodes in @graph back to the values in the
+ * document, e.g. to reuse the graph after changing some of them.
+ */
+void          gegl_graph_template_rebind      (const GeglGraphTemplate *template,
+                                               GeglNode                *graph);
+
+/**
+ * gegl_graph_template_get_node:
+ * @template: a #GeglGraphTemplate
+ * @graph: a graph returned by #gegl_graph_template_instantiate for @template
+ * @id: the id attribute of a node in the document
+ *
+ * Return value: (transfer none): the node of @graph with the id @id in the
+ * document, or %NULL if there is none.
+ */
+GeglNode    * gegl_graph_template_get_node    (const GeglGraphTemplate *template,
+                                               GeglNode                *graph,
+                                               const gchar             *id);
+
+/**
+ * gegl_graph_template_free:
+ * @template: a #GeglGraphTemplate
+ *
+ * Frees @template, graphs created from it are not affected.
+ */
+void          gegl_graph_template_free        (GeglGraphTemplate       *template);
+
 /**
  * gegl_node_to_xml:
  * @node: a #GeglNode
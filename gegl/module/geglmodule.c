@@ -84,6 +84,7 @@ gegl_module_init (GeglModule *module)
   module->state             = GEGL_MODULE_STATE_ERROR;
   module->on_disk           = FALSE;
   module->load_inhibit      = FALSE;
+  module->registered        = FALSE;
 
   module->module            = NULL;
   module->info              = NULL;
@@ -215,8 +216,7 @@ gegl_module_new (const gchar *filename,
 
   if (! module->load_inhibit)
     {
-      if (gegl_module_load (G_TYPE_MODULE (module)))
-        gegl_module_unload (G_TYPE_MODULE (module));
+      gegl_module_register_types (module);
     }
   else
     {
@@ -230,6 +230,70 @@ gegl_module_new (const gchar *filename,
   return module;
 }
 
+/**
+ * gegl_module_new_deferred:
+ * @filename: The filename of a loadable module.
+ * @verbose:  Pass %TRUE to enable debugging output.
+ *
+ * Creates a new #GeglModule instance like gegl_module_new(), without
+ * loading the module. Its types are registered by the first call to
+ * gegl_module_register_types(), for when it is known beforehand which
+ * types the module provides.
+ *
+ * Return value: The new #GeglModule object.
+ **/
+GeglModule *
+gegl_module_new_deferred (const gchar *filename,
+                          gboolean     verbose)
+{
+  GeglModule *module;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  module = g_object_new (GEGL_TYPE_MODULE, NULL);
+
+  module->filename = g_strdup (filename);
+  module->verbose  = verbose ? TRUE : FALSE;
+  module->on_disk  = TRUE;
+  module->state    = GEGL_MODULE_STATE_NOT_LOADED;
+
+  return module;
+}
+
+/**
+ * gegl_module_register_types:
+ * @module: A #GeglModule.
+ *
+ * Loads the module to register the types it implements, unless that was
+ * done before, and unloads it again until an instance of one of the
+ * types is created.
+ *
+ * Return value: %TRUE if the types of the module are registered.
+ **/
+gboolean
+gegl_module_register_types (GeglModule *module)
+{
+  static GMutex mutex;
+  gboolean      registered;
+
+  g_return_val_if_fail (GEGL_IS_MODULE (module), FALSE);
+
+  g_mutex_lock (&mutex);
+
+  if (! module->registered &&
+      gegl_module_load (G_TYPE_MODULE (module)))
+    {
+      gegl_module_unload (G_TYPE_MODULE (module));
+      module->registered = TRUE;
+    }
+
+  registered = module->registered;
+
+  g_mutex_unlock (&mutex);
+
+  return registered;
+}
+
 /**
  * gegl_module_query_module:
  * @module: A #GeglModule.
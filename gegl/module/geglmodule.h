@@ -64,6 +64,7 @@ struct _GeglModule
   GeglModuleState  state;        /* what's happened to the module            */
   gboolean         on_disk;      /* TRUE if file still exists                */
   gboolean         load_inhibit; /* user requests not to load at boot time   */
+  gboolean         registered;   /* TRUE once the types were registered      */
 
   /* stuff from now on may be NULL depending on the state the module is in   */
   /*< private >*/
@@ -98,6 +99,10 @@ GeglModule  * gegl_module_new              (const gchar     *filename,
                                             gboolean         load_inhibit,
                                             gboolean         verbose);
 
+GeglModule  * gegl_module_new_deferred     (const gchar     *filename,
+                                            gboolean         verbose);
+gboolean      gegl_module_register_types   (GeglModule      *module);
+
 gboolean      gegl_module_query_module     (GeglModule      *module);
 
 void          gegl_module_modified         (GeglModule      *module);
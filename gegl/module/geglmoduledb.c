@@ -110,6 +110,8 @@ gegl_module_db_init (GeglModuleDB *db)
   db->modules      = NULL;
   db->load_inhibit = NULL;
   db->verbose      = FALSE;
+  db->defer_func   = NULL;
+  db->defer_data   = NULL;
 }
 
 static void
@@ -238,6 +240,27 @@ gegl_module_db_get_load_inhibit (GeglModuleDB *db)
   return db->load_inhibit;
 }
 
+/**
+ * gegl_module_db_set_defer_func:
+ * @db:         A #GeglModuleDB.
+ * @defer_func: A #GeglModuleDeferFunc, or %NULL.
+ * @user_data:  Data passed to @defer_func.
+ *
+ * Sets a function deciding which modules found by later calls to
+ * gegl_module_db_load() are created with gegl_module_new_deferred()
+ * instead of being loaded right away.
+ **/
+void
+gegl_module_db_set_defer_func (GeglModuleDB        *db,
+                               GeglModuleDeferFunc  defer_func,
+                               gpointer             user_data)
+{
+  g_return_if_fail (GEGL_IS_MODULE_DB (db));
+
+  db->defer_func = defer_func;
+  db->defer_data = user_data;
+}
+
 /**
  * gegl_module_db_load:
  * @db:          A #GeglModuleDB.
@@ -340,9 +363,13 @@ gegl_module_db_module_initialize (const GeglDatafileData *file_data,
   load_inhibit = is_in_inhibit_list (file_data->filename,
                                      db->load_inhibit);
 
-  module = gegl_module_new (file_data->filename,
-                            load_inhibit,
-                            db->verbose);
+  if (! load_inhibit && db->defer_func &&
+      db->defer_func (file_data->filename, file_data->mtime, db->defer_data))
+    module = gegl_module_new_deferred (file_data->filename, db->verbose);
+  else
+    module = gegl_module_new (file_data->filename,
+                              load_inhibit,
+                              db->verbose);
 
   g_signal_connect (module, "modified",
                     G_CALLBACK (gegl_module_db_module_modified),
@@ -31,6 +31,13 @@ G_BEGIN_DECLS
 
 typedef struct _GeglModuleDBClass GeglModuleDBClass;
 
+/* Returns TRUE if the types of the module at filename, last modified at
+ * mtime, are known without loading it.
+ */
+typedef gboolean (* GeglModuleDeferFunc) (const gchar *filename,
+                                          time_t       mtime,
+                                          gpointer     user_data);
+
 struct _GeglModuleDB
 {
   GObject   parent_instance;
@@ -40,6 +47,9 @@ struct _GeglModuleDB
 
   gchar    *load_inhibit;
   gboolean  verbose;
+
+  GeglModuleDeferFunc  defer_func;
+  gpointer             defer_data;
 };
 
 struct _GeglModuleDBClass
@@ -68,6 +78,10 @@ void           gegl_module_db_set_load_inhibit (GeglModuleDB *db,
                                                 const gchar  *load_inhibit);
 const gchar  * gegl_module_db_get_load_inhibit (GeglModuleDB *db);
 
+void           gegl_module_db_set_defer_func   (GeglModuleDB        *db,
+                                                GeglModuleDeferFunc  defer_func,
+                                                gpointer             user_data);
+
 void           gegl_module_db_load             (GeglModuleDB *db,
                                                 const gchar  *module_path);
 void           gegl_module_db_refresh          (GeglModuleDB *db,
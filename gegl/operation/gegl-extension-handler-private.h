@@ -21,4 +21,11 @@
 
 void          gegl_extension_handler_cleanup        (void);
 
+/* Calls func with the extension and the name of the operation of every
+ * registered loader, or saver.
+ */
+void          gegl_extension_handler_foreach        (gboolean  savers,
+                                                     GHFunc    func,
+                                                     gpointer  user_data);
+
 #endif /* __GEGL_EXTENSION_HANDLER_PRIVATE_H__ */
\ No newline at end of file
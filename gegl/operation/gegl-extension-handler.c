@@ -96,6 +96,17 @@ gegl_extension_handler_get_saver (const gchar *extension)
                                           "gegl:png-save");
 }
 
+void
+gegl_extension_handler_foreach (gboolean  savers,
+                                GHFunc    func,
+                                gpointer  user_data)
+{
+  GHashTable *handlers = savers ? save_handlers : load_handlers;
+
+  if (handlers)
+    g_hash_table_foreach (handlers, func, user_data);
+}
+
 void
 gegl_extension_handler_cleanup (void)
 {
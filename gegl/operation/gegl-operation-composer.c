@@ -25,6 +25,8 @@
 #include "gegl-operation-composer.h"
 #include "gegl-operation-context.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
+#include "gegl-stats.h"
 
 static gboolean gegl_operation_composer_process (GeglOperation       *operation,
                               GeglOperationContext     *context,
@@ -113,9 +115,14 @@ typedef struct ThreadData
 static void thread_process (gpointer thread_data, gpointer unused)
 {
   ThreadData *data = thread_data;
+  GEGL_STATS_TASK_START ();
+  GEGL_INSTRUMENT_SPAN_START();
   if (!data->klass->process (data->operation,
                        data->input, data->aux, data->output, &data->roi, data->level))
     data->success = FALSE;
+  GEGL_INSTRUMENT_SPAN_END (GEGL_INSTRUMENT_RECORD_CHUNK,
+                            data->operation, &data->roi);
+  GEGL_STATS_TASK_END ();
   g_atomic_int_add (data->pending, -1);
 }
 
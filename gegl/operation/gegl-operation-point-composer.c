@@ -25,6 +25,8 @@
 #include "gegl-operation-point-composer.h"
 #include "gegl-operation-context.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
+#include "gegl-stats.h"
 #include <sys/types.h>
 #include <unistd.h>
 #include <string.h>
@@ -59,6 +61,8 @@ static void thread_process (gpointer thread_data, gpointer unused)
   guchar *output = data->output;
   glong samples = data->roi.width * data->roi.height;
 
+  GEGL_STATS_TASK_START ();
+
   if (data->input_fish && input)
     {
       babl_process (data->input_fish, data->input, data->in_tmp, samples);
@@ -72,15 +76,20 @@ static void thread_process (gpointer thread_data, gpointer unused)
   if (data->output_fish)
     output = data->output_tmp;
 
+  GEGL_INSTRUMENT_SPAN_START();
   if (!data->klass->process (data->operation,
                        input, aux,
                        output, samples,
                        &data->roi, data->level))
     data->success = FALSE;
+  GEGL_INSTRUMENT_SPAN_END (GEGL_INSTRUMENT_RECORD_CHUNK,
+                            data->operation, &data->roi);
   
   if (data->output_fish)
     babl_process (data->output_fish, data->output_tmp, data->output, samples);
 
+  GEGL_STATS_TASK_END ();
+
   g_atomic_int_add (data->pending, -1);
 }
 
@@ -25,18 +25,21 @@
 #include "gegl-operation-temporal.h"
 #include "gegl-operation-context.h"
 
+/* The history is a ring of history_length buffers, one per frame. Each
+ * frame buffer shares the tiles of the input buffer it was stored from
+ * copy-on-write where they are aligned, so storing a frame rarely copies
+ * pixels, and reading a region of a past frame only touches its tiles.
+ */
 struct _GeglOperationTemporalPrivate
 {
-  gint                count;
+  gint                count;          /* frames stored so far */
   gint                history_length;
-
-  gint                width;
-  gint                height;
-  gint                next_to_write;
-  GeglBuffer         *frame_store;
+  gint                next_to_write;  /* index in frames */
+  GeglBuffer        **frames;
 };
 
-static void gegl_operation_temporal_prepare (GeglOperation *operation);
+static void gegl_operation_temporal_prepare  (GeglOperation *operation);
+static void gegl_operation_temporal_finalize (GObject       *object);
 
 G_DEFINE_TYPE (GeglOperationTemporal,
                gegl_operation_temporal,
@@ -46,6 +49,24 @@ G_DEFINE_TYPE (GeglOperationTemporal,
   G_TYPE_INSTANCE_GET_PRIVATE (obj, GEGL_TYPE_OPERATION_TEMPORAL, GeglOperationTemporalPrivate)
 
 
+static gint
+gegl_operation_temporal_get_n_frames (GeglOperationTemporalPrivate *priv)
+{
+  return MIN (priv->count, priv->history_length);
+}
+
+/* index in priv->frames of frame, 0 being the most recent one and
+ * negative numbers older ones
+ */
+static gint
+gegl_operation_temporal_frame_index (GeglOperationTemporalPrivate *priv,
+                                     gint                          frame)
+{
+  frame = CLAMP (frame, 1 - gegl_operation_temporal_get_n_frames (priv), 0);
+
+  return (priv->next_to_write - 1 + priv->history_length + frame) %
+         priv->history_length;
+}
 
 GeglBuffer *
 gegl_operation_temporal_get_frame (GeglOperation *op,
@@ -53,31 +74,39 @@ gegl_operation_temporal_get_frame (GeglOperation *op,
 {
   GeglOperationTemporal *temporal= GEGL_OPERATION_TEMPORAL (op);
   GeglOperationTemporalPrivate *priv = temporal->priv;
-  GeglBuffer   *buffer;
-
-   if (frame > priv->count)
-     {
-       frame = (priv->count-1);
-       if (frame<0)
-         frame=0;
-       g_print ("%i > priv->count(%i), using frame %i", frame, priv->count,
-        frame);
-     }
-   else
-     {
-       frame = (priv->next_to_write - 1 + priv->history_length + frame) % priv->history_length;
-       g_print ("using frame %i", frame);
-     }
-  /* build in shift */
-  buffer = g_object_new (GEGL_TYPE_BUFFER,
-                         "source",  priv->frame_store,
-                         "shift-y", frame * priv->height,
-                         "width", priv->width,
-                         "height", priv->height,
-                         "x", 0,
-                         "y", 0,
-                         NULL);
-  return buffer;
+
+  if (gegl_operation_temporal_get_n_frames (priv) == 0)
+    return gegl_buffer_new (NULL, babl_format ("RGB u8"));
+
+  return g_object_ref (priv->frames[gegl_operation_temporal_frame_index (priv, frame)]);
+}
+
+void
+gegl_operation_temporal_get_frame_region (GeglOperation       *op,
+                                          gint                 frame,
+                                          const GeglRectangle *roi,
+                                          const Babl          *format,
+                                          gpointer             dest,
+                                          gint                 rowstride)
+{
+  GeglOperationTemporal *temporal= GEGL_OPERATION_TEMPORAL (op);
+  GeglOperationTemporalPrivate *priv = temporal->priv;
+
+  if (gegl_operation_temporal_get_n_frames (priv) == 0)
+    {
+      gint bpp = babl_format_get_bytes_per_pixel (format);
+      gint y;
+
+      if (rowstride == GEGL_AUTO_ROWSTRIDE)
+        rowstride = roi->width * bpp;
+
+      for (y = 0; y < roi->height; y++)
+        memset ((guchar *) dest + y * rowstride, 0, roi->width * bpp);
+      return;
+    }
+
+  gegl_buffer_get (priv->frames[gegl_operation_temporal_frame_index (priv, frame)],
+                   roi, 1.0, format, dest, rowstride, GEGL_ABYSS_NONE);
 }
 
 static gboolean gegl_operation_temporal_process (GeglOperation       *self,
@@ -92,14 +121,19 @@ static gboolean gegl_operation_temporal_process (GeglOperation       *self,
 
   temporal_class = GEGL_OPERATION_TEMPORAL_GET_CLASS (self);
 
-  priv->width  = result->width;
-  priv->height = result->height;
+  if (!priv->frames)
+    priv->frames = g_new0 (GeglBuffer *, priv->history_length);
 
   {
-   GeglRectangle write_rect = *result;
-   write_rect.y = priv->next_to_write * priv->height;
+   GeglBuffer *frame = gegl_buffer_new (result, gegl_buffer_get_format (input));
+
+   /* shares the aligned tiles of input instead of copying them */
+   gegl_buffer_copy (input, result, GEGL_ABYSS_NONE, frame, result);
+
+   if (priv->frames[priv->next_to_write])
+     g_object_unref (priv->frames[priv->next_to_write]);
+   priv->frames[priv->next_to_write] = frame;
 
-   gegl_buffer_copy (input, result, GEGL_ABYSS_NONE, priv->frame_store, &write_rect);
    priv->count++;
    priv->next_to_write++;
    if (priv->next_to_write >= priv->history_length)
@@ -117,12 +151,33 @@ static void gegl_operation_temporal_prepare (GeglOperation *operation)
   gegl_operation_set_format (operation, "input", babl_format ("RGB u8"));
 }
 
+static void
+gegl_operation_temporal_finalize (GObject *object)
+{
+  GeglOperationTemporalPrivate *priv = GEGL_OPERATION_TEMPORAL (object)->priv;
+
+  if (priv->frames)
+    {
+      gint i;
+
+      for (i = 0; i < priv->history_length; i++)
+        if (priv->frames[i])
+          g_object_unref (priv->frames[i]);
+      g_free (priv->frames);
+      priv->frames = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_operation_temporal_parent_class)->finalize (object);
+}
+
 static void
 gegl_operation_temporal_class_init (GeglOperationTemporalClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GeglOperationClass *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationFilterClass *operation_filter_class = GEGL_OPERATION_FILTER_CLASS (klass);
 
+  object_class->finalize = gegl_operation_temporal_finalize;
   operation_class->prepare = gegl_operation_temporal_prepare;
   operation_filter_class->process = gegl_operation_temporal_process;
 
@@ -133,22 +188,13 @@ static void
 gegl_operation_temporal_init (GeglOperationTemporal *self)
 {
   GeglOperationTemporalPrivate *priv;
-  GeglRectangle rect = { 0, 0, 4096, 4096*600 };
 
   self->priv = GEGL_OPERATION_TEMPORAL_GET_PRIVATE(self);
   priv=self->priv;
   priv->count          = 0;
   priv->history_length = 500;
-  priv->width          = 1024;
-  priv->height         = 1024;
   priv->next_to_write  = 0;
-
-  /* FIXME: the format used for the frame_store should be autodetected from
-   * input
-   */
-  priv->frame_store    =
-      gegl_buffer_new (&rect, babl_format ("RGB u8"));
-;
+  priv->frames         = NULL;
 }
 
 void gegl_operation_temporal_set_history_length (GeglOperation *op,
@@ -156,7 +202,42 @@ void gegl_operation_temporal_set_history_length (GeglOperation *op,
 {
   GeglOperationTemporal *self = GEGL_OPERATION_TEMPORAL (op);
   GeglOperationTemporalPrivate *priv = self->priv;
+  GeglBuffer **frames;
+  gint         n_frames;
+  gint         i;
+
+  history_length = MAX (history_length, 1);
+
+  if (history_length == priv->history_length)
+    return;
+
+  if (!priv->frames)
+    {
+      priv->history_length = history_length;
+      return;
+    }
+
+  /* keep the most recent frames, oldest first */
+  n_frames = MIN (gegl_operation_temporal_get_n_frames (priv), history_length);
+  frames   = g_new0 (GeglBuffer *, history_length);
+
+  for (i = 0; i < n_frames; i++)
+    {
+      gint index = gegl_operation_temporal_frame_index (priv, i + 1 - n_frames);
+
+      frames[i] = priv->frames[index];
+      priv->frames[index] = NULL;
+    }
+
+  for (i = 0; i < priv->history_length; i++)
+    if (priv->frames[i])
+      g_object_unref (priv->frames[i]);
+  g_free (priv->frames);
+
+  priv->frames         = frames;
   priv->history_length = history_length;
+  priv->count          = n_frames;
+  priv->next_to_write  = n_frames % history_length;
 }
 
 guint gegl_operation_temporal_get_history_length (GeglOperation *op)
@@ -20,6 +20,8 @@
  * Base class for operations that want access to previous frames in a video sequence,
  * it contains API to configure the amounts of frames to store as well as getting a
  * GeglBuffer pointing to any of the previously stored frames.
+ *
+ * Frames are stored copy-on-write, sharing the tiles of the input buffers.
  */
 
 #ifndef __GEGL_OPERATION_TEMPORAL_H__
@@ -63,10 +65,24 @@ void gegl_operation_temporal_set_history_length (GeglOperation *op,
 
 guint gegl_operation_temporal_get_history_length (GeglOperation *op);
 
-/* you need to unref the buffer when you're done with it */
+/* Returns the stored frame, 0 being the most recent one, -1 the one
+ * before it and so on; frames older than the history are clamped to the
+ * oldest one. The buffer shares its tiles with the stored frame, you need
+ * to unref the buffer when you're done with it.
+ */
 GeglBuffer *gegl_operation_temporal_get_frame (GeglOperation *op,
                                                gint           frame);
 
+/* Reads only the region roi of a stored frame, numbered as for
+ * gegl_operation_temporal_get_frame (), without creating a buffer.
+ */
+void gegl_operation_temporal_get_frame_region (GeglOperation       *op,
+                                               gint                 frame,
+                                               const GeglRectangle *roi,
+                                               const Babl          *format,
+                                               gpointer             dest,
+                                               gint                 rowstride);
+
 
 G_END_DECLS
 
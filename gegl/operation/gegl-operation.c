@@ -24,6 +24,7 @@
 
 #include "gegl.h"
 #include "gegl-config.h"
+#include "gegl-instrument.h"
 #include "gegl-types-internal.h"
 #include "gegl-operation.h"
 #include "gegl-operation-context.h"
@@ -169,6 +170,19 @@ gegl_operation_process (GeglOperation        *operation,
 
   g_return_val_if_fail (klass->process, FALSE);
 
+  if (gegl_instrument_enabled || gegl_trace_enabled)
+    {
+      GeglInstrumentSpan span;
+      gboolean           success;
+
+      gegl_instrument_span_start (&span);
+      success = klass->process (operation, context, output_pad, result, level);
+      gegl_instrument_span_end (&span, GEGL_INSTRUMENT_RECORD_PROCESS,
+                                operation, result);
+
+      return success;
+    }
+
   return klass->process (operation, context, output_pad, result, level);
 }
 
@@ -21,20 +21,97 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 #include "gegl.h"
+#include "gegl-plugin.h"
 #include "gegl-types-internal.h"
 #include "gegl-debug.h"
 #include "gegl-operation.h"
 #include "gegl-operations.h"
 #include "gegl-operation-context.h"
+#include "gegl-extension-handler-private.h"
+#include "module/geglmodule.h"
+
+/* The registry cache is a key file describing the operations of the
+ * modules found by gegl_init (), so that modules which did not change
+ * since it was written are only loaded when one of their operations is
+ * first looked up:
+ *
+ *   [gegl]
+ *   version=0.3.1
+ *   abi=10
+ *
+ *   [module /usr/lib/gegl-0.3/png-load.so]
+ *   mtime=1443537302
+ *   operations=gegl:png-load;
+ *
+ *   [operation gegl:png-load]
+ *   module=/usr/lib/gegl-0.3/png-load.so
+ *   compat=false
+ *   loader-extensions=.png;
+ *   saver-extensions=
+ *   key-name=gegl:png-load
+ *   key-categories=hidden
+ *   ...
+ */
+#define REGISTRY_VERSION G_STRINGIFY (GEGL_MAJOR_VERSION) "." \
+                         G_STRINGIFY (GEGL_MINOR_VERSION) "." \
+                         G_STRINGIFY (GEGL_MICRO_VERSION)
+
+typedef struct
+{
+  GeglModule *module;
+  gchar      *license;    /* NULL if the operation is not restricted */
+  gchar      *categories;
+  gboolean    is_compat;
+} DeferredOperation;
+
+/* What the index needs to know about a poked operation type */
+typedef struct
+{
+  gchar *name;            /* the primary name */
+  gchar *license;
+  gchar *categories;
+} OperationInfo;
+
+/* The visible operations: an index that is never modified once built, but
+ * replaced by a new one when modules were loaded or the accepted licenses
+ * changed, so that looking up operations, like building graphs in many
+ * threads does for every node, takes no lock. Readers hold the index
+ * between gegl_operations_acquire_index () and
+ * gegl_operations_release_index (); replaced indices are retired, and
+ * freed once no reader is left that could still hold them.
+ */
+typedef struct
+{
+  guint       serial;     /* the type registration serial it reflects */
+  gint        generation;
+  GHashTable *types;      /* name and compat name -> GType, 0 for the
+                             operations of modules not loaded yet */
+  GPtrArray  *names;      /* sorted primary names */
+  GHashTable *categories; /* category -> sorted primary names */
+} OperationsIndex;
 
 static gchar     **accepted_licenses       = NULL;
 static GHashTable *known_operation_names   = NULL;
-static GHashTable *visible_operation_names = NULL;
-static GSList     *operations_list         = NULL;
-static guint       gtype_hash_serial       = 0;
+static GHashTable *deferred_operations     = NULL; /* of modules not loaded yet */
+static GHashTable *poked_types             = NULL; /* GType -> OperationInfo,
+                                                      guarded by operations_index_mutex */
+
+static OperationsIndex *operations_index   = NULL;
+static GSList          *retired_indices    = NULL; /* replaced, guarded by
+                                                      operations_index_mutex */
+static gint             index_readers      = 0;    /* holding an index */
+static gint             index_generation   = 0;    /* bumped when outdated */
+static GRecMutex        operations_index_mutex;
+
+static gchar      *registry_path           = NULL;
+static GKeyFile   *registry                = NULL; /* as read from registry_path */
+static GKeyFile   *registry_update         = NULL; /* collected by add_operations */
+static GHashTable *deferred_modules        = NULL; /* filenames */
+static GHashTable *loaded_modules          = NULL; /* filename -> mtime */
 
 static GMutex operations_cache_mutex = { 0, };
 
@@ -62,6 +139,114 @@ gegl_operation_class_register_name (GeglOperationClass *klass,
   g_mutex_unlock (&operations_cache_mutex);
 }
 
+static gchar *
+registry_module_group (const gchar *filename)
+{
+  return g_strconcat ("module ", filename, NULL);
+}
+
+static gchar *
+registry_operation_group (const gchar *name)
+{
+  return g_strconcat ("operation ", name, NULL);
+}
+
+typedef struct
+{
+  const gchar *name;
+  GPtrArray   *extensions;
+} RegistryExtensions;
+
+static void
+registry_collect_extension (gpointer extension,
+                            gpointer handler,
+                            gpointer user_data)
+{
+  RegistryExtensions *data = user_data;
+
+  if (!strcmp (handler, data->name))
+    g_ptr_array_add (data->extensions, extension);
+}
+
+static void
+registry_set_extensions (const gchar *group,
+                         const gchar *name,
+                         gboolean     savers)
+{
+  RegistryExtensions data = { name, g_ptr_array_new () };
+
+  gegl_extension_handler_foreach (savers, registry_collect_extension, &data);
+
+  g_key_file_set_string_list (registry_update, group,
+                              savers ? "saver-extensions" : "loader-extensions",
+                              (const gchar **) data.extensions->pdata,
+                              data.extensions->len);
+
+  g_ptr_array_free (data.extensions, TRUE);
+}
+
+static void
+registry_record_name (GeglOperationClass *klass,
+                      GeglModule         *module,
+                      const gchar        *name,
+                      gboolean            is_compat)
+{
+  GHashTableIter   iter;
+  gpointer         key, value;
+  gchar           *group;
+  gchar          **names;
+  gsize            n_names = 0;
+
+  group = registry_module_group (module->filename);
+  names = g_key_file_get_string_list (registry_update, group, "operations",
+                                      &n_names, NULL);
+  names = g_renew (gchar *, names, n_names + 2);
+  names[n_names++] = g_strdup (name);
+  names[n_names]   = NULL;
+  g_key_file_set_string_list (registry_update, group, "operations",
+                              (const gchar **) names, n_names);
+  g_strfreev (names);
+  g_free (group);
+
+  group = registry_operation_group (name);
+  g_key_file_set_string (registry_update, group, "module", module->filename);
+  g_key_file_set_boolean (registry_update, group, "compat", is_compat);
+
+  registry_set_extensions (group, name, FALSE);
+  registry_set_extensions (group, name, TRUE);
+
+  if (klass->keys)
+    {
+      g_hash_table_iter_init (&iter, klass->keys);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          gchar *key_name = g_strconcat ("key-", key, NULL);
+
+          g_key_file_set_string (registry_update, group, key_name, value);
+          g_free (key_name);
+        }
+    }
+
+  g_free (group);
+}
+
+/* Records the operation implemented in a module, while its class is
+ * referenced, for gegl_operations_cache_save ()
+ */
+static void
+registry_record_class (GeglOperationClass *klass)
+{
+  GTypePlugin *plugin = g_type_get_plugin (G_TYPE_FROM_CLASS (klass));
+
+  if (!registry_update || !klass->name || !GEGL_IS_MODULE (plugin))
+    return;
+
+  registry_record_name (klass, GEGL_MODULE (plugin), klass->name, FALSE);
+
+  if (klass->compat_name)
+    registry_record_name (klass, GEGL_MODULE (plugin), klass->compat_name, TRUE);
+}
+
 static void
 add_operations (GType parent)
 {
@@ -77,9 +262,25 @@ add_operations (GType parent)
     {
       /*
        * Poke the operation so it registers its name with
-       * gegl_operation_class_register_name
+       * gegl_operation_class_register_name, once; the children of
+       * operations poked before can come from modules loaded since
        */
-      g_type_class_unref (g_type_class_ref (types[no]));
+      if (!g_hash_table_contains (poked_types, GSIZE_TO_POINTER (types[no])))
+        {
+          OperationInfo      *info = g_slice_new0 (OperationInfo);
+          GeglOperationClass *klass;
+
+          g_hash_table_insert (poked_types, GSIZE_TO_POINTER (types[no]), info);
+
+          klass = g_type_class_ref (types[no]);
+
+          info->name       = g_strdup (klass->name);
+          info->license    = g_strdup (gegl_operation_class_get_key (klass, "license"));
+          info->categories = g_strdup (gegl_operation_class_get_key (klass, "categories"));
+
+          registry_record_class (klass);
+          g_type_class_unref (klass);
+        }
 
       add_operations (types[no]);
     }
@@ -138,32 +339,86 @@ gegl_operations_check_license (const gchar *operation_license)
   return FALSE;
 }
 
+static gint
+index_name_compare (gconstpointer a,
+                    gconstpointer b)
+{
+  return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
 static void
-gegl_operations_update_visible (void)
+index_add (OperationsIndex *index,
+           const gchar     *name,
+           GType            type,
+           gboolean         is_primary,
+           const gchar     *categories)
 {
-  GHashTableIter iter;
-  const gchar   *iter_key;
-  GType          iter_value;
+  gchar  *key = g_strdup (name);
+  gchar **category_names;
+  gint    i;
 
-  g_mutex_lock (&operations_cache_mutex);
+  g_hash_table_insert (index->types, key, (gpointer) type);
 
-  g_hash_table_remove_all (visible_operation_names);
-  g_slist_free (operations_list);
+  if (!is_primary)
+    return;
 
-  operations_list = NULL;
+  g_ptr_array_add (index->names, key);
 
-  g_hash_table_iter_init (&iter, known_operation_names);
+  if (!categories)
+    return;
 
-  while (g_hash_table_iter_next (&iter, (gpointer)&iter_key, (gpointer)&iter_value))
+  category_names = g_strsplit (categories, ":", 0);
+
+  for (i = 0; category_names[i]; i++)
     {
-      GObjectClass       *object_class;
-      GeglOperationClass *operation_class;
-      const gchar        *operation_license;
+      GPtrArray *names;
+
+      if (!category_names[i][0])
+        continue;
 
-      object_class = g_type_class_ref (iter_value);
-      operation_class = GEGL_OPERATION_CLASS (object_class);
+      names = g_hash_table_lookup (index->categories, category_names[i]);
+      if (!names)
+        {
+          names = g_ptr_array_new ();
+          g_hash_table_insert (index->categories,
+                               g_strdup (category_names[i]), names);
+        }
+
+      g_ptr_array_add (names, key);
+    }
+
+  g_strfreev (category_names);
+}
+
+static OperationsIndex *
+gegl_operations_index_new (guint serial)
+{
+  OperationsIndex   *index = g_slice_new (OperationsIndex);
+  GHashTableIter     iter;
+  const gchar       *iter_key;
+  gpointer           iter_value;
+  DeferredOperation *deferred;
+  GPtrArray         *names;
 
-      operation_license = g_hash_table_lookup (operation_class->keys, "license");
+  index->serial     = serial;
+  index->types      = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  index->names      = g_ptr_array_new ();
+  index->categories = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) g_ptr_array_unref);
+
+  g_mutex_lock (&operations_cache_mutex);
+
+  index->generation = index_generation;
+
+  g_hash_table_iter_init (&iter, known_operation_names);
+
+  while (g_hash_table_iter_next (&iter, (gpointer)&iter_key, &iter_value))
+    {
+      OperationInfo *info;
+      const gchar   *operation_license;
+
+      info = g_hash_table_lookup (poked_types, iter_value);
+      operation_license = info ? info->license : NULL;
 
       if (!operation_license || gegl_operations_check_license (operation_license))
         {
@@ -172,24 +427,126 @@ gegl_operations_update_visible (void)
               GEGL_NOTE (GEGL_DEBUG_LICENSE, "Accepted %s for %s", operation_license, iter_key);
             }
 
-          if (operation_class->name && (0 == strcmp (iter_key, operation_class->name)))
-            {
-              /* Is the primary name of the operation */
-              operations_list = g_slist_insert_sorted (operations_list, (gpointer) iter_key,
-                                                       (GCompareFunc) strcmp);
-            }
-
-          g_hash_table_insert (visible_operation_names, g_strdup (iter_key), (gpointer) iter_value);
+          index_add (index, iter_key, (GType) iter_value,
+                     info && !g_strcmp0 (iter_key, info->name),
+                     info ? info->categories : NULL);
         }
       else if (operation_license)
         {
           GEGL_NOTE (GEGL_DEBUG_LICENSE, "Rejected %s for %s", operation_license, iter_key);
         }
+    }
+
+  /* The operations of modules that are not loaded yet are listed as well */
+  g_hash_table_iter_init (&iter, deferred_operations);
 
-      g_type_class_unref (object_class);
+  while (g_hash_table_iter_next (&iter, (gpointer)&iter_key, (gpointer)&deferred))
+    {
+      if (g_hash_table_contains (known_operation_names, iter_key))
+        continue;
+
+      if (!deferred->license || gegl_operations_check_license (deferred->license))
+        index_add (index, iter_key, 0, !deferred->is_compat, deferred->categories);
     }
 
   g_mutex_unlock (&operations_cache_mutex);
+
+  g_ptr_array_sort (index->names, index_name_compare);
+
+  g_hash_table_iter_init (&iter, index->categories);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer)&names))
+    g_ptr_array_sort (names, index_name_compare);
+
+  return index;
+}
+
+static void
+gegl_operations_index_free (OperationsIndex *index)
+{
+  g_hash_table_destroy (index->categories);
+  g_ptr_array_free (index->names, TRUE);
+  g_hash_table_destroy (index->types);
+  g_slice_free (OperationsIndex, index);
+}
+
+/* Outdates the index, must be called with operations_cache_mutex held */
+static void
+gegl_operations_invalidate_index (void)
+{
+  g_atomic_int_inc (&index_generation);
+}
+
+static inline gboolean
+gegl_operations_index_is_current (OperationsIndex *index)
+{
+  return index &&
+         index->serial == g_type_get_type_registration_serial () &&
+         index->generation == g_atomic_int_get (&index_generation);
+}
+
+/* Returns the current index, valid until the matching
+ * gegl_operations_release_index ()
+ */
+static OperationsIndex *
+gegl_operations_acquire_index (void)
+{
+  OperationsIndex *index;
+
+  /* counted before the index is read, so that an index retired after
+   * this is not freed under the reader
+   */
+  g_atomic_int_inc (&index_readers);
+
+  index = g_atomic_pointer_get (&operations_index);
+
+  if (G_LIKELY (gegl_operations_index_is_current (index)))
+    return index;
+
+  g_rec_mutex_lock (&operations_index_mutex);
+
+  index = g_atomic_pointer_get (&operations_index);
+
+  if (!gegl_operations_index_is_current (index))
+    {
+      OperationsIndex *retired = index;
+      guint            serial  = g_type_get_type_registration_serial ();
+
+      /* If any new modules have been loaded, scan for GeglOperations */
+      add_operations (GEGL_TYPE_OPERATION);
+
+      index = gegl_operations_index_new (serial);
+      g_atomic_pointer_set (&operations_index, index);
+
+      if (retired)
+        retired_indices = g_slist_prepend (retired_indices, retired);
+    }
+
+  g_rec_mutex_unlock (&operations_index_mutex);
+
+  return index;
+}
+
+static void
+gegl_operations_release_index (void)
+{
+  if (!g_atomic_int_dec_and_test (&index_readers) ||
+      !g_atomic_pointer_get (&retired_indices))
+    return;
+
+  g_rec_mutex_lock (&operations_index_mutex);
+
+  /* Readers counted from now on can only get the current index, which is
+   * replaced with the mutex held; if none is left from before, none holds
+   * a retired index.
+   */
+  if (g_atomic_int_get (&index_readers) == 0)
+    {
+      g_slist_free_full (retired_indices,
+                         (GDestroyNotify) gegl_operations_index_free);
+      retired_indices = NULL;
+    }
+
+  g_rec_mutex_unlock (&operations_index_mutex);
 }
 
 void
@@ -202,27 +559,87 @@ gegl_operations_set_licenses_from_string (const gchar *license_str)
 
   accepted_licenses = g_strsplit (license_str, ",", 0);
 
+  gegl_operations_invalidate_index ();
+
   g_mutex_unlock (&operations_cache_mutex);
+}
 
-  gegl_operations_update_visible ();
+static gboolean
+deferred_operation_is_of_module (gpointer key,
+                                 gpointer value,
+                                 gpointer module)
+{
+  DeferredOperation *deferred = value;
+
+  return deferred->module == module;
+}
+
+/* Registers the types of the module implementing the operation name, if
+ * it was not loaded yet, returns FALSE if the operation is not deferred
+ * or not accepted.
+ */
+static gboolean
+gegl_operations_load_deferred (const gchar *name)
+{
+  DeferredOperation *deferred;
+  GeglModule        *module = NULL;
+
+  g_mutex_lock (&operations_cache_mutex);
+
+  deferred = g_hash_table_lookup (deferred_operations, name);
+
+  if (!deferred)
+    {
+      /* another thread loaded it since the index was looked at */
+      g_mutex_unlock (&operations_cache_mutex);
+      return TRUE;
+    }
+
+  if (!deferred->license || gegl_operations_check_license (deferred->license))
+    module = g_object_ref (deferred->module);
+
+  g_mutex_unlock (&operations_cache_mutex);
+
+  if (!module)
+    return FALSE;
+
+  GEGL_NOTE (GEGL_DEBUG_MISC, "Loading %s for %s", module->filename, name);
+
+  if (!gegl_module_register_types (module))
+    g_warning ("Failed to load %s for operation %s", module->filename, name);
+
+  /* The module describes its operations itself from now on */
+  g_mutex_lock (&operations_cache_mutex);
+  g_hash_table_foreach_remove (deferred_operations,
+                               deferred_operation_is_of_module, module);
+  g_hash_table_remove (deferred_modules, module->filename);
+  gegl_operations_invalidate_index ();
+  g_mutex_unlock (&operations_cache_mutex);
+
+  g_object_unref (module);
+
+  return TRUE;
 }
 
 GType
 gegl_operation_gtype_from_name (const gchar *name)
 {
-  /* If any new modules have been loaded, scan for GeglOperations */
-  guint latest_serial;
-  latest_serial = g_type_get_type_registration_serial ();
-  if (gtype_hash_serial != latest_serial)
-    {
-      add_operations (GEGL_TYPE_OPERATION);
+  OperationsIndex *index = gegl_operations_acquire_index ();
+  gpointer         type;
+  gboolean         found;
 
-      gtype_hash_serial = latest_serial;
+  found = g_hash_table_lookup_extended (index->types, name, NULL, &type);
 
-      gegl_operations_update_visible ();
-    }
+  gegl_operations_release_index ();
+
+  if (!found)
+    return 0;
+
+  /* an operation of a module that is not loaded yet */
+  if (!type && gegl_operations_load_deferred (name))
+    return gegl_operation_gtype_from_name (name);
 
-  return (GType) g_hash_table_lookup (visible_operation_names, name);
+  return (GType) type;
 }
 
 gboolean
@@ -231,53 +648,363 @@ gegl_has_operation (const gchar *operation_type)
   return gegl_operation_gtype_from_name (operation_type) != 0;
 }
 
-gchar **gegl_list_operations (guint *n_operations_p)
+/* Returns a copy of names as one allocation, to be freed with g_free */
+static gchar **
+gegl_operations_pack_names (GPtrArray *names,
+                            guint     *n_operations_p)
 {
   gchar **pasp = NULL;
   gint    n_operations;
   gint    i;
-  GSList *iter;
   gint    pasp_size = 0;
   gint    pasp_pos;
 
-  if (!operations_list)
-    {
-      gegl_operation_gtype_from_name ("");
+  n_operations = names ? names->len : 0;
 
-      /* should only happen if no operations are found */
-      if (!operations_list)
-        {
-          if (n_operations_p)
-            *n_operations_p = 0;
-          return NULL;
-        }
-    }
+  if (n_operations_p)
+    *n_operations_p = n_operations;
 
-  g_mutex_lock (&operations_cache_mutex);
+  /* should only happen if no operations are found */
+  if (!n_operations)
+    return NULL;
 
-  n_operations = g_slist_length (operations_list);
-  pasp_size   += (n_operations + 1) * sizeof (gchar *);
-  for (iter = operations_list; iter != NULL; iter = g_slist_next (iter))
+  pasp_size += (n_operations + 1) * sizeof (gchar *);
+  for (i = 0; i < n_operations; i++)
     {
-      const gchar *name = iter->data;
+      const gchar *name = g_ptr_array_index (names, i);
       pasp_size += strlen (name) + 1;
     }
   pasp     = g_malloc (pasp_size);
   pasp_pos = (n_operations + 1) * sizeof (gchar *);
-  for (iter = operations_list, i = 0; iter != NULL; iter = g_slist_next (iter), i++)
+  for (i = 0; i < n_operations; i++)
     {
-      const gchar *name = iter->data;
+      const gchar *name = g_ptr_array_index (names, i);
       pasp[i] = ((gchar *) pasp) + pasp_pos;
       strcpy (pasp[i], name);
       pasp_pos += strlen (name) + 1;
     }
   pasp[i] = NULL;
-  if (n_operations_p)
-    *n_operations_p = n_operations;
+
+  return pasp;
+}
+
+gchar **gegl_list_operations (guint *n_operations_p)
+{
+  OperationsIndex  *index = gegl_operations_acquire_index ();
+  gchar           **names;
+
+  names = gegl_operations_pack_names (index->names, n_operations_p);
+
+  gegl_operations_release_index ();
+
+  return names;
+}
+
+gchar **gegl_list_operations_in_category (const gchar *category,
+                                          guint       *n_operations_p)
+{
+  OperationsIndex  *index = gegl_operations_acquire_index ();
+  gchar           **names;
+
+  names = gegl_operations_pack_names (g_hash_table_lookup (index->categories, category),
+                                      n_operations_p);
+
+  gegl_operations_release_index ();
+
+  return names;
+}
+
+static void
+deferred_operation_free (DeferredOperation *deferred)
+{
+  g_object_unref (deferred->module);
+  g_free (deferred->license);
+  g_free (deferred->categories);
+  g_slice_free (DeferredOperation, deferred);
+}
+
+static void
+operation_info_free (OperationInfo *info)
+{
+  g_free (info->name);
+  g_free (info->license);
+  g_free (info->categories);
+  g_slice_free (OperationInfo, info);
+}
+
+static void
+registry_free (void)
+{
+  g_free (registry_path);
+  registry_path = NULL;
+
+  if (registry)
+    {
+      g_key_file_free (registry);
+      registry = NULL;
+    }
+
+  if (registry_update)
+    {
+      g_key_file_free (registry_update);
+      registry_update = NULL;
+    }
+
+  if (loaded_modules)
+    {
+      g_hash_table_destroy (loaded_modules);
+      loaded_modules = NULL;
+    }
+}
+
+void
+gegl_operations_cache_load (const gchar *path)
+{
+  GKeyFile *key_file = g_key_file_new ();
+
+  registry_free ();
+
+  registry_path   = g_strdup (path);
+  registry_update = g_key_file_new ();
+  loaded_modules  = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  if (g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL))
+    {
+      gchar *version = g_key_file_get_string (key_file, "gegl", "version", NULL);
+      gint   abi     = g_key_file_get_integer (key_file, "gegl", "abi", NULL);
+
+      if (!g_strcmp0 (version, REGISTRY_VERSION) &&
+          abi == GEGL_MODULE_ABI_VERSION)
+        {
+          registry = key_file;
+          key_file = NULL;
+        }
+
+      g_free (version);
+    }
+
+  if (key_file)
+    g_key_file_free (key_file);
+}
+
+gboolean
+gegl_operations_cache_has_module (const gchar *filename,
+                                  time_t       mtime,
+                                  gpointer     unused)
+{
+  gchar    *group;
+  gboolean  cached;
+
+  if (!registry)
+    return FALSE;
+
+  group  = registry_module_group (filename);
+  cached = g_key_file_has_group (registry, group) &&
+           g_key_file_get_int64 (registry, group, "mtime", NULL) == mtime;
+  g_free (group);
+
+  return cached;
+}
+
+void
+gegl_operations_add_module (GTypeModule *type_module)
+{
+  GeglModule  *module = GEGL_MODULE (type_module);
+  gchar      **names;
+  gchar       *group;
+  gint         i;
+
+  if (!registry_update)
+    return;
+
+  /* A module loaded right away, it has to be described in the cache */
+  if (module->registered)
+    {
+      GStatBuf  stat_buf;
+      gint64   *mtime;
+
+      if (g_stat (module->filename, &stat_buf) == 0)
+        {
+          mtime  = g_new (gint64, 1);
+          *mtime = stat_buf.st_mtime;
+          g_hash_table_insert (loaded_modules, g_strdup (module->filename), mtime);
+        }
+      return;
+    }
+
+  if (!registry ||
+      module->load_inhibit ||
+      module->state != GEGL_MODULE_STATE_NOT_LOADED)
+    return;
+
+  group = registry_module_group (module->filename);
+  names = g_key_file_get_string_list (registry, group, "operations", NULL, NULL);
+  g_free (group);
+
+  g_mutex_lock (&operations_cache_mutex);
+
+  g_hash_table_add (deferred_modules, g_strdup (module->filename));
+
+  for (i = 0; names && names[i]; i++)
+    {
+      DeferredOperation  *deferred = g_slice_new (DeferredOperation);
+      gchar             **extensions;
+      gint                j;
+
+      group = registry_operation_group (names[i]);
+
+      deferred->module    = g_object_ref (module);
+      deferred->license    = g_key_file_get_string (registry, group, "key-license", NULL);
+      deferred->categories = g_key_file_get_string (registry, group, "key-categories", NULL);
+      deferred->is_compat  = g_key_file_get_boolean (registry, group, "compat", NULL);
+
+      g_hash_table_insert (deferred_operations, g_strdup (names[i]), deferred);
+
+      /* loaders and savers register their extensions in class_init, which
+       * did not run yet
+       */
+      extensions = g_key_file_get_string_list (registry, group, "loader-extensions",
+                                               NULL, NULL);
+      for (j = 0; extensions && extensions[j]; j++)
+        gegl_extension_handler_register (extensions[j], names[i]);
+      g_strfreev (extensions);
+
+      extensions = g_key_file_get_string_list (registry, group, "saver-extensions",
+                                               NULL, NULL);
+      for (j = 0; extensions && extensions[j]; j++)
+        gegl_extension_handler_register_saver (extensions[j], names[i]);
+      g_strfreev (extensions);
+
+      g_free (group);
+    }
+
+  gegl_operations_invalidate_index ();
 
   g_mutex_unlock (&operations_cache_mutex);
 
-  return pasp;
+  g_strfreev (names);
+}
+
+static void
+registry_copy_group (GKeyFile    *from,
+                     GKeyFile    *to,
+                     const gchar *group)
+{
+  gchar **keys = g_key_file_get_keys (from, group, NULL, NULL);
+  gint    i;
+
+  for (i = 0; keys && keys[i]; i++)
+    {
+      gchar *value = g_key_file_get_value (from, group, keys[i], NULL);
+
+      g_key_file_set_value (to, group, keys[i], value);
+      g_free (value);
+    }
+
+  g_strfreev (keys);
+}
+
+static gboolean
+registry_is_outdated (void)
+{
+  gchar **groups;
+  gint    n_modules = 0;
+  gint    i;
+
+  if (!registry || g_hash_table_size (loaded_modules))
+    return TRUE;
+
+  /* modules removed since the cache was written */
+  groups = g_key_file_get_groups (registry, NULL);
+  for (i = 0; groups[i]; i++)
+    if (g_str_has_prefix (groups[i], "module "))
+      n_modules++;
+  g_strfreev (groups);
+
+  return n_modules != g_hash_table_size (deferred_modules);
+}
+
+void
+gegl_operations_cache_save (void)
+{
+  GHashTableIter  iter;
+  gpointer        key, value;
+  gchar          *data;
+  gsize           length;
+  gchar          *dir;
+  GError         *error = NULL;
+
+  if (!registry_update)
+    return;
+
+  /* poke the operations of the modules loaded right away, recording them */
+  gegl_operation_gtype_from_name ("");
+
+  if (!registry_is_outdated ())
+    {
+      registry_free ();
+      return;
+    }
+
+  g_key_file_set_string (registry_update, "gegl", "version", REGISTRY_VERSION);
+  g_key_file_set_integer (registry_update, "gegl", "abi", GEGL_MODULE_ABI_VERSION);
+
+  g_hash_table_iter_init (&iter, loaded_modules);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      gchar *group = registry_module_group (key);
+
+      g_key_file_set_int64 (registry_update, group, "mtime", *(gint64 *) value);
+
+      /* modules without operations are not loaded again either */
+      if (!g_key_file_has_key (registry_update, group, "operations", NULL))
+        g_key_file_set_string_list (registry_update, group, "operations", NULL, 0);
+
+      g_free (group);
+    }
+
+  g_mutex_lock (&operations_cache_mutex);
+
+  g_hash_table_iter_init (&iter, deferred_modules);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      gchar  *group = registry_module_group (key);
+      gchar **names;
+      gint    i;
+
+      registry_copy_group (registry, registry_update, group);
+
+      names = g_key_file_get_string_list (registry, group, "operations", NULL, NULL);
+      for (i = 0; names && names[i]; i++)
+        {
+          gchar *operation_group = registry_operation_group (names[i]);
+
+          registry_copy_group (registry, registry_update, operation_group);
+          g_free (operation_group);
+        }
+
+      g_strfreev (names);
+      g_free (group);
+    }
+
+  g_mutex_unlock (&operations_cache_mutex);
+
+  data = g_key_file_to_data (registry_update, &length, NULL);
+  dir  = g_path_get_dirname (registry_path);
+
+  g_mkdir_with_parents (dir, S_IRUSR | S_IWUSR | S_IXUSR);
+
+  if (!g_file_set_contents (registry_path, data, length, &error))
+    {
+      GEGL_NOTE (GEGL_DEBUG_MISC, "Failed to write %s: %s",
+                 registry_path, error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (data);
+
+  registry_free ();
 }
 
 void
@@ -288,8 +1015,16 @@ gegl_operation_gtype_init (void)
   if (!known_operation_names)
     known_operation_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-  if (!visible_operation_names)
-    visible_operation_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  if (!deferred_operations)
+    deferred_operations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                 (GDestroyNotify) deferred_operation_free);
+
+  if (!deferred_modules)
+    deferred_modules = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  if (!poked_types)
+    poked_types = g_hash_table_new_full (NULL, NULL, NULL,
+                                         (GDestroyNotify) operation_info_free);
 
   g_mutex_unlock (&operations_cache_mutex);
 }
@@ -303,12 +1038,24 @@ gegl_operation_gtype_cleanup (void)
       g_hash_table_destroy (known_operation_names);
       known_operation_names = NULL;
 
-      g_hash_table_destroy (visible_operation_names);
-      visible_operation_names = NULL;
+      g_slist_free_full (retired_indices,
+                         (GDestroyNotify) gegl_operations_index_free);
+      retired_indices = NULL;
+      if (operations_index)
+        gegl_operations_index_free (operations_index);
+      operations_index = NULL;
+      gegl_operations_invalidate_index ();
+
+      g_hash_table_destroy (deferred_operations);
+      deferred_operations = NULL;
+
+      g_hash_table_destroy (deferred_modules);
+      deferred_modules = NULL;
 
-      g_slist_free (operations_list);
-      operations_list = NULL;
+      g_hash_table_destroy (poked_types);
+      poked_types = NULL;
     }
+  registry_free ();
   g_mutex_unlock (&operations_cache_mutex);
 }
 
@@ -27,6 +27,8 @@
  */
 GType      gegl_operation_gtype_from_name   (const gchar *name);
 gchar   ** gegl_list_operations             (guint *n_operations_p);
+gchar   ** gegl_list_operations_in_category (const gchar *category,
+                                             guint       *n_operations_p);
 void       gegl_operation_gtype_init        (void);
 void       gegl_operation_gtype_cleanup     (void);
 
@@ -36,4 +38,17 @@ void       gegl_operation_class_register_name (GeglOperationClass *klass,
 
 void       gegl_operations_set_licenses_from_string (const gchar *license_str);
 
+/* The registry cache, see gegl-operations.c: gegl_init () loads it before
+ * loading the modules, defers the loading of the modules the cache
+ * describes with gegl_operations_cache_has_module () as the
+ * GeglModuleDeferFunc of the module db, passes every module it adds to
+ * gegl_operations_add_module (), and updates the cache when done.
+ */
+void       gegl_operations_cache_load       (const gchar *path);
+gboolean   gegl_operations_cache_has_module (const gchar *filename,
+                                             time_t       mtime,
+                                             gpointer     unused);
+void       gegl_operations_add_module       (GTypeModule *module);
+void       gegl_operations_cache_save       (void);
+
 #endif
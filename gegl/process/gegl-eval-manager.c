@@ -140,6 +140,27 @@ gegl_eval_manager_apply (GeglEvalManager     *self,
   return object;
 }
 
+/* Estimates the cost of rendering roi at level, running the same
+ * request preparation as gegl_eval_manager_apply without processing.
+ */
+void
+gegl_eval_manager_estimate_cost (GeglEvalManager     *self,
+                                 const GeglRectangle *roi,
+                                 gint                 level,
+                                 gdouble             *seconds,
+                                 guint64             *memory)
+{
+  g_return_if_fail (GEGL_IS_EVAL_MANAGER (self));
+  g_return_if_fail (GEGL_IS_NODE (self->node));
+
+  if (level >= GEGL_CACHE_VALID_MIPMAPS)
+    level = GEGL_CACHE_VALID_MIPMAPS-1;
+
+  gegl_eval_manager_prepare (self);
+  gegl_graph_prepare_request (self->traversal, roi, level);
+  gegl_graph_estimate_cost (self->traversal, level, seconds, memory);
+}
+
 GeglEvalManager * gegl_eval_manager_new     (GeglNode    *node,
                                              const gchar *pad_name)
 {
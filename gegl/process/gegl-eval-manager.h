@@ -69,6 +69,11 @@ GeglRectangle     gegl_eval_manager_get_bounding_box (GeglEvalManager     *self)
 GeglBuffer *      gegl_eval_manager_apply    (GeglEvalManager     *self,
                                               const GeglRectangle *roi,
                                               gint                 level);
+void              gegl_eval_manager_estimate_cost (GeglEvalManager     *self,
+                                                   const GeglRectangle *roi,
+                                                   gint                 level,
+                                                   gdouble             *seconds,
+                                                   guint64             *memory);
 GeglEvalManager * gegl_eval_manager_new      (GeglNode        *node,
                                               const gchar     *pad_name);
 
@@ -19,11 +19,14 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include <glib-object.h>
 
 #include "gegl-types-internal.h"
 #include "gegl.h"
 #include "gegl-debug.h"
+#include "gegl-config.h"
 #include "gegl-instrument.h"
 
 #include "buffer/gegl-region.h"
@@ -40,6 +43,13 @@
 #include "operation/gegl-operation.h"
 #include "operation/gegl-operation-context.h"
 #include "operation/gegl-operation-context-private.h"
+#include "operation/gegl-operation-area-filter.h"
+#include "operation/gegl-operation-point-composer.h"
+#include "operation/gegl-operation-point-composer3.h"
+#include "operation/gegl-operation-point-filter.h"
+#include "operation/gegl-operation-point-render.h"
+#include "operation/gegl-operation-sink.h"
+#include "operation/gegl-operation-source.h"
 
 typedef struct
 {
@@ -482,3 +492,174 @@ gegl_graph_process (GeglGraphTraversal *path,
 
   return result;
 }
+
+/* Nanoseconds it takes operation to process a pixel, from the "cost" key
+ * of its class if set, with a guess from its base class otherwise.
+ */
+static gdouble
+gegl_graph_get_cost_per_pixel (GeglOperation *operation)
+{
+  GeglOperationClass *klass = GEGL_OPERATION_GET_CLASS (operation);
+  const gchar        *cost  = gegl_operation_class_get_key (klass, "cost");
+
+  if (cost)
+    return g_ascii_strtod (cost, NULL);
+
+  if (GEGL_IS_OPERATION_POINT_FILTER (operation)    ||
+      GEGL_IS_OPERATION_POINT_COMPOSER (operation)  ||
+      GEGL_IS_OPERATION_POINT_COMPOSER3 (operation) ||
+      GEGL_IS_OPERATION_POINT_RENDER (operation))
+    return 10.0;
+  else if (GEGL_IS_OPERATION_AREA_FILTER (operation))
+    return 60.0;
+  else if (GEGL_IS_OPERATION_SOURCE (operation) ||
+           GEGL_IS_OPERATION_SINK (operation))
+    return 5.0;
+
+  return 30.0;
+}
+
+/* Bytes of the tiles a buffer of format covering rect allocates */
+static guint64
+gegl_graph_get_tile_memory (const GeglRectangle *rect,
+                            const Babl          *format)
+{
+  gint tile_width  = gegl_config ()->tile_width;
+  gint tile_height = gegl_config ()->tile_height;
+  gint x0, y0, x1, y1;
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return 0;
+
+  if (!format)
+    format = babl_format ("RGBA float");
+
+  x0 = (gint) floor ((gdouble) rect->x / tile_width);
+  y0 = (gint) floor ((gdouble) rect->y / tile_height);
+  x1 = (gint) ceil ((gdouble) (rect->x + rect->width) / tile_width);
+  y1 = (gint) ceil ((gdouble) (rect->y + rect->height) / tile_height);
+
+  return (guint64) (x1 - x0) * (y1 - y0) * tile_width * tile_height *
+         babl_format_get_bytes_per_pixel (format);
+}
+
+/* The pixels of rect at level, rect being in level 0 coordinates */
+static void
+gegl_graph_get_level_rect (const GeglRectangle *rect,
+                           gint                 level,
+                           GeglRectangle       *level_rect)
+{
+  const gint factor = 1 << level;
+  const gint x1     = rect->x;
+  const gint y1     = rect->y;
+  const gint x2     = rect->x + rect->width;
+  const gint y2     = rect->y + rect->height;
+
+  level_rect->x      = (x1 + (x1 < 0 ? 1 - factor : 0)) / factor;
+  level_rect->y      = (y1 + (y1 < 0 ? 1 - factor : 0)) / factor;
+  level_rect->width  = (x2 + (x2 < 0 ? 0 : factor - 1)) / factor - level_rect->x;
+  level_rect->height = (y2 + (y2 < 0 ? 0 : factor - 1)) / factor - level_rect->y;
+}
+
+/**
+ * gegl_graph_estimate_cost:
+ * @path: The traversal path
+ * @level: The mipmap level the request was prepared for
+ * @seconds: (out): Processing time, summed over all threads
+ * @memory: (out): Peak size of the tiles of intermediate buffers
+ *
+ * Estimate the cost of processing the prepared request, from the area
+ * each node has to render and the per pixel cost of its operation. The
+ * output of a node is counted from the time it is processed until its
+ * last consumer in the path was processed, and for as long as the graph
+ * lives if it is the cache of the node. Operations with a cost of 0 are
+ * assumed to pass their input on without allocating a buffer.
+ *
+ * If gegl_graph_prepare_request has not been called
+ * the result of this function is undefined.
+ */
+void
+gegl_graph_estimate_cost (GeglGraphTraversal *path,
+                          gint                level,
+                          gdouble            *seconds,
+                          guint64            *memory)
+{
+  GHashTable *positions = g_hash_table_new (NULL, NULL);
+  guint64    *released;
+  guint64     live = 0;
+  guint64     peak = 0;
+  gdouble     nanoseconds = 0.0;
+  GList      *list_iter;
+  gint        n_nodes;
+  gint        i;
+
+  n_nodes  = g_list_length (path->dfs_path);
+  released = g_new0 (guint64, n_nodes);
+
+  for (list_iter = path->dfs_path, i = 0; list_iter; list_iter = list_iter->next, i++)
+    g_hash_table_insert (positions, list_iter->data, GINT_TO_POINTER (i));
+
+  for (list_iter = path->dfs_path, i = 0; list_iter; list_iter = list_iter->next, i++)
+    {
+      GeglNode             *node      = GEGL_NODE (list_iter->data);
+      GeglOperation        *operation = node->operation;
+      GeglOperationContext *context   = g_hash_table_lookup (path->contexts, node);
+      GeglPad              *output_pad;
+      GeglRectangle         level_rect;
+      gdouble               cost;
+      guint64               bytes;
+      GList                *targets;
+      GList                *targets_iter;
+      gint                  last_use = i;
+
+      /* inputs which were used for the last time by the previous node */
+      if (i > 0)
+        live -= released[i - 1];
+
+      if (context->cached ||
+          context->need_rect.width <= 0 || context->need_rect.height <= 0)
+        continue;
+
+      /* need_rect is in level 0 coordinates, 1 / 4^level of it is rendered */
+      gegl_graph_get_level_rect (&context->need_rect, level, &level_rect);
+
+      cost = gegl_graph_get_cost_per_pixel (operation);
+      nanoseconds += cost * level_rect.width * level_rect.height;
+
+      output_pad = gegl_node_get_pad (node, "output");
+      if (!output_pad || cost == 0.0)
+        continue;
+
+      bytes = gegl_graph_get_tile_memory (&level_rect,
+                                          gegl_operation_get_format (operation,
+                                                                     "output"));
+      live += bytes;
+      peak  = MAX (peak, live);
+
+      if (node->cache)
+        continue;
+
+      targets = gegl_graph_get_connected_output_contexts (path, output_pad);
+      for (targets_iter = targets; targets_iter; targets_iter = targets_iter->next)
+        {
+          ContextConnection *target_con = targets_iter->data;
+          GeglNode          *target     = target_con->context->operation->node;
+
+          last_use = MAX (last_use,
+                          GPOINTER_TO_INT (g_hash_table_lookup (positions, target)));
+        }
+      g_list_free_full (targets, free_context_connection);
+
+      /* the output of the last node is the result, and outlives the path */
+      if (last_use > i)
+        released[last_use] += bytes;
+    }
+
+  if (seconds)
+    *seconds = nanoseconds / 1000000000.0;
+  if (memory)
+    *memory = peak;
+
+  g_free (released);
+  g_hash_table_unref (positions);
+}
@@ -34,4 +34,9 @@ GeglBuffer         *gegl_graph_process          (GeglGraphTraversal  *path,
 
 GeglRectangle       gegl_graph_get_bounding_box (GeglGraphTraversal  *path);
 
+void                gegl_graph_estimate_cost    (GeglGraphTraversal  *path,
+                                                 gint                 level,
+                                                 gdouble             *seconds,
+                                                 guint64             *memory);
+
 #endif /* __GEGL_GRAPH_TRAVERSAL_H__ */
@@ -31,6 +31,7 @@
 #include "operation/gegl-operation-sink.h"
 
 #include "gegl-config.h"
+#include "gegl-instrument.h"
 #include "gegl-processor.h"
 #include "gegl-processor-private.h"
 
@@ -647,7 +648,11 @@ gegl_processor_render (GeglProcessor *processor,
     }
 
   {
-    gboolean more_work = render_rectangle (processor);
+    gboolean more_work;
+
+    GEGL_TRACE_START ();
+    more_work = render_rectangle (processor);
+    GEGL_TRACE_END ("processor", "chunk");
 
     if (more_work == TRUE)
       {
@@ -189,6 +189,7 @@ gegl_op_class_init (GeglOpClass *klass)
       "title",      _("Buffer Source"),
       "categories", "programming:input",
       "description", _("Use an existing in-memory GeglBuffer as image source."),
+      "cost",       "0",
       NULL);
 
   operation_class->no_cache = TRUE;
@@ -57,6 +57,7 @@ property_boolean (normalize, _("Normalize"), TRUE)
 #define GEGL_OP_FILTER
 #define GEGL_OP_C_SOURCE distance-transform.c
 #include "gegl-op.h"
+#include "gegl-parallel.h"
 #include <math.h>
 #include <stdio.h>
 
@@ -145,14 +146,31 @@ cdt_sep (gint i, gint u, gfloat g_i, gfloat g_u)
 }
 
 
+typedef struct
+{
+  gint          width;
+  gint          height;
+  gfloat        thres_lo;
+  GeglDTMetric  metric;
+  gfloat       *src;
+  gfloat       *dest;
+  gfloat       *accum;
+  gfloat        maxval;
+  gfloat        scale;
+} DTPassData;
+
+G_LOCK_DEFINE_STATIC (dt_maxval);
+
+
 static void
-binary_dt_2nd_pass (gint          width,
-                    gint          height,
-                    gfloat        thres_lo,
-                    GeglDTMetric  metric,
-                    gfloat       *src,
-                    gfloat       *dest)
+binary_dt_2nd_pass_rows (gsize    offset,
+                         gsize    size,
+                         gpointer user_data)
 {
+  DTPassData *data   = user_data;
+  gint        width  = data->width;
+  gfloat     *dest   = data->dest;
+  gfloat     *accum  = data->accum;
   gint u, y;
   gint q, w, *t, *s;
   gfloat *g, *row_copy;
@@ -160,7 +178,7 @@ binary_dt_2nd_pass (gint          width,
   gfloat (*dt_f)   (gfloat, gfloat, gfloat);
   gint   (*dt_sep) (gint, gint, gfloat, gfloat);
 
-  switch (metric)
+  switch (data->metric)
     {
       case GEGL_DT_METRIC_CHESSBOARD:
         dt_f   = cdt_f;
@@ -182,16 +200,15 @@ binary_dt_2nd_pass (gint          width,
   t = gegl_calloc (sizeof (gint), width);
   row_copy = gegl_calloc (sizeof (gfloat), width);
 
-  /* this could be parallelized */
-  for (y = 0; y < height; y++)
+  for (y = offset; y < (gint) (offset + size); y++)
     {
       q = 0;
       s[0] = 0;
       t[0] = 0;
       g = dest + y * width;
 
-      dest[0 + y * width] = MIN (dest[0 + y * width], 1.0);
-      dest[width - 1 + y * width] = MIN (dest[width - 1 + y * width], 1.0);
+      g[0] = MIN (g[0], 1.0);
+      g[width - 1] = MIN (g[width - 1], 1.0);
 
       for (u = 1; u < width; u++)
         {
@@ -235,6 +252,15 @@ binary_dt_2nd_pass (gint          width,
               q--;
             }
         }
+
+      /* accumulate while the row is still hot in the cache */
+      if (accum)
+        {
+          gfloat *a = accum + y * width;
+
+          for (u = 0; u < width; u++)
+            a[u] += g[u];
+        }
     }
 
   gegl_free (t);
@@ -242,39 +268,102 @@ binary_dt_2nd_pass (gint          width,
   gegl_free (row_copy);
 }
 
-
+/* The row pass is independent for every row, thus it is distributed over
+ * bands of rows with per-thread scratch memory.
+ */
 static void
-binary_dt_1st_pass (gint    width,
-                    gint    height,
-                    gfloat  thres_lo,
-                    gfloat *src,
-                    gfloat *dest)
+binary_dt_2nd_pass (DTPassData *data)
 {
-  int x, y;
+  gegl_parallel_distribute_range (data->height, 8,
+                                  binary_dt_2nd_pass_rows, data);
+}
+
 
-  /* this loop could be parallelized */
-  for (x = 0; x < width; x++)
+/* The column pass is independent for every column; walking a band of
+ * columns row by row keeps the memory accesses sequential, and lets the
+ * inner loops vectorize, instead of striding through the image one
+ * column at a time.
+ */
+static void
+binary_dt_1st_pass_cols (gsize    offset,
+                         gsize    size,
+                         gpointer user_data)
+{
+  DTPassData   *data     = user_data;
+  gint          width    = data->width;
+  gint          height   = data->height;
+  gfloat        thres_lo = data->thres_lo;
+  const gfloat *src      = data->src;
+  gfloat       *dest     = data->dest;
+  gint          x0       = offset;
+  gint          x1       = offset + size;
+  gint          x, y;
+
+  /* consider out-of-range as 0, i.e. the outside is "empty" */
+  for (x = x0; x < x1; x++)
+    dest[x] = src[x] > thres_lo ? 1.0 : 0.0;
+
+  for (y = 1; y < height; y++)
     {
-      /* consider out-of-range as 0, i.e. the outside is "empty" */
-      dest[x + 0 * width] = src[x + 0 * width] > thres_lo ? 1.0 : 0.0;
+      const gfloat *s    = src  + y * width;
+      gfloat       *d    = dest + y * width;
+      const gfloat *prev = d - width;
 
-      for (y = 1; y < height; y++)
-        {
-          if (src[x + y * width] > thres_lo)
-            dest[x + y * width] = 1.0 + dest[x + (y - 1) * width];
-          else
-            dest[x + y * width] = 0.0;
-        }
+      for (x = x0; x < x1; x++)
+        d[x] = s[x] > thres_lo ? 1.0 + prev[x] : 0.0;
+    }
 
-      dest[x + (height - 1) * width] = MIN (dest[x + (height - 1) * width], 1.0);
-      for (y = height - 2; y >= 0; y--)
-        {
-          if (dest[x + (y + 1) * width] + 1.0 < dest[x + y * width])
-            dest [x + y * width] = dest[x + (y + 1) * width] + 1.0;
-        }
+  for (x = x0; x < x1; x++)
+    dest[x + (height - 1) * width] = MIN (dest[x + (height - 1) * width], 1.0);
+
+  for (y = height - 2; y >= 0; y--)
+    {
+      gfloat       *d    = dest + y * width;
+      const gfloat *next = d + width;
+
+      for (x = x0; x < x1; x++)
+        d[x] = MIN (d[x], next[x] + 1.0);
     }
 }
 
+static void
+binary_dt_1st_pass (DTPassData *data)
+{
+  gegl_parallel_distribute_range (data->width, 64,
+                                  binary_dt_1st_pass_cols, data);
+}
+
+
+static void
+find_maxval (gsize    offset,
+             gsize    size,
+             gpointer user_data)
+{
+  DTPassData *data   = user_data;
+  gfloat      maxval = EPSILON;
+  gsize       i;
+
+  for (i = offset; i < offset + size; i++)
+    maxval = MAX (data->dest[i], maxval);
+
+  G_LOCK (dt_maxval);
+  data->maxval = MAX (data->maxval, maxval);
+  G_UNLOCK (dt_maxval);
+}
+
+static void
+scale_values (gsize    offset,
+              gsize    size,
+              gpointer user_data)
+{
+  DTPassData *data  = user_data;
+  gfloat      scale = data->scale;
+  gsize       i;
+
+  for (i = offset; i < offset + size; i++)
+    data->dest[i] *= scale;
+}
+
 
 /**
  * Process the gegl filter
@@ -296,8 +385,8 @@ process (GeglOperation       *operation,
   const Babl  *input_format = babl_format ("Y float");
   const int bytes_per_pixel = babl_format_get_bytes_per_pixel (input_format);
 
-  GeglDTMetric metric;
-  gint     width, height, averaging, i;
+  DTPassData data;
+  gint     width, height, averaging;
   gfloat   threshold_lo, threshold_hi, maxval, *src_buf, *dst_buf;
   gboolean normalize;
 
@@ -307,7 +396,6 @@ process (GeglOperation       *operation,
   threshold_lo = o->threshold_lo;
   threshold_hi = o->threshold_hi;
   normalize    = o->normalize;
-  metric       = o->metric;
   averaging    = o->averaging;
 
   src_buf = gegl_malloc (width * height * bytes_per_pixel);
@@ -316,20 +404,32 @@ process (GeglOperation       *operation,
   gegl_buffer_get (input, result, 1.0, input_format, src_buf,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
+  data.width    = width;
+  data.height   = height;
+  data.metric   = o->metric;
+  data.src      = src_buf;
+  data.accum    = NULL;
+  data.maxval   = EPSILON;
+  data.scale    = 1.0;
+
   if (!averaging)
     {
-      binary_dt_1st_pass (width, height, threshold_lo,
-                          src_buf, dst_buf);
-      binary_dt_2nd_pass (width, height, threshold_lo, metric,
-                          src_buf, dst_buf);
+      data.thres_lo = threshold_lo;
+      data.dest     = dst_buf;
+
+      binary_dt_1st_pass (&data);
+      binary_dt_2nd_pass (&data);
     }
   else
     {
       gfloat *tmp_buf;
-      gint i, j;
+      gint i;
 
       tmp_buf = gegl_malloc (width * height * bytes_per_pixel);
 
+      data.dest  = tmp_buf;
+      data.accum = dst_buf;
+
       for (i = 0; i < averaging; i++)
         {
           gfloat thres;
@@ -337,24 +437,22 @@ process (GeglOperation       *operation,
           thres = (i+1) * (threshold_hi - threshold_lo) / (averaging + 1);
           thres += threshold_lo;
 
-          binary_dt_1st_pass (width, height, thres,
-                              src_buf, tmp_buf);
-          binary_dt_2nd_pass (width, height, thres, metric,
-                              src_buf, tmp_buf);
+          data.thres_lo = thres;
 
-          for (j = 0; j < width * height; j++)
-            dst_buf[j] += tmp_buf[j];
+          binary_dt_1st_pass (&data);
+          binary_dt_2nd_pass (&data);
         }
 
       gegl_free (tmp_buf);
     }
 
+  data.dest = dst_buf;
+
   if (normalize)
     {
-      maxval = EPSILON;
-
-      for (i = 0; i < width * height; i++)
-        maxval = MAX (dst_buf[i], maxval);
+      gegl_parallel_distribute_range ((gsize) width * height, 4096,
+                                      find_maxval, &data);
+      maxval = data.maxval;
     }
   else
     {
@@ -363,8 +461,9 @@ process (GeglOperation       *operation,
 
   if (averaging > 0 || normalize)
     {
-      for (i = 0; i < width * height; i++)
-        dst_buf[i] = dst_buf[i] * threshold_hi / maxval;
+      data.scale = threshold_hi / maxval;
+      gegl_parallel_distribute_range ((gsize) width * height, 4096,
+                                      scale_values, &data);
     }
 
   gegl_buffer_set (output, result, 0, input_format, dst_buf,
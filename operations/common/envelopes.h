@@ -14,6 +14,21 @@
  * Copyright 2007, 2009 Øyvind Kolås     <pippin@gimp.org>
  */
 
+/* The envelopes are computed from linear RGBA float copies of the source
+ * area a chunk depends on, fetched once per chunk, instead of going through
+ * a sampler for every spray sample. When the neighbourhood is very large,
+ * the spray is taken from a lower resolution mipmap level of the source,
+ * bounding the memory needed per chunk.
+ *
+ * The spray for a pixel is determined by its position relative to the
+ * bounding box of the input, and the lookup tables are filled from a fixed
+ * seed, making the results reproducible and independent of the chunking,
+ * the order, or the threads, pixels are processed in.
+ */
+
+#define ENVELOPES_MAX_SPRAY_PIXELS (2 * 1024 * 1024)
+#define ENVELOPES_SEED             1
+
 #define ANGLE_PRIME  95273 /* the lookuptables are sized as primes to ensure */
 #define RADIUS_PRIME 29537 /* as good as possible variation when using both */
 
@@ -21,8 +36,8 @@ static gfloat   lut_cos[ANGLE_PRIME];
 static gfloat   lut_sin[ANGLE_PRIME];
 static gfloat   radiuses[RADIUS_PRIME];
 static gdouble  luts_computed = 0.0;
-static gint     angle_no=0;
-static gint     radius_no=0;
+
+G_LOCK_DEFINE_STATIC (luts);
 
 static void compute_luts(gdouble rgamma)
 {
@@ -31,10 +46,14 @@ static void compute_luts(gdouble rgamma)
   gfloat golden_angle = G_PI * (3-sqrt(5.0)); /* http://en.wikipedia.org/wiki/Golden_angle */
   gfloat angle = 0.0;
 
+  G_LOCK (luts);
+
   if (luts_computed==rgamma)
-    return;
-  luts_computed = rgamma;
-  rand = g_rand_new();
+    {
+      G_UNLOCK (luts);
+      return;
+    }
+  rand = g_rand_new_with_seed (ENVELOPES_SEED);
 
   for (i=0;i<ANGLE_PRIME;i++)
     {
@@ -49,81 +68,183 @@ static void compute_luts(gdouble rgamma)
 
   g_rand_free(rand);
 
+  luts_computed = rgamma;
+
+  G_UNLOCK (luts);
+}
+
+typedef struct
+{
+  GeglRectangle  rect;         /* the area, in level coordinates */
+  GeglRectangle  bounds;       /* the input bounding box, in level coordinates */
+  gfloat        *center;       /* the pixels of the area that are processed */
+  GeglRectangle  center_rect;
+  gfloat        *spray;        /* the area, at 1 / (1 << spray_shift) scale */
+  gint           spray_width;
+  gint           spray_height;
+  gint           spray_shift;
+} EnvelopesSource;
+
+static inline gfloat *
+envelopes_get_pixels (GeglBuffer          *buffer,
+                      const GeglRectangle *rect,
+                      gint                 level)
+{
+  gfloat *buf = gegl_malloc (sizeof (gfloat) * 4 * rect->width * rect->height);
+
+  gegl_buffer_get (buffer, rect, 1.0 / (1 << level),
+                   babl_format ("RGBA float"), buf,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  return buf;
 }
 
+/* Fetches the source data needed to compute the envelopes of the pixels in
+ * dst_rect, with src_rect being the area dst_rect depends on, both in the
+ * coordinates of the given level. bounds is the bounding box of the input,
+ * at level 0.
+ */
 static inline void
-sample_min_max (GeglBuffer  *buffer,
-                GeglSampler *sampler,
-                gint         x,
-                gint         y,
-                gint         radius,
-                gint         samples,
-                gfloat      *min,
-                gfloat      *max,
-                gfloat      *pixel,
-                const Babl  *format)
+envelopes_source_init (EnvelopesSource     *source,
+                       GeglBuffer          *buffer,
+                       const GeglRectangle *bounds,
+                       const GeglRectangle *src_rect,
+                       const GeglRectangle *dst_rect,
+                       gint                 level)
 {
-  gfloat best_min[3];
-  gfloat best_max[3];
-  gint width = gegl_buffer_get_width (buffer);
-  gint height = gegl_buffer_get_height (buffer);
-  
-  gint i, c;
+  GeglRectangle spray_rect;
+  gint          shift = 0;
+
+  while ((gint64) (src_rect->width  >> shift) *
+                  (src_rect->height >> shift) > ENVELOPES_MAX_SPRAY_PIXELS)
+    shift++;
+
+  source->rect          = *src_rect;
+  source->bounds.x      = bounds->x >> level;
+  source->bounds.y      = bounds->y >> level;
+  source->bounds.width  = MAX (bounds->width  >> level, 1);
+  source->bounds.height = MAX (bounds->height >> level, 1);
+  source->spray_shift   = shift;
+
+  if (shift == 0)
+    {
+      source->spray        = envelopes_get_pixels (buffer, src_rect, level);
+      source->spray_width  = src_rect->width;
+      source->spray_height = src_rect->height;
+      source->center       = source->spray;
+      source->center_rect  = *src_rect;
+      return;
+    }
+
+  spray_rect.x      = src_rect->x >> shift;
+  spray_rect.y      = src_rect->y >> shift;
+  spray_rect.width  = ((src_rect->x + src_rect->width  - 1) >> shift) -
+                      spray_rect.x + 1;
+  spray_rect.height = ((src_rect->y + src_rect->height - 1) >> shift) -
+                      spray_rect.y + 1;
+
+  source->spray        = envelopes_get_pixels (buffer, &spray_rect,
+                                               level + shift);
+  source->spray_width  = spray_rect.width;
+  source->spray_height = spray_rect.height;
+  source->center       = envelopes_get_pixels (buffer, dst_rect, level);
+  source->center_rect  = *dst_rect;
+}
+
+static inline void
+envelopes_source_clear (EnvelopesSource *source)
+{
+  if (source->center != source->spray)
+    gegl_free (source->center);
+  gegl_free (source->spray);
+
+  source->center = NULL;
+  source->spray  = NULL;
+}
+
+static inline void
+sample_min_max (const EnvelopesSource *source,
+                gint                   x,
+                gint                   y,
+                gint                   radius,
+                gint                   samples,
+                gint                   iteration,
+                gint                   iterations,
+                const gfloat          *center,
+                gfloat                *min,
+                gfloat                *max)
+{
+  const gfloat *spray        = source->spray;
+  const gint    spray_width  = source->spray_width;
+  const gint    spray_height = source->spray_height;
+  const gint    shift        = source->spray_shift;
+  const gfloat  spray_radius = (gfloat) radius / (1 << shift);
+  const gint    spray_x      = (x >> shift) - (source->rect.x >> shift);
+  const gint    spray_y      = (y >> shift) - (source->rect.y >> shift);
+  gfloat        best_min[3];
+  gfloat        best_max[3];
+  gint64        spray_no;
+  gint          angle_no;
+  gint          radius_no;
+  gint          i, c;
 
   for (c=0;c<3;c++)
     {
-      best_min[c]=pixel[c];
-      best_max[c]=pixel[c];
+      best_min[c]=center[c];
+      best_max[c]=center[c];
     }
 
+  spray_no  = (gint64) source->bounds.width * (y - source->bounds.y) +
+                                              (x - source->bounds.x);
+  spray_no  = (spray_no * iterations + iteration) * samples;
+  angle_no  = spray_no % ANGLE_PRIME;
+  radius_no = spray_no % RADIUS_PRIME;
+
+  /* pixels above or left of the bounding box, e.g. of an abyss chunk */
+  if (angle_no < 0)
+    angle_no += ANGLE_PRIME;
+  if (radius_no < 0)
+    radius_no += RADIUS_PRIME;
+
   for (i=0; i<samples; i++)
     {
-      gint u, v;
-      gint angle;
-      gfloat rmag;
-retry:                      /* if we've sampled outside the valid image
-                               area, we grab another sample instead, this
-                               should potentially work better than mirroring
-                               or extending the image
-                             */
+      const gfloat *pixel;
+      gint          u, v;
+      gint          angle;
+      gfloat        rmag;
+
       angle = angle_no++;
-      rmag = radiuses[radius_no++] * radius;
+      rmag = radiuses[radius_no++] * spray_radius;
 
       if (angle_no>=ANGLE_PRIME)
         angle_no=0;
       if (radius_no>=RADIUS_PRIME)
         radius_no=0;
 
-      u = x + rmag * lut_cos[angle];
-      v = y + rmag * lut_sin[angle];
+      u = spray_x + rmag * lut_cos[angle];
+      v = spray_y + rmag * lut_sin[angle];
 
-      if (u>=width ||
+      /* samples outside the valid image area, or fully transparent ones,
+       * do not contribute to the envelopes
+       */
+      if (u>=spray_width ||
           u<0 ||
-          v>=height ||
+          v>=spray_height ||
           v<0)
-        goto retry;
+        continue;
 
-      {
-        gfloat pixel[4];
-        gegl_sampler_get (sampler, u, v, NULL, (void*)(&pixel[0]), GEGL_ABYSS_CLAMP);
-
-        if (pixel[3]>0.0) /* ignore fully transparent pixels */
-          {
-            for (c=0;c<3;c++)
-              {
-                if (pixel[c]<best_min[c])
-                  best_min[c]=pixel[c];
-
-                if (pixel[c]>best_max[c])
-                  best_max[c]=pixel[c];
-              }
-          }
-        else
-          {
-            goto retry;
-          }
-      }
+      pixel = spray + 4 * (spray_width * v + u);
+
+      if (pixel[3]<=0.0)
+        continue;
+
+      for (c=0;c<3;c++)
+        {
+          best_min[c] = MIN (best_min[c], pixel[c]);
+          best_max[c] = MAX (best_max[c], pixel[c]);
+        }
     }
+
   for (c=0;c<3;c++)
     {
       min[c]=best_min[c];
@@ -131,46 +252,40 @@ retry:                      /* if we've sampled outside the valid image
     }
 }
 
-static inline void compute_envelopes (GeglBuffer *buffer,
-                                      GeglSampler *sampler,
-                                      gint     x,
-                                      gint     y,
-                                      gint     radius,
-                                      gint     samples,
-                                      gint     iterations,
-                                      gboolean same_spray,
-                                      gdouble  rgamma,
-                                      gfloat  *min_envelope,
-                                      gfloat  *max_envelope,
-                                      gfloat  *pixel,
-                                      const Babl *format)
+/* x and y are in the coordinates of the level the source was fetched at,
+ * and have to be within the dst_rect passed to envelopes_source_init ().
+ * compute_luts () has to be called before.
+ */
+static inline void compute_envelopes (const EnvelopesSource *source,
+                                      gint                   x,
+                                      gint                   y,
+                                      gint                   radius,
+                                      gint                   samples,
+                                      gint                   iterations,
+                                      gfloat                *min_envelope,
+                                      gfloat                *max_envelope,
+                                      gfloat                *pixel)
 {
   gint    i;
   gint    c;
   gfloat  range_sum[4]               = {0,0,0,0};
   gfloat  relative_brightness_sum[4] = {0,0,0,0};
 
-  gegl_sampler_get (sampler, x, y, NULL, (void*)(&pixel[0]), GEGL_ABYSS_CLAMP);
-
-  /* compute lookuptables for the gamma, currently not used/exposed
-   * as a tweakable property */
-  compute_luts(rgamma);
-
-  if (same_spray)
-    {
-      angle_no = 0;
-      radius_no = 0;
-    }
+  memcpy (pixel,
+          source->center + 4 * (source->center_rect.width *
+                                (y - source->center_rect.y) +
+                                (x - source->center_rect.x)),
+          sizeof (gfloat) * 4);
 
   for (i=0;i<iterations;i++)
     {
       gfloat min[3], max[3];
 
-      sample_min_max (buffer,
-                      sampler,
+      sample_min_max (source,
                       x, y,
                       radius, samples,
-                      min, max, pixel, format);
+                      i, iterations,
+                      pixel, min, max);
 
       for (c=0;c<3;c++)
         {
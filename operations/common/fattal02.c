@@ -56,6 +56,8 @@ property_double (noise, _("Noise"), 0.0)
 #include "gegl-debug.h"
 #include <stdlib.h>
 
+#include "pde-solver.h"
+
 static const gchar *OUTPUT_FORMAT   = "RGB float";
 static const gint   MINIMUM_PYRAMID = 32;
 
@@ -112,9 +114,7 @@ fattal02_set_array (gfloat *array,
                     guint   size,
                     gfloat  value)
 {
-  guint i;
-  for (i = 0; i < size; ++i)
-    array[i] = value;
+  pde_vector_set (size, array, value);
 }
 
 
@@ -123,9 +123,7 @@ fattal02_add_array (gfloat       *accum,
                     guint         size,
                     const gfloat *input)
 {
-  guint i;
-  for (i = 0; i < size; ++i)
-    accum[i] += input[i];
+  pde_vector_axpy (size, 1.0f, input, accum);
 }
 
 
@@ -142,17 +140,35 @@ fattal02_copy_array (const gfloat *input,
  * Full Multigrid Algorithm for solving partial differential equations
  */
 
+/* Input and output of the resampling kernels, which are distributed over
+ * bands of output rows.
+ */
+typedef struct
+{
+  const gfloat        *input;
+  const GeglRectangle *extent_i;
+  gfloat              *output;
+  const GeglRectangle *extent_o;
+  const gfloat        *F;
+  const gfloat        *U;
+} Fattal02RowData;
+
+
 static void
-fattal02_restrict (const gfloat        *input,
-                   const GeglRectangle *extent_i,
-                   gfloat              *output,
-                   const GeglRectangle *extent_o)
+fattal02_restrict_rows (gint     y0,
+                        gint     y1,
+                        gpointer user_data)
 {
-  const guint inRows = extent_i->height,
-              inCols = extent_i->width;
+  Fattal02RowData *data = user_data;
+
+  const gfloat *input  = data->input;
+  gfloat       *output = data->output;
 
-  const guint outRows = extent_o->height,
-              outCols = extent_o->width;
+  const guint inRows = data->extent_i->height,
+              inCols = data->extent_i->width;
+
+  const guint outRows = data->extent_o->height,
+              outCols = data->extent_o->width;
 
   const gfloat dx = (gfloat)inCols / (gfloat)outCols,
                dy = (gfloat)inRows / (gfloat)outRows;
@@ -162,8 +178,13 @@ fattal02_restrict (const gfloat        *input,
   gfloat sx, sy;
   guint   x,  y;
 
-  for (y = 0, sy = dy / 2 - 0.5; y < outRows; ++y, sy += dy)
+  /* sy is computed from y on every row, not accumulated, so that it
+   * doesn't depend on where the band of rows starts
+   */
+  for (y = y0; y < y1; ++y)
     {
+      sy = dy / 2 - 0.5 + y * dy;
+
       for (x = 0, sx = dx / 2 - 0.5; x < outCols; ++x, sx += dx )
         {
           gfloat pixVal = 0;
@@ -190,16 +211,35 @@ fattal02_restrict (const gfloat        *input,
 
 
 static void
-fattal02_prolongate (const gfloat        *input,
-                     const GeglRectangle *extent_i,
-                     gfloat              *output,
-                     const GeglRectangle *extent_o)
+fattal02_restrict (const gfloat        *input,
+                   const GeglRectangle *extent_i,
+                   gfloat              *output,
+                   const GeglRectangle *extent_o)
 {
+  Fattal02RowData data = { input, extent_i, output, extent_o, NULL, NULL };
+
+  pde_parallel_rows (extent_o->height, extent_o->width,
+                     fattal02_restrict_rows, &data);
+}
+
+
+static void
+fattal02_prolongate_rows (gint     y0,
+                          gint     y1,
+                          gpointer user_data)
+{
+  Fattal02RowData *data = user_data;
+
+  const GeglRectangle *extent_i = data->extent_i,
+                      *extent_o = data->extent_o;
+
+  const gfloat *input  = data->input;
+  gfloat       *output = data->output;
+
   gfloat dx = (gfloat)extent_i->width  / (gfloat)extent_o->width,
          dy = (gfloat)extent_i->height / (gfloat)extent_o->height;
 
-  const guint outRows = extent_o->height,
-              outCols = extent_o->width;
+  const guint outCols = extent_o->width;
 
   const gfloat inRows = extent_i->height,
                inCols = extent_i->width;
@@ -209,8 +249,11 @@ fattal02_prolongate (const gfloat        *input,
   gfloat sx, sy;
   guint   x,  y;
 
-  for (y = 0, sy = -dy / 2; y < outRows; ++y, sy += dy)
+  /* like in fattal02_restrict_rows (), independent of the band */
+  for (y = y0; y < y1; ++y)
     {
+      sy = -dy / 2 + y * dy;
+
       for (x = 0, sx = -dx / 2; x < outCols; ++x, sx += dx )
         {
           gfloat pixVal = 0;
@@ -242,6 +285,19 @@ fattal02_prolongate (const gfloat        *input,
 }
 
 
+static void
+fattal02_prolongate (const gfloat        *input,
+                     const GeglRectangle *extent_i,
+                     gfloat              *output,
+                     const GeglRectangle *extent_o)
+{
+  Fattal02RowData data = { input, extent_i, output, extent_o, NULL, NULL };
+
+  pde_parallel_rows (extent_o->height, extent_o->width,
+                     fattal02_prolongate_rows, &data);
+}
+
+
 static void
 fattal02_exact_solution (gfloat              *F,
                          const GeglRectangle *extent_f,
@@ -278,18 +334,25 @@ fattal02_smooth (gfloat              *U,
 
 
 static void
-fattal02_calculate_defect (gfloat              *D,
-                           const GeglRectangle *extent_d,
-                           gfloat              *U,
-                           const GeglRectangle *extent_u,
-                           gfloat              *F,
-                           const GeglRectangle *extent_f)
+fattal02_calculate_defect_rows (gint     y0,
+                                gint     y1,
+                                gpointer user_data)
 {
+  Fattal02RowData *data = user_data;
+
+  const GeglRectangle *extent_d = data->extent_o,
+                      *extent_u = data->extent_i,
+                      *extent_f = data->extent_i;
+
+  gfloat       *D = data->output;
+  const gfloat *U = data->U;
+  const gfloat *F = data->F;
+
   guint sx = extent_f->width,
         sy = extent_f->height;
   guint x, y;
 
-  for (y = 0; y < sy; ++y)
+  for (y = y0; y < y1; ++y)
     {
       for (x = 0; x < sx; ++x)
         {
@@ -310,6 +373,24 @@ fattal02_calculate_defect (gfloat              *D,
 }
 
 
+static void
+fattal02_calculate_defect (gfloat              *D,
+                           const GeglRectangle *extent_d,
+                           gfloat              *U,
+                           const GeglRectangle *extent_u,
+                           gfloat              *F,
+                           const GeglRectangle *extent_f)
+{
+  Fattal02RowData data = { NULL, extent_f, D, extent_d, F, U };
+
+  g_return_if_fail (extent_u->width  == extent_f->width &&
+                    extent_u->height == extent_f->height);
+
+  pde_parallel_rows (extent_f->height, extent_f->width,
+                     fattal02_calculate_defect_rows, &data);
+}
+
+
 static void
 fattal02_solve_pde_multigrid (gfloat              *F,
                               const GeglRectangle *extent_f,
@@ -482,12 +563,10 @@ asolve (gulong n,
         gfloat x[],
         gint   itrnsp)
 {
-  guint i;
-
-  for (i = 0; i < n; ++i)
-    x[i] = -4 * b[i];
+  pde_vector_scale (n, -4, b, x);
 }
 
+/* The discretized Poisson equation with Neumann boundary conditions. */
 static void
 atimes (guint  rows,
         guint  cols,
@@ -495,57 +574,7 @@ atimes (guint  rows,
         gfloat res[],
         gint   itrnsp)
 {
-  guint r, c;
-
-#define IDX(R,C) ((R) * cols + (C))
-
-  for (r = 1; r < rows - 1; ++r)
-    {
-      for (c = 1; c < cols - 1; ++c)
-        {
-          res[IDX (r,c)] = x[IDX (r-1,c)] + x[IDX (r+1,c)] +
-            x[IDX (r,c-1)] + x[IDX (r,c+1)] - 4*x[IDX (r,c)];
-        }
-    }
-
-  for (r = 1; r < rows - 1; ++r)
-    {
-      res[IDX (r, 0)] =     x[IDX (r - 1, 0)] +
-                            x[IDX (r + 1, 0)] +
-                            x[IDX (r    , 1)] -
-                        3 * x[IDX (r    , 0)];
-
-      res[IDX (r, cols - 1)] =     x[IDX (r - 1, cols - 1)] +
-                                   x[IDX (r + 1, cols - 1)] +
-                                   x[IDX (r    , cols - 2)] -
-                               3 * x[IDX (r    , cols - 1)];
-    }
-
-  for (c = 1; c < cols - 1; ++c)
-    {
-      res[IDX (0, c)] =     x[IDX (1, c    )] +
-                            x[IDX (0, c - 1)] +
-                            x[IDX (0, c + 1)] -
-                        3 * x[IDX (0, c     )];
-
-      res[IDX (rows - 1, c)] =     x[IDX (rows - 2, c    )] +
-                                   x[IDX (rows - 1, c - 1)] +
-                                   x[IDX (rows - 1, c + 1)] -
-                               3 * x[IDX (rows - 1, c    )];
-    }
-
-  res[IDX (0       ,        0)] =     x[IDX (1       ,        0)] +
-                                      x[IDX (0       ,        1)] -
-                                  2 * x[IDX (0       ,        0)];
-  res[IDX (rows - 1,        0)] =     x[IDX (rows - 2,        0)] +
-                                      x[IDX (rows - 1,        1)] -
-                                  2 * x[IDX (rows - 1,        0)];
-  res[IDX (0       , cols - 1)] =     x[IDX (1       , cols - 1)] +
-                                      x[IDX (0       , cols - 2)] -
-                                  2 * x[IDX (0       , cols - 1)];
-  res[IDX (rows - 1, cols - 1)] =     x[IDX (rows - 2, cols - 1)] +
-                                      x[IDX (rows - 1, cols - 2)] -
-                                  2 * x[IDX (rows - 1, cols - 1)];
+  pde_laplacian (cols, rows, x, res);
 }
 
 static gfloat
@@ -557,10 +586,7 @@ snrm (gulong n,
 
   if (itol <= 3)
     {
-      gfloat ans = 0.0;
-      for (i = 0; i < n; ++i)
-          ans += sx[i] * sx[i];
-      return sqrtf (ans);
+      return sqrtf (pde_vector_dot (n, sx, sx));
     }
   else
     {
@@ -644,47 +670,32 @@ linbcg (guint   rows,
 
       zm1nrm = znrm;
       asolve (n, rr, zz, 1);
-      for (bknum = 0.0, j = 0; j < n; ++j)
-        {
-          bknum += z[j] * rr[j];
-        }
+      bknum = pde_vector_dot (n, z, rr);
 
       if (*iter == 1)
         {
-          for (j = 0; j < n; ++j)
-            {
-               p[j] =  z[j];
-              pp[j] = zz[j];
-            }
+          fattal02_copy_array ( z, n,  p);
+          fattal02_copy_array (zz, n, pp);
         }
       else
         {
           bk = bknum / bkden;
 
-          for (j = 0; j < n; ++j)
-            {
-               p[j] = bk *  p[j] +  z[j];
-              pp[j] = bk * pp[j] + zz[j];
-            }
+          pde_vector_xpby (n,  z, bk,  p);
+          pde_vector_xpby (n, zz, bk, pp);
         }
 
       bkden = bknum;
       atimes (rows, cols, p, z, 0);
 
-      for (akden = 0.0, j = 0; j < n; ++j)
-        {
-          akden += z[j] * pp[j];
-        }
+      akden = pde_vector_dot (n, z, pp);
 
       ak = bknum / akden;
       atimes (rows, cols, pp, zz, 1);
 
-      for (j = 0; j < n; ++j)
-        {
-           x[j] += ak *  p[j];
-           r[j] -= ak *  z[j];
-          rr[j] -= ak * zz[j];
-        }
+      pde_vector_axpy (n,  ak,  p,  x);
+      pde_vector_axpy (n, -ak,  z,  r);
+      pde_vector_axpy (n, -ak, zz, rr);
 
       asolve (n, r, z, 0);
 
@@ -49,11 +49,7 @@ property_double (detail, _("Detail"), 1.0)
 #include <stdio.h>
 #include <stdlib.h>
 
-#ifdef HAVE_OPENMP
-#define _OMP(x) _Pragma(#x)
-#else
-#define _OMP(x) /* OMP disabled: "#x" */
-#endif
+#include "pde-solver.h"
 
 /* Common return codes for operators */
 #define PFSTMO_OK 1             /* Successful */
@@ -224,17 +220,31 @@ static gfloat R_table[] =
 };
 
 
+typedef struct
+{
+  gint          cols;
+  gint          rows;
+  const gfloat *in;
+  gfloat       *out;
+} MantiukResampleData;
+
+
 /* upsample the matrix
  * upsampled matrix is twice bigger in each direction than data[]
  * res should be a pointer to allocated memory for bigger matrix
  * cols and rows are the dimmensions of the output matrix
  */
 static void
-mantiuk06_matrix_upsample (const gint          outCols,
-                           const gint          outRows,
-                           const gfloat *const in,
-                           gfloat       *const out)
+mantiuk06_matrix_upsample_rows (gint     y0,
+                                gint     y1,
+                                gpointer user_data)
 {
+  const MantiukResampleData *data = user_data;
+  const gint          outCols = data->cols;
+  const gint          outRows = data->rows;
+  const gfloat *const in      = data->in;
+  gfloat       *const out     = data->out;
+
   const int inRows = outRows/2;
   const int inCols = outCols/2;
   gint      x, y;
@@ -253,8 +263,7 @@ mantiuk06_matrix_upsample (const gint          outCols,
                                          * best.
                                          */
 
-  _OMP (omp parallel for schedule(static))
-  for (y = 0; y < outRows; y++)
+  for (y = y0; y < y1; y++)
     {
       const gfloat sy  = y * dy;
       const gint   iy1 =      (  y   * inRows) / outRows;
@@ -275,14 +284,30 @@ mantiuk06_matrix_upsample (const gint          outCols,
     }
 }
 
+static void
+mantiuk06_matrix_upsample (const gint          outCols,
+                           const gint          outRows,
+                           const gfloat *const in,
+                           gfloat       *const out)
+{
+  MantiukResampleData data = { outCols, outRows, in, out };
+
+  pde_parallel_rows (outRows, outCols, mantiuk06_matrix_upsample_rows, &data);
+}
+
 
 /* downsample the matrix */
 static void
-mantiuk06_matrix_downsample (const gint          inCols,
-                             const gint          inRows,
-                             const gfloat *const data,
-                             gfloat       *const res)
+mantiuk06_matrix_downsample_rows (gint     y0,
+                                  gint     y1,
+                                  gpointer user_data)
 {
+  const MantiukResampleData *rdata = user_data;
+  const gint          inCols = rdata->cols;
+  const gint          inRows = rdata->rows;
+  const gfloat *const data   = rdata->in;
+  gfloat       *const res    = rdata->out;
+
   const int outRows = inRows / 2;
   const int outCols = inCols / 2;
   gint      x, y, i, j;
@@ -308,8 +333,8 @@ mantiuk06_matrix_downsample (const gint          inCols,
    */
 
   const gfloat normalize = 1.0f/(dx*dy);
-  _OMP (omp parallel for schedule(static))
-  for (y = 0; y < outRows; y++)
+
+  for (y = y0; y < y1; y++)
     {
       const gint   iy1 = (  y   * inRows) / outRows;
       const gint   iy2 = ((y+1) * inRows) / outRows;
@@ -372,6 +397,18 @@ mantiuk06_matrix_downsample (const gint          inCols,
     }
 }
 
+static void
+mantiuk06_matrix_downsample (const gint          inCols,
+                             const gint          inRows,
+                             const gfloat *const data,
+                             gfloat       *const res)
+{
+  MantiukResampleData rdata = { inCols, inRows, data, res };
+
+  pde_parallel_rows (inRows / 2, inCols / 2,
+                     mantiuk06_matrix_downsample_rows, &rdata);
+}
+
 
 /* return = a - b */
 static inline void
@@ -379,11 +416,7 @@ mantiuk06_matrix_subtract (const guint         n,
                            const gfloat *const a,
                            gfloat       *const b)
 {
-  guint i;
-
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    b[i] = a[i] - b[i];
+  pde_vector_subtract (n, a, b);
 }
 
 /* copy matix a to b, return = a  */
@@ -401,10 +434,7 @@ mantiuk06_matrix_multiply_const (const guint         n,
                                  gfloat       *const a,
                                  const gfloat        val)
 {
-  guint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    a[i] *= val;
+  pde_vector_scale (n, val, a, a);
 }
 
 /* b = a[i] / b[i] */
@@ -413,10 +443,7 @@ mantiuk06_matrix_divide (const guint         n,
                          const gfloat *const a,
                          gfloat       *const b)
 {
-  guint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-      b[i] = a[i] / b[i];
+  pde_vector_divide (n, a, b);
 }
 
 
@@ -440,14 +467,7 @@ mantiuk06_matrix_dot_product (const guint         n,
                               const gfloat *const a,
                               const gfloat *const b)
 {
-  gfloat val = 0;
-  guint j;
-
-  _OMP (omp parallel for reduction(+:val) schedule(static))
-  for (j = 0; j < n; j++)
-    val += a[j] * b[j];
-
-  return val;
+  return pde_vector_dot (n, a, b);
 }
 
 /* set zeros for matrix elements */
@@ -468,29 +488,7 @@ mantiuk06_calculate_and_add_divergence (const gint          cols,
                                         const gfloat *const Gy,
                                         gfloat       *const divG)
 {
-  gint ky, kx;
-
-  _OMP (omp parallel for schedule(static))
-  for (ky = 0; ky < rows; ky++)
-    {
-      for (kx = 0; kx<cols; kx++)
-        {
-          gfloat divGx, divGy;
-          const int idx = kx + ky*cols;
-
-          if (kx == 0)
-            divGx = Gx[idx];
-          else
-            divGx = Gx[idx] - Gx[idx-1];
-
-          if (ky == 0)
-            divGy = Gy[idx];
-          else
-            divGy = Gy[idx] - Gy[idx - cols];
-
-          divG[idx] += divGx + divGy;
-        }
-    }
+  pde_add_divergence (cols, rows, Gx, Gy, divG);
 }
 
 /* calculate the sum of divergences for the all pyramid level. the smaller
@@ -565,19 +563,28 @@ mantiuk06_pyramid_calculate_divergence_sum (pyramid_t *pyramid,
  * C is equal to EDGE_WEIGHT for gradients smaller than GFIXATE or
  * 1.0 otherwise
  */
-static inline void
-mantiuk06_calculate_scale_factor (const gint          n,
-                                  const gfloat *const G,
-                                  gfloat       *const C)
+typedef struct
+{
+  const gfloat *G;
+  gfloat       *C;
+} MantiukScaleFactorData;
+
+static void
+mantiuk06_calculate_scale_factor_range (gsize    offset,
+                                        gsize    size,
+                                        gpointer user_data)
 {
+  const MantiukScaleFactorData *data = user_data;
+  const gfloat *const G = data->G;
+  gfloat       *const C = data->C;
+
   const gfloat detectT = 0.001f;
   const gfloat a = 0.038737;
   const gfloat b = 0.537756;
 
-  gint i;
+  gsize i;
 
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
+  for (i = offset; i < offset + size; i++)
     {
 #if 1
       const gfloat g = MAX (detectT, fabsf (G[i]));
@@ -594,6 +601,18 @@ mantiuk06_calculate_scale_factor (const gint          n,
     }
 }
 
+static inline void
+mantiuk06_calculate_scale_factor (const gint          n,
+                                  const gfloat *const G,
+                                  gfloat       *const C)
+{
+  MantiukScaleFactorData data = { G, C };
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  mantiuk06_calculate_scale_factor_range,
+                                  &data);
+}
+
 /* calculate scale factor for the whole pyramid */
 static void
 mantiuk06_pyramid_calculate_scale_factor (pyramid_t *pyramid,
@@ -617,10 +636,7 @@ mantiuk06_scale_gradient (const gint          n,
                           gfloat       *const G,
                           const gfloat *const C)
 {
-  gint i;
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    G[i] *= C[i];
+  pde_vector_multiply (n, C, G);
 }
 
 /* scale gradients for the whole one pyramid with the use of (Cx,Cy) from the
@@ -714,26 +730,7 @@ mantiuk06_calculate_gradient (const gint          cols,
                               gfloat       *const Gx,
                               gfloat       *const Gy)
 {
-  gint ky, kx;
-
-  _OMP (omp parallel for schedule(static))
-  for (ky = 0; ky < rows; ky++)
-    {
-      for (kx = 0; kx < cols; kx++)
-        {
-          const gint idx = kx + ky*cols;
-
-          if (kx == (cols - 1))
-            Gx[idx] = 0;
-          else
-            Gx[idx] = lum[idx+1] - lum[idx];
-
-          if (ky == (rows - 1))
-            Gy[idx] = 0;
-          else
-            Gy[idx] = lum[idx + cols] - lum[idx];
-        }
-    }
+  pde_gradient (cols, rows, lum, Gx, Gy);
 }
 
 
@@ -786,11 +783,7 @@ mantiuk06_solveX (const gint          n,
                   const gfloat *const b,
                   gfloat       *const x)
 {
-  gint i;
-
-  _OMP (omp parallel for schedule(static))
-  for (i = 0; i < n; i++)
-    x[i] = -0.25f * b[i];
+  pde_vector_scale (n, -0.25f, b, x);
 }
 
 /* divG_sum = A * x = sum (divG (x))
@@ -858,7 +851,6 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
 
   for (; iter < itmax; iter++)
     {
-      guint i;
       gfloat bknum, ak, old_err2;
 
       if (progress_cb != NULL)
@@ -879,12 +871,8 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
         {
           const gfloat bk = bknum / bkden; /* beta = ...  */
 
-          _OMP (omp parallel for schedule(static))
-          for (i = 0; i < n; i++)
-            {
-              p[i]  =  z[i] + bk *  p[i];
-              pp[i] = zz[i] + bk * pp[i];
-            }
+          pde_vector_xpby (n,  z, bk,  p);
+          pde_vector_xpby (n, zz, bk, pp);
         }
 
       bkden = bknum; /* numerator becomes the dominator for the next iteration */
@@ -894,12 +882,8 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
 
       ak = bknum / mantiuk06_matrix_dot_product (n, z, pp); /* alfa = ...   */
 
-      _OMP (omp parallel for schedule(static))
-      for (i = 0 ; i < n ; i++ )
-        {
-          r[i]  -= ak *  z[i];  /*  r =  r - alfa *  z  */
-          rr[i] -= ak * zz[i];  /* rr = rr - alfa * zz  */
-        }
+      pde_vector_axpy (n, -ak,  z,  r);  /*  r =  r - alfa *  z  */
+      pde_vector_axpy (n, -ak, zz, rr);  /* rr = rr - alfa * zz  */
 
       old_err2 = err2;
       err2 = mantiuk06_matrix_dot_product (n, r, r);
@@ -921,9 +905,7 @@ mantiuk06_linbcg (pyramid_t           *pyramid,
           num_backwards = 0;
         }
 
-      _OMP (omp parallel for schedule(static))
-      for (i = 0 ; i < n ; i++ )
-        x[i] += ak * p[i];      /* x =  x + alfa * p */
+      pde_vector_axpy (n, ak, p, x);     /* x =  x + alfa * p */
 
       if (num_backwards > num_backwards_ceiling)
         {
@@ -1031,7 +1013,6 @@ mantiuk06_lincg (pyramid_t           *pyramid,
   percent_sf = 100.0f / logf (tol2 * bnrm2 / irdotr);
   for (; iter < itmax; iter++)
     {
-      gint  i;
       gfloat alpha, old_rdotr;
 
       if (progress_cb != NULL) {
@@ -1047,9 +1028,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
       alpha = rdotr / mantiuk06_matrix_dot_product (n, p, Ap);
 
       /* r = r - alpha Ap */
-      _OMP (omp parallel for schedule(static))
-      for (i = 0; i < n; i++)
-        r[i] -= alpha * Ap[i];
+      pde_vector_axpy (n, -alpha, Ap, r);
 
       /* rdotr = r.r */
       old_rdotr = rdotr;
@@ -1073,9 +1052,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
         }
 
       /* x = x + alpha p */
-      _OMP (omp parallel for schedule(static))
-      for (i = 0; i < n; i++)
-        x[i] += alpha * p[i];
+      pde_vector_axpy (n, alpha, p, x);
 
 
       /* Exit if we're done */
@@ -1106,9 +1083,7 @@ mantiuk06_lincg (pyramid_t           *pyramid,
           /* p = r + beta p */
           const gfloat beta = rdotr/old_rdotr;
 
-          _OMP (omp parallel for schedule(static))
-          for (i = 0; i < n; i++)
-            p[i] = r[i] + beta*p[i];
+          pde_vector_xpby (n, r, beta, p);
         }
     }
 
@@ -1169,14 +1144,15 @@ mantiuk06_lookup_table (const gint          n,
 
 
 /* transform gradient (Gx,Gy) to R */
-static inline void
-mantiuk06_transform_to_R (const gint        n,
-                          gfloat     *const G)
+static void
+mantiuk06_transform_to_R_range (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
 {
-  gint j;
+  gfloat *const G = user_data;
+  gsize         j;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
+  for (j = offset; j < offset + size; j++)
     {
       /* G to W */
       const gfloat absG = fabsf (G[j]);
@@ -1200,6 +1176,14 @@ mantiuk06_transform_to_R (const gint        n,
     }
 }
 
+static inline void
+mantiuk06_transform_to_R (const gint        n,
+                          gfloat     *const G)
+{
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  mantiuk06_transform_to_R_range, G);
+}
+
 /* transform gradient (Gx,Gy) to R for the whole pyramid */
 static inline void
 mantiuk06_pyramid_transform_to_R (pyramid_t *pyramid)
@@ -1214,14 +1198,15 @@ mantiuk06_pyramid_transform_to_R (pyramid_t *pyramid)
 }
 
 /* transform from R to G */
-static inline void
-mantiuk06_transform_to_G (const gint        n,
-                          gfloat     *const R)
+static void
+mantiuk06_transform_to_G_range (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
 {
-  gint j;
+  gfloat *const R = user_data;
+  gsize         j;
 
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++){
+  for (j = offset; j < offset + size; j++){
     /* RESP to W */
     gint sign;
     if (R[j] < 0)
@@ -1243,6 +1228,14 @@ mantiuk06_transform_to_G (const gint        n,
   }
 }
 
+static inline void
+mantiuk06_transform_to_G (const gint        n,
+                          gfloat     *const R)
+{
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  mantiuk06_transform_to_G_range, R);
+}
+
 /* transform from R to G for the pyramid */
 static inline void
 mantiuk06_pyramid_transform_to_G (pyramid_t *pyramid)
@@ -1347,13 +1340,70 @@ mantiuk06_hist_data_index (const void *const v1,
 }
 
 
+typedef struct
+{
+  pyramid_t        *level;
+  struct hist_data *hist;
+  gint              offset; /* of the entries of level in hist */
+  gfloat            factor;
+} MantiukHistData;
+
+static void
+mantiuk06_hist_build_range (gsize    offset,
+                            gsize    size,
+                            gpointer user_data)
+{
+  const MantiukHistData *data = user_data;
+  const pyramid_t       *l    = data->level;
+  gsize                  c;
+
+  for (c = offset; c < offset + size; c++)
+    {
+      data->hist[c + data->offset].size  = sqrtf (l->Gx[c] * l->Gx[c] +
+                                                  l->Gy[c] * l->Gy[c]);
+      data->hist[c + data->offset].index = c + data->offset;
+    }
+}
+
+static void
+mantiuk06_hist_cdf_range (gsize    offset,
+                          gsize    size,
+                          gpointer user_data)
+{
+  const MantiukHistData *data = user_data;
+  gsize                  i;
+
+  for (i = offset; i < offset + size; i++)
+    data->hist[i].cdf = ((gfloat) i) * data->factor;
+}
+
+static void
+mantiuk06_hist_remap_range (gsize    offset,
+                            gsize    size,
+                            gpointer user_data)
+{
+  const MantiukHistData *data = user_data;
+  pyramid_t             *l    = data->level;
+  gsize                  c;
+
+  for (c = offset; c < offset + size; c++)
+    {
+      const gfloat scale = data->factor                  *
+                           data->hist[c + data->offset].cdf  /
+                           data->hist[c + data->offset].size;
+      l->Gx[c] *= scale;
+      l->Gy[c] *= scale;
+    }
+}
+
 static void
 mantiuk06_contrast_equalization (pyramid_t   *pp,
                                  const gfloat  contrastFactor )
 {
-  gint              i, idx;
+  gint              idx;
   struct hist_data *hist;
   gint              total_pixels = 0;
+  MantiukHistData   data;
 
   /* Count sizes */
   pyramid_t *l = pp;
@@ -1369,19 +1419,15 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   /* Build histogram info */
   l   = pp;
   idx = 0;
+  data.hist = hist;
   while (l != NULL)
     {
       const int pixels = l->rows*l->cols;
-      const int offset = idx;
-      gint      c;
 
-      _OMP (omp parallel for schedule(static))
-      for (c = 0; c < pixels; c++)
-        {
-          hist[c+offset].size = sqrtf (l->Gx[c] * l->Gx[c] +
-                                       l->Gy[c] * l->Gy[c]);
-          hist[c+offset].index = c + offset;
-        }
+      data.level  = l;
+      data.offset = idx;
+      gegl_parallel_distribute_range (pixels, PDE_MIN_SUB_SIZE,
+                                      mantiuk06_hist_build_range, &data);
       idx += pixels;
       l = l->next;
     }
@@ -1391,12 +1437,9 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
          mantiuk06_hist_data_order);
 
   /* Calculate cdf */
-  {
-    const gfloat norm = 1.0f / (gfloat) total_pixels;
-    _OMP (omp parallel for schedule(static))
-    for (i = 0; i < total_pixels; i++)
-      hist[i].cdf = ((gfloat) i) * norm;
-  }
+  data.factor = 1.0f / (gfloat) total_pixels;
+  gegl_parallel_distribute_range (total_pixels, PDE_MIN_SUB_SIZE,
+                                  mantiuk06_hist_cdf_range, &data);
 
   /* Recalculate in terms of indexes */
   qsort (hist, total_pixels,
@@ -1406,21 +1449,15 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
   /*Remap gradient magnitudes */
   l   = pp;
   idx = 0;
+  data.factor = contrastFactor;
   while (l != NULL )
     {
-      gint      c;
       const int pixels = l->rows*l->cols;
-      const int offset = idx;
 
-      _OMP (omp parallel for schedule(static))
-      for (c = 0; c < pixels; c++)
-        {
-          const gfloat scale = contrastFactor      *
-                               hist[c+offset].cdf  /
-                               hist[c+offset].size;
-          l->Gx[c] *= scale;
-          l->Gy[c] *= scale;
-        }
+      data.level  = l;
+      data.offset = idx;
+      gegl_parallel_distribute_range (pixels, PDE_MIN_SUB_SIZE,
+                                      mantiuk06_hist_remap_range, &data);
       idx += pixels;
       l    = l->next;
     }
@@ -1429,6 +1466,69 @@ mantiuk06_contrast_equalization (pyramid_t   *pp,
 }
 
 
+typedef struct
+{
+  gfloat *rgb;
+  gfloat *Y;
+  gfloat  clip_min;
+  gfloat  l_min;
+  gfloat  l_max;
+  gfloat  saturation;
+} MantiukContmapData;
+
+/* clip, divide the colors by the luminance and take its logarithm */
+static void
+mantiuk06_normalize_range (gsize    offset,
+                           gsize    size,
+                           gpointer user_data)
+{
+  const MantiukContmapData *data = user_data;
+  gfloat *const             rgb  = data->rgb;
+  gfloat *const             Y    = data->Y;
+  const gfloat              clip_min = data->clip_min;
+  gsize                     j, c;
+
+  for (j = offset; j < offset + size; j++)
+    {
+      for (c = 0; c < 4; c++)
+        if (G_UNLIKELY (rgb[j * 4 + c] < clip_min)) rgb[j * 4 + c] = clip_min;
+
+      if (G_UNLIKELY (  Y[j] < clip_min))   Y[j] = clip_min;
+
+      rgb[j * 4 + 0] /= Y[j];
+      rgb[j * 4 + 1] /= Y[j];
+      rgb[j * 4 + 2] /= Y[j];
+      Y[j]            = log10f (Y[j]);
+    }
+}
+
+/* scale the luminance to the display range, transform to linear RGB */
+static void
+mantiuk06_denormalize_range (gsize    offset,
+                             gsize    size,
+                             gpointer user_data)
+{
+  const MantiukContmapData *data = user_data;
+  gfloat *const             rgb  = data->rgb;
+  gfloat *const             Y    = data->Y;
+  const gfloat              disp_dyn_range = 2.3f;
+  gsize                     j;
+
+  for (j = offset; j < offset + size; j++)
+    {
+      /* x scaled */
+      Y[j] = ( Y[j] - data->l_min) /
+             (data->l_max - data->l_min) *
+             disp_dyn_range - disp_dyn_range;
+
+      Y[j] = powf (10,Y[j]);
+
+      rgb[j * 4 + 0] = powf (rgb[j * 4 + 0], data->saturation) * Y[j];
+      rgb[j * 4 + 1] = powf (rgb[j * 4 + 1], data->saturation) * Y[j];
+      rgb[j * 4 + 2] = powf (rgb[j * 4 + 2], data->saturation) * Y[j];
+    }
+}
+
 /* tone mapping */
 static int
 mantiuk06_contmap (const int                       c,
@@ -1445,30 +1545,17 @@ mantiuk06_contmap (const int                       c,
   const guint n = c*r;
         guint j;
 
+  MantiukContmapData data = { rgb, Y, 0.0f, 0.0f, 0.0f, saturationFactor };
+
   /* Normalize */
-  gfloat Ymax = Y[0],
-         clip_min;
+  gfloat Ymax = Y[0];
 
   for (j = 1; j < n; j++)
       Ymax = MAX (Y[j], Ymax);
 
-  clip_min = 1e-7f * Ymax;
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n * 4; j++)
-      if (G_UNLIKELY (rgb[j] < clip_min)) rgb[j] = clip_min;
-
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
-      if (G_UNLIKELY (  Y[j] < clip_min))   Y[j] = clip_min;
-
-  _OMP (omp parallel for schedule(static))
-  for (j = 0; j < n; j++)
-    {
-      rgb[j * 4 + 0] /= Y[j];
-      rgb[j * 4 + 1] /= Y[j];
-      rgb[j * 4 + 2] /= Y[j];
-      Y[j]            = log10f (Y[j]);
-    }
+  data.clip_min = 1e-7f * Ymax;
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  mantiuk06_normalize_range, &data);
 
   {
     /* create pyramid */
@@ -1522,26 +1609,12 @@ mantiuk06_contmap (const int                       c,
             temp[(int) ceilf (trim)] * (1.0f - delta);
 
     mantiuk06_matrix_free (temp);
-    {
-      const gfloat disp_dyn_range = 2.3f;
-      _OMP (omp parallel for schedule(static))
-      for (j = 0; j < n; j++)
-          /* x scaled */
-          Y[j] = ( Y[j] - l_min) /
-                 (l_max - l_min) *
-                 disp_dyn_range - disp_dyn_range;
-    }
 
     /* Transform to linear scale RGB */
-    _OMP (omp parallel for schedule(static))
-    for (j = 0; j < n; j++)
-      {
-        Y[j] = powf (10,Y[j]);
-
-        rgb[j * 4 + 0] = powf (rgb[j * 4 + 0], saturationFactor) * Y[j];
-        rgb[j * 4 + 1] = powf (rgb[j * 4 + 1], saturationFactor) * Y[j];
-        rgb[j * 4 + 2] = powf (rgb[j * 4 + 2], saturationFactor) * Y[j];
-      }
+    data.l_min = l_min;
+    data.l_max = l_max;
+    gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                    mantiuk06_denormalize_range, &data);
   }
 
   return PFSTMO_OK;
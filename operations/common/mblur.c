@@ -43,19 +43,46 @@ static void
 init (GeglProperties *o)
 {
   Priv         *priv = (Priv*)o->user_data;
-  GeglRectangle extent = {0,0,1024,1024};
 
   g_assert (priv == NULL);
 
   priv = g_new0 (Priv, 1);
   o->user_data = (void*) priv;
-
-  priv->acc = gegl_buffer_new (&extent, babl_format ("RGBA float"));
 }
 
 static void prepare (GeglOperation *operation)
 {
-  gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  const Babl     *format = babl_format ("RGBA float");
+  GeglRectangle  *in_rect;
+  Priv           *p;
+
+  gegl_operation_set_format (operation, "input", format);
+  gegl_operation_set_format (operation, "output", format);
+
+  if (o->user_data == NULL)
+    init (o);
+  p = (Priv*)o->user_data;
+
+  /* the accumulator covers the input, it grows with it; this is done here
+   * rather than in process (), which runs in several threads at once
+   */
+  in_rect = gegl_operation_source_get_bounding_box (operation, "input");
+  if (!in_rect || gegl_rectangle_is_empty (in_rect))
+    return;
+
+  if (!p->acc)
+    {
+      p->acc = gegl_buffer_new (in_rect, format);
+    }
+  else if (!gegl_rectangle_contains (gegl_buffer_get_extent (p->acc), in_rect))
+    {
+      GeglRectangle extent;
+
+      gegl_rectangle_bounding_box (&extent, in_rect,
+                                   gegl_buffer_get_extent (p->acc));
+      gegl_buffer_set_extent (p->acc, &extent);
+    }
 }
 
 static gboolean
@@ -65,41 +92,41 @@ process (GeglOperation       *operation,
          const GeglRectangle *result,
          gint                 level)
 {
-  GeglProperties *o;
-  Priv           *p;
+  GeglProperties     *o      = GEGL_PROPERTIES (operation);
+  Priv               *p      = (Priv*)o->user_data;
+  GeglBufferIterator *iter;
+  const Babl         *format = babl_format ("RGBA float");
+  gfloat              dampness;
+
+  /* prepare () found no input */
+  if (!p->acc)
+    {
+      gegl_buffer_copy (input, result, GEGL_ABYSS_NONE, output, result);
+      return TRUE;
+    }
 
-  o = GEGL_PROPERTIES (operation);
-  p = (Priv*)o->user_data;
-  if (p == NULL)
-    init (o);
-  p = (Priv*)o->user_data;
+  dampness = o->dampness;
+
+  /* blend only the region being processed, a tile at a time */
+  iter = gegl_buffer_iterator_new (output, result, 0, format,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+  gegl_buffer_iterator_add (iter, input, result, 0, format,
+                            GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  gegl_buffer_iterator_add (iter, p->acc, result, 0, format,
+                            GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
 
+  while (gegl_buffer_iterator_next (iter))
     {
-      GeglBuffer *temp_in;
-
-      temp_in = gegl_buffer_create_sub_buffer (input, result);
-
-      {
-        gint pixels = result->width * result->height;
-        gfloat *buf = g_new (gfloat, pixels * 4);
-        gfloat *acc = g_new (gfloat, pixels * 4);
-        gfloat dampness;
-        gint i;
-        gegl_buffer_get (p->acc, result, 1.0, babl_format ("RGBA float"), acc, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-        gegl_buffer_get (temp_in, result, 1.0, babl_format ("RGBA float"), buf, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-        dampness = o->dampness;
-        for (i=0;i<pixels;i++)
-          {
-            gint c;
-            for (c=0;c<4;c++)
-              acc[i*4+c]=acc[i*4+c]*dampness + buf[i*4+c]*(1.0-dampness);
-          }
-        gegl_buffer_set (p->acc, result, 0, babl_format ("RGBA float"), acc, GEGL_AUTO_ROWSTRIDE);
-        gegl_buffer_set (output, result, 0, babl_format ("RGBA float"), acc, GEGL_AUTO_ROWSTRIDE);
-        g_free (buf);
-        g_free (acc);
-      }
-      g_object_unref (temp_in);
+      gfloat *out = iter->data[0];
+      gfloat *in  = iter->data[1];
+      gfloat *acc = iter->data[2];
+      gint    i;
+
+      for (i = 0; i < iter->length * 4; i++)
+        {
+          acc[i] = acc[i] * dampness + in[i] * (1.0 - dampness);
+          out[i] = acc[i];
+        }
     }
 
   return  TRUE;
@@ -114,7 +141,8 @@ finalize (GObject *object)
     {
       Priv *p = (Priv*)o->user_data;
 
-      g_object_unref (p->acc);
+      if (p->acc)
+        g_object_unref (p->acc);
 
       g_free (o->user_data);
       o->user_data = NULL;
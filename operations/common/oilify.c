@@ -46,97 +46,136 @@ property_boolean (use_inten, _("Intensity Mode"), TRUE)
 #define GEGL_OP_C_SOURCE oilify.c
 
 #include "gegl-op.h"
+#include "gegl-parallel.h"
 #include <math.h>
 
 #define NUM_INTENSITIES       256
 
-/* Get the pixel from x, y offset from the center pixel src_pix */
+/* The histograms of the circular neighbourhood are maintained
+ * incrementally along each row: moving the center one pixel to the right
+ * only adds the pixels entering on the right edge of the circle, and
+ * removes the ones leaving on its left edge, instead of rebuilding the
+ * histograms from the whole neighbourhood for every pixel.
+ */
+typedef struct
+{
+  gint   hist[4][NUM_INTENSITIES];           /* one per channel, only the
+                                                first in intensity mode */
+  gfloat cumulative_rgb[4][NUM_INTENSITIES]; /* intensity mode only */
+} OilifyHistogram;
+
+typedef struct
+{
+  const GeglRectangle *result;
+  gint                 radius;
+  gint                 exponent;
+  gint                 intensities;
+  gint                 buf_width;
+  const gfloat        *src_buf;
+  const gfloat        *inten_buf;
+  gfloat              *dst_buf;
+  const gint          *half_widths; /* half width of the circle for each row
+                                       offset from -radius to radius */
+} OilifyData;
+
+static inline gint
+oilify_intensity (gfloat value,
+                  gint   intensities)
+{
+  return CLAMP (value, 0.0f, 1.0f) * (intensities - 1);
+}
+
+/* add (sign = 1) or remove (sign = -1) the pixels x0 to x1 of row y */
 static void
-get_pixel (gint    x,
-           gint    y,
-           gint    buf_width,
-           gfloat *src_begin,
-           gfloat *dst)
+oilify_histogram_update_span (OilifyHistogram  *hist,
+                              const OilifyData *data,
+                              gint              x0,
+                              gint              x1,
+                              gint              y,
+                              gint              sign)
 {
-  gint b;
-  gfloat* src = src_begin + 4*(x + buf_width*y);
-  for (b = 0; b < 4; b++)
+  const gint    intensities = data->intensities;
+  const gfloat *src         = data->src_buf + 4 * (x0 + data->buf_width * y);
+  gint          x, b;
+
+  if (data->inten_buf)
     {
-      dst[b] = src[b];
+      const gfloat *inten = data->inten_buf + (x0 + data->buf_width * y);
+
+      for (x = x0; x <= x1; x++, src += 4, inten++)
+        {
+          gint intensity = oilify_intensity (*inten, intensities);
+
+          hist->hist[0][intensity] += sign;
+          for (b = 0; b < 4; b++)
+            hist->cumulative_rgb[b][intensity] += sign * src[b];
+        }
+    }
+  else
+    {
+      for (x = x0; x <= x1; x++, src += 4)
+        {
+          for (b = 0; b < 4; b++)
+            hist->hist[b][oilify_intensity (src[b], intensities)] += sign;
+        }
     }
 }
+
 static void
-get_pixel_inten (gint    x,
-                 gint    y,
-                 gint    buf_width,
-                 gfloat *inten_begin,
-                 gfloat *dst)
+oilify_histogram_init (OilifyHistogram  *hist,
+                       const OilifyData *data,
+                       gint              x,
+                       gint              y)
 {
-  *dst = *(inten_begin + (x + buf_width*y));
+  gint j;
+
+  memset (hist, 0, sizeof (OilifyHistogram));
+
+  for (j = -data->radius; j <= data->radius; j++)
+    {
+      gint w = data->half_widths[j + data->radius];
+
+      oilify_histogram_update_span (hist, data, x - w, x + w, y + j, 1);
+    }
 }
+
+/* move the neighbourhood centered at x one pixel to the right */
 static void
-oilify_pixel_inten (gint     x,
-                    gint     y,
-                    gdouble  radius,
-                    gint     exponent,
-                    gint     intensities,
-                    gint     buf_width,
-                    gfloat  *src_buf,
-                    gfloat  *inten_buf,
-                    gfloat  *dst_pixel)
+oilify_histogram_slide (OilifyHistogram  *hist,
+                        const OilifyData *data,
+                        gint              x,
+                        gint              y)
+{
+  gint j;
+
+  for (j = -data->radius; j <= data->radius; j++)
+    {
+      gint w = data->half_widths[j + data->radius];
+
+      oilify_histogram_update_span (hist, data, x - w, x - w, y + j, -1);
+      oilify_histogram_update_span (hist, data, x + w + 1, x + w + 1, y + j, 1);
+    }
+}
+
+static void
+oilify_pixel_inten (const OilifyHistogram *hist,
+                    gint                   exponent,
+                    gint                   intensities,
+                    gfloat                *dst_pixel)
 {
-  gfloat cumulative_rgb[4][NUM_INTENSITIES];
-  gint   hist_inten[NUM_INTENSITIES];
   gfloat mult_inten;
-  gfloat temp_pixel[4];
-  gint   ceil_radius = ceil (radius);
-  gdouble radius_sq = radius*radius;
   gint i, j, b;
   gint inten_max;
-  gint intensity;
-  gfloat ratio, temp_inten_pixel;
+  gfloat ratio;
   gfloat weight;
   gfloat color[4];
   gfloat div;
-  for (i = 0; i < intensities; i++)
-    {
-      hist_inten[i] = 0;
-      for (b = 0; b < 4; b++)
-          cumulative_rgb[b][i] = 0.0;
-    }
-
-  /* calculate histograms */
-  for (i = -ceil_radius; i <= ceil_radius; i++)
-    {
-      for (j = -ceil_radius; j <= ceil_radius; j++)
-        {
-          if (i*i + j*j <= radius_sq)
-            {
-              get_pixel (x + i,
-                         y + j,
-                         buf_width,
-                         src_buf,
-                         temp_pixel);
-              get_pixel_inten (x + i,
-                               y + j,
-                               buf_width,
-                               inten_buf,
-                               &temp_inten_pixel);
-              intensity = temp_inten_pixel * (intensities - 1);
-              hist_inten[intensity]++;
-              for (b = 0; b < 4; b++)
-                {
-                  cumulative_rgb[b][intensity] += temp_pixel[b];
-                }
-            }
-        }
-    }
 
   inten_max = 1;
 
   /* calculated maximums */
   for (i = 0; i < intensities; i++) {
-    inten_max = MAX (inten_max, hist_inten[i]);
+    inten_max = MAX (inten_max, hist->hist[0][i]);
   }
 
   /* calculate weight and use it to set the pixel */
@@ -146,9 +185,9 @@ oilify_pixel_inten (gint     x,
     color[b] = 0.0;
   for (i = 0; i < intensities; i++)
     {
-      if (hist_inten[i] > 0)
+      if (hist->hist[0][i] > 0)
       {
-        ratio = (gfloat) hist_inten[i] / (gfloat) inten_max;
+        ratio = (gfloat) hist->hist[0][i] / (gfloat) inten_max;
 
         /* using this instead of pow function gives HUGE performance improvement
            but we cannot use floating point exponent... */
@@ -156,11 +195,11 @@ oilify_pixel_inten (gint     x,
         for(j = 0; j < exponent; j++)
           weight *= ratio;
         /* weight = powf(ratio, exponent); */
-        mult_inten = weight / (gfloat) hist_inten[i];
+        mult_inten = weight / (gfloat) hist->hist[0][i];
 
         div += weight;
         for (b = 0; b < 4; b++)
-          color[b] += mult_inten * cumulative_rgb[b][i];
+          color[b] += mult_inten * hist->cumulative_rgb[b][i];
       }
     }
   for (b = 0; b < 4; b++)
@@ -168,61 +207,25 @@ oilify_pixel_inten (gint     x,
 }
 
 static void
-oilify_pixel (gint           x,
-              gint           y,
-              gdouble        radius,
-              gint           exponent,
-              gint           intensities,
-              gint           buf_width,
-              gfloat        *src_buf,
-              gfloat        *dst_pixel)
+oilify_pixel (const OilifyHistogram *hist,
+              gint                   exponent,
+              gint                   intensities,
+              gfloat                *dst_pixel)
 {
-  gint   hist[4][NUM_INTENSITIES];
-  gfloat temp_pixel[4];
-  gint   ceil_radius = ceil (radius);
-  gdouble radius_sq = radius*radius;
   gint i, j, b;
   gint hist_max[4];
-  gint intensity;
   gfloat sum[4];
   gfloat ratio;
   gfloat weight;
   gfloat result[4];
   gfloat div[4];
-  for (i = 0; i < intensities; i++)
-    {
-      for (b = 0; b < 4; b++)
-        {
-          hist[b][i] = 0;
-        }
-    }
 
-  /* calculate histograms */
-  for (i = -ceil_radius; i <= ceil_radius; i++)
-    {
-      for (j = -ceil_radius; j <= ceil_radius; j++)
-        {
-          if (i*i + j*j <= radius_sq)
-            {
-              get_pixel (x + i,
-                         y + j,
-                         buf_width,
-                         src_buf,
-                         temp_pixel);
-              for (b = 0; b < 4; b++)
-                {
-                  intensity = temp_pixel[b] * (intensities - 1);
-                  hist[b][intensity]++;
-                }
-            }
-        }
-    }
     for (b = 0; b < 4; b++)
       hist_max[b] = 1;
     for (i = 0; i < intensities; i++) {
       for (b = 0; b < 4; b++)
-        if(hist_max[b] < hist[b][i]) /* MAX macros too slow here */
-          hist_max[b] = hist[b][i];
+        if(hist_max[b] < hist->hist[b][i]) /* MAX macros too slow here */
+          hist_max[b] = hist->hist[b][i];
     }
 
   /* calculate weight and use it to set the pixel */
@@ -235,9 +238,9 @@ oilify_pixel (gint           x,
     for (i = 0; i < intensities; i++)
       {
         /* UNROLL this bottleneck loop, up to 50% faster */
-        #define DO_HIST_STEP(b) if(hist[b][i] > 0)                          \
+        #define DO_HIST_STEP(b) if(hist->hist[b][i] > 0)                    \
           {                                                                 \
-            ratio = (gfloat) hist[b][i] / (gfloat) hist_max[b];             \
+            ratio = (gfloat) hist->hist[b][i] / (gfloat) hist_max[b];       \
             weight = 1.;                                                    \
             for(j = 0; j < exponent; j++)                                   \
               weight *= ratio;                                              \
@@ -259,6 +262,43 @@ oilify_pixel (gint           x,
       }
 }
 
+/* oilify the rows offset to offset + size of the result */
+static void
+oilify_rows (gsize    offset,
+             gsize    size,
+             gpointer user_data)
+{
+  const OilifyData *data = user_data;
+  OilifyHistogram  *hist = g_new (OilifyHistogram, 1);
+  gint              width = data->result->width;
+  gint              row;
+
+  for (row = offset; row < (gint) (offset + size); row++)
+    {
+      gint    y         = row + data->radius;
+      gfloat *out_pixel = data->dst_buf + 4 * width * row;
+      gint    x;
+
+      for (x = data->radius; x < width + data->radius; x++)
+        {
+          if (x == data->radius)
+            oilify_histogram_init (hist, data, x, y);
+          else
+            oilify_histogram_slide (hist, data, x - 1, y);
+
+          if (data->inten_buf)
+            oilify_pixel_inten (hist, data->exponent, data->intensities,
+                                out_pixel);
+          else
+            oilify_pixel (hist, data->exponent, data->intensities,
+                          out_pixel);
+          out_pixel += 4;
+        }
+    }
+
+  g_free (hist);
+}
+
 static void
 prepare (GeglOperation *operation)
 {
@@ -392,15 +432,15 @@ process (GeglOperation       *operation,
   GeglProperties *o                = GEGL_PROPERTIES (operation);
   GeglOperationAreaFilter *op_area = GEGL_OPERATION_AREA_FILTER (operation);
 
-  gint x = o->mask_radius; /* initial x                   */
-  gint y = o->mask_radius; /*           and y coordinates */
+  OilifyData data;
   gfloat *src_buf;
   gfloat *dst_buf;
   gfloat *inten_buf;
-  gfloat *out_pixel;
+  gint   *half_widths;
   gint n_pixels = result->width * result->height;
   GeglRectangle src_rect;
   gint total_pixels;
+  gint j;
 
   if (gegl_operation_use_opencl (operation))
     if (cl_process (operation, input, output, result))
@@ -427,31 +467,28 @@ process (GeglOperation       *operation,
     gegl_buffer_get (input, &src_rect, 1.0, babl_format ("Y float"),
                    inten_buf, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
 
-  out_pixel = dst_buf;
+  /* the circle contains the pixels with i*i + j*j <= radius*radius */
+  half_widths = g_new (gint, 2 * o->mask_radius + 1);
+  for (j = -o->mask_radius; j <= o->mask_radius; j++)
+    half_widths[j + o->mask_radius] =
+      floor (sqrt (o->mask_radius * o->mask_radius - j * j));
 
-  while (n_pixels--)
-    {
-      if (inten_buf)
-        oilify_pixel_inten (x, y, o->mask_radius, o->exponent, o->intensities,
-                   src_rect.width, src_buf, inten_buf, out_pixel);
-      else
-        oilify_pixel (x, y, o->mask_radius, o->exponent, o->intensities,
-                   src_rect.width, src_buf, out_pixel);
-      out_pixel += 4;
-
-      /* update x and y coordinates */
-      x++;
-      if (x >= result->width + o->mask_radius)
-        {
-          x=o->mask_radius;
-          y++;
-        }
-    }
+  data.result      = result;
+  data.radius      = o->mask_radius;
+  data.exponent    = o->exponent;
+  data.intensities = o->intensities;
+  data.buf_width   = src_rect.width;
+  data.src_buf     = src_buf;
+  data.inten_buf   = inten_buf;
+  data.dst_buf     = dst_buf;
+  data.half_widths = half_widths;
 
+  gegl_parallel_distribute_range (result->height, 1, oilify_rows, &data);
 
   gegl_buffer_set (output, result, 0,
                    babl_format ("RGBA float"),
                    dst_buf, GEGL_AUTO_ROWSTRIDE);
+  g_free (half_widths);
   gegl_free (src_buf);
   gegl_free (dst_buf);
   if (inten_buf)
@@ -472,6 +509,11 @@ gegl_op_class_init (GeglOpClass *klass)
   filter_class->process    = process;
   operation_class->prepare = prepare;
 
+  /* the rows of each chunk are distributed over threads in process (),
+   * sharing the source data of the chunk
+   */
+  operation_class->threaded = FALSE;
+
   gegl_operation_class_set_keys (operation_class,
                                  "categories" , "artistic",
                                  "name"       , "gegl:oilify",
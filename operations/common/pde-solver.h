@@ -0,0 +1,527 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+/* Threaded numerical kernels shared by the operations solving partial
+ * differential equations on whole-image float matrices (fattal02,
+ * mantiuk06). All matrices are single channel with a stride of cols.
+ *
+ * The kernels are distributed over gegl_config_threads () threads with
+ * gegl_parallel_distribute_range (), and the inner loops are written so
+ * the compiler can vectorize them. Reductions are computed in fixed size
+ * blocks and summed in order, so results do not depend on the number of
+ * threads. They accumulate in float, like the serial loops they replace.
+ */
+
+#ifndef __PDE_SOLVER_H__
+#define __PDE_SOLVER_H__
+
+#include "gegl-parallel.h"
+
+#define PDE_MIN_SUB_SIZE  16384 /* minimal number of elements per thread */
+#define PDE_BLOCK_SIZE    4096  /* size of the blocks reductions work on */
+
+typedef void (*PdeRowFunc) (gint     y0,
+                            gint     y1,
+                            gpointer user_data);
+
+typedef struct
+{
+  gfloat       *y;
+  const gfloat *x;
+  const gfloat *z;
+  gfloat        a;
+  gfloat        b;
+  gint          n;
+  gint          cols;
+  gint          rows;
+  gfloat       *partial;
+  PdeRowFunc    row_func;
+  gpointer      row_data;
+} PdeKernelData;
+
+
+static inline void
+pde_rows_range (gsize    offset,
+                gsize    size,
+                gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+
+  d->row_func (offset, offset + size, d->row_data);
+}
+
+/* Call func on bands of rows [y0, y1) of a rows x cols matrix, in
+ * parallel; func must only write to the rows it is handed.
+ */
+static inline void
+pde_parallel_rows (gint       rows,
+                   gint       cols,
+                   PdeRowFunc func,
+                   gpointer   user_data)
+{
+  PdeKernelData d;
+
+  d.row_func = func;
+  d.row_data = user_data;
+
+  gegl_parallel_distribute_range (rows, MAX (1, PDE_MIN_SUB_SIZE / MAX (cols, 1)),
+                                  pde_rows_range, &d);
+}
+
+
+/* x[i] = a */
+static inline void
+pde_vector_set_range (gsize    offset,
+                      gsize    size,
+                      gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gfloat        *y = d->y + offset;
+  const gfloat   a = d->a;
+  gsize          i;
+
+  for (i = 0; i < size; i++)
+    y[i] = a;
+}
+
+static inline void
+pde_vector_set (gint    n,
+                gfloat *x,
+                gfloat  value)
+{
+  PdeKernelData d;
+
+  d.y = x;
+  d.a = value;
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  pde_vector_set_range, &d);
+}
+
+/* y[i] = a * x[i] + b * y[i] */
+static inline void
+pde_vector_axpby_range (gsize    offset,
+                        gsize    size,
+                        gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gfloat        *y = d->y + offset;
+  const gfloat  *x = d->x + offset;
+  const gfloat   a = d->a;
+  const gfloat   b = d->b;
+  gsize          i;
+
+  if (b == 1.0f)
+    {
+      for (i = 0; i < size; i++)
+        y[i] += a * x[i];
+    }
+  else if (a == 1.0f)
+    {
+      for (i = 0; i < size; i++)
+        y[i] = x[i] + b * y[i];
+    }
+  else
+    {
+      for (i = 0; i < size; i++)
+        y[i] = a * x[i] + b * y[i];
+    }
+}
+
+static inline void
+pde_vector_axpby (gint          n,
+                  gfloat        a,
+                  const gfloat *x,
+                  gfloat        b,
+                  gfloat       *y)
+{
+  PdeKernelData d;
+
+  d.y = y;
+  d.x = x;
+  d.a = a;
+  d.b = b;
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  pde_vector_axpby_range, &d);
+}
+
+/* y[i] += a * x[i] */
+static inline void
+pde_vector_axpy (gint          n,
+                 gfloat        a,
+                 const gfloat *x,
+                 gfloat       *y)
+{
+  pde_vector_axpby (n, a, x, 1.0f, y);
+}
+
+/* y[i] = x[i] + b * y[i] */
+static inline void
+pde_vector_xpby (gint          n,
+                 const gfloat *x,
+                 gfloat        b,
+                 gfloat       *y)
+{
+  pde_vector_axpby (n, 1.0f, x, b, y);
+}
+
+/* y[i] = a * x[i] */
+static inline void
+pde_vector_scale_range (gsize    offset,
+                        gsize    size,
+                        gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gfloat        *y = d->y + offset;
+  const gfloat  *x = d->x + offset;
+  const gfloat   a = d->a;
+  gsize          i;
+
+  for (i = 0; i < size; i++)
+    y[i] = a * x[i];
+}
+
+static inline void
+pde_vector_scale (gint          n,
+                  gfloat        a,
+                  const gfloat *x,
+                  gfloat       *y)
+{
+  PdeKernelData d;
+
+  d.y = y;
+  d.x = x;
+  d.a = a;
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  pde_vector_scale_range, &d);
+}
+
+/* y[i] *= x[i] */
+static inline void
+pde_vector_multiply_range (gsize    offset,
+                           gsize    size,
+                           gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gfloat        *y = d->y + offset;
+  const gfloat  *x = d->x + offset;
+  gsize          i;
+
+  for (i = 0; i < size; i++)
+    y[i] *= x[i];
+}
+
+static inline void
+pde_vector_multiply (gint          n,
+                     const gfloat *x,
+                     gfloat       *y)
+{
+  PdeKernelData d;
+
+  d.y = y;
+  d.x = x;
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  pde_vector_multiply_range, &d);
+}
+
+/* y[i] = x[i] - y[i] */
+static inline void
+pde_vector_subtract_range (gsize    offset,
+                           gsize    size,
+                           gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gfloat        *y = d->y + offset;
+  const gfloat  *x = d->x + offset;
+  gsize          i;
+
+  for (i = 0; i < size; i++)
+    y[i] = x[i] - y[i];
+}
+
+static inline void
+pde_vector_subtract (gint          n,
+                     const gfloat *x,
+                     gfloat       *y)
+{
+  PdeKernelData d;
+
+  d.y = y;
+  d.x = x;
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  pde_vector_subtract_range, &d);
+}
+
+/* y[i] = x[i] / y[i] */
+static inline void
+pde_vector_divide_range (gsize    offset,
+                         gsize    size,
+                         gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gfloat        *y = d->y + offset;
+  const gfloat  *x = d->x + offset;
+  gsize          i;
+
+  for (i = 0; i < size; i++)
+    y[i] = x[i] / y[i];
+}
+
+static inline void
+pde_vector_divide (gint          n,
+                   const gfloat *x,
+                   gfloat       *y)
+{
+  PdeKernelData d;
+
+  d.y = y;
+  d.x = x;
+
+  gegl_parallel_distribute_range (n, PDE_MIN_SUB_SIZE,
+                                  pde_vector_divide_range, &d);
+}
+
+/* sum (x[i] * z[i]), one partial sum per block */
+static inline void
+pde_vector_dot_range (gsize    offset,
+                      gsize    size,
+                      gpointer user_data)
+{
+  PdeKernelData *d = user_data;
+  gsize          block;
+
+  for (block = offset; block < offset + size; block++)
+    {
+      const gint    start = block * PDE_BLOCK_SIZE;
+      const gint    end   = MIN (start + PDE_BLOCK_SIZE, d->n);
+      const gfloat *x     = d->x;
+      const gfloat *z     = d->z;
+      gfloat        sum   = 0.0f;
+      gint          i;
+
+      for (i = start; i < end; i++)
+        sum += x[i] * z[i];
+
+      d->partial[block] = sum;
+    }
+}
+
+static inline gfloat
+pde_vector_dot (gint          n,
+                const gfloat *x,
+                const gfloat *z)
+{
+  PdeKernelData d;
+  gint          blocks = (n + PDE_BLOCK_SIZE - 1) / PDE_BLOCK_SIZE;
+  gfloat        sum    = 0.0f;
+  gint          i;
+
+  d.x       = x;
+  d.z       = z;
+  d.n       = n;
+  d.partial = g_new (gfloat, blocks);
+
+  gegl_parallel_distribute_range (blocks,
+                                  PDE_MIN_SUB_SIZE / PDE_BLOCK_SIZE,
+                                  pde_vector_dot_range, &d);
+
+  for (i = 0; i < blocks; i++)
+    sum += d.partial[i];
+
+  g_free (d.partial);
+
+  return sum;
+}
+
+
+/* res = laplacian (x), five point stencil with Neumann boundary
+ * conditions; the matrix of the discretized Poisson equation.
+ */
+static inline void
+pde_laplacian_rows (gint     y0,
+                    gint     y1,
+                    gpointer user_data)
+{
+  PdeKernelData *d    = user_data;
+  const gfloat  *x    = d->x;
+  gfloat        *res  = d->y;
+  const gint     rows = d->rows;
+  const gint     cols = d->cols;
+  gint           r, c;
+
+  for (r = y0; r < y1; r++)
+    {
+      const gfloat *row  = x + r * cols;
+      const gfloat *up   = r > 0        ? row - cols : NULL;
+      const gfloat *down = r < rows - 1 ? row + cols : NULL;
+      gfloat       *out  = res + r * cols;
+
+      if (cols == 1)
+        {
+          out[0] = (up ? up[0] - row[0] : 0.0f) +
+                   (down ? down[0] - row[0] : 0.0f);
+          continue;
+        }
+
+      for (c = 0; c < cols; c++)
+        out[c] = 0.0f;
+
+      if (up)
+        for (c = 0; c < cols; c++)
+          out[c] += up[c] - row[c];
+
+      if (down)
+        for (c = 0; c < cols; c++)
+          out[c] += down[c] - row[c];
+
+      out[0] += row[1] - row[0];
+      for (c = 1; c < cols - 1; c++)
+        out[c] += row[c - 1] + row[c + 1] - 2 * row[c];
+      out[cols - 1] += row[cols - 2] - row[cols - 1];
+    }
+}
+
+static inline void
+pde_laplacian (gint          cols,
+               gint          rows,
+               const gfloat *x,
+               gfloat       *res)
+{
+  PdeKernelData d;
+
+  d.x    = x;
+  d.y    = res;
+  d.cols = cols;
+  d.rows = rows;
+
+  pde_parallel_rows (rows, cols, pde_laplacian_rows, &d);
+}
+
+
+/* Gx, Gy = forward differences of lum, zero at the far borders */
+static inline void
+pde_gradient_rows (gint     y0,
+                   gint     y1,
+                   gpointer user_data)
+{
+  PdeKernelData *d    = user_data;
+  const gfloat  *lum  = d->x;
+  gfloat        *Gx   = d->y;
+  gfloat        *Gy   = (gfloat *) d->z;
+  const gint     rows = d->rows;
+  const gint     cols = d->cols;
+  gint           ky, kx;
+
+  for (ky = y0; ky < y1; ky++)
+    {
+      const gfloat *l  = lum + ky * cols;
+      gfloat       *gx = Gx  + ky * cols;
+      gfloat       *gy = Gy  + ky * cols;
+
+      for (kx = 0; kx < cols - 1; kx++)
+        gx[kx] = l[kx + 1] - l[kx];
+      gx[cols - 1] = 0.0f;
+
+      if (ky == rows - 1)
+        {
+          for (kx = 0; kx < cols; kx++)
+            gy[kx] = 0.0f;
+        }
+      else
+        {
+          for (kx = 0; kx < cols; kx++)
+            gy[kx] = l[kx + cols] - l[kx];
+        }
+    }
+}
+
+static inline void
+pde_gradient (gint          cols,
+              gint          rows,
+              const gfloat *lum,
+              gfloat       *Gx,
+              gfloat       *Gy)
+{
+  PdeKernelData d;
+
+  d.x    = lum;
+  d.y    = Gx;
+  d.z    = Gy;
+  d.cols = cols;
+  d.rows = rows;
+
+  pde_parallel_rows (rows, cols, pde_gradient_rows, &d);
+}
+
+/* divG += backward differences of (Gx, Gy), the adjoint of pde_gradient */
+static inline void
+pde_add_divergence_rows (gint     y0,
+                         gint     y1,
+                         gpointer user_data)
+{
+  PdeKernelData *d    = user_data;
+  const gfloat  *Gx   = d->x;
+  const gfloat  *Gy   = d->z;
+  gfloat        *divG = d->y;
+  const gint     cols = d->cols;
+  gint           ky, kx;
+
+  for (ky = y0; ky < y1; ky++)
+    {
+      const gfloat *gx  = Gx   + ky * cols;
+      const gfloat *gy  = Gy   + ky * cols;
+      gfloat       *div = divG + ky * cols;
+
+      div[0] += gx[0];
+      for (kx = 1; kx < cols; kx++)
+        div[kx] += gx[kx] - gx[kx - 1];
+
+      if (ky == 0)
+        {
+          for (kx = 0; kx < cols; kx++)
+            div[kx] += gy[kx];
+        }
+      else
+        {
+          for (kx = 0; kx < cols; kx++)
+            div[kx] += gy[kx] - gy[kx - cols];
+        }
+    }
+}
+
+static inline void
+pde_add_divergence (gint          cols,
+                    gint          rows,
+                    const gfloat *Gx,
+                    const gfloat *Gy,
+                    gfloat       *divG)
+{
+  PdeKernelData d;
+
+  d.x    = Gx;
+  d.z    = Gy;
+  d.y    = divG;
+  d.cols = cols;
+  d.rows = rows;
+
+  pde_parallel_rows (rows, cols, pde_add_divergence_rows, &d);
+}
+
+#endif /* __PDE_SOLVER_H__ */
@@ -65,6 +65,7 @@ property_double (rgamma, _("Radial Gamma"), 0.0, 8.0, 2.0,
 #include "envelopes.h"
 
 static void stress (GeglBuffer          *src,
+                    const GeglRectangle *bounds,
                     const GeglRectangle *src_rect,
                     GeglBuffer          *dst,
                     const GeglRectangle *dst_rect,
@@ -74,13 +75,15 @@ static void stress (GeglBuffer          *src,
                     gdouble              rgamma,
                     gint                 level)
 {
-  const Babl *format = babl_format ("RGBA float");
-
   if (dst_rect->width > 0 && dst_rect->height > 0)
   {
     GeglBufferIterator *i = gegl_buffer_iterator_new (dst, dst_rect, 0, babl_format("RaGaBaA float"),
                                                       GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
-    GeglSampler *sampler = gegl_buffer_sampler_new_at_level (src, format, GEGL_SAMPLER_NEAREST, level);
+    EnvelopesSource source;
+
+    envelopes_source_init (&source, src, bounds, src_rect, dst_rect, level);
+
+    compute_luts (rgamma);
 
     while (gegl_buffer_iterator_next (i))
     {
@@ -96,13 +99,11 @@ static void stress (GeglBuffer          *src,
               gfloat  max[4];
               gfloat  pixel[4];
 
-              compute_envelopes (src, sampler,
+              compute_envelopes (&source,
                                  x, y,
                                  radius, samples,
                                  iterations,
-                                 FALSE, /* same spray */
-                                 rgamma,
-                                 min, max, pixel, format);
+                                 min, max, pixel);
               {
                 /* this should be replaced with a better/faster projection of
                  * pixel onto the vector spanned by min -> max, currently
@@ -131,7 +132,7 @@ static void stress (GeglBuffer          *src,
             }
           }
     }
-    g_object_unref (sampler);
+    envelopes_source_clear (&source);
   }
 }
 
@@ -164,10 +165,11 @@ process (GeglOperation       *operation,
          gint                 level)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
+  GeglRectangle bounds = get_bounding_box (operation);
   GeglRectangle compute;
   compute = gegl_operation_get_required_for_output (operation, "input",result);
 
-  stress (input, &compute, output, result,
+  stress (input, &bounds, &compute, output, result,
           o->radius,
           o->samples,
           o->iterations,
@@ -60,15 +60,147 @@ static void path_changed (GeglPath            *path,
                           const GeglRectangle *roi,
                           gpointer             userdata);
 #include "gegl-op.h"
+#include "gegl-parallel.h"
+
+/* The displacement resulting from the stroke processed so far is kept
+ * between process calls, so that extending the stroke only stamps the new
+ * dabs. Every WARP_CHECKPOINT_DABS dabs, at the end of a segment, the state
+ * is saved as a checkpoint; the checkpoint buffers share their unchanged
+ * tiles with the current buffer. When points of the stroke change, the
+ * stroke is replayed from the last checkpoint before the first changed
+ * point.
+ *
+ * Only the area the dabs can touch, the bounds of the stroke grown by the
+ * brush radius, is kept; the displacement elsewhere is the input's.
+ */
+#define WARP_CHECKPOINT_DABS  256
+#define WARP_MAX_CHECKPOINTS  16
+
+/* the rows of a dab are distributed over threads in bands of at least this
+ * many pixels
+ */
+#define WARP_MIN_PIXELS_PER_THREAD 16384
+
+typedef struct {
+  GeglBuffer    *buffer;         /* displacement after n_points points */
+  gint           n_points;       /* points of the stroke processed */
+  GeglPathPoint  prev;           /* where the next segment starts */
+  gdouble        last_x;
+  gdouble        last_y;
+  gboolean       last_point_set;
+} WarpState;
 
 typedef struct {
-  gdouble     *lookup;
-  GeglBuffer  *buffer;
-  gdouble      last_x;
-  gdouble      last_y;
-  gboolean     last_point_set;
+  gdouble       *lookup;
+  GeglRectangle  input_extent;    /* of the input the state started from */
+  WarpState      state;
+  GArray        *points;          /* the points stamped into state.buffer */
+  GSList        *checkpoints;     /* of WarpState, newest first */
+  gint           checkpoint_dabs; /* dabs between checkpoints */
+  gint           dabs;            /* since the last checkpoint */
+  gboolean       invalidating;    /* in path_changed */
 } WarpPrivate;
 
+static void
+warp_state_clear (WarpState *state)
+{
+  if (state->buffer)
+    g_object_unref (state->buffer);
+  memset (state, 0, sizeof (WarpState));
+}
+
+static void
+warp_clear_checkpoints (WarpPrivate *priv)
+{
+  while (priv->checkpoints)
+    {
+      warp_state_clear (priv->checkpoints->data);
+      g_slice_free (WarpState, priv->checkpoints->data);
+      priv->checkpoints = g_slist_delete_link (priv->checkpoints,
+                                               priv->checkpoints);
+    }
+}
+
+static void
+warp_clear_cache (WarpPrivate *priv)
+{
+  warp_state_clear (&priv->state);
+  warp_clear_checkpoints (priv);
+  g_array_set_size (priv->points, 0);
+  priv->checkpoint_dabs = WARP_CHECKPOINT_DABS;
+  priv->dabs            = 0;
+}
+
+static void
+warp_add_checkpoint (WarpPrivate *priv)
+{
+  WarpState *checkpoint = g_slice_dup (WarpState, &priv->state);
+
+  checkpoint->buffer = gegl_buffer_dup (priv->state.buffer);
+  priv->checkpoints  = g_slist_prepend (priv->checkpoints, checkpoint);
+  priv->dabs         = 0;
+
+  /* keep every other checkpoint, and space the following ones further */
+  if (g_slist_length (priv->checkpoints) > WARP_MAX_CHECKPOINTS)
+    {
+      GSList *iter;
+
+      for (iter = priv->checkpoints; iter && iter->next; iter = iter->next)
+        {
+          GSList *drop = iter->next;
+
+          /* the checkpoint of the input is always kept */
+          if (((WarpState *) drop->data)->n_points == 0)
+            break;
+
+          warp_state_clear (drop->data);
+          g_slice_free (WarpState, drop->data);
+          iter->next = g_slist_delete_link (drop, drop);
+        }
+
+      priv->checkpoint_dabs *= 2;
+    }
+}
+
+/* Go back to the newest checkpoint before point n_points */
+static void
+warp_restore_checkpoint (WarpPrivate *priv,
+                         gint         n_points)
+{
+  while (priv->checkpoints &&
+         ((WarpState *) priv->checkpoints->data)->n_points > n_points)
+    {
+      warp_state_clear (priv->checkpoints->data);
+      g_slice_free (WarpState, priv->checkpoints->data);
+      priv->checkpoints = g_slist_delete_link (priv->checkpoints,
+                                               priv->checkpoints);
+    }
+
+  warp_state_clear (&priv->state);
+
+  if (priv->checkpoints)
+    {
+      priv->state        = *(WarpState *) priv->checkpoints->data;
+      priv->state.buffer = gegl_buffer_dup (priv->state.buffer);
+    }
+
+  g_array_set_size (priv->points, priv->state.n_points);
+  priv->dabs = 0;
+}
+
+static void
+node_invalidated (GeglNode            *node,
+                  const GeglRectangle *rect,
+                  GeglOperation       *operation)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  WarpPrivate    *priv = (WarpPrivate*) o->user_data;
+
+  /* the input or properties other than the stroke changed */
+  if (priv && !priv->invalidating)
+    warp_clear_cache (priv);
+}
+
 static void
 path_changed (GeglPath            *path,
               const GeglRectangle *roi,
@@ -76,6 +208,7 @@ path_changed (GeglPath            *path,
 {
   GeglRectangle   rect = *roi;
   GeglProperties *o    = GEGL_PROPERTIES (userdata);
+  WarpPrivate    *priv = (WarpPrivate*) o->user_data;
   /* invalidate the incoming rectangle */
 
   rect.x -= o->size/2;
@@ -83,14 +216,18 @@ path_changed (GeglPath            *path,
   rect.width += o->size;
   rect.height += o->size;
 
+  /* the cached stroke is compared with the new one in process */
+  if (priv)
+    priv->invalidating = TRUE;
   gegl_operation_invalidate (userdata, &rect, FALSE);
+  if (priv)
+    priv->invalidating = FALSE;
 }
 
 static void
 prepare (GeglOperation *operation)
 {
   GeglProperties *o     = GEGL_PROPERTIES (operation);
-  WarpPrivate    *priv;
 
   const Babl *format = babl_format_n (babl_type ("float"), 2);
   gegl_operation_set_format (operation, "input", format);
@@ -98,13 +235,15 @@ prepare (GeglOperation *operation)
 
   if (!o->user_data)
     {
-      o->user_data = g_slice_new (WarpPrivate);
-    }
+      WarpPrivate *priv = g_slice_new0 (WarpPrivate);
+
+      priv->points          = g_array_new (FALSE, FALSE, sizeof (GeglPathPoint));
+      priv->checkpoint_dabs = WARP_CHECKPOINT_DABS;
+      o->user_data = priv;
 
-  priv = (WarpPrivate*) o->user_data;
-  priv->last_point_set = FALSE;
-  priv->lookup = NULL;
-  priv->buffer = NULL;
+      g_signal_connect_object (operation->node, "invalidated",
+                               G_CALLBACK (node_invalidated), operation, 0);
+    }
 }
 
 static void
@@ -114,6 +253,12 @@ finalize (GObject *object)
 
   if (o->user_data)
     {
+      WarpPrivate *priv = (WarpPrivate*) o->user_data;
+
+      warp_clear_cache (priv);
+      g_array_free (priv->points, TRUE);
+      g_free (priv->lookup);
+
       g_slice_free (WarpPrivate, o->user_data);
       o->user_data = NULL;
     }
@@ -171,6 +316,7 @@ calc_lut (GeglProperties  *o)
     }
 }
 
+/* the lookup table has to be set up */
 static gdouble
 get_stamp_force (GeglProperties *o,
                  gdouble         x,
@@ -179,11 +325,6 @@ get_stamp_force (GeglProperties *o,
   WarpPrivate  *priv = (WarpPrivate*) o->user_data;
   gfloat        radius;
 
-  if (!priv->lookup)
-    {
-      calc_lut (o);
-    }
-
   radius = sqrt(x*x+y*y);
 
   if (radius < 0.5 * o->size + 1)
@@ -205,77 +346,39 @@ get_stamp_force (GeglProperties *o,
   return 0.0;
 }
 
+typedef struct {
+  GeglProperties *o;
+  gfloat         *coords;  /* of area */
+  GeglRectangle   area;
+  gdouble         x;
+  gdouble         y;
+  gdouble         x_mean;
+  gdouble         y_mean;
+} StampData;
+
 static void
-stamp (GeglProperties          *o,
-       const GeglRectangle     *result,
-       gdouble                  x,
-       gdouble                  y)
+stamp_rows (gsize    offset,
+            gsize    size,
+            gpointer user_data)
 {
-  WarpPrivate         *priv = (WarpPrivate*) o->user_data;
-  GeglBufferIterator  *it;
-  const Babl          *format;
-  gdouble              influence;
-  gdouble              x_mean = 0.0;
-  gdouble              y_mean = 0.0;
-  gint                 x_iter, y_iter;
-  GeglRectangle        area = {x - o->size / 2.0,
-                               y - o->size / 2.0,
-                               o->size,
-                               o->size};
-
-  /* first point of the stroke */
-  if (!priv->last_point_set)
-    {
-      priv->last_x = x;
-      priv->last_y = y;
-      priv->last_point_set = TRUE;
-      return;
-    }
-
-  /* don't stamp if outside the roi treated */
-  if (!gegl_rectangle_intersect (NULL, result, &area))
-    return;
-
-  format = babl_format_n (babl_type ("float"), 2);
-
-  /* If needed, compute the mean deformation */
-  if (o->behavior == GEGL_WARP_BEHAVIOR_SMOOTH)
-    {
-      gint pixel_count = 0;
-
-      it = gegl_buffer_iterator_new (priv->buffer, &area, 0, format,
-                                     GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-
-      while (gegl_buffer_iterator_next (it))
-        {
-          gint    n_pixels    = it->length;
-          gfloat *coords      = it->data[0];
-
-          while (n_pixels--)
-            {
-              x_mean += coords[0];
-              y_mean += coords[1];
-              coords += 2;
-            }
-          pixel_count += it->roi->width * it->roi->height;
-        }
-      x_mean /= pixel_count;
-      y_mean /= pixel_count;
-    }
-
-  it = gegl_buffer_iterator_new (priv->buffer, &area, 0, format,
-                                 GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
-
-  while (gegl_buffer_iterator_next (it))
+  StampData      *data = user_data;
+  GeglProperties *o    = data->o;
+  WarpPrivate    *priv = (WarpPrivate*) o->user_data;
+  gdouble         x    = data->x;
+  gdouble         y    = data->y;
+  gdouble         influence;
+  gint            x_iter, y_iter;
+
+  for (y_iter = data->area.y + offset;
+       y_iter < data->area.y + (gint) (offset + size);
+       y_iter++)
     {
-      /* iterate inside the stamp roi */
-      gint    n_pixels = it->length;
-      gfloat *coords   = it->data[0];
+      gfloat *coords = data->coords +
+                       (y_iter - data->area.y) * data->area.width * 2;
 
-      x_iter = it->roi->x; /* initial x         */
-      y_iter = it->roi->y; /* and y coordinates */
-
-      while (n_pixels--)
+      for (x_iter = data->area.x;
+           x_iter < data->area.x + data->area.width;
+           x_iter++, coords += 2)
         {
           influence = 0.01 * o->strength * get_stamp_force (o,
                                                             x_iter - x,
@@ -284,8 +387,8 @@ stamp (GeglProperties          *o,
           switch (o->behavior)
             {
               case GEGL_WARP_BEHAVIOR_MOVE:
-                coords[0] += influence * (priv->last_x - x);
-                coords[1] += influence * (priv->last_y - y);
+                coords[0] += influence * (priv->state.last_x - x);
+                coords[1] += influence * (priv->state.last_y - y);
                 break;
               case GEGL_WARP_BEHAVIOR_GROW:
                 coords[0] -= influence * 0.1 * (x_iter - x);
@@ -308,26 +411,198 @@ stamp (GeglProperties          *o,
                 coords[1] *= 1.0 - MIN (influence, 1.0);
                 break;
               case GEGL_WARP_BEHAVIOR_SMOOTH:
-                coords[0] -= influence * (coords[0] - x_mean);
-                coords[1] -= influence * (coords[1] - y_mean);
+                coords[0] -= influence * (coords[0] - data->x_mean);
+                coords[1] -= influence * (coords[1] - data->y_mean);
                 break;
             }
+        }
+    }
+}
 
-          coords += 2;
+static void
+stamp (GeglProperties          *o,
+       gdouble                  x,
+       gdouble                  y)
+{
+  WarpPrivate         *priv = (WarpPrivate*) o->user_data;
+  const Babl          *format;
+  StampData            data;
+  GeglRectangle        area = {x - o->size / 2.0,
+                               y - o->size / 2.0,
+                               o->size,
+                               o->size};
 
-          /* update x and y coordinates */
-          x_iter++;
-          if (x_iter >= (it->roi->x + it->roi->width))
-            {
-              x_iter = it->roi->x;
-              y_iter++;
-            }
+  /* first point of the stroke */
+  if (!priv->state.last_point_set)
+    {
+      priv->state.last_x = x;
+      priv->state.last_y = y;
+      priv->state.last_point_set = TRUE;
+      return;
+    }
+
+  priv->dabs++;
+
+  /* don't stamp if outside the buffer */
+  if (!gegl_rectangle_intersect (NULL,
+                                 gegl_buffer_get_extent (priv->state.buffer),
+                                 &area))
+    return;
+
+  format = babl_format_n (babl_type ("float"), 2);
+
+  data.o      = o;
+  data.area   = area;
+  data.x      = x;
+  data.y      = y;
+  data.x_mean = 0.0;
+  data.y_mean = 0.0;
+  data.coords = g_new (gfloat, area.width * area.height * 2);
+
+  gegl_buffer_get (priv->state.buffer, &area, 1.0, format, data.coords,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /* If needed, compute the mean deformation */
+  if (o->behavior == GEGL_WARP_BEHAVIOR_SMOOTH)
+    {
+      gint pixel_count = area.width * area.height;
+      gint i;
+
+      for (i = 0; i < pixel_count; i++)
+        {
+          data.x_mean += data.coords[i * 2];
+          data.y_mean += data.coords[i * 2 + 1];
         }
+      data.x_mean /= pixel_count;
+      data.y_mean /= pixel_count;
     }
 
+  /* the pixels of a dab are independent of each other */
+  gegl_parallel_distribute_range (area.height,
+                                  MAX (WARP_MIN_PIXELS_PER_THREAD / area.width, 1),
+                                  stamp_rows, &data);
+
+  gegl_buffer_set (priv->state.buffer, &area, 0, format, data.coords,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_free (data.coords);
+
   /* Memorize the stamp location for movement dependant behavior like move */
-  priv->last_x = x;
-  priv->last_y = y;
+  priv->state.last_x = x;
+  priv->state.last_y = y;
+}
+
+/* Returns the number of leading points of the stroke that were processed
+ * already, the path's points are returned in points.
+ */
+static gint
+get_unchanged_points (WarpPrivate *priv,
+                      GeglPath    *stroke,
+                      GArray      *points)
+{
+  GeglPathList *event;
+  gint          n_unchanged = 0;
+
+  for (event = gegl_path_get_path (stroke); event; event = event->next)
+    g_array_append_val (points, *(event->d.point));
+
+  while (n_unchanged < points->len && n_unchanged < priv->points->len &&
+         !memcmp (&g_array_index (points, GeglPathPoint, n_unchanged),
+                  &g_array_index (priv->points, GeglPathPoint, n_unchanged),
+                  sizeof (GeglPathPoint)))
+    n_unchanged++;
+
+  return n_unchanged;
+}
+
+/* The area of the input the dabs of the stroke can touch */
+static GeglRectangle
+get_stroke_area (GeglOperation *operation)
+{
+  GeglProperties *o       = GEGL_PROPERTIES (operation);
+  GeglRectangle  *in_rect = gegl_operation_source_get_bounding_box (operation, "input");
+  GeglRectangle   area    = {0, 0, 0, 0};
+  GeglPathList   *event   = o->stroke ? gegl_path_get_path (o->stroke) : NULL;
+  gint            radius  = ceil (o->size / 2.0) + 1;
+  gdouble         min_x, min_y, max_x, max_y;
+
+  if (!event)
+    return area;
+
+  min_x = max_x = event->d.point[0].x;
+  min_y = max_y = event->d.point[0].y;
+
+  for (; event; event = event->next)
+    {
+      min_x = MIN (min_x, event->d.point[0].x);
+      min_y = MIN (min_y, event->d.point[0].y);
+      max_x = MAX (max_x, event->d.point[0].x);
+      max_y = MAX (max_y, event->d.point[0].y);
+    }
+
+  area.x      = floor (min_x) - radius;
+  area.y      = floor (min_y) - radius;
+  area.width  = ceil (max_x) + radius + 1 - area.x;
+  area.height = ceil (max_y) + radius + 1 - area.y;
+
+  if (in_rect)
+    gegl_rectangle_intersect (&area, &area, in_rect);
+
+  return area;
+}
+
+/* The stroke area, and the area the kept displacement covers already,
+ * which is grown from the input when the stroke extends beyond it
+ */
+static GeglRectangle
+get_required_for_output (GeglOperation       *operation,
+                         const gchar         *input_pad,
+                         const GeglRectangle *roi)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  WarpPrivate    *priv = (WarpPrivate*) o->user_data;
+  GeglRectangle   area = get_stroke_area (operation);
+
+  if (priv && priv->state.buffer)
+    gegl_rectangle_bounding_box (&area, &area,
+                                 gegl_buffer_get_extent (priv->state.buffer));
+
+  gegl_rectangle_bounding_box (&area, &area, roi);
+
+  return area;
+}
+
+/* the whole stroke is processed for any region */
+static GeglRectangle
+get_cached_region (GeglOperation       *operation,
+                   const GeglRectangle *roi)
+{
+  return get_required_for_output (operation, "input", roi);
+}
+
+/* Grow the displacement to cover area, with the input's displacement,
+ * which the dabs stamped so far have not touched there
+ */
+static void
+warp_state_cover (WarpPrivate         *priv,
+                  GeglBuffer          *input,
+                  const GeglRectangle *area)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (priv->state.buffer);
+  GeglRectangle        covered;
+  GeglBuffer          *buffer;
+
+  if (gegl_rectangle_is_empty (area) ||
+      gegl_rectangle_contains (extent, area))
+    return;
+
+  gegl_rectangle_bounding_box (&covered, extent, area);
+
+  buffer = gegl_buffer_new (&covered, gegl_buffer_get_format (priv->state.buffer));
+  gegl_buffer_copy (input, &covered, GEGL_ABYSS_NONE, buffer, &covered);
+  gegl_buffer_copy (priv->state.buffer, extent, GEGL_ABYSS_NONE, buffer, extent);
+
+  g_object_unref (priv->state.buffer);
+  priv->state.buffer = buffer;
 }
 
 static gboolean
@@ -345,24 +620,54 @@ process (GeglOperation       *operation,
 
   GeglPathPoint        prev, next, lerp;
   gulong               i;
-  GeglPathList        *event;
+  GArray              *points;
+  gint                 n_unchanged;
+  GeglRectangle        area = get_stroke_area (operation);
+
+  if (priv->state.buffer &&
+      !gegl_rectangle_equal (&priv->input_extent,
+                             gegl_buffer_get_extent (input)))
+    warp_clear_cache (priv);
+
+  if (!priv->state.buffer)
+    {
+      priv->input_extent = *gegl_buffer_get_extent (input);
+      priv->state.buffer = gegl_buffer_new (&area,
+                                            gegl_buffer_get_format (input));
+      gegl_buffer_copy (input, &area, GEGL_ABYSS_NONE,
+                        priv->state.buffer, &area);
+      warp_add_checkpoint (priv);
+    }
+
+  points      = g_array_new (FALSE, FALSE, sizeof (GeglPathPoint));
+  n_unchanged = o->stroke ? get_unchanged_points (priv, o->stroke, points) : 0;
 
-  priv->buffer = gegl_buffer_dup (input);
+  if (n_unchanged < priv->state.n_points)
+    warp_restore_checkpoint (priv, n_unchanged);
 
-  event = gegl_path_get_path (o->stroke);
+  /* points added to the stroke may extend it */
+  warp_state_cover (priv, input, &area);
 
-  prev = *(event->d.point);
+  if (!priv->lookup)
+    calc_lut (o);
 
-  while (event->next)
+  if (priv->state.n_points == 0 && points->len > 0)
     {
-      event = event->next;
-      next = *(event->d.point);
+      priv->state.prev = g_array_index (points, GeglPathPoint, 0);
+      priv->state.n_points = 1;
+    }
+
+  prev = priv->state.prev;
+
+  while (priv->state.n_points < points->len)
+    {
+      next = g_array_index (points, GeglPathPoint, priv->state.n_points);
       dist = gegl_path_point_dist (&next, &prev);
       stamps = dist / spacing;
 
       if (stamps < 1)
         {
-          stamp (o, result, next.x, next.y);
+          stamp (o, next.x, next.y);
           prev = next;
         }
       else
@@ -370,22 +675,31 @@ process (GeglOperation       *operation,
           for (i = 0; i < stamps; i++)
             {
               gegl_path_point_lerp (&lerp, &prev, &next, (i * spacing) / dist);
-              stamp (o, result, lerp.x, lerp.y);
+              stamp (o, lerp.x, lerp.y);
             }
           prev = lerp;
         }
+
+      priv->state.prev = prev;
+      priv->state.n_points++;
+
+      if (priv->dabs >= priv->checkpoint_dabs)
+        warp_add_checkpoint (priv);
     }
 
+  g_array_set_size (priv->points, 0);
+  g_array_append_vals (priv->points, points->data, priv->state.n_points);
+  g_array_free (points, TRUE);
+
   /* Affect the output buffer */
-  gegl_buffer_copy (priv->buffer, result, GEGL_ABYSS_NONE,
-                    output, result);
+  gegl_buffer_copy (input, result, GEGL_ABYSS_NONE, output, result);
+  if (gegl_rectangle_intersect (&area, result,
+                                gegl_buffer_get_extent (priv->state.buffer)))
+    gegl_buffer_copy (priv->state.buffer, &area, GEGL_ABYSS_NONE,
+                      output, &area);
   gegl_buffer_set_extent (output, gegl_buffer_get_extent (input));
-  g_object_unref (priv->buffer);
-
-  /* prepare for the recomputing of the op */
-  priv->last_point_set = FALSE;
 
-  /* free the LUT */
+  /* free the LUT, size and hardness may change */
   if (priv->lookup)
     {
       g_free (priv->lookup);
@@ -404,6 +718,8 @@ gegl_op_class_init (GeglOpClass *klass)
 
   object_class->finalize   = finalize;
   operation_class->prepare = prepare;
+  operation_class->get_required_for_output = get_required_for_output;
+  operation_class->get_cached_region       = get_cached_region;
   filter_class->process    = process;
   operation_class->threaded = FALSE;
 
@@ -109,6 +109,7 @@ gegl_op_class_init (GeglOpClass *klass)
        "title",         _("Clone"),
        "description",   _("Clone a buffer"),
        "categories",    "core",
+       "cost",          "0",
        NULL);
 }
 
@@ -207,6 +207,7 @@ gegl_op_class_init (GeglOpClass *klass)
       "title",       _("Crop"),
       "description", _("Crop a buffer"),
       "reference-composition", composition,
+      "cost",        "0",
       NULL);
 
   operation_class->no_cache = TRUE;
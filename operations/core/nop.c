@@ -79,6 +79,7 @@ gegl_op_class_init (GeglOpClass *klass)
               "title",       _("No Operation"),
               "categories",  "core",
               "description", _("No operation (can be used as a routing point)"),
+              "cost",        "0",
               NULL);
 }
 
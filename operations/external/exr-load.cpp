@@ -30,9 +30,13 @@ property_file_path (path, "File", "")
 
 extern "C" {
 #include "gegl-op.h"
+#include "gegl-config.h"
 }
 
 #include <ImfInputFile.h>
+#include <ImfTiledInputFile.h>
+#include <ImfTestFile.h>
+#include <ImfThreading.h>
 #include <ImfChannelList.h>
 #include <ImfRgbaFile.h>
 #include <ImfRgbaYca.h>
@@ -80,6 +84,13 @@ import_exr             (GeglBuffer  *gegl_buffer,
                         const gchar *path,
                         gint         format_flags);
 
+static gboolean
+import_exr_tiles       (GeglBuffer          *gegl_buffer,
+                        TiledInputFile      &file,
+                        const GeglRectangle *roi,
+                        gint                 level,
+                        gint                 format_flags);
+
 static void
 convert_yca_to_rgba    (GeglBuffer *buf,
                         gint        has_alpha,
@@ -124,7 +135,8 @@ insert_channels        (FrameBuffer  &fb,
                         char         *base,
                         gint          width,
                         gint          format_flags,
-                        gint          bpp);
+                        gint          bpp,
+                        gsize         rowstride);
 
 
 
@@ -407,7 +419,8 @@ insert_channels (FrameBuffer  &fb,
                  char         *base,
                  gint          width,
                  gint          format_flags,
-                 gint          bpp)
+                 gint          bpp,
+                 gsize         rowstride)
 {
   gint alpha_offset;
   PixelType tp;
@@ -428,24 +441,24 @@ insert_channels (FrameBuffer  &fb,
 
   if (format_flags & COLOR_RGB)
     {
-      fb.insert ("R", Slice (tp, base,          bpp, 0, 1,1, 0.0));
-      fb.insert ("G", Slice (tp, base+bpc,      bpp, 0, 1,1, 0.0));
-      fb.insert ("B", Slice (tp, base+bpc*2,    bpp, 0, 1,1, 0.0));
+      fb.insert ("R", Slice (tp, base,          bpp, rowstride, 1,1, 0.0));
+      fb.insert ("G", Slice (tp, base+bpc,      bpp, rowstride, 1,1, 0.0));
+      fb.insert ("B", Slice (tp, base+bpc*2,    bpp, rowstride, 1,1, 0.0));
     }
   else if (format_flags & COLOR_C)
     {
-      fb.insert ("Y",  Slice (tp, base,         bpp,   0, 1,1, 0.5));
-      fb.insert ("RY", Slice (tp, base+bpc,     bpp*2, 0, 2,2, 0.0));
-      fb.insert ("BY", Slice (tp, base+bpc*2,   bpp*2, 0, 2,2, 0.0));
+      fb.insert ("Y",  Slice (tp, base,         bpp,   rowstride, 1,1, 0.5));
+      fb.insert ("RY", Slice (tp, base+bpc,     bpp*2, rowstride, 2,2, 0.0));
+      fb.insert ("BY", Slice (tp, base+bpc*2,   bpp*2, rowstride, 2,2, 0.0));
     }
   else if (format_flags & COLOR_Y)
     {
-      fb.insert ("Y",  Slice (tp, base, bpp, 0, 1,1, 0.5));
+      fb.insert ("Y",  Slice (tp, base, bpp, rowstride, 1,1, 0.5));
       alpha_offset = bpc;
     }
 
   if (format_flags & COLOR_ALPHA)
-    fb.insert ("A", Slice (tp, base+alpha_offset, bpp, 0, 1,1, 1.0));
+    fb.insert ("A", Slice (tp, base+alpha_offset, bpp, rowstride, 1,1, 1.0));
 }
 
 
@@ -483,7 +496,8 @@ import_exr (GeglBuffer  *gegl_buffer,
                        base,
                        gegl_buffer_get_width (gegl_buffer),
                        format_flags,
-                       pxsize);
+                       pxsize,
+                       0);
 
       file.setFrameBuffer (frameBuffer);
 
@@ -528,6 +542,96 @@ import_exr (GeglBuffer  *gegl_buffer,
 }
 
 
+/* Read the tiles of a tiled file needed for roi, one row of tiles at a
+ * time. For mip-mapped files the tiles are read from the level matching
+ * the requested level, or the smallest one available, and written to the
+ * tiles of that level of the buffer.
+ */
+static gboolean
+import_exr_tiles (GeglBuffer          *gegl_buffer,
+                  TiledInputFile      &file,
+                  const GeglRectangle *roi,
+                  gint                 level,
+                  gint                 format_flags)
+{
+  char *pixels = NULL;
+
+  try
+    {
+      const TileDescription &td = file.header().tileDescription();
+      gint  exr_level = 0;
+      gint  factor;
+      gint  pxsize;
+
+      if (td.mode == MIPMAP_LEVELS)
+        exr_level = MIN (level, file.numLevels () - 1);
+      factor = 1 << exr_level;
+
+      Box2i dw = file.dataWindowForLevel (exr_level);
+      gint  lw = dw.max.x - dw.min.x + 1;
+      gint  lh = dw.max.y - dw.min.y + 1;
+
+      /* roi in the coordinates of the level */
+      gint  x0 = MAX (roi->x / factor, 0);
+      gint  y0 = MAX (roi->y / factor, 0);
+      gint  x1 = MIN ((roi->x + roi->width  + factor - 1) / factor, lw);
+      gint  y1 = MIN ((roi->y + roi->height + factor - 1) / factor, lh);
+
+      if (x0 >= x1 || y0 >= y1)
+        return TRUE;
+
+      gint  dx0 = x0 / td.xSize;
+      gint  dx1 = (x1 - 1) / td.xSize;
+      gint  dy0 = y0 / td.ySize;
+      gint  dy1 = (y1 - 1) / td.ySize;
+      gint  bx0 = dx0 * td.xSize;
+      gint  bw  = MIN ((dx1 + 1) * (gint) td.xSize, lw) - bx0;
+      gint  dy;
+
+      g_object_get (gegl_buffer, "px-size", &pxsize, NULL);
+
+      gsize rowstride = (gsize) bw * pxsize;
+
+      pixels = (char*) g_malloc0 (rowstride * td.ySize);
+
+      for (dy = dy0; dy <= dy1; dy++)
+        {
+          FrameBuffer   frameBuffer;
+          GeglRectangle rect;
+          gint          by0 = dy * td.ySize;
+          gint          bh  = MIN (by0 + (gint) td.ySize, lh) - by0;
+
+          /* as in import_exr, OpenEXR addresses the pixels by their
+           * coordinates in the data window
+           */
+          char *base = pixels - pxsize * (dw.min.x + bx0)
+                              - rowstride * (dw.min.y + by0);
+
+          insert_channels (frameBuffer, file.header(), base, bw,
+                           format_flags, pxsize, rowstride);
+
+          file.setFrameBuffer (frameBuffer);
+          file.readTiles (dx0, dx1, dy, dy, exr_level);
+
+          /* the rectangle is in level 0 coordinates */
+          gegl_rectangle_set (&rect, bx0 * factor, by0 * factor,
+                              bw * factor, bh * factor);
+          gegl_buffer_set (gegl_buffer, &rect, exr_level, NULL, pixels,
+                           rowstride);
+        }
+    }
+  catch (...)
+    {
+      g_warning ("failed to load tiles of `%s'", file.fileName ());
+      g_free (pixels);
+      return FALSE;
+    }
+
+  g_free (pixels);
+  return TRUE;
+}
+
+
 static gboolean
 query_exr (const gchar *path,
            gint        *width,
@@ -633,6 +737,59 @@ get_bounding_box (GeglOperation *operation)
   return result;
 }
 
+/* The tiled file of the operation, kept open between calls to process. */
+typedef struct
+{
+  gchar          *path;
+  TiledInputFile *file; /* NULL when the file is not tiled */
+} ExrTiledFile;
+
+static void
+exr_tiled_file_free (ExrTiledFile *tiled)
+{
+  delete tiled->file;
+  g_free (tiled->path);
+  g_free (tiled);
+}
+
+/* Returns the open tiled file for the operation's path, or NULL if the
+ * file is a scanline file or cannot be read.
+ */
+static TiledInputFile *
+get_tiled_file (GeglOperation *operation)
+{
+  GeglProperties *o     = GEGL_PROPERTIES (operation);
+  ExrTiledFile   *tiled = (ExrTiledFile *) o->user_data;
+
+  if (tiled && g_strcmp0 (tiled->path, o->path))
+    {
+      exr_tiled_file_free (tiled);
+      tiled = NULL;
+      o->user_data = NULL;
+    }
+
+  if (!tiled)
+    {
+      bool is_tiled = false;
+
+      tiled = g_new0 (ExrTiledFile, 1);
+      tiled->path = g_strdup (o->path);
+      o->user_data = tiled;
+
+      try
+        {
+          if (isOpenExrFile (o->path, is_tiled) && is_tiled)
+            tiled->file = new TiledInputFile (o->path);
+        }
+      catch (...)
+        {
+          tiled->file = NULL;
+        }
+    }
+
+  return tiled->file;
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *output,
@@ -640,29 +797,72 @@ process (GeglOperation       *operation,
          int                  level)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
+  TiledInputFile *tiled_file;
   gint        w,h,ff;
   gpointer    format;
   gboolean    ok;
 
   ok = query_exr (o->path, &w, &h, &ff, &format);
 
-  if (ok)
-    {
-      import_exr (output, o->path, ff);
-    }
-  else
-    {
-      return FALSE;
-    }
+  if (!ok)
+    return FALSE;
+
+  /* let openexr decompress in as many threads as gegl renders with */
+  if (globalThreadCount () != gegl_config_threads ())
+    setGlobalThreadCount (gegl_config_threads ());
+
+  tiled_file = get_tiled_file (operation);
+
+  if (tiled_file)
+    return import_exr_tiles (output, *tiled_file, result, level, ff);
+
+  import_exr (output, o->path, ff);
 
   return TRUE;
 }
 
+/* Tiled files are read lazily, a tile at a time, scanline files are read
+ * whole.
+ */
 static GeglRectangle
 get_cached_region (GeglOperation       *operation,
                    const GeglRectangle *roi)
 {
-  return get_bounding_box (operation);
+  GeglRectangle   bounds     = get_bounding_box (operation);
+  TiledInputFile *tiled_file = get_tiled_file (operation);
+  GeglRectangle   region;
+  gint            x0, y0, x1, y1;
+
+  if (!tiled_file || roi->width <= 0 || roi->height <= 0)
+    return bounds;
+
+  const TileDescription &td = tiled_file->header().tileDescription();
+  gint tw = td.xSize;
+  gint th = td.ySize;
+
+  x0 = MAX (roi->x, 0) / tw * tw;
+  y0 = MAX (roi->y, 0) / th * th;
+  x1 = (roi->x + roi->width  + tw - 1) / tw * tw;
+  y1 = (roi->y + roi->height + th - 1) / th * th;
+
+  gegl_rectangle_set (&region, x0, y0, x1 - x0, y1 - y0);
+  gegl_rectangle_intersect (&region, &region, &bounds);
+
+  return region;
+}
+
+static void
+finalize (GObject *object)
+{
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  if (o->user_data)
+    {
+      exr_tiled_file_free ((ExrTiledFile *) o->user_data);
+      o->user_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
 }
 
 static void
@@ -674,6 +874,8 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   source_class    = GEGL_OPERATION_SOURCE_CLASS (klass);
 
+  G_OBJECT_CLASS (klass)->finalize = finalize;
+
   source_class->process = process;
   operation_class->get_bounding_box = get_bounding_box;
 
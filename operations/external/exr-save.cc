@@ -18,8 +18,25 @@
 
 #ifdef GEGL_CHANT_PROPERTIES
 
+gegl_chant_register_enum (gegl_exr_save_compression)
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_NONE,  "none")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_RLE,   "rle")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_ZIPS,  "zips")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_ZIP,   "zip")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_PIZ,   "piz")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_PXR24, "pxr24")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_B44,   "b44")
+  enum_value (GEGL_EXR_SAVE_COMPRESSION_B44A,  "b44a")
+gegl_chant_register_enum_end (GeglExrSaveCompression)
+
 gegl_chant_file_path  (path, "File", "", "path of file to write to.")
 gegl_chant_int  (tile, "Tile", 0, 2048, 0, "tile size to use.")
+gegl_chant_enum (compression, "Compression",
+                 GeglExrSaveCompression, gegl_exr_save_compression,
+                 GEGL_EXR_SAVE_COMPRESSION_ZIP,
+                 "compression method to use.")
+gegl_chant_boolean (mipmap, "Mipmap", FALSE,
+                    "write mip-map levels, only used for tiled images.")
 
 #else
 
@@ -28,6 +45,7 @@ gegl_chant_int  (tile, "Tile", 0, 2048, 0, "tile size to use.")
 
 extern "C" {
 #include "gegl-chant.h"
+#include "gegl-config.h"
 } /* extern "C" */
 
 #include "config.h"
@@ -35,19 +53,23 @@ extern "C" {
 #include <ImfTiledOutputFile.h>
 #include <ImfOutputFile.h>
 #include <ImfChannelList.h>
+#include <ImfThreading.h>
 
 /**
  * create an Imf::Header for writing up to 4 channels (given in d).
  * d must be between 1 and 4.
  */
 static Imf::Header
-create_header (int w,
-               int h,
-               int d)
+create_header (int              w,
+               int              h,
+               int              d,
+               Imf::Compression compression)
 {
   Imf::Header header (w, h);
   Imf::FrameBuffer fbuf;
 
+  header.compression () = compression;
+
   if (d <= 2)
     {
       header.channels ().insert ("Y", Imf::Channel (Imf::FLOAT));
@@ -106,22 +128,58 @@ create_frame_buffer (int          w,
  * d=2: write Y and A.
  * d=3: write RGB.
  * d=4: write RGB and A.
+ * If input is given, mip-map levels rounded down are written as well,
+ * fetched from input at the scale of each level.
  */
 static void
-write_tiled_exr (const float       *pixels,
-                 int                w,
-                 int                h,
-                 int                d,
-                 int                tw,
-                 int                th,
-                 const std::string &filename)
+write_tiled_exr (const float         *pixels,
+                 int                  w,
+                 int                  h,
+                 int                  d,
+                 int                  tw,
+                 int                  th,
+                 Imf::Compression     compression,
+                 GeglBuffer          *input,
+                 const GeglRectangle *rect,
+                 const Babl          *format,
+                 const std::string   &filename)
 {
-  Imf::Header header (create_header (w, h, d));
-  header.setTileDescription (Imf::TileDescription (tw, th, Imf::ONE_LEVEL));
+  Imf::Header header (create_header (w, h, d, compression));
+  header.setTileDescription (Imf::TileDescription (tw, th,
+                               input ? Imf::MIPMAP_LEVELS : Imf::ONE_LEVEL,
+                               Imf::ROUND_DOWN));
   Imf::TiledOutputFile out (filename.c_str (), header);
   Imf::FrameBuffer fbuf (create_frame_buffer (w, h, d, pixels));
   out.setFrameBuffer (fbuf);
   out.writeTiles (0, out.numXTiles () - 1, 0, out.numYTiles () - 1);
+
+  for (int level = 1; input && level < out.numLevels (); level++)
+    {
+      int           lw = out.levelWidth (level);
+      int           lh = out.levelHeight (level);
+      GeglRectangle level_rect = {rect->x >> level, rect->y >> level, lw, lh};
+      float        *level_pixels
+        = (float *) g_malloc (lw * lh * d * sizeof *level_pixels);
+
+      gegl_buffer_get (input, &level_rect, 1.0 / (1 << level), format,
+                       level_pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      try
+        {
+          Imf::FrameBuffer level_fbuf (create_frame_buffer (lw, lh, d,
+                                                            level_pixels));
+          out.setFrameBuffer (level_fbuf);
+          out.writeTiles (0, out.numXTiles (level) - 1,
+                          0, out.numYTiles (level) - 1, level);
+        }
+      catch (...)
+        {
+          g_free (level_pixels);
+          throw;
+        }
+
+      g_free (level_pixels);
+    }
 }
 
 /**
@@ -134,9 +192,10 @@ write_scanline_exr (const float       *pixels,
                     int                w,
                     int                h,
                     int                d,
+                    Imf::Compression   compression,
                     const std::string &filename)
 {
-  Imf::Header header (create_header (w, h, d));
+  Imf::Header header (create_header (w, h, d, compression));
   Imf::OutputFile out (filename.c_str (), header);
   Imf::FrameBuffer fbuf (create_frame_buffer (w, h, d, pixels));
   out.setFrameBuffer (fbuf);
@@ -146,25 +205,35 @@ write_scanline_exr (const float       *pixels,
 /**
  * write the given pixel buffer, which is w * h * d to filename using the
  * tilesize as tile width and height. This is the only function calling
- * the openexr lib and therefore should be exception save.
+ * the openexr lib and therefore should be exception save. When
+ * mipmap_input is given, the tiled image includes mip-map levels.
  */
 static void
-exr_save_process (const float       *pixels,
-                  int                w,
-                  int                h,
-                  int                d,
-                  int                tile_size,
-                  const std::string &filename)
+exr_save_process (const float         *pixels,
+                  int                  w,
+                  int                  h,
+                  int                  d,
+                  int                  tile_size,
+                  Imf::Compression     compression,
+                  GeglBuffer          *mipmap_input,
+                  const GeglRectangle *rect,
+                  const Babl          *format,
+                  const std::string   &filename)
 {
+  /* let openexr (de)compress in as many threads as gegl renders with */
+  if (Imf::globalThreadCount () != gegl_config_threads ())
+    Imf::setGlobalThreadCount (gegl_config_threads ());
+
   if (tile_size == 0)
     {
       /* write a scanline exr image. */
-      write_scanline_exr (pixels, w, h, d, filename);
+      write_scanline_exr (pixels, w, h, d, compression, filename);
     }
   else
     {
       /* write a tiled exr image. */
-      write_tiled_exr (pixels, w, h, d, tile_size, tile_size, filename);
+      write_tiled_exr (pixels, w, h, d, tile_size, tile_size, compression,
+                       mipmap_input, rect, format, filename);
     }
 }
 
@@ -212,13 +281,15 @@ gegl_exr_save_process (GeglOperation       *operation,
         rect->width, rect->height, depth);
       return FALSE;
     }
-  gegl_buffer_get (input, rect, 1.0, babl_format (output_format.c_str ()),
+  const Babl *format = babl_format (output_format.c_str ());
+  gegl_buffer_get (input, rect, 1.0, format,
                    pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
   bool status;
   try
     {
       exr_save_process (pixels, rect->width, rect->height,
-                        depth, tile_size, filename);
+                        depth, tile_size, (Imf::Compression) o->compression,
+                        o->mipmap ? input : NULL, rect, format, filename);
       status = TRUE;
     }
   catch (std::exception &e)
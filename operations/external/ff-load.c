@@ -40,6 +40,7 @@ property_int (frames, _("frames"), 0)
 
 #include "gegl-op.h"
 #include <errno.h>
+#include <math.h>
 
 #ifdef HAVE_LIBAVFORMAT_AVFORMAT_H
 #include <libavformat/avformat.h>
@@ -47,6 +48,35 @@ property_int (frames, _("frames"), 0)
 #include <avformat.h>
 #endif
 
+/* A background thread decodes frames ahead of the requested frame, the
+ * playhead, into a ring of FF_LOAD_RING_SIZE frames converted to
+ * R'G'B'A u8, so that playback and temporal operations requesting
+ * consecutive frames find them decoded already.
+ *
+ * Requests for frames behind the decoded position, or too far ahead of
+ * it, seek to the closest keyframe before the frame, and decode forward
+ * from there. Keyframe positions are remembered as they are decoded.
+ */
+#define FF_LOAD_RING_SIZE 8
+
+/* How far ahead of the decoded position decoding forward is preferred
+ * over seeking, when no keyframe in between is known
+ */
+#define FF_LOAD_MAX_SKIP  64
+
+/* How long the decoder thread waits for a request once the frames ahead
+ * of the playhead are decoded, before it frees the ring and exits. The
+ * next request starts it again.
+ */
+#define FF_LOAD_IDLE_TIME (5 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+  glong   frame;  /* frame number, -1 when the slot is free */
+  gint    users;  /* process calls copying from pixels */
+  guchar *pixels; /* R'G'B'A u8 */
+} FfFrame;
+
 typedef struct
 {
   gdouble          frames;
@@ -68,7 +98,21 @@ typedef struct
   guchar          *coded_buf;
 
   gchar           *loadedfilename; /* to remember which file is "cached"     */
-  glong            prevframe;      /* previously decoded frame in loadedfile */
+
+  /* only used by the decoder thread */
+  GArray          *keyframes;      /* sorted frame numbers of keyframes */
+  gboolean         no_timestamps;  /* frames are counted, seeking rewinds */
+
+  /* protected by mutex */
+  GThread         *decoder;
+  GMutex           mutex;
+  GCond            cond;
+  gboolean         quit;
+  gboolean         idle;           /* the decoder thread exited, idle */
+  glong            wanted_frame;   /* the playhead */
+  glong            next_frame;     /* of the decoder, -1 after seeking */
+  glong            eof_frame;      /* number of frames, once known */
+  FfFrame          ring[FF_LOAD_RING_SIZE];
 } Priv;
 
 
@@ -114,6 +158,9 @@ init (GeglProperties *o)
     {
       p = g_new0 (Priv, 1);
       o->user_data = (void*) p;
+
+      g_mutex_init (&p->mutex);
+      g_cond_init (&p->cond);
     }
 
   p->width = 320;
@@ -130,6 +177,35 @@ init (GeglProperties *o)
   p->codec_name = g_strdup ("");
 }
 
+static void
+ff_stop_decoder (Priv *p)
+{
+  gint i;
+
+  if (!p->decoder)
+    return;
+
+  g_mutex_lock (&p->mutex);
+  p->quit = TRUE;
+  g_cond_broadcast (&p->cond);
+  g_mutex_unlock (&p->mutex);
+
+  g_thread_join (p->decoder);
+  p->decoder = NULL;
+  p->quit    = FALSE;
+  p->idle    = FALSE;
+
+  for (i = 0; i < FF_LOAD_RING_SIZE; i++)
+    {
+      g_free (p->ring[i].pixels);
+      p->ring[i].pixels = NULL;
+    }
+
+  if (p->keyframes)
+    g_array_free (p->keyframes, TRUE);
+  p->keyframes = NULL;
+}
+
 /* FIXME: probably some more stuff to free here */
 static void
 ff_cleanup (GeglProperties *o)
@@ -137,6 +213,8 @@ ff_cleanup (GeglProperties *o)
   Priv *p = (Priv*)o->user_data;
   if (p)
     {
+      ff_stop_decoder (p);
+
       if (p->codec_name)
         g_free (p->codec_name);
       if (p->loadedfilename)
@@ -157,104 +235,400 @@ ff_cleanup (GeglProperties *o)
     }
 }
 
+static gdouble
+ff_fps (Priv *p)
+{
+  if (p->video_st->avg_frame_rate.num && p->video_st->avg_frame_rate.den)
+    return av_q2d (p->video_st->avg_frame_rate);
+  return 25.0;
+}
+
+static int64_t
+ff_start_time (Priv *p)
+{
+  if (p->video_st->start_time == AV_NOPTS_VALUE)
+    return 0;
+  return p->video_st->start_time;
+}
+
 static glong
-prev_keyframe (Priv *priv, glong frame)
+ff_timestamp_to_frame (Priv    *p,
+                       int64_t  timestamp)
 {
-  /* no way to detect previous keyframe at the moment for ffmpeg,
-     so we'll just return 0, the first, and a forced reload happens
-     if needed
-   */
-  return 0;
+  return floor ((timestamp - ff_start_time (p)) *
+                av_q2d (p->video_st->time_base) * ff_fps (p) + 0.5);
 }
 
-static int
-decode_frame (GeglOperation *operation,
-              glong          frame)
+static int64_t
+ff_frame_to_timestamp (Priv  *p,
+                       glong  frame)
 {
-  GeglProperties *o = GEGL_PROPERTIES (operation);
-  Priv       *p = (Priv*)o->user_data;
-  glong       prevframe = p->prevframe;
-  glong       decodeframe;        /*< frame to be requested decoded */
+  return ff_start_time (p) +
+         (int64_t) floor (frame / ff_fps (p) /
+                          av_q2d (p->video_st->time_base) + 0.5);
+}
+
+static void
+add_keyframe (Priv  *p,
+              glong  frame)
+{
+  guint lo = 0;
+  guint hi = p->keyframes->len;
 
-  if (frame >= p->frames)
+  while (lo < hi)
     {
-      frame = p->frames - 1;
+      guint mid = (lo + hi) / 2;
+
+      if (g_array_index (p->keyframes, glong, mid) < frame)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
 
-  if (frame < 0)
+  if (lo == p->keyframes->len ||
+      g_array_index (p->keyframes, glong, lo) != frame)
+    g_array_insert_val (p->keyframes, lo, frame);
+}
+
+/* the closest known keyframe at or before frame, or -1 */
+static glong
+prev_keyframe (Priv *priv, glong frame)
+{
+  glong keyframe = -1;
+  guint i;
+
+  for (i = 0; i < priv->keyframes->len; i++)
     {
-      frame = 0;
+      if (g_array_index (priv->keyframes, glong, i) > frame)
+        break;
+      keyframe = g_array_index (priv->keyframes, glong, i);
     }
 
-  if (frame == prevframe)
+  return keyframe;
+}
+
+/* Position the demuxer and decoder so that frame is among the next ones
+ * decoded. Returns the number of the next frame, or -1 when it is only
+ * known once that frame is decoded.
+ */
+static glong
+ff_seek (Priv  *p,
+         glong  frame)
+{
+  glong keyframe = prev_keyframe (p, frame);
+
+  if (p->no_timestamps || frame == 0)
     {
+      /* without timestamps, only rewinding is frame accurate */
+      av_seek_frame (p->ic, p->video_stream, ff_start_time (p),
+                     AVSEEK_FLAG_BACKWARD);
+      avcodec_flush_buffers (p->enc);
       return 0;
     }
 
-  /* figure out which frame we should start decoding at */
+  av_seek_frame (p->ic, p->video_stream,
+                 ff_frame_to_timestamp (p, keyframe >= 0 ? keyframe : frame),
+                 AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers (p->enc);
+
+  return -1;
+}
+
+/* Decode the next frame into p->lavc_frame, returns its frame number, -1
+ * at the end of the stream or on errors, or -2 when the frame number is
+ * not known.
+ */
+static glong
+ff_decode_next (Priv  *p,
+                glong  next_frame)
+{
+  int64_t timestamp;
+  int     got_picture = 0;
 
-  if (frame == prevframe + 1)
+  while (!got_picture)
     {
-      decodeframe = prevframe + 1;
+      AVPacket pkt;
+      int      eof;
+
+      do
+        {
+          eof = av_read_frame (p->ic, &pkt) < 0;
+          if (!eof && pkt.stream_index != p->video_stream)
+            av_free_packet (&pkt);
+        }
+      while (!eof && pkt.stream_index != p->video_stream);
+
+      if (eof)
+        {
+          /* drain the frames delayed in the decoder */
+          av_init_packet (&pkt);
+          pkt.data = NULL;
+          pkt.size = 0;
+        }
+
+      if (avcodec_decode_video2 (p->enc, p->lavc_frame,
+                                 &got_picture, &pkt) < 0)
+        {
+          if (!eof)
+            av_free_packet (&pkt);
+          return -1;
+        }
+
+      if (eof)
+        {
+          if (!got_picture)
+            return -1;
+        }
+      else
+        {
+          av_free_packet (&pkt);
+        }
     }
+
+  timestamp = av_frame_get_best_effort_timestamp (p->lavc_frame);
+
+  if (timestamp != AV_NOPTS_VALUE && !p->no_timestamps)
+    next_frame = ff_timestamp_to_frame (p, timestamp);
   else
+    p->no_timestamps = TRUE;
+
+  if (next_frame < 0)
+    return -2;
+
+  if (p->lavc_frame->key_frame)
+    add_keyframe (p, next_frame);
+
+  return next_frame;
+}
+
+/* Convert the decoded YUV 4:2:0 frame to R'G'B'A u8 */
+static void
+ff_frame_to_rgba (Priv   *p,
+                  guchar *buf)
+{
+  gint x, y;
+
+  for (y=0; y < p->height; y++)
     {
-      decodeframe = prev_keyframe (p, frame);
-      if (prevframe > decodeframe && prevframe < frame)
-        decodeframe = prevframe + 1;
+      guchar       *dst  = buf + y * p->width * 4;
+      const guchar *ysrc = p->lavc_frame->data[0] + y * p->lavc_frame->linesize[0];
+      const guchar *usrc = p->lavc_frame->data[1] + y/2 * p->lavc_frame->linesize[1];
+      const guchar *vsrc = p->lavc_frame->data[2] + y/2 * p->lavc_frame->linesize[2];
+
+      for (x=0;x < p->width; x++)
+        {
+          gint R,G,B;
+#ifndef byteclamp
+#define byteclamp(j) do{if(j<0)j=0; else if(j>255)j=255;}while(0)
+#endif
+#define YUV82RGB8(Y,U,V,R,G,B)do{\
+          R= ((Y<<15)                 + 37355*(V-128))>>15;\
+          G= ((Y<<15) -12911* (U-128) - 19038*(V-128))>>15;\
+          B= ((Y<<15) +66454* (U-128)                )>>15;\
+          byteclamp(R);\
+          byteclamp(G);\
+          byteclamp(B);\
+        } while(0)
+
+          YUV82RGB8 (*ysrc, *usrc, *vsrc, R, G, B);
+
+          *(unsigned int *) dst = R + G * 256 + B * 256 * 256 + 0xff000000;
+          dst += 4;
+          ysrc ++;
+          if (x % 2)
+            {
+              usrc++;
+              vsrc++;
+            }
+        }
     }
+}
+
+static FfFrame *
+ff_find_frame (Priv  *p,
+               glong  frame)
+{
+  gint i;
+
+  for (i = 0; i < FF_LOAD_RING_SIZE; i++)
+    if (p->ring[i].frame == frame)
+      return &p->ring[i];
+
+  return NULL;
+}
+
+/* Waits for a request, returns FALSE when none came for FF_LOAD_IDLE_TIME
+ * and the ring was freed. wanted is the frame the thread last decoded
+ * towards, a request for another one that came in while the wait timed
+ * out still counts.
+ */
+static gboolean
+ff_decoder_wait (Priv  *p,
+                 glong  wanted)
+{
+  gint i;
+
+  if (g_cond_wait_until (&p->cond, &p->mutex,
+                         g_get_monotonic_time () + FF_LOAD_IDLE_TIME))
+    return TRUE;
+
+  if (p->wanted_frame != wanted)
+    return TRUE;
+
+  for (i = 0; i < FF_LOAD_RING_SIZE; i++)
+    if (p->ring[i].users)
+      return TRUE;
 
-  if (decodeframe < prevframe + 0.0) // XXX: shuts up gcc
+  for (i = 0; i < FF_LOAD_RING_SIZE; i++)
     {
-      /* seeking backwards, since it ffmpeg doesn't allow us,. we'll reload the file */
-      g_free (p->loadedfilename);
-      p->loadedfilename = NULL;
-      init (o);
+      g_free (p->ring[i].pixels);
+      p->ring[i].pixels = NULL;
+      p->ring[i].frame  = -1;
     }
 
-  while (decodeframe <= frame)
+  return FALSE;
+}
+
+static gpointer
+ff_decoder_thread (gpointer data)
+{
+  Priv *p = data;
+
+  g_mutex_lock (&p->mutex);
+
+  while (!p->quit)
     {
-      int       got_picture = 0;
+      glong    wanted = p->wanted_frame;
+      glong    next   = p->next_frame;
+      glong    keyframe;
+      FfFrame *slot   = NULL;
+      gint     i;
+
+      /* frames behind the playhead, or too far ahead of it, are dropped */
+      for (i = 0; i < FF_LOAD_RING_SIZE; i++)
+        if (p->ring[i].frame < wanted ||
+            p->ring[i].frame >= wanted + FF_LOAD_RING_SIZE)
+          p->ring[i].frame = -1;
+
+      keyframe = prev_keyframe (p, wanted);
+
+      if (!ff_find_frame (p, wanted) && next >= 0 &&
+          (next > wanted ||
+           (!p->no_timestamps &&
+            (wanted - next > FF_LOAD_MAX_SKIP || keyframe > next))))
+        {
+          g_mutex_unlock (&p->mutex);
+          next = ff_seek (p, wanted);
+          g_mutex_lock (&p->mutex);
 
-      do
+          p->next_frame = next;
+          continue;
+        }
+
+      if (next >= wanted + FF_LOAD_RING_SIZE || next >= p->eof_frame)
         {
-          int       decoded_bytes;
+          if (!ff_decoder_wait (p, wanted))
+            break;
+          continue;
+        }
 
-          if (p->coded_bytes <= 0)
-            {
-              do
-                {
-                  if (av_read_frame (p->ic, &p->pkt) < 0)
-                    {
-                      fprintf (stderr, "av_read_frame failed for %s\n",
-                               o->path);
-                      return -1;
-                    }
-                }
-              while (p->pkt.stream_index != p->video_stream);
-
-              p->coded_bytes = p->pkt.size;
-              p->coded_buf = p->pkt.data;
-            }
-          decoded_bytes =
-            avcodec_decode_video2 (p->video_st->codec, p->lavc_frame,
-                                  &got_picture, &p->pkt);
-          if (decoded_bytes < 0)
-            {
-              fprintf (stderr, "avcodec_decode_video failed for %s\n",
-                       o->path);
-              return -1;
-            }
+      /* slots being copied from are not reused, even if dropped */
+      for (i = 0; i < FF_LOAD_RING_SIZE && !slot; i++)
+        if (p->ring[i].frame < 0 && !p->ring[i].users)
+          slot = &p->ring[i];
+
+      /* the whole window is decoded */
+      if (!slot)
+        {
+          if (!ff_decoder_wait (p, wanted))
+            break;
+          continue;
+        }
+
+      g_mutex_unlock (&p->mutex);
+
+      /* only this thread changes the ring, it can be read unlocked here */
+      next = ff_decode_next (p, next);
+      if (next >= wanted && next < wanted + FF_LOAD_RING_SIZE &&
+          !ff_find_frame (p, next))
+        ff_frame_to_rgba (p, slot->pixels);
+      else
+        slot = NULL;
+
+      g_mutex_lock (&p->mutex);
 
-          p->coded_buf += decoded_bytes;
-          p->coded_bytes -= decoded_bytes;
+      if (next == -2 || (p->next_frame < 0 && next > wanted))
+        {
+          /* timestamps are missing, or the seek went past the frame; fall
+           * back to counting frames from the start
+           */
+          p->no_timestamps = TRUE;
+          g_mutex_unlock (&p->mutex);
+          next = ff_seek (p, 0);
+          g_mutex_lock (&p->mutex);
+
+          p->next_frame = next;
+        }
+      else if (next < 0)
+        {
+          /* the end of the stream, when it is hit right after seeking the
+           * wanted frame does not exist
+           */
+          if (p->next_frame >= 0)
+            p->eof_frame = p->next_frame;
+          else
+            p->eof_frame = MIN (p->eof_frame, wanted);
+          p->next_frame = p->eof_frame;
+        }
+      else
+        {
+          if (slot)
+            slot->frame = next;
+          p->next_frame = next + 1;
         }
-      while (!got_picture);
 
-      decodeframe++;
+      g_cond_broadcast (&p->cond);
+    }
+
+  p->idle = !p->quit;
+
+  /* wake process () if it waits, it restarts the thread */
+  g_cond_broadcast (&p->cond);
+
+  g_mutex_unlock (&p->mutex);
+
+  return NULL;
+}
+
+/* Allocates the ring and starts the decoder thread, decoding on from
+ * where it was
+ */
+static void
+ff_start_decoder_thread (Priv *p)
+{
+  gint i;
+
+  for (i = 0; i < FF_LOAD_RING_SIZE; i++)
+    {
+      p->ring[i].frame  = -1;
+      p->ring[i].users  = 0;
+      p->ring[i].pixels = g_new (guchar, p->width * p->height * 4);
     }
-  p->prevframe = frame;
-  return 0;
+
+  p->idle    = FALSE;
+  p->decoder = g_thread_new ("ff-load decoder", ff_decoder_thread, p);
+}
+
+static void
+ff_start_decoder (Priv *p)
+{
+  p->keyframes     = g_array_new (FALSE, FALSE, sizeof (glong));
+  p->no_timestamps = FALSE;
+  p->wanted_frame  = 0;
+  p->next_frame    = 0;
+  p->eof_frame     = G_MAXLONG;
+
+  ff_start_decoder_thread (p);
 }
 
 static void
@@ -353,7 +727,6 @@ prepare (GeglOperation *operation)
       if (p->loadedfilename)
         g_free (p->loadedfilename);
       p->loadedfilename = g_strdup (o->path);
-      p->prevframe = -1;
       p->coded_bytes = 0;
       p->coded_buf = NULL;
 
@@ -365,6 +738,8 @@ prepare (GeglOperation *operation)
          */
         o->frames = p->ic->duration * p->video_st->time_base.den  / p->video_st->time_base.num / AV_TIME_BASE;
       }
+
+      ff_start_decoder (p);
     }
 }
 
@@ -384,58 +759,61 @@ process (GeglOperation       *operation,
          const GeglRectangle *result,
          gint                 level)
 {
-  GeglProperties *o = GEGL_PROPERTIES (operation);
-  Priv       *p = (Priv*)o->user_data;
+  GeglProperties *o     = GEGL_PROPERTIES (operation);
+  Priv           *p     = (Priv*)o->user_data;
+  glong           frame = o->frame;
+  FfFrame        *slot  = NULL;
 
-  {
-    if (p->ic && !decode_frame (operation, o->frame))
-      {
-        guchar *buf;
-        gint    pxsize;
-        gint    x,y;
+  if (!p->decoder)
+    return TRUE;
 
+  g_mutex_lock (&p->mutex);
 
-        g_object_get (output, "px-size", &pxsize, NULL);
-        buf = g_new (guchar, p->width * p->height * pxsize);
+  p->wanted_frame = frame;
+  g_cond_broadcast (&p->cond);
 
-        for (y=0; y < p->height; y++)
-          {
-            guchar       *dst  = buf + y * p->width * 4;
-            const guchar *ysrc = p->lavc_frame->data[0] + y * p->lavc_frame->linesize[0];
-            const guchar *usrc = p->lavc_frame->data[1] + y/2 * p->lavc_frame->linesize[1];
-            const guchar *vsrc = p->lavc_frame->data[2] + y/2 * p->lavc_frame->linesize[2];
+  while (!(slot = ff_find_frame (p, frame)))
+    {
+      /* the thread has exited, with the mutex released for good */
+      if (p->idle)
+        {
+          g_thread_join (p->decoder);
+          ff_start_decoder_thread (p);
+          continue;
+        }
+
+      /* past the end, show the last frame */
+      if (frame >= p->eof_frame)
+        {
+          if (p->eof_frame == 0)
+            break;
+
+          frame = p->wanted_frame = p->eof_frame - 1;
+          g_cond_broadcast (&p->cond);
+          continue;
+        }
+
+      g_cond_wait (&p->cond, &p->mutex);
+    }
+
+  if (slot)
+    slot->users++;
+
+  g_mutex_unlock (&p->mutex);
+
+  if (slot)
+    {
+      gegl_buffer_set (output, result, 0, babl_format ("R'G'B'A u8"),
+                       slot->pixels + (result->y * p->width + result->x) * 4,
+                       p->width * 4);
+
+      /* let the decoder reuse the slot */
+      g_mutex_lock (&p->mutex);
+      slot->users--;
+      g_cond_broadcast (&p->cond);
+      g_mutex_unlock (&p->mutex);
+    }
 
-            for (x=0;x < p->width; x++)
-              {
-                gint R,G,B;
-#ifndef byteclamp
-#define byteclamp(j) do{if(j<0)j=0; else if(j>255)j=255;}while(0)
-#endif
-#define YUV82RGB8(Y,U,V,R,G,B)do{\
-                R= ((Y<<15)                 + 37355*(V-128))>>15;\
-                G= ((Y<<15) -12911* (U-128) - 19038*(V-128))>>15;\
-                B= ((Y<<15) +66454* (U-128)                )>>15;\
-                byteclamp(R);\
-                byteclamp(G);\
-                byteclamp(B);\
-              } while(0)
-
-              YUV82RGB8 (*ysrc, *usrc, *vsrc, R, G, B);
-
-              *(unsigned int *) dst = R + G * 256 + B * 256 * 256 + 0xff000000;
-              dst += 4;
-              ysrc ++;
-              if (x % 2)
-                {
-                  usrc++;
-                  vsrc++;
-                }
-              }
-          }
-        gegl_buffer_set (output, NULL, 0, NULL, buf, GEGL_AUTO_ROWSTRIDE);
-        g_free (buf);
-      }
-  }
   return  TRUE;
 }
 
@@ -448,9 +826,11 @@ finalize (GObject *object)
     {
       Priv *p = (Priv*)o->user_data;
 
-      g_free (p->loadedfilename);
+      ff_cleanup (o);
       g_free (p->fourcc);
-      g_free (p->codec_name);
+
+      g_mutex_clear (&p->mutex);
+      g_cond_clear (&p->cond);
 
       g_free (o->user_data);
       o->user_data = NULL;
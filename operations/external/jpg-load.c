@@ -205,111 +205,279 @@ gegl_jpg_load_query_jpg (GInputStream *stream,
   return status;
 }
 
-static gint
-gegl_jpg_load_buffer_import_jpg (GeglBuffer  *gegl_buffer,
-                                 GInputStream *stream,
-                                 gint         dest_x,
-                                 gint         dest_y)
+/* libjpeg can scale the image down by 1/2, 1/4 and 1/8 while decoding,
+ * which is much cheaper than decoding it whole and downsampling.
+ */
+#define JPG_LOAD_MAX_LEVEL 3
+
+/* An open jpeg file, decoded progressively. The decoder is kept around
+ * between calls to process, so that requests for successive bands of
+ * rows only decode each row once, and rows below the requested region
+ * are not decoded at all. It is freed, closing the file, once the last
+ * row has been decoded.
+ */
+typedef struct
 {
-  gint row_stride;
+  GFile                         *file;
+  GInputStream                  *stream;
   struct jpeg_decompress_struct  cinfo;
   struct jpeg_error_mgr          jerr;
   struct jpeg_source_mgr         src;
-  JSAMPARRAY                     buffer;
+  GioSource                      gio_source;
+  gint                           level; /* mipmap level decoded, at most JPG_LOAD_MAX_LEVEL */
   const Babl                    *format;
-  GeglRectangle                  write_rect;
-  gboolean                       is_inverted_cmyk = FALSE;
-  GioSource gio_source = { stream, NULL, 1024 };
+  gboolean                       is_inverted_cmyk;
+} JpgDecoder;
 
-  cinfo.err = jpeg_std_error (&jerr);
-  jpeg_create_decompress (&cinfo);
+static void
+gegl_jpg_load_decoder_free (JpgDecoder *decoder)
+{
+  if (decoder->gio_source.stream)
+    jpeg_destroy_decompress (&decoder->cinfo);
+  if (decoder->stream)
+    {
+      g_input_stream_close (decoder->stream, NULL, NULL);
+      g_object_unref (decoder->stream);
+    }
+  if (decoder->file)
+    g_object_unref (decoder->file);
+  g_free (decoder);
+}
 
-  gio_source_enable(&cinfo, &src, &gio_source);
+static JpgDecoder *
+gegl_jpg_load_decoder_open (const gchar *uri,
+                            const gchar *path,
+                            gint         level)
+{
+  JpgDecoder *decoder = g_new0 (JpgDecoder, 1);
+  GError     *err     = NULL;
 
-  (void) jpeg_read_header (&cinfo, TRUE);
+  decoder->stream = gegl_gio_open_input_stream (uri, path, &decoder->file, &err);
+  if (!decoder->stream)
+    {
+      if (err)
+        {
+          g_warning ("gegl:jpg-load %s", err->message);
+          g_error_free (err);
+        }
+      gegl_jpg_load_decoder_free (decoder);
+      return NULL;
+    }
+
+  decoder->gio_source.stream      = decoder->stream;
+  decoder->gio_source.buffer_size = 1024;
+
+  decoder->cinfo.err = jpeg_std_error (&decoder->jerr);
+  jpeg_create_decompress (&decoder->cinfo);
+
+  gio_source_enable (&decoder->cinfo, &decoder->src, &decoder->gio_source);
+
+  (void) jpeg_read_header (&decoder->cinfo, TRUE);
 
   /* This is the most accurate method and could be the fastest too. But
    * the results may vary on different platforms due to different
    * rounding behavior and precision.
    */
-  cinfo.dct_method = JDCT_FLOAT;
+  decoder->cinfo.dct_method = JDCT_FLOAT;
 
-  (void) jpeg_start_decompress (&cinfo);
+  /* Decode directly at the requested mipmap level */
+  decoder->level             = level;
+  decoder->cinfo.scale_num   = 1;
+  decoder->cinfo.scale_denom = 1 << level;
 
-  format = babl_from_jpeg_colorspace(cinfo.out_color_space);
-  if (!format)
+  (void) jpeg_start_decompress (&decoder->cinfo);
+
+  decoder->format = babl_from_jpeg_colorspace (decoder->cinfo.out_color_space);
+  if (!decoder->format)
     {
       g_warning ("attempted to load JPEG with unsupported color space: '%s'",
-                 jpeg_colorspace_name(cinfo.out_color_space));
-      jpeg_destroy_decompress (&cinfo);
-      return -1;
+                 jpeg_colorspace_name (decoder->cinfo.out_color_space));
+      gegl_jpg_load_decoder_free (decoder);
+      return NULL;
     }
 
-  row_stride = cinfo.output_width * cinfo.output_components;
+  // Most CMYK JPEG files are produced by Adobe Photoshop. Each component is stored where 0 means 100% ink
+  // However this might not be case for all. Gory details: https://bugzilla.mozilla.org/show_bug.cgi?id=674619
+  decoder->is_inverted_cmyk = (decoder->format == babl_format ("CMYK u8"));
 
-  if ((row_stride) % 2)
-    (row_stride)++;
+  return decoder;
+}
 
-  /* allocated with the jpeg library, and freed with the decompress context */
-  buffer = (*cinfo.mem->alloc_sarray)
-    ((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
+/* Decode scanlines up to (but not including) end_row into buffer, in
+ * strips of strip_height rows written with a single gegl_buffer_set each.
+ * Rows above start_row that still need to be decoded are skipped without
+ * being written. Rows are counted at the decoder's level, and written to
+ * the tiles of that level.
+ */
+static void
+gegl_jpg_load_decoder_read (JpgDecoder *decoder,
+                            GeglBuffer *buffer,
+                            gint        start_row,
+                            gint        end_row,
+                            gint        strip_height)
+{
+  struct jpeg_decompress_struct *cinfo = &decoder->cinfo;
+  gint        factor    = 1 << decoder->level;
+  gint        rowstride = cinfo->output_width * cinfo->output_components;
+  JSAMPLE    *pixels;
+  JSAMPROW   *rows;
+  gint        i;
+
+  end_row      = MIN (end_row, (gint) cinfo->output_height);
+  strip_height = MIN (strip_height, (gint) cinfo->output_height);
+
+  pixels = g_new (JSAMPLE, rowstride * strip_height);
+  rows   = g_new (JSAMPROW, strip_height);
+  for (i = 0; i < strip_height; i++)
+    rows[i] = pixels + i * rowstride;
+
+  while ((gint) cinfo->output_scanline < end_row)
+    {
+      GeglRectangle write_rect;
+      gint          first = cinfo->output_scanline;
+      gint          n;
+
+      if (first < start_row)
+        n = MIN (strip_height, start_row - first);
+      else
+        n = MIN (strip_height, end_row - first);
+
+      /* jpeg_read_scanlines may return fewer rows than asked for */
+      for (i = 0; i < n; )
+        i += jpeg_read_scanlines (cinfo, rows + i, n - i);
+
+      if (first < start_row)
+        continue;
+
+      if (decoder->is_inverted_cmyk)
+        {
+          for (i = 0; i < rowstride * n; i++)
+            pixels[i] = 255 - pixels[i];
+        }
 
-  write_rect.x = dest_x;
-  write_rect.y = dest_y;
-  write_rect.width  = cinfo.output_width;
-  write_rect.height = 1;
+      /* the rectangle is in level 0 coordinates */
+      gegl_rectangle_set (&write_rect,
+                          0, first * factor,
+                          cinfo->output_width * factor, n * factor);
+      gegl_buffer_set (buffer, &write_rect, decoder->level, decoder->format,
+                       pixels, rowstride);
+    }
 
-  // Most CMYK JPEG files are produced by Adobe Photoshop. Each component is stored where 0 means 100% ink
-  // However this might not be case for all. Gory details: https://bugzilla.mozilla.org/show_bug.cgi?id=674619
-  is_inverted_cmyk = (format == babl_format("CMYK u8"));
+  g_free (rows);
+  g_free (pixels);
+}
+
+/* What the operation keeps in user_data: the header of its file, read
+ * once per path, and the decoder while the image is being decoded.
+ */
+typedef struct
+{
+  gchar       *path;    /* path or uri the header was read from */
+  gint         width;
+  gint         height;
+  const Babl  *format;
+  JpgDecoder  *decoder;
+} JpgLoad;
+
+static void
+gegl_jpg_load_free (JpgLoad *load)
+{
+  if (load->decoder)
+    gegl_jpg_load_decoder_free (load->decoder);
+  g_free (load->path);
+  g_free (load);
+}
 
-  while (cinfo.output_scanline < cinfo.output_height)
+/* Get the header of the operation's file, reading it if the file changed */
+static JpgLoad *
+gegl_jpg_load_get_load (GeglOperation *operation)
+{
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  JpgLoad        *load   = o->user_data;
+  const gchar    *path   = o->uri && *o->uri ? o->uri : o->path;
+  GFile          *file   = NULL;
+  GError         *err    = NULL;
+  GInputStream   *stream;
+  gint            status;
+
+  if (load && ! g_strcmp0 (load->path, path))
+    return load;
+
+  if (load)
     {
-      jpeg_read_scanlines (&cinfo, buffer, 1);
+      gegl_jpg_load_free (load);
+      o->user_data = NULL;
+    }
 
-      if (is_inverted_cmyk) {
-        for (int i=0; i<row_stride; i++) {
-            buffer[0][i] = 255-buffer[0][i];
-        }
-      }
+  stream = gegl_gio_open_input_stream (o->uri, o->path, &file, &err);
+  if (!stream)
+    {
+      g_clear_error (&err);
+      return NULL;
+    }
+
+  load = g_new0 (JpgLoad, 1);
 
-      gegl_buffer_set (gegl_buffer, &write_rect, 0,
-                       format, buffer[0],
-                       GEGL_AUTO_ROWSTRIDE);
+  status = gegl_jpg_load_query_jpg (stream, &load->width, &load->height,
+                                    &load->format);
+  g_input_stream_close (stream, NULL, NULL);
 
-      write_rect.y += 1;
+  g_object_unref (stream);
+  if (file) g_object_unref (file);
+
+  if (err || status)
+    {
+      g_clear_error (&err);
+      g_free (load);
+      return NULL;
     }
 
-  jpeg_destroy_decompress (&cinfo);
+  load->path   = g_strdup (path);
+  o->user_data = load;
 
-  return 0;
+  return load;
 }
 
 static GeglRectangle
 gegl_jpg_load_get_bounding_box (GeglOperation *operation)
 {
-  gint width, height;
-  GeglProperties   *o = GEGL_PROPERTIES (operation);
-  const Babl *format = NULL;
-  GFile *file = NULL;
-  GError *err = NULL;
-  gint status = -1;
+  JpgLoad *load = gegl_jpg_load_get_load (operation);
 
-  GInputStream *stream = gegl_gio_open_input_stream(o->uri, o->path, &file, &err);
-  if (!stream)
+  if (!load)
     return (GeglRectangle) {0, 0, 0, 0};
-  status = gegl_jpg_load_query_jpg (stream, &width, &height, &format);
-  g_input_stream_close(stream, NULL, NULL);
 
-  if (format)
-    gegl_operation_set_format (operation, "output", format);
+  gegl_operation_set_format (operation, "output", load->format);
 
-  g_object_unref(stream);
-  if (file) g_object_unref(file);
-  if (err || status)
-    return (GeglRectangle) {0, 0, 0, 0};
-  else
-    return (GeglRectangle) {0, 0, width, height};
+  return (GeglRectangle) {0, 0, load->width, load->height};
+}
+
+/* Get the decoder of the operation's file at level, (re)opening it if
+ * the level changed or if rows above start_row are needed after they
+ * were decoded.
+ */
+static JpgDecoder *
+gegl_jpg_load_get_decoder (GeglOperation *operation,
+                           gint           level,
+                           gint           start_row)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  JpgLoad        *load = gegl_jpg_load_get_load (operation);
+
+  if (!load)
+    return NULL;
+
+  if (load->decoder &&
+      (load->decoder->level != level ||
+       (gint) load->decoder->cinfo.output_scanline > start_row))
+    {
+      gegl_jpg_load_decoder_free (load->decoder);
+      load->decoder = NULL;
+    }
+
+  if (!load->decoder)
+    load->decoder = gegl_jpg_load_decoder_open (o->uri, o->path, level);
+
+  return load->decoder;
 }
 
 static gboolean
@@ -319,32 +487,90 @@ gegl_jpg_load_process (GeglOperation       *operation,
                        gint                 level)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
-  GFile *file = NULL;
-  GError *err = NULL;
-  gint status = -1;
-  GInputStream *stream = gegl_gio_open_input_stream(o->uri, o->path, &file, &err);
-  if (!stream)
-    return FALSE;
-  status = gegl_jpg_load_buffer_import_jpg(output, stream, 0, 0);
-  g_input_stream_close(stream, NULL, NULL);
+  JpgDecoder     *decoder;
+  gint            factor;
+  gint            strip_height;
+
+  /* Deeper levels are built from the smallest scaled decode by the
+   * buffer's mipmap generation.
+   */
+  level  = CLAMP (level, 0, JPG_LOAD_MAX_LEVEL);
+  factor = 1 << level;
 
-  if (err)
+  decoder = gegl_jpg_load_get_decoder (operation, level, result->y / factor);
+
+  if (!decoder)
     {
-      g_warning ("%s failed to open file %s for reading: %s",
-        G_OBJECT_TYPE_NAME (operation), o->path, err->message);
-      g_object_unref(stream);
+      g_warning ("%s failed to open file %s for reading",
+                 G_OBJECT_TYPE_NAME (operation), o->path);
       return FALSE;
     }
 
-  g_object_unref(stream);
-  return status != 1;
+  g_object_get (output, "tile-height", &strip_height, NULL);
+  strip_height = MAX (strip_height, 1);
+
+  gegl_jpg_load_decoder_read (decoder, output, result->y / factor,
+                              (result->y + result->height + factor - 1) / factor,
+                              strip_height);
+
+  /* nothing is left to decode, don't hold on to the file */
+  if (decoder->cinfo.output_scanline >= decoder->cinfo.output_height)
+    {
+      JpgLoad *load = o->user_data;
+
+      gegl_jpg_load_decoder_free (decoder);
+      load->decoder = NULL;
+    }
+
+  return TRUE;
 }
 
+/* Jpeg files are decoded from the top, processing is rounded to bands of
+ * JPG_LOAD_BAND_HEIGHT complete rows so that successive requests continue
+ * where the previous one stopped.
+ */
+#define JPG_LOAD_BAND_HEIGHT 128
+
 static GeglRectangle
 gegl_jpg_load_get_cached_region (GeglOperation       *operation,
                                  const GeglRectangle *roi)
 {
-  return gegl_jpg_load_get_bounding_box (operation);
+  JpgLoad       *load   = gegl_jpg_load_get_load (operation);
+  GeglRectangle  bounds = {0,0,0,0};
+  GeglRectangle  region;
+  gint           y0, y1;
+
+  if (!load)
+    return bounds;
+
+  bounds.width  = load->width;
+  bounds.height = load->height;
+
+  if (roi->height <= 0)
+    return bounds;
+
+  y0 = roi->y / JPG_LOAD_BAND_HEIGHT * JPG_LOAD_BAND_HEIGHT;
+  y1 = (roi->y + roi->height + JPG_LOAD_BAND_HEIGHT - 1) /
+       JPG_LOAD_BAND_HEIGHT * JPG_LOAD_BAND_HEIGHT;
+
+  gegl_rectangle_set (&region, bounds.x, y0, bounds.width, y1 - y0);
+  gegl_rectangle_intersect (&region, &region, &bounds);
+
+  return region;
+}
+
+static void
+gegl_jpg_load_finalize (GObject *object)
+{
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  if (o->user_data)
+    {
+      gegl_jpg_load_free (o->user_data);
+      o->user_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
 }
 
 static void
@@ -356,6 +582,8 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   source_class    = GEGL_OPERATION_SOURCE_CLASS (klass);
 
+  G_OBJECT_CLASS (klass)->finalize = gegl_jpg_load_finalize;
+
   source_class->process = gegl_jpg_load_process;
   operation_class->get_bounding_box = gegl_jpg_load_get_bounding_box;
   operation_class->get_cached_region = gegl_jpg_load_get_cached_region;
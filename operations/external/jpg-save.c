@@ -49,6 +49,11 @@ property_boolean (grayscale, _("Grayscale"), FALSE)
 #include <stdio.h>
 #include <jpeglib.h>
 
+#include "strip-reader.h"
+
+/* Rows fetched from the buffer while the previous ones are compressed */
+#define JPG_SAVE_STRIP_HEIGHT 64
+
 static gint
 gegl_buffer_export_jpg (GeglBuffer  *gegl_buffer,
                         const gchar *path,
@@ -65,8 +70,11 @@ gegl_buffer_export_jpg (GeglBuffer  *gegl_buffer,
   FILE *fp;
   struct jpeg_compress_struct cinfo;
   struct jpeg_error_mgr jerr;
-  JSAMPROW row_pointer[1];
+  JSAMPROW row_pointer[JPG_SAVE_STRIP_HEIGHT];
   const Babl *format;
+  GeglRectangle rect;
+  StripReader *reader;
+  Strip *strip;
 
   if (!strcmp (path, "-"))
     {
@@ -126,36 +134,33 @@ gegl_buffer_export_jpg (GeglBuffer  *gegl_buffer,
   jpeg_start_compress (&cinfo, TRUE);
 
   if (!grayscale)
-    {
-      format = babl_format ("R'G'B' u8");
-      row_pointer[0] = g_malloc (width * 3);
-    }
+    format = babl_format ("R'G'B' u8");
   else
+    format = babl_format ("Y' u8");
+
+  /* compress each strip while the next one is being fetched */
+  gegl_rectangle_set (&rect, src_x, src_y, width, height);
+  reader = strip_reader_new (gegl_buffer, &rect, format,
+                             JPG_SAVE_STRIP_HEIGHT);
+
+  while ((strip = strip_reader_next (reader)))
     {
-      format = babl_format ("Y' u8");
-      row_pointer[0] = g_malloc (width);
-    }
+      gint i;
 
-  while (cinfo.next_scanline < cinfo.image_height) {
-    GeglRectangle rect;
+      for (i = 0; i < strip->height; i++)
+        row_pointer[i] = strip->data + i * reader->rowstride;
 
-    rect.x = src_x;
-    rect.y = src_y + cinfo.next_scanline;
-    rect.width = width;
-    rect.height = 1;
+      for (i = 0; i < strip->height; )
+        i += jpeg_write_scanlines (&cinfo, row_pointer + i, strip->height - i);
 
-    gegl_buffer_get (gegl_buffer, &rect, 1.0, format,
-                     row_pointer[0], GEGL_AUTO_ROWSTRIDE,
-                     GEGL_ABYSS_NONE);
+      strip_reader_release (reader, strip);
+    }
 
-    jpeg_write_scanlines (&cinfo, row_pointer, 1);
-  }
+  strip_reader_free (reader);
 
   jpeg_finish_compress (&cinfo);
   jpeg_destroy_compress (&cinfo);
 
-  g_free (row_pointer[0]);
-
   if (stdout != fp)
     fclose (fp);
 
@@ -188,6 +193,7 @@ gegl_op_class_init (GeglOpClass *klass)
   sink_class      = GEGL_OPERATION_SINK_CLASS (klass);
 
   sink_class->process    = gegl_jpg_save_process;
+  /* the input is rendered in full before it is encoded, see strip-reader.h */
   sink_class->needs_full = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
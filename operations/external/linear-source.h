@@ -0,0 +1,172 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+/* Loaders of uncompressed formats hand the graph a linear buffer over
+ * their pixel data, the way gegl:buffer-source passes on its buffer,
+ * instead of copying the pixels into the tiles of an output buffer.
+ *
+ * When the pixels in the file are laid out in a babl format, the buffer
+ * is backed by a read-only mapping of the file: nothing is copied, and
+ * only the pages of the file a graph actually reads are faulted in.
+ * Otherwise the loader decodes the image once into memory owned by the
+ * buffer.
+ *
+ * Operations using this set no_cache, and override the process method of
+ * GeglOperationClass with one calling linear_source_process().
+ */
+
+#include "gegl-buffer-backend.h"
+
+typedef GeglBuffer * (*LinearSourceLoadFunc) (GeglOperation *operation);
+
+typedef struct
+{
+  gchar      *path;   /* the path buffer was loaded from */
+  GeglBuffer *buffer;
+} LinearSource;
+
+/* The single tile of a linear buffer is inserted in the tile cache as
+ * modified, so when the cache evicts it, it is written to the buffer's
+ * backend, with the pixels faulted in from the file for a mapping. Store
+ * it right away instead: the ram backend keeps a reference to the tile,
+ * not a copy of its pixels, and the clean tile is dropped from the cache
+ * without writing anything and found again in the backend.
+ */
+static void
+linear_source_store_tile (GeglBuffer *buffer)
+{
+  GeglTile *tile = gegl_buffer_get_tile (buffer, 0, 0, 0);
+
+  gegl_tile_store (tile);
+  gegl_tile_unref (tile);
+}
+
+/* Returns a linear buffer over the width x height pixels of format stored
+ * at offset in the file at path, or NULL if the file is too short, or the
+ * pixels are not aligned for the format's components.
+ */
+static GeglBuffer *
+linear_source_new_mapped (const gchar *path,
+                          gsize        offset,
+                          const Babl  *format,
+                          gint         width,
+                          gint         height)
+{
+  GMappedFile   *mapped;
+  GeglBuffer    *buffer;
+  GeglRectangle  extent    = {0, 0, width, height};
+  gint           bpp       = babl_format_get_bytes_per_pixel (format);
+  gsize          rowstride = (gsize) width * bpp;
+  GError        *error     = NULL;
+
+  if (offset % (bpp / babl_format_get_n_components (format)))
+    return NULL;
+
+  mapped = g_mapped_file_new (path, FALSE, &error);
+  if (!mapped)
+    {
+      g_error_free (error);
+      return NULL;
+    }
+
+  if (g_mapped_file_get_length (mapped) < offset + rowstride * height)
+    {
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  buffer = gegl_buffer_linear_new_from_data (g_mapped_file_get_contents (mapped) + offset,
+                                             format, &extent, rowstride,
+                                             (GDestroyNotify) g_mapped_file_unref,
+                                             mapped);
+  linear_source_store_tile (buffer);
+
+  return buffer;
+}
+
+/* Returns a linear buffer taking ownership of width x height pixels of
+ * format in g_malloc'ed memory.
+ */
+static GeglBuffer *
+linear_source_new_from_data (gpointer    pixels,
+                             const Babl *format,
+                             gint        width,
+                             gint        height)
+{
+  GeglRectangle  extent = {0, 0, width, height};
+  GeglBuffer    *buffer;
+
+  buffer = gegl_buffer_linear_new_from_data (pixels, format, &extent, 0,
+                                             g_free, pixels);
+  linear_source_store_tile (buffer);
+
+  return buffer;
+}
+
+/* Passes buffer on as the output of the operation being processed in
+ * context.
+ */
+static void
+linear_source_output (GeglOperationContext *context,
+                      GeglBuffer           *buffer)
+{
+  g_object_ref (buffer); /* gegl_operation_context_take_object steals one */
+  gegl_operation_context_take_object (context, "output", G_OBJECT (buffer));
+
+  /* the pixels may be a read-only mapping, never process in place */
+  gegl_object_set_has_forked (G_OBJECT (buffer));
+}
+
+static void
+linear_source_free (LinearSource *source)
+{
+  if (source->buffer)
+    g_object_unref (source->buffer);
+  g_free (source->path);
+  g_free (source);
+}
+
+/* Outputs the buffer of the file at path, loading it with load unless it
+ * was already loaded for that path. The buffer is kept in *source until
+ * the path changes or linear_source_free() is called.
+ */
+static gboolean
+linear_source_process (GeglOperation         *operation,
+                       LinearSource         **source,
+                       const gchar           *path,
+                       LinearSourceLoadFunc   load,
+                       GeglOperationContext  *context)
+{
+  if (*source && g_strcmp0 ((*source)->path, path))
+    {
+      linear_source_free (*source);
+      *source = NULL;
+    }
+
+  if (!*source)
+    {
+      *source = g_new0 (LinearSource, 1);
+      (*source)->path   = g_strdup (path);
+      (*source)->buffer = load (operation);
+    }
+
+  if (!(*source)->buffer)
+    return FALSE;
+
+  linear_source_output (context, (*source)->buffer);
+
+  return TRUE;
+}
@@ -46,6 +46,11 @@ property_int    (active_levels, _("Active levels"), 2)
    description  (_("Number of levels to perform solving"))
    value_range  (0, 8)
 
+property_int    (direct_max_pixels, _("Direct solve size"), 256 * 256)
+   description  (_("Levels with more pixels are solved iteratively rather "
+                   "than by factorisation, which needs much more memory"))
+   value_range  (0, G_MAXINT)
+
 #else
 
 #define GEGL_OP_COMPOSER
@@ -53,6 +58,7 @@ property_int    (active_levels, _("Active levels"), 2)
 
 #include "gegl-op.h"
 #include "gegl-debug.h"
+#include "gegl-parallel.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -132,6 +138,27 @@ static const gdouble TRIMAP_ALPHA_THRESHOLD = 0.01;
 static const gint MIN_LEVEL_DIAMETER = 30;
 
 
+/* Levels with more pixels than the direct-max-pixels property (256x256 by
+ * default) are solved iteratively, using a matrix free conjugate gradient,
+ * rather than by factorising the matting laplacian with UMFPACK. The memory
+ * required by the factorisation grows much faster than the image, which
+ * otherwise limits us to rather small images.
+ *
+ * The conjugate gradient stops once the norm of the residual, L x - b, has
+ * dropped below MATTING_CG_TOLERANCE times the norm of b, or after
+ * MATTING_CG_MAX_ITERATIONS iterations. Since it starts from the upsampled
+ * solution of the coarser level, it usually stops on the tolerance after a
+ * few dozen iterations; the cap only bounds the time spent on badly
+ * conditioned problems, whose solution is then less accurate than the
+ * direct one.
+ */
+static const gint    MATTING_CG_MAX_ITERATIONS = 1000;
+static const gdouble MATTING_CG_TOLERANCE      = 1e-5;
+
+/* The minimum number of rows handed to a thread by the iterative solver */
+static const gint    MATTING_MIN_ROWS          = 8;
+
+
 /* Round upwards with performing `x / y' */
 static guint
 ceil_div (gint x, gint y)
@@ -1266,10 +1293,571 @@ cleanup:
 }
 
 
+/* The matting laplacian, in the matrix free form used by the iterative
+ * solver. Only the mean and the inverse regularised covariance of each
+ * window are stored (indexed by the window's center pixel). With
+ *
+ *   a_w = mean (x_j),  b_w = inv(cov_w) mean ((I_j - mean_w) x_j),  j in w
+ *
+ * the product of the laplacian with a vector x is
+ *
+ *   (L x)_i = lambda [i known] x_i + sum (x_i - a_w - (I_i - mean_w)' b_w)
+ *
+ * summed over the windows w containing pixel i, which is the same matrix
+ * matting_get_laplacian builds explicitly.
+ */
+typedef struct
+{
+  const gdouble       *image,
+                      *trimap;
+  const GeglRectangle *roi;
+  gint                 radius;
+  gdouble              epsilon,
+                       lambda;
+
+  gboolean            *window_valid;
+  gdouble             *window_mean,
+                      *window_inverse,
+                      *window_a,
+                      *window_b;
+  gdouble             *diagonal;
+} laplacian_t;
+
+
+/* State of the conjugate gradient solver shared by the threaded passes */
+typedef struct
+{
+  laplacian_t   *laplacian;
+  const gdouble *rhs;
+  gdouble       *x,
+                *r,
+                *z,
+                *p,
+                *q;
+  gdouble        alpha,
+                 beta;
+
+  /* Per row partial sums, added in order afterwards so that the result
+   * does not depend on the number of threads.
+   */
+  gdouble       *row_rz,
+                *row_rr;
+
+  /* Operands of the laplacian product */
+  const gdouble *product_in;
+  gdouble       *product_out;
+} matting_cg_t;
+
+
+static void
+matting_laplacian_windows (gsize    first_row,
+                           gsize    n_rows,
+                           gpointer user_data)
+{
+  laplacian_t         *l            = user_data;
+  const GeglRectangle *roi          = l->roi;
+  gint                 radius       = l->radius,
+                       diameter     = radius * 2 + 1,
+                       window_elems = diameter * diameter,
+                       cx, cy, x, y, a, b;
+
+  for (cy = first_row; cy < first_row + n_rows; ++cy)
+    for (cx = 0; cx < roi->width; ++cx)
+      {
+        gint     c = cx + cy * roi->width;
+        gdouble  mean[COMPONENTS_INPUT] = { 0.0, 0.0, 0.0 },
+          mean_matrix[COMPONENTS_INPUT][COMPONENTS_INPUT],
+           covariance[COMPONENTS_INPUT][COMPONENTS_INPUT],
+              inverse[COMPONENTS_INPUT][COMPONENTS_INPUT];
+
+        l->window_valid[c] = FALSE;
+
+        if (cx < radius || cx >= roi->width  - radius ||
+            cy < radius || cy >= roi->height - radius ||
+            !trimap_masked (l->trimap, cx, cy, roi))
+          continue;
+
+        memset (covariance, 0, sizeof (covariance));
+        for (y = cy - radius; y <= cy + radius; ++y)
+          for (x = cx - radius; x <= cx + radius; ++x)
+            {
+              const gdouble *pixel = l->image +
+                                     offset (x, y, roi, COMPONENTS_INPUT);
+
+              for (a = 0; a < COMPONENTS_INPUT; ++a)
+                {
+                  mean[a] += pixel[a];
+                  for (b = 0; b < COMPONENTS_INPUT; ++b)
+                    covariance[a][b] += pixel[a] * pixel[b];
+                }
+            }
+
+        for (a = 0; a < COMPONENTS_INPUT; ++a)
+          {
+            mean[a] /= window_elems;
+            for (b = 0; b < COMPONENTS_INPUT; ++b)
+              covariance[a][b] /= window_elems;
+          }
+
+        matting_vector3_self_product (mean, mean_matrix);
+        matting_matrix3_matrix3_sub  (covariance, mean_matrix, covariance);
+        covariance[0][0] += l->epsilon / window_elems;
+        covariance[1][1] += l->epsilon / window_elems;
+        covariance[2][2] += l->epsilon / window_elems;
+        matting_matrix3_inverse      (covariance, inverse);
+
+        memcpy (l->window_mean + c * COMPONENTS_INPUT, mean, sizeof (mean));
+        memcpy (l->window_inverse + c * COMPONENTS_INPUT * COMPONENTS_INPUT,
+                inverse, sizeof (inverse));
+        l->window_valid[c] = TRUE;
+      }
+}
+
+
+/* (I_i - mean_w)' M v, for the pixel colour I_i and the mean of window c */
+static inline gdouble
+matting_window_product (const laplacian_t *restrict l,
+                        const gdouble     *restrict pixel,
+                        gint               c,
+                        const gdouble     *restrict matrix,
+                        const gdouble     *restrict v)
+{
+  const gdouble *mean = l->window_mean + c * COMPONENTS_INPUT;
+  gdouble        d[COMPONENTS_INPUT],
+                 sum = 0.0;
+  gint           a;
+
+  for (a = 0; a < COMPONENTS_INPUT; ++a)
+    d[a] = pixel[a] - mean[a];
+
+  if (!matrix)
+    return d[0] * v[0] + d[1] * v[1] + d[2] * v[2];
+
+  for (a = 0; a < COMPONENTS_INPUT; ++a)
+    sum += d[a] * (matrix[a * COMPONENTS_INPUT + 0] * v[0] +
+                   matrix[a * COMPONENTS_INPUT + 1] * v[1] +
+                   matrix[a * COMPONENTS_INPUT + 2] * v[2]);
+  return sum;
+}
+
+
+/* The diagonal of the laplacian, used as the preconditioner */
+static void
+matting_laplacian_diagonal (gsize    first_row,
+                            gsize    n_rows,
+                            gpointer user_data)
+{
+  laplacian_t         *l            = user_data;
+  const GeglRectangle *roi          = l->roi;
+  gint                 radius       = l->radius,
+                       diameter     = radius * 2 + 1,
+                       window_elems = diameter * diameter,
+                       px, py, cx, cy;
+
+  for (py = first_row; py < first_row + n_rows; ++py)
+    for (px = 0; px < roi->width; ++px)
+      {
+        const gdouble *pixel = l->image + offset (px, py, roi, COMPONENTS_INPUT);
+        gdouble        value = 0.0;
+
+        if (!trimap_masked (l->trimap, px, py, roi))
+          value = l->lambda;
+
+        for (cy = MAX (py - radius, 0); cy <= MIN (py + radius, roi->height - 1); ++cy)
+          for (cx = MAX (px - radius, 0); cx <= MIN (px + radius, roi->width - 1); ++cx)
+            {
+              gint           c = cx + cy * roi->width;
+              const gdouble *mean;
+              gdouble        d[COMPONENTS_INPUT];
+
+              if (!l->window_valid[c])
+                continue;
+
+              mean = l->window_mean + c * COMPONENTS_INPUT;
+              d[0] = pixel[0] - mean[0];
+              d[1] = pixel[1] - mean[1];
+              d[2] = pixel[2] - mean[2];
+
+              value += 1.0 - (1.0 + matting_window_product (l, pixel, c,
+                                l->window_inverse +
+                                c * COMPONENTS_INPUT * COMPONENTS_INPUT, d)) /
+                             window_elems;
+            }
+
+        l->diagonal[px + py * roi->width] = value;
+      }
+}
+
+
+/* First half of the laplacian product: a_w and b_w of each window */
+static void
+matting_laplacian_product_windows (gsize    first_row,
+                                   gsize    n_rows,
+                                   gpointer user_data)
+{
+  matting_cg_t        *cg           = user_data;
+  laplacian_t         *l            = cg->laplacian;
+  const GeglRectangle *roi          = l->roi;
+  const gdouble       *in           = cg->product_in;
+  gint                 radius       = l->radius,
+                       diameter     = radius * 2 + 1,
+                       window_elems = diameter * diameter,
+                       cx, cy, x, y, a;
+
+  for (cy = first_row; cy < first_row + n_rows; ++cy)
+    for (cx = 0; cx < roi->width; ++cx)
+      {
+        gint           c = cx + cy * roi->width;
+        const gdouble *mean,
+                      *inverse;
+        gdouble        sum = 0.0,
+                       weighted[COMPONENTS_INPUT] = { 0.0, 0.0, 0.0 };
+
+        if (!l->window_valid[c])
+          continue;
+
+        mean    = l->window_mean    + c * COMPONENTS_INPUT;
+        inverse = l->window_inverse + c * COMPONENTS_INPUT * COMPONENTS_INPUT;
+
+        for (y = cy - radius; y <= cy + radius; ++y)
+          for (x = cx - radius; x <= cx + radius; ++x)
+            {
+              const gdouble *pixel = l->image +
+                                     offset (x, y, roi, COMPONENTS_INPUT);
+              gdouble        value = in[x + y * roi->width];
+
+              sum += value;
+              for (a = 0; a < COMPONENTS_INPUT; ++a)
+                weighted[a] += (pixel[a] - mean[a]) * value;
+            }
+
+        l->window_a[c] = sum / window_elems;
+        for (a = 0; a < COMPONENTS_INPUT; ++a)
+          l->window_b[c * COMPONENTS_INPUT + a] =
+            (inverse[a * COMPONENTS_INPUT + 0] * weighted[0] +
+             inverse[a * COMPONENTS_INPUT + 1] * weighted[1] +
+             inverse[a * COMPONENTS_INPUT + 2] * weighted[2]) / window_elems;
+      }
+}
+
+
+/* Second half of the laplacian product: gather the window terms of each
+ * pixel.
+ */
+static void
+matting_laplacian_product_pixels (gsize    first_row,
+                                  gsize    n_rows,
+                                  gpointer user_data)
+{
+  matting_cg_t        *cg     = user_data;
+  laplacian_t         *l      = cg->laplacian;
+  const GeglRectangle *roi    = l->roi;
+  const gdouble       *in     = cg->product_in;
+  gdouble             *out    = cg->product_out;
+  gint                 radius = l->radius,
+                       px, py, cx, cy;
+
+  for (py = first_row; py < first_row + n_rows; ++py)
+    for (px = 0; px < roi->width; ++px)
+      {
+        const gdouble *pixel = l->image + offset (px, py, roi, COMPONENTS_INPUT);
+        gint           i     = px + py * roi->width;
+        gdouble        value = 0.0;
+
+        if (!trimap_masked (l->trimap, px, py, roi))
+          value = l->lambda * in[i];
+
+        for (cy = MAX (py - radius, 0); cy <= MIN (py + radius, roi->height - 1); ++cy)
+          for (cx = MAX (px - radius, 0); cx <= MIN (px + radius, roi->width - 1); ++cx)
+            {
+              gint c = cx + cy * roi->width;
+
+              if (!l->window_valid[c])
+                continue;
+
+              value += in[i] - l->window_a[c] -
+                       matting_window_product (l, pixel, c, NULL,
+                                               l->window_b + c * COMPONENTS_INPUT);
+            }
+
+        out[i] = value;
+      }
+}
+
+
+static void
+matting_laplacian_product (matting_cg_t  *cg,
+                           const gdouble *in,
+                           gdouble       *out)
+{
+  cg->product_in  = in;
+  cg->product_out = out;
+
+  gegl_parallel_distribute_range (cg->laplacian->roi->height, MATTING_MIN_ROWS,
+                                  matting_laplacian_product_windows, cg);
+  gegl_parallel_distribute_range (cg->laplacian->roi->height, MATTING_MIN_ROWS,
+                                  matting_laplacian_product_pixels, cg);
+}
+
+
+static gdouble
+matting_cg_sum (const gdouble *row_sums,
+                gint           rows)
+{
+  gdouble sum = 0.0;
+  gint    i;
+
+  for (i = 0; i < rows; ++i)
+    sum += row_sums[i];
+  return sum;
+}
+
+
+/* z = M^-1 r, and the row sums of r.z and r.r */
+static void
+matting_cg_precondition_rows (matting_cg_t *cg,
+                              gint          first_row,
+                              gint          n_rows)
+{
+  const laplacian_t *l     = cg->laplacian;
+  gint               width = l->roi->width,
+                     x, y;
+
+  for (y = first_row; y < first_row + n_rows; ++y)
+    {
+      gdouble rz = 0.0,
+              rr = 0.0;
+
+      for (x = y * width; x < (y + 1) * width; ++x)
+        {
+          /* Unconstrained pixels outside any window have an empty row */
+          cg->z[x] = l->diagonal[x] > 0.0 ? cg->r[x] / l->diagonal[x] : 0.0;
+          rz += cg->r[x] * cg->z[x];
+          rr += cg->r[x] * cg->r[x];
+        }
+
+      cg->row_rz[y] = rz;
+      cg->row_rr[y] = rr;
+    }
+}
+
+
+/* r = rhs - A x, z = M^-1 r, p = z; expects A x in q */
+static void
+matting_cg_start (gsize    first_row,
+                  gsize    n_rows,
+                  gpointer user_data)
+{
+  matting_cg_t *cg    = user_data;
+  gint          width = cg->laplacian->roi->width,
+                i;
+
+  for (i = first_row * width; i < (first_row + n_rows) * width; ++i)
+    cg->r[i] = cg->rhs[i] - cg->q[i];
+
+  matting_cg_precondition_rows (cg, first_row, n_rows);
+
+  for (i = first_row * width; i < (first_row + n_rows) * width; ++i)
+    cg->p[i] = cg->z[i];
+}
+
+
+/* Row sums of p.q, stored in row_rz */
+static void
+matting_cg_dot_pq (gsize    first_row,
+                   gsize    n_rows,
+                   gpointer user_data)
+{
+  matting_cg_t *cg    = user_data;
+  gint          width = cg->laplacian->roi->width,
+                x, y;
+
+  for (y = first_row; y < first_row + n_rows; ++y)
+    {
+      gdouble pq = 0.0;
+
+      for (x = y * width; x < (y + 1) * width; ++x)
+        pq += cg->p[x] * cg->q[x];
+
+      cg->row_rz[y] = pq;
+    }
+}
+
+
+/* x += alpha p, r -= alpha q, z = M^-1 r */
+static void
+matting_cg_step (gsize    first_row,
+                 gsize    n_rows,
+                 gpointer user_data)
+{
+  matting_cg_t *cg    = user_data;
+  gint          width = cg->laplacian->roi->width,
+                i;
+
+  for (i = first_row * width; i < (first_row + n_rows) * width; ++i)
+    {
+      cg->x[i] += cg->alpha * cg->p[i];
+      cg->r[i] -= cg->alpha * cg->q[i];
+    }
+
+  matting_cg_precondition_rows (cg, first_row, n_rows);
+}
+
+
+/* p = z + beta p */
+static void
+matting_cg_direction (gsize    first_row,
+                      gsize    n_rows,
+                      gpointer user_data)
+{
+  matting_cg_t *cg    = user_data;
+  gint          width = cg->laplacian->roi->width,
+                i;
+
+  for (i = first_row * width; i < (first_row + n_rows) * width; ++i)
+    cg->p[i] = cg->z[i] + cg->beta * cg->p[i];
+}
+
+
+/* Solve the matting laplacian with a Jacobi preconditioned conjugate
+ * gradient, starting from the estimate passed in solution (typically the
+ * upsampled solution of the coarser level). Memory use and the cost of each
+ * iteration are linear in the number of pixels, and every pass is
+ * distributed over rows.
+ */
+static gboolean
+matting_solve_laplacian_cg (const gdouble       *restrict image,
+                            const gdouble       *restrict trimap,
+                            gdouble             *restrict solution,
+                            const GeglRectangle *restrict roi,
+                            gint                 radius,
+                            gdouble              epsilon,
+                            gdouble              lambda)
+{
+  laplacian_t  l;
+  matting_cg_t cg;
+  gdouble     *rhs;
+  gdouble      rz, rhs_norm, residual_norm;
+  gint         image_elems, rows, i, iteration;
+
+  g_return_val_if_fail (image,    FALSE);
+  g_return_val_if_fail (trimap,   FALSE);
+  g_return_val_if_fail (solution, FALSE);
+  g_return_val_if_fail (radius > 0, FALSE);
+
+  g_return_val_if_fail (roi,       FALSE);
+  g_return_val_if_fail (!gegl_rectangle_is_empty (roi), FALSE);
+  image_elems = roi->width * roi->height;
+  rows        = roi->height;
+
+  l.image          = image;
+  l.trimap         = trimap;
+  l.roi            = roi;
+  l.radius         = radius;
+  l.epsilon        = epsilon;
+  l.lambda         = lambda;
+  l.window_valid   = g_new  (gboolean, image_elems);
+  l.window_mean    = g_new  (gdouble,  image_elems * COMPONENTS_INPUT);
+  l.window_inverse = g_new  (gdouble,  image_elems * COMPONENTS_INPUT *
+                                                     COMPONENTS_INPUT);
+  l.window_a       = g_new  (gdouble,  image_elems);
+  l.window_b       = g_new  (gdouble,  image_elems * COMPONENTS_INPUT);
+  l.diagonal       = g_new  (gdouble,  image_elems);
+
+  gegl_parallel_distribute_range (rows, MATTING_MIN_ROWS,
+                                  matting_laplacian_windows, &l);
+  gegl_parallel_distribute_range (rows, MATTING_MIN_ROWS,
+                                  matting_laplacian_diagonal, &l);
+
+  rhs = g_new (gdouble, image_elems);
+  for (i = 0; i < image_elems; ++i)
+    {
+      if (trimap_masked (trimap, i, 0, roi))
+        rhs[i] = 0.0;
+      else
+        rhs[i] = lambda * trimap[i * COMPONENTS_AUX + AUX_VALUE];
+    }
+
+  cg.laplacian = &l;
+  cg.rhs       = rhs;
+  cg.x         = solution;
+  cg.r         = g_new (gdouble, image_elems);
+  cg.z         = g_new (gdouble, image_elems);
+  cg.p         = g_new (gdouble, image_elems);
+  cg.q         = g_new (gdouble, image_elems);
+  cg.row_rz    = g_new (gdouble, rows);
+  cg.row_rr    = g_new (gdouble, rows);
+
+  rhs_norm = 0.0;
+  for (i = 0; i < image_elems; ++i)
+    rhs_norm += rhs[i] * rhs[i];
+  rhs_norm = sqrt (rhs_norm);
+
+  matting_laplacian_product (&cg, cg.x, cg.q);
+  gegl_parallel_distribute_range (rows, MATTING_MIN_ROWS,
+                                  matting_cg_start, &cg);
+  rz            = matting_cg_sum (cg.row_rz, rows);
+  residual_norm = sqrt (matting_cg_sum (cg.row_rr, rows));
+
+  for (iteration = 0;
+       iteration < MATTING_CG_MAX_ITERATIONS &&
+       residual_norm > MATTING_CG_TOLERANCE * rhs_norm;
+       ++iteration)
+    {
+      gdouble pq, new_rz;
+
+      matting_laplacian_product (&cg, cg.p, cg.q);
+      gegl_parallel_distribute_range (rows, MATTING_MIN_ROWS,
+                                      matting_cg_dot_pq, &cg);
+      pq = matting_cg_sum (cg.row_rz, rows);
+      if (pq <= 0.0)
+        break;
+
+      cg.alpha = rz / pq;
+      gegl_parallel_distribute_range (rows, MATTING_MIN_ROWS,
+                                      matting_cg_step, &cg);
+      new_rz        = matting_cg_sum (cg.row_rz, rows);
+      residual_norm = sqrt (matting_cg_sum (cg.row_rr, rows));
+
+      cg.beta = new_rz / rz;
+      rz      = new_rz;
+      gegl_parallel_distribute_range (rows, MATTING_MIN_ROWS,
+                                      matting_cg_direction, &cg);
+    }
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS,
+             "conjugate gradient on %dx%d: %d iterations, residual %g\n",
+             roi->width, roi->height, iteration,
+             rhs_norm > 0.0 ? residual_norm / rhs_norm : 0.0);
+
+  /* Courtesy clamping of the solution to normal alpha range */
+  for (i = 0; i < image_elems; ++i)
+    solution[i] = CLAMP (solution[i], 0.0, 1.0);
+
+  g_free (cg.r);
+  g_free (cg.z);
+  g_free (cg.p);
+  g_free (cg.q);
+  g_free (cg.row_rz);
+  g_free (cg.row_rr);
+  g_free (rhs);
+
+  g_free (l.window_valid);
+  g_free (l.window_mean);
+  g_free (l.window_inverse);
+  g_free (l.window_a);
+  g_free (l.window_b);
+  g_free (l.diagonal);
+
+  return TRUE;
+}
+
+
 /* Recursively downsample, solve, then upsample the matting laplacian.
  * Perform up to `levels' recursions (provided the image remains large
  * enough), with up to `active_levels' number of full laplacian solves (not
- * just extrapolation).
+ * just extrapolation). Levels of more than `direct_max_elems' pixels are
+ * solved with the conjugate gradient.
  */
 static gdouble *
 matting_solve_level (gdouble             *restrict pixels,
@@ -1280,7 +1868,8 @@ matting_solve_level (gdouble             *restrict pixels,
                      guint                radius,
                      gdouble              epsilon,
                      gdouble              lambda,
-                     gdouble              threshold)
+                     gdouble              threshold,
+                     gint                 direct_max_elems)
 {
   gint     i;
   gdouble *new_alpha    = NULL,
@@ -1326,7 +1915,7 @@ matting_solve_level (gdouble             *restrict pixels,
       small_alpha = matting_solve_level (small_pixels, small_trimap,
                                          &small_region, active_levels,
                                          levels - 1, radius, epsilon,
-                                         lambda, threshold);
+                                         lambda, threshold, direct_max_elems);
 
       new_alpha = matting_upsample_alpha (small_pixels, pixels, small_alpha,
                                           &small_region, region, epsilon,
@@ -1361,7 +1950,8 @@ matting_solve_level (gdouble             *restrict pixels,
     }
 
   /* Ordinary solution of the matting laplacian */
-  if (active_levels >= levels || levels == 0)
+  if ((active_levels >= levels || levels == 0) &&
+      region->width * region->height <= direct_max_elems)
     {
       sparse_t *laplacian;
       g_free (new_alpha);
@@ -1377,6 +1967,22 @@ matting_solve_level (gdouble             *restrict pixels,
       matting_solve_laplacian (trimap, laplacian, new_alpha, region, lambda);
       matting_sparse_free (laplacian);
     }
+  else if (active_levels >= levels || levels == 0)
+    {
+      /* Refine the upsampled solution of the coarser level if there is
+       * one, otherwise start from the trimap.
+       */
+      if (!new_alpha)
+        {
+          new_alpha = g_new (gdouble, region->width * region->height);
+          for (i = 0; i < region->width * region->height; ++i)
+            new_alpha[i] = CLAMP (trimap[i * COMPONENTS_AUX + AUX_VALUE],
+                                  0.0, 1.0);
+        }
+
+      matting_solve_laplacian_cg (pixels, trimap, new_alpha, region,
+                                  radius, epsilon, lambda);
+    }
 
   g_return_val_if_fail (new_alpha != NULL, NULL);
   return new_alpha;
@@ -1419,7 +2025,7 @@ matting_process (GeglOperation       *operation,
   output = matting_solve_level (input, trimap, result,
                                 MIN (o->active_levels, o->levels), o->levels,
                                 o->radius, powf (10, o->epsilon), o->lambda,
-                                o->threshold);
+                                o->threshold, o->direct_max_pixels);
   gegl_buffer_set (output_buf, result, 0, babl_format (FORMAT_OUTPUT), output,
                    GEGL_AUTO_ROWSTRIDE);
 
@@ -0,0 +1,348 @@
+/* This file is an image processing operation for GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ *
+ * This operation loads images in the npy file format, as written by
+ * gegl:npy-save or by python:
+ *
+ *   import numpy
+ *   numpy.save('image.npy', img)
+ *
+ * Arrays of shape (height, width) or (height, width, channels) with one
+ * to four channels of little endian unsigned integers or floating point
+ * numbers in C order are supported, and interpreted as linear Y, YA, RGB
+ * or RGBA.
+ */
+
+#include "config.h"
+#include <glib/gi18n-lib.h>
+
+
+#ifdef GEGL_PROPERTIES
+
+property_file_path (path, _("File"), "")
+    description (_("Path of file to load."))
+
+#else
+
+#define GEGL_OP_SOURCE
+#define GEGL_OP_C_SOURCE npy-load.c
+
+#include "gegl-op.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib/gstdio.h>
+
+#include "linear-source.h"
+
+#define NPY_MAGIC       "\223NUMPY"
+#define NPY_MAGIC_SIZE  6
+#define NPY_MAX_HEADER  (64 * 1024)
+
+typedef struct {
+  gint        width;
+  gint        height;
+  const Babl *format;
+  gsize       offset;   /* of the array data in the file */
+} npy_struct;
+
+/* Returns the value following 'key': in the header dictionary */
+static const gchar *
+npy_find_value (const gchar *header,
+                const gchar *key)
+{
+  gchar       *quoted = g_strdup_printf ("'%s'", key);
+  const gchar *value  = strstr (header, quoted);
+
+  if (value)
+    {
+      value = strchr (value + strlen (quoted), ':');
+      if (value)
+        {
+          value++;
+          while (*value == ' ')
+            value++;
+        }
+    }
+
+  g_free (quoted);
+  return value;
+}
+
+static const gchar *
+npy_get_type (const gchar *descr)
+{
+  /* single byte types have no byte order */
+  if (!strncmp (descr, "'|u1'", 5) || !strncmp (descr, "'u1'", 4) ||
+      !strncmp (descr, "'<u1'", 5))
+    return "u8";
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  if (!strncmp (descr, "'<u2'", 5))
+    return "u16";
+  if (!strncmp (descr, "'<u4'", 5))
+    return "u32";
+  if (!strncmp (descr, "'<f4'", 5))
+    return "float";
+  if (!strncmp (descr, "'<f8'", 5))
+    return "double";
+#endif
+
+  return NULL;
+}
+
+static gboolean
+npy_load_read_header (FILE       *fp,
+                      npy_struct *npy)
+{
+  guchar       preamble[NPY_MAGIC_SIZE + 2];
+  guchar       size[4];
+  gsize        size_len;
+  gsize        header_len;
+  gchar       *header;
+  const gchar *value;
+  const gchar *type;
+  glong        shape[3];
+  gint         n_dims = 0;
+  gint         channels;
+  gchar        format_string[32];
+  gboolean     ret = FALSE;
+
+  if (fread (preamble, 1, sizeof (preamble), fp) != sizeof (preamble) ||
+      memcmp (preamble, NPY_MAGIC, NPY_MAGIC_SIZE))
+    {
+      g_warning ("Image is not a npy file");
+      return FALSE;
+    }
+
+  /* version 1 stores the header length in 2 bytes, later versions in 4 */
+  size_len = preamble[NPY_MAGIC_SIZE] == 1 ? 2 : 4;
+  if (fread (size, 1, size_len, fp) != size_len)
+    return FALSE;
+
+  header_len = size[0] | size[1] << 8;
+  if (size_len == 4)
+    header_len |= (gsize) size[2] << 16 | (gsize) size[3] << 24;
+
+  if (header_len > NPY_MAX_HEADER)
+    {
+      g_warning ("npy header too long");
+      return FALSE;
+    }
+
+  header = g_malloc0 (header_len + 1);
+  if (fread (header, 1, header_len, fp) != header_len)
+    goto out;
+
+  npy->offset = sizeof (preamble) + size_len + header_len;
+
+  value = npy_find_value (header, "fortran_order");
+  if (!value || strncmp (value, "False", 5))
+    {
+      g_warning ("Only C ordered npy arrays are supported");
+      goto out;
+    }
+
+  value = npy_find_value (header, "descr");
+  if (!value || !(type = npy_get_type (value)))
+    {
+      g_warning ("Unsupported npy data type");
+      goto out;
+    }
+
+  value = npy_find_value (header, "shape");
+  if (!value || *value != '(')
+    goto out;
+  value++;
+
+  while (n_dims < 3)
+    {
+      gchar *end;
+
+      shape[n_dims] = strtol (value, &end, 10);
+      if (end == value)
+        break;
+      n_dims++;
+
+      value = end;
+      while (*value == ',' || *value == ' ' || *value == 'L')
+        value++;
+    }
+
+  if (*value != ')' || n_dims < 2)
+    {
+      g_warning ("Unsupported npy array shape");
+      goto out;
+    }
+
+  channels = n_dims == 3 ? shape[2] : 1;
+
+  if (shape[0] <= 0 || shape[0] > G_MAXINT ||
+      shape[1] <= 0 || shape[1] > G_MAXINT ||
+      channels < 1 || channels > 4)
+    {
+      g_warning ("Unsupported npy array shape");
+      goto out;
+    }
+
+  npy->height = shape[0];
+  npy->width  = shape[1];
+
+  g_snprintf (format_string, sizeof (format_string), "%s %s",
+              channels == 1 ? "Y" :
+              channels == 2 ? "YA" :
+              channels == 3 ? "RGB" : "RGBA",
+              type);
+  npy->format = babl_format (format_string);
+
+  ret = TRUE;
+
+ out:
+  g_free (header);
+  return ret;
+}
+
+static GeglRectangle
+get_bounding_box (GeglOperation *operation)
+{
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  GeglRectangle   result = {0,0,0,0};
+  npy_struct      npy;
+  FILE           *fp;
+
+  fp = fopen (o->path, "rb");
+
+  if (!fp)
+    return result;
+
+  if (npy_load_read_header (fp, &npy))
+    {
+      gegl_operation_set_format (operation, "output", npy.format);
+
+      result.width  = npy.width;
+      result.height = npy.height;
+    }
+
+  fclose (fp);
+
+  return result;
+}
+
+static GeglBuffer *
+npy_load_buffer (GeglOperation *operation)
+{
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  GeglBuffer     *buffer = NULL;
+  npy_struct      npy;
+  GStatBuf        stat_buf;
+  guint64         rowstride;
+  FILE           *fp;
+
+  fp = fopen (o->path, "rb");
+
+  if (!fp)
+    return NULL;
+
+  if (!npy_load_read_header (fp, &npy))
+    goto out;
+
+  /* don't allocate for the shape in the header before checking that the
+   * file holds that much data
+   */
+  rowstride = (guint64) npy.width * babl_format_get_bytes_per_pixel (npy.format);
+
+  if (g_stat (o->path, &stat_buf) ||
+      (guint64) stat_buf.st_size < npy.offset ||
+      ((guint64) stat_buf.st_size - npy.offset) / rowstride < npy.height)
+    {
+      g_warning ("%s: file is truncated", o->path);
+      goto out;
+    }
+
+  /* the array data is stored in the pixel format of the buffer */
+  buffer = linear_source_new_mapped (o->path, npy.offset, npy.format,
+                                     npy.width, npy.height);
+
+  /* e.g. when the data is not aligned for its type */
+  if (!buffer)
+    {
+      gsize   size   = rowstride * npy.height;
+      guchar *pixels = g_malloc0 (size);
+
+      if (fread (pixels, 1, size, fp) != size)
+        g_warning ("%s: failed to read the image data", o->path);
+
+      buffer = linear_source_new_from_data (pixels, npy.format,
+                                            npy.width, npy.height);
+    }
+
+ out:
+  fclose (fp);
+
+  return buffer;
+}
+
+static gboolean
+process (GeglOperation        *operation,
+         GeglOperationContext *context,
+         const gchar          *output_pad,
+         const GeglRectangle  *result,
+         gint                  level)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return linear_source_process (operation, (LinearSource **) &o->user_data,
+                                o->path, npy_load_buffer, context);
+}
+
+static void
+finalize (GObject *object)
+{
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  if (o->user_data)
+    {
+      linear_source_free (o->user_data);
+      o->user_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
+}
+
+static void
+gegl_op_class_init (GeglOpClass *klass)
+{
+  GeglOperationClass *operation_class;
+
+  operation_class = GEGL_OPERATION_CLASS (klass);
+
+  G_OBJECT_CLASS (klass)->finalize = finalize;
+
+  operation_class->process = process;
+  operation_class->get_bounding_box = get_bounding_box;
+  operation_class->no_cache = TRUE;
+
+  gegl_operation_class_set_keys (operation_class,
+    "name",        "gegl:npy-load",
+    "title",       _("NPY File Loader"),
+    "categories",  "hidden",
+    "description", _("NPY image loader (Numerical python file loader.)"),
+    NULL);
+
+  gegl_extension_handler_register (".npy", "gegl:npy-load");
+}
+
+#endif
@@ -44,6 +44,8 @@ static int npywrite_header(FILE *fp, int width, int height, int num_channels)
   const gchar* format;
   gsize header_len;
   gchar *header;
+  GString *padded;
+  guchar len_bytes[2];
 
   // Write header and version number to file
   fwrite("\223NUMPY"
@@ -57,9 +59,21 @@ static int npywrite_header(FILE *fp, int width, int height, int num_channels)
     format = "{'descr': '<f4', 'fortran_order': False, 'shape': (%d, %d), } \n";
   
   header = g_strdup_printf(format, height, width);
-  header_len = strlen(header);
-  fwrite(&header_len, 2, 1, fp);
-  fwrite(header, header_len, 1, fp);
+
+  // Pad the header with spaces so that the data following it is 64 byte
+  // aligned, as numpy does, letting gegl:npy-load map the data directly
+  padded = g_string_new (header);
+  g_string_truncate (padded, padded->len - 1);
+  while ((10 + padded->len + 1) % 64)
+    g_string_append_c (padded, ' ');
+  g_string_append_c (padded, '\n');
+
+  header_len = padded->len;
+  len_bytes[0] = header_len & 0xff;
+  len_bytes[1] = header_len >> 8;
+  fwrite(len_bytes, 2, 1, fp);
+  fwrite(padded->str, header_len, 1, fp);
+  g_string_free(padded, TRUE);
   g_free(header);
   
   return 0;
@@ -122,6 +136,11 @@ process (GeglOperation       *operation,
 
   g_free (data);
 
+  if (stdout != fp)
+    fclose (fp);
+
+  ret = TRUE;
+
   return ret;
 }
 
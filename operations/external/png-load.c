@@ -20,6 +20,7 @@
 
 #include "config.h"
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
 #include <gegl-gio-private.h>
 
 #ifdef GEGL_PROPERTIES
@@ -157,187 +158,257 @@ get_babl_format(int bit_depth, int color_type)
     return babl_format (format_string);
 }
 
-static gint
-gegl_buffer_import_png (GeglBuffer  *gegl_buffer,
-                        GInputStream *stream,
-                        gint         dest_x,
-                        gint         dest_y,
-                        gint        *ret_width,
-                        gint        *ret_height,
-                        const Babl  *format, // can be NULL
-                        GError **err)
+/* An open png file, decoded progressively. The decoder is kept around
+ * between calls to process, so that requests for successive bands of
+ * rows only decode each row once, and rows below the requested region
+ * are not decoded at all. It is freed, closing the file, once the last
+ * row has been decoded.
+ */
+typedef struct
 {
-  gint           width;
-  gint           bit_depth;
-  gint           bpp;
-  gint           number_of_passes=1;
-  png_uint_32    w;
-  png_uint_32    h;
-  png_structp    load_png_ptr;
-  png_infop      load_info_ptr;
-  guchar        *pixels;
-  /*png_bytep     *rows;*/
-
-
-  unsigned   int i;
-  png_bytep  *row_p = NULL;
-
-  g_return_val_if_fail(stream, -1);
+  GFile        *file;
+  GInputStream *stream;
+  png_structp   load_png_ptr;
+  png_infop     load_info_ptr;
+  const Babl   *format;
+  gint          width;
+  gint          height;
+  gint          bpp;
+  gint          passes;
+  gint          next_row;  /* next row libpng will decode */
+} PngDecoder;
 
-  if (!check_valid_png_header(stream, err))
+static void
+png_decoder_free (PngDecoder *decoder)
+{
+  if (decoder->load_png_ptr)
+    png_destroy_read_struct (&decoder->load_png_ptr,
+                             &decoder->load_info_ptr, NULL);
+  if (decoder->stream)
     {
-      return -1;
+      g_input_stream_close (decoder->stream, NULL, NULL);
+      g_object_unref (decoder->stream);
     }
+  if (decoder->file)
+    g_object_unref (decoder->file);
+  g_free (decoder);
+}
 
-  load_png_ptr = png_create_read_struct (PNG_LIBPNG_VER_STRING, NULL, error_fn, NULL);
+static PngDecoder *
+png_decoder_open (const gchar  *uri,
+                  const gchar  *path,
+                  GError      **err)
+{
+  PngDecoder  *decoder = g_new0 (PngDecoder, 1);
+  gint         bit_depth;
+  gint         color_type;
+  gint         interlace_type;
+  png_uint_32  w;
+  png_uint_32  h;
+
+  decoder->stream = gegl_gio_open_input_stream (uri, path, &decoder->file, err);
+  if (!decoder->stream ||
+      !check_valid_png_header (decoder->stream, err))
+    {
+      png_decoder_free (decoder);
+      return NULL;
+    }
 
-  if (!load_png_ptr)
+  decoder->load_png_ptr = png_create_read_struct (PNG_LIBPNG_VER_STRING,
+                                                  NULL, error_fn, NULL);
+  if (!decoder->load_png_ptr)
     {
-      return -1;
+      png_decoder_free (decoder);
+      return NULL;
     }
 
-  load_info_ptr = png_create_info_struct (load_png_ptr);
-  if (!load_info_ptr)
+  decoder->load_info_ptr = png_create_info_struct (decoder->load_png_ptr);
+  if (!decoder->load_info_ptr)
     {
-      png_destroy_read_struct (&load_png_ptr, &load_info_ptr, NULL);
-      return -1;
+      png_decoder_free (decoder);
+      return NULL;
     }
 
-  if (setjmp (png_jmpbuf (load_png_ptr)))
+  if (setjmp (png_jmpbuf (decoder->load_png_ptr)))
     {
-      png_destroy_read_struct (&load_png_ptr, &load_info_ptr, NULL);
-     if (row_p)
-        g_free (row_p);
-      return -1;
+      png_decoder_free (decoder);
+      return NULL;
     }
 
-  png_set_read_fn(load_png_ptr, stream, read_fn);
+  png_set_read_fn (decoder->load_png_ptr, decoder->stream, read_fn);
 
-  png_set_sig_bytes (load_png_ptr, 8); // we already read header
-  png_read_info (load_png_ptr, load_info_ptr);
-  {
-    int color_type;
-    int interlace_type;
+  png_set_sig_bytes (decoder->load_png_ptr, 8); // we already read header
+  png_read_info (decoder->load_png_ptr, decoder->load_info_ptr);
 
-    png_get_IHDR (load_png_ptr,
-                  load_info_ptr,
-                  &w, &h,
-                  &bit_depth,
-                  &color_type,
-                  &interlace_type,
-                  NULL, NULL);
-    width = w;
-    if (ret_width)
-      *ret_width = w;
-    if (ret_height)
-      *ret_height = h;
+  png_get_IHDR (decoder->load_png_ptr,
+                decoder->load_info_ptr,
+                &w, &h,
+                &bit_depth,
+                &color_type,
+                &interlace_type,
+                NULL, NULL);
+  decoder->width  = w;
+  decoder->height = h;
 
-    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
-      {
-        png_set_expand (load_png_ptr);
-        bit_depth = 8;
-      }
+  if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+    {
+      png_set_expand (decoder->load_png_ptr);
+      bit_depth = 8;
+    }
 
-    if (png_get_valid (load_png_ptr, load_info_ptr, PNG_INFO_tRNS))
-      {
-        png_set_tRNS_to_alpha (load_png_ptr);
-        color_type |= PNG_COLOR_MASK_ALPHA;
-      }
+  if (png_get_valid (decoder->load_png_ptr, decoder->load_info_ptr, PNG_INFO_tRNS))
+    {
+      png_set_tRNS_to_alpha (decoder->load_png_ptr);
+      color_type |= PNG_COLOR_MASK_ALPHA;
+    }
 
-    switch (color_type)
-      {
-        case PNG_COLOR_TYPE_GRAY:
-          bpp = 1;
-          break;
-        case PNG_COLOR_TYPE_GRAY_ALPHA:
-          bpp = 2;
-          break;
-        case PNG_COLOR_TYPE_RGB:
-          bpp = 3;
-          break;
-        case PNG_COLOR_TYPE_RGB_ALPHA:
-          bpp = 4;
-          break;
-        case (PNG_COLOR_TYPE_PALETTE | PNG_COLOR_MASK_ALPHA):
-          bpp = 4;
-          break;
-        case PNG_COLOR_TYPE_PALETTE:
-          bpp = 3;
-          break;
-        default:
-          g_warning ("color type mismatch");
-          png_destroy_read_struct (&load_png_ptr, &load_info_ptr, NULL);
-          return -1;
-      }
+  switch (color_type)
+    {
+      case PNG_COLOR_TYPE_GRAY:
+        decoder->bpp = 1;
+        break;
+      case PNG_COLOR_TYPE_GRAY_ALPHA:
+        decoder->bpp = 2;
+        break;
+      case PNG_COLOR_TYPE_RGB:
+        decoder->bpp = 3;
+        break;
+      case PNG_COLOR_TYPE_RGB_ALPHA:
+        decoder->bpp = 4;
+        break;
+      case (PNG_COLOR_TYPE_PALETTE | PNG_COLOR_MASK_ALPHA):
+        decoder->bpp = 4;
+        break;
+      case PNG_COLOR_TYPE_PALETTE:
+        decoder->bpp = 3;
+        break;
+      default:
+        g_warning ("color type mismatch");
+        png_decoder_free (decoder);
+        return NULL;
+    }
 
-    if (color_type == PNG_COLOR_TYPE_PALETTE)
-      png_set_palette_to_rgb (load_png_ptr);
+  if (color_type == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb (decoder->load_png_ptr);
 
-    if (bit_depth == 16)
-      bpp = bpp << 1;
+  if (bit_depth == 16)
+    decoder->bpp = decoder->bpp << 1;
 
-    if (!format)
-      format = get_babl_format(bit_depth, color_type);
+  decoder->format = get_babl_format (bit_depth, color_type);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
-    if (bit_depth == 16)
-      png_set_swap (load_png_ptr);
+  if (bit_depth == 16)
+    png_set_swap (decoder->load_png_ptr);
 #endif
 
-    if (interlace_type == PNG_INTERLACE_ADAM7)
-      number_of_passes = png_set_interlace_handling (load_png_ptr);
+  decoder->passes = 1;
+  if (interlace_type == PNG_INTERLACE_ADAM7)
+    decoder->passes = png_set_interlace_handling (decoder->load_png_ptr);
 
-    if (png_get_valid (load_png_ptr, load_info_ptr, PNG_INFO_gAMA))
-      {
-        gdouble gamma;
-        png_get_gAMA (load_png_ptr, load_info_ptr, &gamma);
-        png_set_gamma (load_png_ptr, 2.2, gamma);
-      }
-    else
-      {
-        png_set_gamma (load_png_ptr, 2.2, 0.45455);
-      }
+  if (png_get_valid (decoder->load_png_ptr, decoder->load_info_ptr, PNG_INFO_gAMA))
+    {
+      gdouble gamma;
+      png_get_gAMA (decoder->load_png_ptr, decoder->load_info_ptr, &gamma);
+      png_set_gamma (decoder->load_png_ptr, 2.2, gamma);
+    }
+  else
+    {
+      png_set_gamma (decoder->load_png_ptr, 2.2, 0.45455);
+    }
 
-    png_read_update_info (load_png_ptr, load_info_ptr);
-  }
+  png_read_update_info (decoder->load_png_ptr, decoder->load_info_ptr);
 
-  pixels = g_malloc0 (width*bpp);
+  return decoder;
+}
 
-  {
-    gint           pass;
-    GeglRectangle  rect;
+/* Decode rows up to (but not including) end_row into buffer, in strips of
+ * strip_height rows written with a single gegl_buffer_set each. Rows above
+ * start_row that still need to be decoded are skipped without being
+ * written. Interlaced images are always decoded as a whole.
+ */
+static gboolean
+png_decoder_read (PngDecoder *decoder,
+                  GeglBuffer *buffer,
+                  gint        start_row,
+                  gint        end_row,
+                  gint        strip_height)
+{
+  guchar     *pixels;
+  png_bytep  *rows;
+  gsize       rowstride = (gsize) decoder->width * decoder->bpp;
+  gint        pass;
+  gint        i;
 
-    for (pass=0; pass<number_of_passes; pass++)
-      {
-        for(i=0; i<h; i++)
-          {
-            gegl_rectangle_set (&rect, 0, i, width, 1);
+  if (decoder->passes > 1)
+    {
+      start_row = 0;
+      end_row   = decoder->height;
+    }
 
-            if (pass != 0)
-              gegl_buffer_get (gegl_buffer, &rect, 1.0, format, pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  end_row      = MIN (end_row, decoder->height);
+  strip_height = MIN (strip_height, decoder->height);
 
-            png_read_rows (load_png_ptr, &pixels, NULL, 1);
-            gegl_buffer_set (gegl_buffer, &rect, 0, format, pixels,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-      }
-  }
+  pixels = g_malloc0 (rowstride * strip_height);
+  rows   = g_new (png_bytep, strip_height);
+  for (i = 0; i < strip_height; i++)
+    rows[i] = pixels + i * rowstride;
 
+  if (setjmp (png_jmpbuf (decoder->load_png_ptr)))
+    {
+      g_free (rows);
+      g_free (pixels);
+      return FALSE;
+    }
 
-  png_read_end (load_png_ptr, NULL);
-  png_destroy_read_struct (&load_png_ptr, &load_info_ptr, NULL);
+  /* skip the rows between the last decoded row and the requested ones */
+  while (decoder->next_row < start_row)
+    {
+      gint n = MIN (strip_height, start_row - decoder->next_row);
+
+      png_read_rows (decoder->load_png_ptr, rows, NULL, n);
+      decoder->next_row += n;
+    }
+
+  for (pass = 0; pass < decoder->passes; pass++)
+    {
+      gint row = decoder->passes > 1 ? 0 : decoder->next_row;
+
+      while (row < end_row)
+        {
+          GeglRectangle rect;
+          gint          n = MIN (strip_height, end_row - row);
+
+          gegl_rectangle_set (&rect, 0, row, decoder->width, n);
+
+          /* later passes of interlaced images fill in earlier ones */
+          if (pass != 0)
+            gegl_buffer_get (buffer, &rect, 1.0, decoder->format, pixels,
+                             rowstride, GEGL_ABYSS_NONE);
 
+          png_read_rows (decoder->load_png_ptr, rows, NULL, n);
+
+          gegl_buffer_set (buffer, &rect, 0, decoder->format, pixels,
+                           rowstride);
+          row += n;
+        }
+    }
+
+  decoder->next_row = end_row;
+  if (decoder->next_row == decoder->height)
+    png_read_end (decoder->load_png_ptr, NULL);
+
+  g_free (rows);
   g_free (pixels);
 
-  return 0;
+  return TRUE;
 }
 
 
-
 static gint query_png (GInputStream *stream,
                        gint        *width,
                        gint        *height,
                        const Babl  **format,
+                       gboolean    *interlaced,
                        GError **err)
 {
   png_uint_32   w;
@@ -380,6 +451,7 @@ static gint query_png (GInputStream *stream,
   {
     int bit_depth;
     int color_type;
+    int interlace_type;
     const Babl *f;
 
     png_get_IHDR (load_png_ptr,
@@ -387,9 +459,11 @@ static gint query_png (GInputStream *stream,
                   &w, &h,
                   &bit_depth,
                   &color_type,
-                  NULL, NULL, NULL);
+                  &interlace_type,
+                  NULL, NULL);
     *width = w;
     *height = h;
+    *interlaced = interlace_type == PNG_INTERLACE_ADAM7;
 
     if (png_get_valid (load_png_ptr, load_info_ptr, PNG_INFO_tRNS))
       color_type |= PNG_COLOR_MASK_ALPHA;
@@ -407,76 +481,250 @@ static gint query_png (GInputStream *stream,
   return 0;
 }
 
-static GeglRectangle
-get_bounding_box (GeglOperation *operation)
+/* What the operation keeps in user_data: the header of its file, read
+ * again when the path or the file changes, and the decoder while the
+ * image is being decoded.
+ */
+typedef struct
 {
-  GeglProperties   *o = GEGL_PROPERTIES (operation);
-  GeglRectangle result = {0,0,0,0};
-  gint          width, height;
-  gint          status;
-  const Babl *  format;
-  GError *err = NULL;
-  GFile *infile = NULL;
+  gchar       *path;       /* path or uri the header was read from */
+  gint64       mtime;      /* of the file then, see png_file_stamp () */
+  gint64       size;
+  gint         width;
+  gint         height;
+  const Babl  *format;
+  gboolean     interlaced;
+  PngDecoder  *decoder;
+} PngLoad;
+
+static void
+png_load_free (PngLoad *load)
+{
+  if (load->decoder)
+    png_decoder_free (load->decoder);
+  g_free (load->path);
+  g_free (load);
+}
+
+/* Gets the modification time and size of the operation's file, to notice
+ * it was rewritten. Only local files are checked, other URIs and stdin
+ * are taken not to change and get 0 for both.
+ */
+static void
+png_file_stamp (GeglProperties *o,
+                gint64         *mtime,
+                gint64         *size)
+{
+  gchar    *filename = NULL;
+  GStatBuf  stat_buf;
 
-  GInputStream *stream = gegl_gio_open_input_stream(o->uri, o->path, &infile, &err);
+  *mtime = 0;
+  *size  = 0;
+
+  if (o->uri && *o->uri)
+    filename = g_filename_from_uri (o->uri, NULL, NULL);
+  else if (g_strcmp0 (o->path, "-"))
+    filename = g_strdup (o->path);
+
+  if (filename && g_stat (filename, &stat_buf) == 0)
+    {
+      *mtime = stat_buf.st_mtime;
+      *size  = stat_buf.st_size;
+    }
+
+  g_free (filename);
+}
+
+/* Get the header of the operation's file, reading it if the file changed */
+static PngLoad *
+get_load (GeglOperation *operation)
+{
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  PngLoad        *load   = o->user_data;
+  const gchar    *path   = o->uri && *o->uri ? o->uri : o->path;
+  GError         *err    = NULL;
+  GFile          *infile = NULL;
+  GInputStream   *stream;
+  gint64          mtime, size;
+  gint            status;
+
+  png_file_stamp (o, &mtime, &size);
+
+  if (load && ! g_strcmp0 (load->path, path) &&
+      load->mtime == mtime && load->size == size)
+    return load;
+
+  if (load)
+    {
+      png_load_free (load);
+      o->user_data = NULL;
+    }
+
+  stream = gegl_gio_open_input_stream (o->uri, o->path, &infile, &err);
   WARN_IF_ERROR(err);
-  if (!stream) return result;
-  status = query_png(stream, &width, &height, &format, &err);
+  g_clear_error (&err);
+  if (!stream)
+    return NULL;
+
+  load = g_new0 (PngLoad, 1);
+
+  status = query_png (stream, &load->width, &load->height, &load->format,
+                      &load->interlaced, &err);
   WARN_IF_ERROR(err);
-  g_input_stream_close(stream, NULL, NULL);
+  g_clear_error (&err);
+  g_input_stream_close (stream, NULL, NULL);
+
+  if (infile) g_object_unref (infile);
+  g_object_unref (stream);
 
   if (status)
     {
-      width = 0;
-      height = 0;
+      g_free (load);
+      return NULL;
     }
 
-  gegl_operation_set_format (operation, "output", format);
-  result.width  = width;
-  result.height  = height;
+  load->path   = g_strdup (path);
+  load->mtime  = mtime;
+  load->size   = size;
+  o->user_data = load;
+
+  return load;
+}
+
+static GeglRectangle
+get_bounding_box (GeglOperation *operation)
+{
+  GeglRectangle  result = {0,0,0,0};
+  PngLoad       *load   = get_load (operation);
+
+  if (!load)
+    return result;
+
+  gegl_operation_set_format (operation, "output", load->format);
+  result.width  = load->width;
+  result.height = load->height;
 
-  if (infile) g_object_unref(infile);
-  g_object_unref(stream);
   return result;
 }
 
+/* Get the decoder of the operation's file, (re)opening it if rows above
+ * start_row are needed after they were decoded.
+ */
+static PngDecoder *
+get_decoder (GeglOperation *operation,
+             gint           start_row)
+{
+  GeglProperties *o    = GEGL_PROPERTIES (operation);
+  PngLoad        *load = get_load (operation);
+  GError         *err  = NULL;
+
+  if (!load)
+    return NULL;
+
+  if (load->decoder && load->decoder->next_row > start_row)
+    {
+      png_decoder_free (load->decoder);
+      load->decoder = NULL;
+    }
+
+  if (!load->decoder)
+    {
+      load->decoder = png_decoder_open (o->uri, o->path, &err);
+      WARN_IF_ERROR(err);
+      g_clear_error (&err);
+    }
+
+  return load->decoder;
+}
+
 static gboolean
 process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result,
          gint                 level)
 {
-  GeglProperties *o = GEGL_PROPERTIES (operation);
-  gint        problem;
-  gint        width, height;
-  Babl        *format = NULL;
-  GError *err = NULL;
-  GFile *infile = NULL;
-  GInputStream *stream = gegl_gio_open_input_stream(o->uri, o->path, &infile, &err);
-  WARN_IF_ERROR(err);
-  problem = gegl_buffer_import_png (output, stream, 0, 0,
-                                    &width, &height, format, &err);
-  WARN_IF_ERROR(err);
-  g_input_stream_close(stream, NULL, NULL);
+  GeglProperties *o       = GEGL_PROPERTIES (operation);
+  PngDecoder     *decoder = get_decoder (operation, result->y);
+  PngLoad        *load    = o->user_data;
+  gint            strip_height;
 
-  if (problem)
+  if (!decoder)
     {
-      g_object_unref(infile);
-      g_object_unref(stream);
       g_warning ("%s failed to open file %s for reading.",
                  G_OBJECT_TYPE_NAME (operation), o->path);
       return FALSE;
     }
-  if (infile) g_object_unref(infile);
-  g_object_unref(stream);
+
+  g_object_get (output, "tile-height", &strip_height, NULL);
+  strip_height = MAX (strip_height, 1);
+
+  if (!png_decoder_read (decoder, output, result->y,
+                         result->y + result->height, strip_height))
+    {
+      png_decoder_free (decoder);
+      load->decoder = NULL;
+      g_warning ("%s failed to decode file %s.",
+                 G_OBJECT_TYPE_NAME (operation), o->path);
+      return FALSE;
+    }
+
+  /* nothing is left to decode, don't hold on to the file */
+  if (decoder->next_row >= decoder->height)
+    {
+      png_decoder_free (decoder);
+      load->decoder = NULL;
+    }
+
   return TRUE;
 }
 
+/* Complete rows are decoded, and as png files have to be decoded from the
+ * top, interlaced files as a whole. Processing is rounded to bands of
+ * PNG_LOAD_BAND_HEIGHT rows, so that successive requests continue where the
+ * previous one stopped.
+ */
+#define PNG_LOAD_BAND_HEIGHT 128
+
 static GeglRectangle
 get_cached_region (GeglOperation       *operation,
                    const GeglRectangle *roi)
 {
-  return get_bounding_box (operation);
+  PngLoad       *load   = get_load (operation);
+  GeglRectangle  bounds = {0,0,0,0};
+  GeglRectangle  region;
+  gint           y0, y1;
+
+  if (!load)
+    return bounds;
+
+  bounds.width  = load->width;
+  bounds.height = load->height;
+
+  if (load->interlaced || roi->height <= 0)
+    return bounds;
+
+  y0 = roi->y / PNG_LOAD_BAND_HEIGHT * PNG_LOAD_BAND_HEIGHT;
+  y1 = (roi->y + roi->height + PNG_LOAD_BAND_HEIGHT - 1) /
+       PNG_LOAD_BAND_HEIGHT * PNG_LOAD_BAND_HEIGHT;
+
+  gegl_rectangle_set (&region, bounds.x, y0, bounds.width, y1 - y0);
+  gegl_rectangle_intersect (&region, &region, &bounds);
+
+  return region;
+}
+
+static void
+finalize (GObject *object)
+{
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  if (o->user_data)
+    {
+      png_load_free (o->user_data);
+      o->user_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
 }
 
 static void
@@ -488,6 +736,8 @@ gegl_op_class_init (GeglOpClass *klass)
   operation_class = GEGL_OPERATION_CLASS (klass);
   source_class    = GEGL_OPERATION_SOURCE_CLASS (klass);
 
+  G_OBJECT_CLASS (klass)->finalize = finalize;
+
   source_class->process = process;
   operation_class->get_bounding_box = get_bounding_box;
   operation_class->get_cached_region = get_cached_region;
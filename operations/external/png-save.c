@@ -38,9 +38,285 @@ property_int    (bitdepth, _("Bitdepth"), 16)
 #define GEGL_OP_C_SOURCE png-save.c
 
 #include "gegl-op.h"
+#include "gegl-parallel.h"
 #include <png.h>
+#include <zlib.h>
 #include <stdio.h>
 
+#include "strip-reader.h"
+
+/* Rows fetched from the buffer and encoded at a time */
+#define PNG_SAVE_STRIP_HEIGHT 64
+
+/* With more than one thread, the image data is filtered and deflated in
+ * strips of PNG_SAVE_STRIP_HEIGHT rows in parallel. Each strip is
+ * compressed as an independent raw deflate stream ended by a sync flush,
+ * their concatenation forms the single zlib stream png requires, with the
+ * checksum combined from the checksums of the strips. The strips are
+ * processed in batches of PNG_SAVE_BATCH_STRIPS strips per thread to bound
+ * the memory used.
+ */
+#define PNG_SAVE_BATCH_STRIPS 4
+
+typedef struct
+{
+  guchar   *data;     /* raw deflate data */
+  gsize     size;
+  gsize     raw_size; /* size of the filtered rows */
+  uLong     adler;    /* adler32 of the filtered rows */
+  gboolean  failed;
+} PngDeflateStrip;
+
+typedef struct
+{
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle    rect;
+  gint             bpp;         /* bytes per pixel */
+  gint             bit_depth;
+  gint             compression;
+  gint             first_strip; /* first strip of the batch */
+  PngDeflateStrip *strips;
+} PngDeflateData;
+
+static inline guchar
+png_paeth (guchar a,
+           guchar b,
+           guchar c)
+{
+  gint p  = a + b - c;
+  gint pa = ABS (p - a);
+  gint pb = ABS (p - b);
+  gint pc = ABS (p - c);
+
+  if (pa <= pb && pa <= pc)
+    return a;
+  else if (pb <= pc)
+    return b;
+  return c;
+}
+
+static inline guchar
+png_filter_byte (gint          filter,
+                 const guchar *row,
+                 const guchar *prev,
+                 gint          i,
+                 gint          bpp)
+{
+  guchar a = i >= bpp ? row[i - bpp]  : 0;
+  guchar b = prev[i];
+  guchar c = i >= bpp ? prev[i - bpp] : 0;
+
+  switch (filter)
+    {
+      case PNG_FILTER_VALUE_SUB:   return row[i] - a;
+      case PNG_FILTER_VALUE_UP:    return row[i] - b;
+      case PNG_FILTER_VALUE_AVG:   return row[i] - ((a + b) >> 1);
+      case PNG_FILTER_VALUE_PAETH: return row[i] - png_paeth (a, b, c);
+      default:                     return row[i];
+    }
+}
+
+/* Filter a row with the filter type minimizing the sum of the absolute
+ * values of the filtered bytes, the heuristic libpng uses by default.
+ * Writes the filter type followed by the filtered row to out.
+ */
+static void
+png_filter_row (const guchar *row,
+                const guchar *prev,
+                gint          length,
+                gint          bpp,
+                guchar       *out)
+{
+  guint best_sum    = G_MAXUINT;
+  gint  best_filter = PNG_FILTER_VALUE_NONE;
+  gint  filter;
+  gint  i;
+
+  for (filter = PNG_FILTER_VALUE_NONE; filter < PNG_FILTER_VALUE_LAST; filter++)
+    {
+      guint sum = 0;
+
+      for (i = 0; i < length && sum < best_sum; i++)
+        sum += ABS ((gint8) png_filter_byte (filter, row, prev, i, bpp));
+
+      if (sum < best_sum)
+        {
+          best_sum    = sum;
+          best_filter = filter;
+        }
+    }
+
+  out[0] = best_filter;
+  for (i = 0; i < length; i++)
+    out[i + 1] = png_filter_byte (best_filter, row, prev, i, bpp);
+}
+
+static void
+png_deflate_strips (gsize    offset,
+                    gsize    size,
+                    gpointer user_data)
+{
+  PngDeflateData *data      = user_data;
+  gint            rowstride = data->rect.width * data->bpp;
+  guchar         *rows      = g_malloc ((PNG_SAVE_STRIP_HEIGHT + 1) * rowstride);
+  guchar         *filtered  = g_malloc (PNG_SAVE_STRIP_HEIGHT * (rowstride + 1));
+  gsize           i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      PngDeflateStrip *strip = &data->strips[i];
+      gint             y0    = (data->first_strip + i) * PNG_SAVE_STRIP_HEIGHT;
+      gint             y1    = MIN (y0 + PNG_SAVE_STRIP_HEIGHT, data->rect.height);
+      gboolean         last  = y1 == data->rect.height;
+      GeglRectangle    rect;
+      z_stream         stream = { 0, };
+      gsize            bound;
+      gint             y;
+
+      /* the row above the strip is needed for filtering */
+      memset (rows, 0, rowstride);
+      gegl_rectangle_set (&rect, data->rect.x, data->rect.y + MAX (y0 - 1, 0),
+                          data->rect.width, y1 - MAX (y0 - 1, 0));
+      gegl_buffer_get (data->buffer, &rect, 1.0, data->format,
+                       y0 > 0 ? rows : rows + rowstride,
+                       rowstride, GEGL_ABYSS_NONE);
+
+      /* png stores 16 bit samples big endian */
+      if (data->bit_depth == 16)
+        {
+          guint16 *samples   = (guint16 *) rows;
+          gint     n_samples = (y1 - y0 + 1) * rowstride / 2;
+          gint     j;
+
+          for (j = 0; j < n_samples; j++)
+            samples[j] = GUINT16_TO_BE (samples[j]);
+        }
+
+      for (y = 0; y < y1 - y0; y++)
+        png_filter_row (rows + (y + 1) * rowstride, rows + y * rowstride,
+                        rowstride, data->bpp,
+                        filtered + y * (rowstride + 1));
+
+      strip->raw_size = (y1 - y0) * (rowstride + 1);
+      strip->adler    = adler32 (adler32 (0, NULL, 0),
+                                 filtered, strip->raw_size);
+
+      if (deflateInit2 (&stream, data->compression, Z_DEFLATED,
+                        -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+          strip->failed = TRUE;
+          continue;
+        }
+
+      /* room for the sync flush marker on top of the bound */
+      bound       = deflateBound (&stream, strip->raw_size) + 16;
+      strip->data = g_malloc (bound);
+
+      stream.next_in   = filtered;
+      stream.avail_in  = strip->raw_size;
+      stream.next_out  = strip->data;
+      stream.avail_out = bound;
+
+      if (deflate (&stream, last ? Z_FINISH : Z_SYNC_FLUSH) !=
+            (last ? Z_STREAM_END : Z_OK) ||
+          stream.avail_in)
+        strip->failed = TRUE;
+
+      strip->size = stream.total_out;
+      deflateEnd (&stream);
+    }
+
+  g_free (filtered);
+  g_free (rows);
+}
+
+static gboolean
+png_write_idat_parallel (png_struct          *png,
+                         GeglBuffer          *buffer,
+                         const Babl          *format,
+                         const GeglRectangle *rect,
+                         gint                 bit_depth,
+                         gint                 compression,
+                         gint                 threads)
+{
+  PngDeflateData data;
+  gint           n_strips   = (rect->height + PNG_SAVE_STRIP_HEIGHT - 1) /
+                              PNG_SAVE_STRIP_HEIGHT;
+  gint           batch_size = threads * PNG_SAVE_BATCH_STRIPS;
+  uLong          adler      = adler32 (0, NULL, 0);
+  gboolean       success    = TRUE;
+  gint           i;
+
+  data.buffer      = buffer;
+  data.format      = format;
+  data.rect        = *rect;
+  data.bpp         = babl_format_get_bytes_per_pixel (format);
+  data.bit_depth   = bit_depth;
+  data.compression = compression;
+  data.strips      = g_new (PngDeflateStrip, batch_size);
+
+  for (data.first_strip = 0;
+       success && data.first_strip < n_strips;
+       data.first_strip += batch_size)
+    {
+      gint n = MIN (batch_size, n_strips - data.first_strip);
+
+      memset (data.strips, 0, n * sizeof (PngDeflateStrip));
+      gegl_parallel_distribute_range (n, 1, png_deflate_strips, &data);
+
+      /* one IDAT chunk per strip, the first one starting with the zlib
+       * header, and the last one ending with the checksum
+       */
+      for (i = 0; i < n; i++)
+        {
+          PngDeflateStrip *strip = &data.strips[i];
+          gboolean         first = data.first_strip + i == 0;
+          gboolean         last  = data.first_strip + i == n_strips - 1;
+
+          if (strip->failed || !success)
+            {
+              success = FALSE;
+              g_free (strip->data);
+              continue;
+            }
+
+          adler = adler32_combine (adler, strip->adler, strip->raw_size);
+
+          png_write_chunk_start (png, (png_bytep) "IDAT",
+                                 strip->size + (first ? 2 : 0) + (last ? 4 : 0));
+          if (first)
+            {
+              gint   level_flags = compression < 2 ? 0 :
+                                   compression < 6 ? 1 :
+                                   compression == 6 ? 2 : 3;
+              guint  header      = (0x78 << 8) | (level_flags << 6);
+              guchar bytes[2];
+
+              header  += 31 - header % 31;
+              bytes[0] = header >> 8;
+              bytes[1] = header & 0xff;
+              png_write_chunk_data (png, bytes, 2);
+            }
+          png_write_chunk_data (png, strip->data, strip->size);
+          if (last)
+            {
+              guchar bytes[4] = { adler >> 24, (adler >> 16) & 0xff,
+                                  (adler >> 8) & 0xff, adler & 0xff };
+
+              png_write_chunk_data (png, bytes, 4);
+            }
+          png_write_chunk_end (png);
+
+          g_free (strip->data);
+        }
+    }
+
+  g_free (data.strips);
+
+  return success;
+}
+
 /* this call is available when the png-save plug-in is loaded,
  * it might have to be dlsymed to be used?
  */
@@ -65,15 +341,17 @@ gegl_buffer_export_png (GeglBuffer  *gegl_buffer,
                         gint         height)
 {
   FILE          *fp;
-  gint           i;
   png_struct    *png;
   png_info      *info;
-  guchar        *pixels;
   png_color_16   white;
   int            png_color_type;
   gchar          format_string[16];
   const Babl    *format;
   gint           bit_depth = 8;
+  GeglRectangle  rect;
+  gint           threads;
+  gint           ret = 0;
+  StripReader   *volatile reader = NULL;
 
   if (!strcmp (path, "-"))
     {
@@ -138,6 +416,8 @@ gegl_buffer_export_png (GeglBuffer  *gegl_buffer,
 
   if (setjmp (png_jmpbuf (png)))
     {
+      if (reader)
+        strip_reader_free (reader);
       if (stdout != fp)
         fclose (fp);
 
@@ -163,37 +443,58 @@ gegl_buffer_export_png (GeglBuffer  *gegl_buffer,
 
   png_write_info (png, info);
 
+  format = babl_format (format_string);
+  gegl_rectangle_set (&rect, src_x, src_y, width, height);
+
+  threads = gegl_parallel_get_n_threads ((height + PNG_SAVE_STRIP_HEIGHT - 1) /
+                                         PNG_SAVE_STRIP_HEIGHT, 1);
+
+  if (threads > 1)
+    {
+      if (png_write_idat_parallel (png, gegl_buffer, format, &rect,
+                                   bit_depth, compression, threads))
+        png_write_chunk (png, (png_bytep) "IEND", NULL, 0);
+      else
+        ret = -1;
+    }
+  else
+    {
+      Strip       *strip;
+      png_bytep    rows[PNG_SAVE_STRIP_HEIGHT];
+
 #if BYTE_ORDER == LITTLE_ENDIAN
-  if (bit_depth > 8)
-    png_set_swap (png);
+      if (bit_depth > 8)
+        png_set_swap (png);
 #endif
 
-  format = babl_format (format_string);
-  pixels = g_malloc0 (width * babl_format_get_bytes_per_pixel (format));
+      /* encode each strip while the next one is being fetched */
+      reader = strip_reader_new (gegl_buffer, &rect, format,
+                                 PNG_SAVE_STRIP_HEIGHT);
 
-  for (i=0; i< height; i++)
-    {
-      GeglRectangle rect;
+      while ((strip = strip_reader_next (reader)))
+        {
+          gint i;
 
-      rect.x = src_x;
-      rect.y = src_y+i;
-      rect.width = width;
-      rect.height = 1;
+          for (i = 0; i < strip->height; i++)
+            rows[i] = strip->data + i * reader->rowstride;
 
-      gegl_buffer_get (gegl_buffer, &rect, 1.0, babl_format (format_string), pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+          png_write_rows (png, rows, strip->height);
 
-      png_write_rows (png, &pixels, 1);
-    }
+          strip_reader_release (reader, strip);
+        }
 
-  png_write_end (png, info);
+      strip_reader_free (reader);
+      reader = NULL;
+
+      png_write_end (png, info);
+    }
 
   png_destroy_write_struct (&png, &info);
-  g_free (pixels);
 
   if (stdout != fp)
     fclose (fp);
 
-  return 0;
+  return ret;
 }
 
 static gboolean
@@ -221,6 +522,7 @@ gegl_op_class_init (GeglOpClass *klass)
   sink_class      = GEGL_OPERATION_SINK_CLASS (klass);
 
   sink_class->process    = gegl_png_save_process;
+  /* the input is rendered in full before it is encoded, see strip-reader.h */
   sink_class->needs_full = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
@@ -40,6 +40,8 @@ property_file_path (path, _("File"), "")
 #include <stdlib.h>
 #include <errno.h>
 
+#include "linear-source.h"
+
 typedef enum {
   PIXMAP_ASCII_GRAY = '2',
   PIXMAP_ASCII      = '3',
@@ -216,6 +218,28 @@ ppm_load_read_image(FILE       *fp,
       }
 }
 
+static const Babl *
+ppm_load_get_format (pnm_struct *img)
+{
+  if (img->bpc == 1)
+    {
+      if (img->channels == 3)
+        return babl_format ("R'G'B' u8");
+      else
+        return babl_format ("Y' u8");
+    }
+  else if (img->bpc == 2)
+    {
+      if (img->channels == 3)
+        return babl_format ("R'G'B' u16");
+      else
+        return babl_format ("Y' u16");
+    }
+
+  g_warning ("%s: Programmer stupidity error", G_STRLOC);
+  return NULL;
+}
+
 static GeglRectangle
 get_bounding_box (GeglOperation *operation)
 {
@@ -232,26 +256,7 @@ get_bounding_box (GeglOperation *operation)
   if (!ppm_load_read_header (fp, &img))
     goto out;
 
-  if (img.bpc == 1)
-    {
-      if (img.channels == 3)
-        gegl_operation_set_format (operation, "output",
-                                   babl_format ("R'G'B' u8"));
-      else
-        gegl_operation_set_format (operation, "output",
-                                   babl_format ("Y' u8"));
-    }
-  else if (img.bpc == 2)
-    {
-      if (img.channels == 3)
-        gegl_operation_set_format (operation, "output",
-                                   babl_format ("R'G'B' u16"));
-      else
-        gegl_operation_set_format (operation, "output",
-                                   babl_format ("Y' u16"));
-    }
-  else
-    g_warning ("%s: Programmer stupidity error", G_STRLOC);
+  gegl_operation_set_format (operation, "output", ppm_load_get_format (&img));
 
   result.width = img.width;
   result.height = img.height;
@@ -263,118 +268,97 @@ get_bounding_box (GeglOperation *operation)
   return result;
 }
 
-static gboolean
-process (GeglOperation       *operation,
-         GeglBuffer          *output,
-         const GeglRectangle *result,
-         gint                 level)
+static GeglBuffer *
+ppm_load_buffer (GeglOperation *operation)
 {
-  GeglProperties   *o = GEGL_PROPERTIES (operation);
-  FILE         *fp;
-  pnm_struct    img;
-  GeglRectangle rect = {0,0,0,0};
-  gboolean      ret = FALSE;
+  GeglProperties *o      = GEGL_PROPERTIES (operation);
+  GeglBuffer     *buffer = NULL;
+  const Babl     *format;
+  FILE           *fp;
+  pnm_struct      img;
 
   fp = (!strcmp (o->path, "-") ? stdin : fopen (o->path,"rb"));
 
   if (!fp)
-    return FALSE;
+    return NULL;
 
   if (!ppm_load_read_header (fp, &img))
     goto out;
 
-  /* Allocating Array Size */
-
-  /* Should use g_try_malloc(), but this causes crashes elsewhere because the
-   * error signalled by returning FALSE isn't properly acted upon. Therefore
-   * g_malloc() is used here which aborts if the requested memory size can't be
-   * allocated causing a controlled crash. */
-  img.data = (guchar*) g_malloc (img.numsamples * img.bpc);
-
-  /* No-op without g_try_malloc(), see above. */
-  if (! img.data)
-    {
-      g_warning ("Couldn't allocate %" G_GSIZE_FORMAT " bytes, giving up.", ((gsize)img.numsamples * img.bpc));
-      goto out;
-    }
+  format = ppm_load_get_format (&img);
+  if (!format)
+    goto out;
 
-  rect.height = img.height;
-  rect.width = img.width;
+  /* Binary pixmaps are stored in the pixel format of the buffer, except
+   * for the byte order of 16 bit samples on little endian machines
+   */
+  if (stdin != fp &&
+      (img.type == PIXMAP_RAW || img.type == PIXMAP_RAW_GRAY) &&
+      (img.bpc == 1 || G_BYTE_ORDER == G_BIG_ENDIAN))
+    buffer = linear_source_new_mapped (o->path, ftell (fp), format,
+                                       img.width, img.height);
 
-  if (img.bpc == 1)
-    {
-      if (img.channels == 3)
-        gegl_buffer_get (output, &rect, 1.0, babl_format ("R'G'B' u8"), img.data,
-                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      else
-        gegl_buffer_get (output, &rect, 1.0, babl_format ("Y' u8"), img.data,
-                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-    }
-  else if (img.bpc == 2)
+  if (!buffer)
     {
-      if (img.channels == 3)
-        gegl_buffer_get (output, &rect, 1.0, babl_format ("R'G'B' u16"), img.data,
-                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      else
-        gegl_buffer_get (output, &rect, 1.0, babl_format ("Y' u16"), img.data,
-                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-    }
-  else
-    g_warning ("%s: Programmer stupidity error", G_STRLOC);
+      /* Should use g_try_malloc(), but this causes crashes elsewhere
+       * because the error signalled by returning FALSE isn't properly
+       * acted upon. Therefore g_malloc() is used here which aborts if the
+       * requested memory size can't be allocated causing a controlled
+       * crash. */
+      img.data = (guchar*) g_malloc0 (img.numsamples * img.bpc);
 
-  ppm_load_read_image (fp, &img);
+      ppm_load_read_image (fp, &img);
 
-  if (img.bpc == 1)
-    {
-      if (img.channels == 3)
-        gegl_buffer_set (output, &rect, 0, babl_format ("R'G'B' u8"), img.data,
-                         GEGL_AUTO_ROWSTRIDE);
-      else
-        gegl_buffer_set (output, &rect, 0, babl_format ("Y' u8"), img.data,
-                         GEGL_AUTO_ROWSTRIDE);
-    }
-  else if (img.bpc == 2)
-    {
-      if (img.channels == 3)
-        gegl_buffer_set (output, &rect, 0, babl_format ("R'G'B' u16"), img.data,
-                         GEGL_AUTO_ROWSTRIDE);
-      else
-        gegl_buffer_set (output, &rect, 0, babl_format ("Y' u16"), img.data,
-                         GEGL_AUTO_ROWSTRIDE);
+      buffer = linear_source_new_from_data (img.data, format,
+                                            img.width, img.height);
     }
-  else
-    g_warning ("%s: Programmer stupidity error", G_STRLOC);
-
-  g_free (img.data);
-
-  ret = TRUE;
 
  out:
   if (stdin != fp)
     fclose (fp);
 
-  return ret;
+  return buffer;
 }
 
-static GeglRectangle
-get_cached_region (GeglOperation       *operation,
-                   const GeglRectangle *roi)
+static gboolean
+process (GeglOperation        *operation,
+         GeglOperationContext *context,
+         const gchar          *output_pad,
+         const GeglRectangle  *result,
+         gint                  level)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return linear_source_process (operation, (LinearSource **) &o->user_data,
+                                o->path, ppm_load_buffer, context);
+}
+
+static void
+finalize (GObject *object)
 {
-  return get_bounding_box (operation);
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  if (o->user_data)
+    {
+      linear_source_free (o->user_data);
+      o->user_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
 }
 
 static void
 gegl_op_class_init (GeglOpClass *klass)
 {
   GeglOperationClass       *operation_class;
-  GeglOperationSourceClass *source_class;
 
   operation_class = GEGL_OPERATION_CLASS (klass);
-  source_class    = GEGL_OPERATION_SOURCE_CLASS (klass);
 
-  source_class->process = process;
+  G_OBJECT_CLASS (klass)->finalize = finalize;
+
+  operation_class->process = process;
   operation_class->get_bounding_box = get_bounding_box;
-  operation_class->get_cached_region = get_cached_region;
+  operation_class->no_cache = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
     "name",         "gegl:ppm-load",
@@ -57,9 +57,12 @@ GEGL_DEFINE_DYNAMIC_OPERATION(GEGL_TYPE_OPERATION_SOURCE)
 #include <string.h>
 #include <libraw/libraw.h>
 
+#include "linear-source.h"
+
 typedef struct {
   libraw_data_t            *LibRaw;
   libraw_processed_image_t *image;
+  GeglBuffer               *buffer; /* linear buffer over image->data */
 } Private;
 
 unsigned char first_pass = 1;
@@ -129,14 +132,14 @@ get_bounding_box (GeglOperation *operation)
 }
 
 static gboolean
-process (GeglOperation       *operation,
-         GeglBuffer          *output,
-         const GeglRectangle *result,
-         int                  level)
+process (GeglOperation        *operation,
+         GeglOperationContext *context,
+         const gchar          *output_pad,
+         const GeglRectangle  *result,
+         gint                  level)
 {
   GeglProperties *o = GEGL_PROPERTIES (operation);
   Private *p = (Private*)o->user_data;
-  GeglRectangle rect = {0,0,0,0};
   const Babl *format = NULL;
   int ret;
 
@@ -146,6 +149,12 @@ process (GeglOperation       *operation,
       p = (Private*)o->user_data;
     }
 
+  if (p != NULL && p->buffer != NULL)
+    {
+      linear_source_output (context, p->buffer);
+      return TRUE;
+    }
+
   if (p != NULL &&
       p->LibRaw != NULL)
     {
@@ -164,11 +173,9 @@ process (GeglOperation       *operation,
         }
     }
 
-  if (p->image != NULL)
+  if (p != NULL && p->image != NULL)
     {
       g_assert (p->image->type == LIBRAW_IMAGE_BITMAP);
-      rect.width  = p->image->width;
-      rect.height = p->image->height;
 
       if (p->image->bits == 8)
         {
@@ -185,7 +192,23 @@ process (GeglOperation       *operation,
             format = babl_format ("RGB u16");
         }
 
-      gegl_buffer_set (output, &rect, 0, format, p->image->data, GEGL_AUTO_ROWSTRIDE);
+      /* hand the processed image to the graph without copying it, the
+       * buffer now owns the image; libraw frees it, so this can't use
+       * linear_source_new_from_data ()
+       */
+      {
+        GeglRectangle extent = {0, 0, p->image->width, p->image->height};
+
+        p->buffer = gegl_buffer_linear_new_from_data (p->image->data, format,
+                                                      &extent, 0,
+                                                      (GDestroyNotify) libraw_dcraw_clear_mem,
+                                                      p->image);
+        p->image = NULL;
+
+        linear_source_store_tile (p->buffer);
+      }
+
+      linear_source_output (context, p->buffer);
       return TRUE;
     }
 
@@ -200,6 +223,8 @@ finalize (GObject *object)
   if (o->user_data)
     {
       Private *p = (Private*)o->user_data;
+      if (p->buffer != NULL)
+        g_object_unref (p->buffer);
       if (p->LibRaw != NULL)
         {
           if (p->image != NULL)
@@ -222,15 +247,14 @@ gegl_op_class_init (GeglOpClass *klass)
 
   GObjectClass             *object_class;
   GeglOperationClass       *operation_class;
-  GeglOperationSourceClass *source_class;
 
   object_class    = G_OBJECT_CLASS (klass);
   operation_class = GEGL_OPERATION_CLASS (klass);
-  source_class = GEGL_OPERATION_SOURCE_CLASS (klass);
 
   operation_class->prepare     = prepare;
   operation_class->get_bounding_box = get_bounding_box;
-  source_class->process = process;
+  operation_class->process = process;
+  operation_class->no_cache = TRUE;
   object_class->finalize = finalize;
 
   gegl_operation_class_set_keys (operation_class,
@@ -38,6 +38,8 @@ property_file_path (path, _("File"), "")
 #include <errno.h>
 #include <stdio.h>
 
+#include "linear-source.h"
+
 
 static const gchar* FORMAT = "RGBA float";
 
@@ -70,14 +72,14 @@ cleanup:
 }
 
 
-static gboolean
-gegl_rgbe_load_process (GeglOperation       *operation,
-                        GeglBuffer          *output,
-                        const GeglRectangle *result,
-                        gint                 level)
+/* Radiance files are run length encoded, the scanlines are decoded once
+ * into the memory of the output buffer.
+ */
+static GeglBuffer *
+gegl_rgbe_load_buffer (GeglOperation *operation)
 {
   GeglProperties       *o       = GEGL_PROPERTIES (operation);
-  gboolean          success = FALSE;
+  GeglBuffer       *buffer  = NULL;
   gfloat           *pixels  = NULL;
   rgbe_file        *file;
   guint             width, height;
@@ -89,31 +91,46 @@ gegl_rgbe_load_process (GeglOperation       *operation,
   if (!rgbe_get_size (file, &width, &height))
       goto cleanup;
 
-  if (width  != result->width  ||
-      height != result->height)
-      goto cleanup;
-
   pixels = rgbe_read_scanlines (file);
   if (!pixels)
     goto cleanup;
 
-  gegl_buffer_set (output, result, 0, babl_format (FORMAT), pixels,
-                   GEGL_AUTO_ROWSTRIDE);
-  success = TRUE;
+  buffer = linear_source_new_from_data (pixels, babl_format (FORMAT),
+                                        width, height);
 
 cleanup:
-  g_free         (pixels);
   rgbe_file_free (file);
 
-  return success;
+  return buffer;
 }
 
 
-static GeglRectangle
-gegl_rgbe_load_get_cached_region (GeglOperation *operation,
-                                  const GeglRectangle *roi)
+static gboolean
+gegl_rgbe_load_process (GeglOperation        *operation,
+                        GeglOperationContext *context,
+                        const gchar          *output_pad,
+                        const GeglRectangle  *result,
+                        gint                  level)
+{
+  GeglProperties *o = GEGL_PROPERTIES (operation);
+
+  return linear_source_process (operation, (LinearSource **) &o->user_data,
+                                o->path, gegl_rgbe_load_buffer, context);
+}
+
+
+static void
+gegl_rgbe_load_finalize (GObject *object)
 {
-  return gegl_rgbe_load_get_bounding_box (operation);
+  GeglProperties *o = GEGL_PROPERTIES (object);
+
+  if (o->user_data)
+    {
+      linear_source_free (o->user_data);
+      o->user_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gegl_op_parent_class)->finalize (object);
 }
 
 
@@ -121,14 +138,14 @@ static void
 gegl_op_class_init (GeglOpClass *klass)
 {
   GeglOperationClass       *operation_class;
-  GeglOperationSourceClass *source_class;
 
   operation_class = GEGL_OPERATION_CLASS (klass);
-  source_class    = GEGL_OPERATION_SOURCE_CLASS (klass);
 
-  source_class->process = gegl_rgbe_load_process;
+  G_OBJECT_CLASS (klass)->finalize = gegl_rgbe_load_finalize;
+
+  operation_class->process           = gegl_rgbe_load_process;
   operation_class->get_bounding_box  = gegl_rgbe_load_get_bounding_box;
-  operation_class->get_cached_region = gegl_rgbe_load_get_cached_region;
+  operation_class->no_cache          = TRUE;
 
   gegl_operation_class_set_keys (operation_class,
     "name",        "gegl:rgbe-load",
@@ -0,0 +1,162 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+/* Reads a region of a buffer as consecutive strips of rows in a separate
+ * thread, so that savers can encode one strip while the next is fetched
+ * and converted to the format they encode from.
+ *
+ * This does not overlap the encoding with the rendering of the input:
+ * the savers set needs_full, so their input is rendered in full before
+ * process is called. Without it the processor would hand them chunks in
+ * no particular order, which an encoder writing rows sequentially can't
+ * consume.
+ *
+ *   reader = strip_reader_new (buffer, &rect, format, strip_height);
+ *   while ((strip = strip_reader_next (reader)))
+ *     {
+ *       encode (strip->data, strip->height);
+ *       strip_reader_release (reader, strip);
+ *     }
+ *   strip_reader_free (reader);
+ */
+
+#define STRIP_READER_N_STRIPS 2
+
+typedef struct
+{
+  guchar *data;      /* strip->height rows of reader->rowstride bytes */
+  gint    y;         /* first row of the strip, relative to the region */
+  gint    height;
+} Strip;
+
+typedef struct
+{
+  GeglBuffer    *buffer;
+  GeglRectangle  rect;
+  const Babl    *format;
+  gint           strip_height;
+  gint           rowstride;
+  Strip          strips[STRIP_READER_N_STRIPS];
+  Strip          end;        /* pushed after the last strip */
+  GAsyncQueue   *free_strips;
+  GAsyncQueue   *full_strips;
+  GThread       *thread;
+  gboolean       done;
+} StripReader;
+
+static gpointer
+strip_reader_thread (gpointer data)
+{
+  StripReader *reader = data;
+  gint         y;
+
+  for (y = 0; y < reader->rect.height; y += reader->strip_height)
+    {
+      Strip         *strip = g_async_queue_pop (reader->free_strips);
+      GeglRectangle  rect;
+
+      strip->y      = y;
+      strip->height = MIN (reader->strip_height, reader->rect.height - y);
+
+      gegl_rectangle_set (&rect, reader->rect.x, reader->rect.y + y,
+                          reader->rect.width, strip->height);
+      gegl_buffer_get (reader->buffer, &rect, 1.0, reader->format,
+                       strip->data, reader->rowstride, GEGL_ABYSS_NONE);
+
+      g_async_queue_push (reader->full_strips, strip);
+    }
+
+  g_async_queue_push (reader->full_strips, &reader->end);
+
+  return NULL;
+}
+
+static StripReader *
+strip_reader_new (GeglBuffer          *buffer,
+                  const GeglRectangle *rect,
+                  const Babl          *format,
+                  gint                 strip_height)
+{
+  StripReader *reader = g_new0 (StripReader, 1);
+  gint         i;
+
+  reader->buffer       = buffer;
+  reader->rect         = *rect;
+  reader->format       = format;
+  reader->strip_height = CLAMP (strip_height, 1, MAX (rect->height, 1));
+  reader->rowstride    = rect->width * babl_format_get_bytes_per_pixel (format);
+  reader->free_strips  = g_async_queue_new ();
+  reader->full_strips  = g_async_queue_new ();
+
+  for (i = 0; i < STRIP_READER_N_STRIPS; i++)
+    {
+      reader->strips[i].data = g_malloc (reader->rowstride *
+                                         reader->strip_height);
+      g_async_queue_push (reader->free_strips, &reader->strips[i]);
+    }
+
+  reader->thread = g_thread_new ("strip reader", strip_reader_thread, reader);
+
+  return reader;
+}
+
+/* Returns the next strip, in order, or NULL once the whole region has been
+ * read. The strip has to be handed back with strip_reader_release().
+ */
+static Strip *
+strip_reader_next (StripReader *reader)
+{
+  Strip *strip;
+
+  if (reader->done)
+    return NULL;
+
+  strip = g_async_queue_pop (reader->full_strips);
+  if (strip == &reader->end)
+    {
+      reader->done = TRUE;
+      return NULL;
+    }
+
+  return strip;
+}
+
+static void
+strip_reader_release (StripReader *reader,
+                      Strip       *strip)
+{
+  g_async_queue_push (reader->free_strips, strip);
+}
+
+/* Can be called before all strips were read, e.g. when encoding failed */
+static void
+strip_reader_free (StripReader *reader)
+{
+  Strip *strip;
+  gint   i;
+
+  while ((strip = strip_reader_next (reader)))
+    strip_reader_release (reader, strip);
+
+  g_thread_join (reader->thread);
+
+  for (i = 0; i < STRIP_READER_N_STRIPS; i++)
+    g_free (reader->strips[i].data);
+
+  g_async_queue_unref (reader->free_strips);
+  g_async_queue_unref (reader->full_strips);
+  g_free (reader);
+}
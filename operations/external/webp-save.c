@@ -34,9 +34,34 @@ property_int (quality, _("Quality"), 90)
 #define GEGL_OP_C_SOURCE webp-save.c
 
 #include "gegl-op.h"
+#include "gegl-config.h"
+#include "gegl-parallel.h"
 #include <webp/encode.h>
 #include <stdio.h>
 
+typedef struct
+{
+  GeglBuffer          *buffer;
+  const GeglRectangle *bounds;
+  gint                 rowstride;
+  guchar              *pixels;
+} FetchData;
+
+static void
+fetch_rows (gsize    offset,
+            gsize    size,
+            gpointer user_data)
+{
+  FetchData     *data = user_data;
+  GeglRectangle  rect;
+
+  gegl_rectangle_set (&rect, data->bounds->x, data->bounds->y + offset,
+                      data->bounds->width, size);
+  gegl_buffer_get (data->buffer, &rect, 1.0, babl_format ("R'G'B'A u8"),
+                   data->pixels + offset * data->rowstride, data->rowstride,
+                   GEGL_ABYSS_NONE);
+}
+
 static int
 write_func (const uint8_t* data, size_t data_size, const WebPPicture* const pic)
 {
@@ -64,6 +89,9 @@ process (GeglOperation       *operation,
   if (!WebPConfigPreset (&config, WEBP_PRESET_DEFAULT, o->quality))
     return FALSE;
 
+  /* let the encoder use more than one thread */
+  config.thread_level = gegl_config_threads () > 1;
+
   if (!WebPValidateConfig (&config))
     return FALSE;
 
@@ -78,15 +106,19 @@ process (GeglOperation       *operation,
   pic.custom_ptr = file;
 
   {
-    gint rowstride = bounds->width * sizeof (char) * 4;
-    gpointer temp = g_malloc (rowstride * bounds->height);
+    FetchData data;
+
+    data.buffer    = input;
+    data.bounds    = bounds;
+    data.rowstride = bounds->width * sizeof (char) * 4;
+    data.pixels    = g_malloc (data.rowstride * bounds->height);
 
-    gegl_buffer_get (input, bounds, 1.0, babl_format ("R'G'B'A u8"), temp,
-                     rowstride, GEGL_ABYSS_NONE);
+    /* the conversion to R'G'B'A u8 is done in parallel row ranges */
+    gegl_parallel_distribute_range (bounds->height, 64, fetch_rows, &data);
 
-    WebPPictureImportRGBA (&pic, temp, rowstride);
+    WebPPictureImportRGBA (&pic, data.pixels, data.rowstride);
 
-    g_free (temp);
+    g_free (data.pixels);
   }
 
   status = WebPEncode (&config, &pic);
@@ -42,7 +42,8 @@ enum
 {
   PROP_ORIGIN_X = 1,
   PROP_ORIGIN_Y,
-  PROP_SAMPLER
+  PROP_SAMPLER,
+  PROP_FILTER
 };
 
 static void          gegl_transform_get_property                 (GObject              *object,
@@ -78,6 +79,16 @@ static GeglNode     *gegl_transform_detect                       (GeglOperation
 
 static gboolean      gegl_matrix3_is_affine                      (GeglMatrix3          *matrix);
 static gboolean      gegl_transform_matrix3_allow_fast_translate (GeglMatrix3          *matrix);
+static gboolean      gegl_transform_matrix3_is_orthogonal        (GeglMatrix3          *inverse);
+static gboolean      gegl_transform_allow_exact_copy             (OpTransform          *transform,
+                                                                  GeglMatrix3          *matrix);
+static gboolean      gegl_transform_matrix3_is_axis_aligned      (GeglMatrix3          *inverse);
+static void          gegl_transform_get_level_inverse            (GeglMatrix3          *matrix,
+                                                                  gint                  level,
+                                                                  GeglMatrix3          *inverse);
+static void          gegl_transform_get_context_rect             (OpTransform          *transform,
+                                                                  GeglMatrix3          *matrix,
+                                                                  GeglRectangle        *context_rect);
 static void          gegl_transform_create_composite_matrix      (OpTransform *transform,
                                                                   GeglMatrix3 *matrix);
 
@@ -123,6 +134,33 @@ op_transform_get_type (void)
   return g_define_type_id;
 }
 
+GType
+gegl_transform_filter_get_type (void)
+{
+  static GType etype = 0;
+
+  if (etype == 0)
+    {
+      static GEnumValue values[] = {
+        { GEGL_TRANSFORM_FILTER_AUTO,     N_("Auto"),     "auto"     },
+        { GEGL_TRANSFORM_FILTER_BOX,      N_("Box"),      "box"      },
+        { GEGL_TRANSFORM_FILTER_TRIANGLE, N_("Triangle"), "triangle" },
+        { GEGL_TRANSFORM_FILTER_MITCHELL, N_("Mitchell"), "mitchell" },
+        { GEGL_TRANSFORM_FILTER_LANCZOS3, N_("Lanczos3"), "lanczos3" },
+        { 0, NULL, NULL }
+      };
+      gint i;
+
+      for (i = 0; i < G_N_ELEMENTS (values); i++)
+        if (values[i].value_name)
+          values[i].value_name =
+            dgettext (GETTEXT_PACKAGE, values[i].value_name);
+
+      etype = g_enum_register_static ("GeglTransformFilter", values);
+    }
+  return etype;
+}
+
 static void
 gegl_transform_prepare (GeglOperation *operation)
 {
@@ -132,7 +170,8 @@ gegl_transform_prepare (GeglOperation *operation)
 
   gegl_transform_create_composite_matrix (transform, &matrix);
 
-  if (gegl_transform_matrix3_allow_fast_translate (&matrix))
+  if (gegl_transform_matrix3_allow_fast_translate (&matrix) ||
+      gegl_transform_allow_exact_copy (transform, &matrix))
     {
       const Babl *fmt = gegl_operation_get_source_format (operation, "input");
 
@@ -191,6 +230,17 @@ op_transform_class_init (OpTransformClass *klass)
                                      gegl_sampler_type_get_type (),
                                      GEGL_SAMPLER_LINEAR,
                                      G_PARAM_CONSTRUCT | G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FILTER,
+                                   g_param_spec_enum (
+                                     "filter",
+                                     _("Filter"),
+                                     _("Filter used when only scaling along "
+                                       "the axes, auto gives the same result "
+                                       "as the sampler; the other filters "
+                                       "are widened when downscaling"),
+                                     GEGL_TYPE_TRANSFORM_FILTER,
+                                     GEGL_TRANSFORM_FILTER_AUTO,
+                                     G_PARAM_CONSTRUCT | G_PARAM_READWRITE));
 }
 
 static void
@@ -217,6 +267,9 @@ gegl_transform_get_property (GObject    *object,
     case PROP_SAMPLER:
       g_value_set_enum (value, self->sampler);
       break;
+    case PROP_FILTER:
+      g_value_set_enum (value, self->filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -242,6 +295,9 @@ gegl_transform_set_property (GObject      *object,
     case PROP_SAMPLER:
       self->sampler = g_value_get_enum (value);
       break;
+    case PROP_FILTER:
+      self->filter = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -544,25 +600,19 @@ gegl_transform_get_required_for_output (GeglOperation       *op,
   GeglRectangle  requested_rect,
                  need_rect;
   GeglRectangle  context_rect;
-  GeglSampler   *sampler;
   gdouble        need_points [8];
   gint           i;
 
   requested_rect = *region;
 
   gegl_transform_create_composite_matrix (transform, &inverse);
-  gegl_matrix3_invert (&inverse);
 
   if (gegl_transform_is_intermediate_node (transform) ||
       gegl_matrix3_is_identity (&inverse))
     return requested_rect;
 
-  sampler = gegl_buffer_sampler_new_at_level (NULL,
-                                     babl_format("RaGaBaA float"),
-                                     transform->sampler,
-                                     0); //XXX: need level?
-  context_rect = *gegl_sampler_get_context_rect (sampler);
-  g_object_unref (sampler);
+  gegl_transform_get_context_rect (transform, &inverse, &context_rect);
+  gegl_matrix3_invert (&inverse);
 
   /*
    * Convert indices to absolute positions:
@@ -609,7 +659,6 @@ gegl_transform_get_invalidated_by_change (GeglOperation       *op,
   GeglRectangle  affected_rect;
 
   GeglRectangle  context_rect;
-  GeglSampler   *sampler;
 
   gdouble        affected_points [8];
   gint           i;
@@ -637,13 +686,6 @@ gegl_transform_get_invalidated_by_change (GeglOperation       *op,
    * allow for round off error (for "safety")?
    */
 
-  sampler = gegl_buffer_sampler_new_at_level (NULL,
-                                     babl_format("RaGaBaA float"),
-                                     transform->sampler,
-                                     0); // XXX: need level?
-  context_rect = *gegl_sampler_get_context_rect (sampler);
-  g_object_unref (sampler);
-
   gegl_transform_create_matrix (transform, &matrix);
 
   if (transform->origin_x || transform->origin_y)
@@ -661,6 +703,8 @@ gegl_transform_get_invalidated_by_change (GeglOperation       *op,
       gegl_matrix3_is_identity (&matrix))
     return region;
 
+  gegl_transform_get_context_rect (transform, &matrix, &context_rect);
+
   /*
    * Fatten (dilate) the input region by the context_rect.
    */
@@ -698,13 +742,16 @@ gegl_transform_get_invalidated_by_change (GeglOperation       *op,
   return affected_rect;
 }
 
+typedef void (*TransformFunc) (GeglOperation       *operation,
+                               GeglBuffer          *dest,
+                               GeglBuffer          *src,
+                               GeglMatrix3         *matrix,
+                               const GeglRectangle *roi,
+                               gint                 level);
+
 typedef struct ThreadData
 {
-  void (*func) (GeglOperation *operation,
-                GeglBuffer  *dest,
-                GeglBuffer  *src,
-                GeglMatrix3 *matrix,
-                gint         level);
+  TransformFunc             func;
 
 
   GeglOperation            *operation;
@@ -721,7 +768,8 @@ static void thread_process (gpointer thread_data, gpointer unused)
 {
   ThreadData *data = thread_data;
   data->func (data->operation,
-                   data->output, data->input, data->matrix, data->level);
+              data->output, data->input, data->matrix, &data->roi,
+              data->level);
     data->success = FALSE;
   g_atomic_int_add (data->pending, -1);
 }
@@ -739,13 +787,13 @@ static GThreadPool *thread_pool (void)
 
 
 static void
-transform_affine (GeglOperation *operation,
-                  GeglBuffer  *dest,
-                  GeglBuffer  *src,
-                  GeglMatrix3 *matrix,
-                  gint         level)
+transform_affine (GeglOperation       *operation,
+                  GeglBuffer          *dest,
+                  GeglBuffer          *src,
+                  GeglMatrix3         *matrix,
+                  const GeglRectangle *roi,
+                  gint                 level)
 {
-  gint         factor = 1 << level;
   OpTransform *transform = (OpTransform *) operation;
   const Babl  *format = babl_format ("RaGaBaA float");
   GeglMatrix3  inverse;
@@ -760,9 +808,9 @@ transform_affine (GeglOperation *operation,
 
 
   /*
-   * XXX: fast paths as existing in files in the same dir as
-   *      transform.c should probably be hooked in here, and bailing
-   *      out before using the generic code.
+   * Rotations by multiples of 90 degrees, flips and axis aligned
+   * scaling are dispatched to transform_orthogonal and transform_scale
+   * by gegl_transform_process before getting here.
    */
   /*
    * It is assumed that the affine transformation has been normalized,
@@ -771,26 +819,13 @@ transform_affine (GeglOperation *operation,
    * GEGL_TRANSFORM_CORE_EPSILON).
    */
 
-  gegl_matrix3_copy_into (&inverse, matrix);
-
-  if (factor)
-  {
-    inverse.coeff[0][0] /= factor;
-    inverse.coeff[0][1] /= factor;
-    inverse.coeff[0][2] /= factor;
-    inverse.coeff[1][0] /= factor;
-    inverse.coeff[1][1] /= factor;
-    inverse.coeff[1][2] /= factor;
-  }
-
-  gegl_matrix3_invert (&inverse);
+  gegl_transform_get_level_inverse (matrix, level, &inverse);
 
   g_object_get (dest, "pixels", &dest_pixels, NULL);
 
   {
-    const GeglRectangle *dest_extent = gegl_buffer_get_extent (dest);
     GeglBufferIterator *i = gegl_buffer_iterator_new (dest,
-                                                      dest_extent,
+                                                      roi,
                                                       level,
                                                       format,
                                                       GEGL_ACCESS_WRITE,
@@ -917,27 +952,27 @@ transform_affine (GeglOperation *operation,
 
     while (gegl_buffer_iterator_next (i))
       {
-        GeglRectangle *roi = &i->roi[0];
+        GeglRectangle *tile = &i->roi[0];
         gfloat * restrict dest_ptr =
           (gfloat *)i->data[0] +
-          (gint) 4 * ( flip_x * (roi->width  - (gint) 1) +
-                       flip_y * (roi->height - (gint) 1) * roi->width );
+          (gint) 4 * ( flip_x * (tile->width  - (gint) 1) +
+                       flip_y * (tile->height - (gint) 1) * tile->width );
 
         gdouble u_start =
           base_u +
-          inverse.coeff [0][0] * ( roi->x + flip_x * roi->width  ) +
-          inverse.coeff [0][1] * ( roi->y + flip_y * roi->height );
+          inverse.coeff [0][0] * ( tile->x + flip_x * tile->width  ) +
+          inverse.coeff [0][1] * ( tile->y + flip_y * tile->height );
         gdouble v_start =
           base_v +
-          inverse.coeff [1][0] * ( roi->x + flip_x * roi->width  ) +
-          inverse.coeff [1][1] * ( roi->y + flip_y * roi->height );
+          inverse.coeff [1][0] * ( tile->x + flip_x * tile->width  ) +
+          inverse.coeff [1][1] * ( tile->y + flip_y * tile->height );
 
-        gint y = roi->height;
+        gint y = tile->height;
         do {
           gdouble u_float = u_start;
           gdouble v_float = v_start;
 
-          gint x = roi->width;
+          gint x = tile->width;
           do {
             sampler_get_fun (sampler,
                              u_float, v_float,
@@ -950,7 +985,7 @@ transform_affine (GeglOperation *operation,
             v_float += inverse_jacobian.coeff [1][0];
           } while (--x);
 
-          dest_ptr += (gint) 8 * (flip_x - flip_y) * roi->width;
+          dest_ptr += (gint) 8 * (flip_x - flip_y) * tile->width;
 
           u_start += inverse_jacobian.coeff [0][1];
           v_start += inverse_jacobian.coeff [1][1];
@@ -962,17 +997,16 @@ transform_affine (GeglOperation *operation,
 }
 
 static void
-transform_generic (GeglOperation *operation,
-                   GeglBuffer  *dest,
-                   GeglBuffer  *src,
-                   GeglMatrix3 *matrix,
-                   gint         level)
+transform_generic (GeglOperation       *operation,
+                   GeglBuffer          *dest,
+                   GeglBuffer          *src,
+                   GeglMatrix3         *matrix,
+                   const GeglRectangle *roi,
+                   gint                 level)
 {
   OpTransform *transform = (OpTransform *) operation;
   const Babl          *format = babl_format ("RaGaBaA float");
-  gint                 factor = 1 << level;
   GeglBufferIterator  *i;
-  const GeglRectangle *dest_extent;
   GeglMatrix3          inverse;
   gint                 dest_pixels;
   GeglSampler *sampler = gegl_buffer_sampler_new_at_level (src,
@@ -983,38 +1017,25 @@ transform_generic (GeglOperation *operation,
   GeglSamplerGetFun sampler_get_fun = gegl_sampler_get_fun (sampler);
 
   g_object_get (dest, "pixels", &dest_pixels, NULL);
-  dest_extent = gegl_buffer_get_extent (dest);
 
   /*
    * Construct an output tile iterator.
    */
   i = gegl_buffer_iterator_new (dest,
-                                dest_extent,
+                                roi,
                                 level,
                                 format,
                                 GEGL_ACCESS_WRITE,
                                 GEGL_ABYSS_NONE);
 
-  gegl_matrix3_copy_into (&inverse, matrix);
-
-  if (factor)
-  {
-    inverse.coeff[0][0] /= factor;
-    inverse.coeff[0][1] /= factor;
-    inverse.coeff[0][2] /= factor;
-    inverse.coeff[1][0] /= factor;
-    inverse.coeff[1][1] /= factor;
-    inverse.coeff[1][2] /= factor;
-  }
-
-  gegl_matrix3_invert (&inverse);
+  gegl_transform_get_level_inverse (matrix, level, &inverse);
 
   /*
    * Fill the output tiles.
    */
   while (gegl_buffer_iterator_next (i))
     {
-      GeglRectangle *roi         = &i->roi[0];
+      GeglRectangle *tile        = &i->roi[0];
       /*
        * This code uses a variant of the (novel?) method of ensuring
        * that scanlines stay, as much as possible, within an input
@@ -1032,24 +1053,24 @@ transform_generic (GeglOperation *operation,
        * not to get right.
        */
       const gdouble u_start_y =
-        inverse.coeff [0][0] * (roi->x + (gdouble) 0.5) +
-        inverse.coeff [0][1] * (roi->y + (gdouble) 0.5) +
+        inverse.coeff [0][0] * (tile->x + (gdouble) 0.5) +
+        inverse.coeff [0][1] * (tile->y + (gdouble) 0.5) +
         inverse.coeff [0][2];
       const gdouble v_start_y =
-        inverse.coeff [1][0] * (roi->x + (gdouble) 0.5) +
-        inverse.coeff [1][1] * (roi->y + (gdouble) 0.5) +
+        inverse.coeff [1][0] * (tile->x + (gdouble) 0.5) +
+        inverse.coeff [1][1] * (tile->y + (gdouble) 0.5) +
         inverse.coeff [1][2];
       const gdouble w_start_y =
-        inverse.coeff [2][0] * (roi->x + (gdouble) 0.5) +
-        inverse.coeff [2][1] * (roi->y + (gdouble) 0.5) +
+        inverse.coeff [2][0] * (tile->x + (gdouble) 0.5) +
+        inverse.coeff [2][1] * (tile->y + (gdouble) 0.5) +
         inverse.coeff [2][2];
 
       const gdouble u_float_y =
-        u_start_y + inverse.coeff [0][1] * (roi->height - (gint) 1);
+        u_start_y + inverse.coeff [0][1] * (tile->height - (gint) 1);
       const gdouble v_float_y =
-        v_start_y + inverse.coeff [1][1] * (roi->height - (gint) 1);
+        v_start_y + inverse.coeff [1][1] * (tile->height - (gint) 1);
       const gdouble w_float_y =
-        w_start_y + inverse.coeff [2][1] * (roi->height - (gint) 1);
+        w_start_y + inverse.coeff [2][1] * (tile->height - (gint) 1);
 
       /*
        * Check whether the next scanline is likely to fall within the
@@ -1073,11 +1094,11 @@ transform_generic (GeglOperation *operation,
       const gdouble w_start_x = bflip_y ? w_float_y : w_start_y;
 
       const gdouble u_float_x =
-        u_start_x + inverse.coeff [0][0] * (roi->width - (gint) 1);
+        u_start_x + inverse.coeff [0][0] * (tile->width - (gint) 1);
       const gdouble v_float_x =
-        v_start_x + inverse.coeff [1][0] * (roi->width - (gint) 1);
+        v_start_x + inverse.coeff [1][0] * (tile->width - (gint) 1);
       const gdouble w_float_x =
-        w_start_x + inverse.coeff [2][0] * (roi->width - (gint) 1);
+        w_start_x + inverse.coeff [2][0] * (tile->width - (gint) 1);
 
       const gint bflip_x =
         (u_float_x + v_float_x)/w_float_x < (u_start_x + v_start_x)/w_start_x
@@ -1088,8 +1109,8 @@ transform_generic (GeglOperation *operation,
 
       gfloat * restrict dest_ptr =
         (gfloat *)i->data[0] +
-        (gint) 4 * ( bflip_x * (roi->width  - (gint) 1) +
-                     bflip_y * (roi->height - (gint) 1) * roi->width );
+        (gint) 4 * ( bflip_x * (tile->width  - (gint) 1) +
+                     bflip_y * (tile->height - (gint) 1) * tile->width );
 
       gdouble u_start = bflip_x ? u_float_x : u_start_x;
       gdouble v_start = bflip_x ? v_float_x : v_start_x;
@@ -1101,13 +1122,13 @@ transform_generic (GeglOperation *operation,
       /*
        * Assumes that height and width are > 0.
        */
-      gint y = roi->height;
+      gint y = tile->height;
       do {
         gdouble u_float = u_start;
         gdouble v_float = v_start;
         gdouble w_float = w_start;
 
-        gint x = roi->width;
+        gint x = tile->width;
         do {
           gdouble w_recip = (gdouble) 1.0 / w_float;
           gdouble u = u_float * w_recip;
@@ -1135,7 +1156,7 @@ transform_generic (GeglOperation *operation,
           w_float += flip_x * inverse.coeff [2][0];
         } while (--x);
 
-        dest_ptr += (gint) 4 * (flip_y - flip_x) * roi->width;
+        dest_ptr += (gint) 4 * (flip_y - flip_x) * tile->width;
         u_start += flip_y * inverse.coeff [0][1];
         v_start += flip_y * inverse.coeff [1][1];
         w_start += flip_y * inverse.coeff [2][1];
@@ -1191,6 +1212,638 @@ gegl_transform_matrix3_allow_fast_translate (GeglMatrix3 *matrix)
   return gegl_matrix3_is_translate (matrix);
 }
 
+/*
+ * Check whether an affine inverse matrix pulls output pixel centers
+ * back to input pixel centers through a rotation by a multiple of 90
+ * degrees and/or a flip (including plain integer translations), so
+ * that every output pixel is a copy of one input pixel.
+ */
+static gboolean
+gegl_transform_matrix3_is_orthogonal (GeglMatrix3 *inverse)
+{
+  gdouble u0, v0;
+
+  if (! gegl_matrix3_is_affine (inverse))
+    return FALSE;
+
+  if (! (is_zero (inverse->coeff [0][1]) && is_zero (inverse->coeff [1][0]) &&
+         is_one (fabs (inverse->coeff [0][0])) &&
+         is_one (fabs (inverse->coeff [1][1]))) &&
+      ! (is_zero (inverse->coeff [0][0]) && is_zero (inverse->coeff [1][1]) &&
+         is_one (fabs (inverse->coeff [0][1])) &&
+         is_one (fabs (inverse->coeff [1][0]))))
+    return FALSE;
+
+  /*
+   * Input position of the center of output pixel (0,0), relative to
+   * the center of input pixel (0,0).
+   */
+  u0 = (inverse->coeff [0][0] + inverse->coeff [0][1]) * (gdouble) 0.5 +
+       inverse->coeff [0][2] - (gdouble) 0.5;
+  v0 = (inverse->coeff [1][0] + inverse->coeff [1][1]) * (gdouble) 0.5 +
+       inverse->coeff [1][2] - (gdouble) 0.5;
+
+  return is_zero (u0 - round (u0)) && is_zero (v0 - round (v0));
+}
+
+/*
+ * Check whether an affine inverse matrix only scales (and possibly
+ * flips) along the axes, plus a translation.
+ */
+static gboolean
+gegl_transform_matrix3_is_axis_aligned (GeglMatrix3 *inverse)
+{
+  return gegl_matrix3_is_affine (inverse) &&
+         is_zero (inverse->coeff [0][1]) &&
+         is_zero (inverse->coeff [1][0]) &&
+         ! is_zero (inverse->coeff [0][0]) &&
+         ! is_zero (inverse->coeff [1][1]);
+}
+
+/*
+ * Whether the transform can be done by copying pixels. This is only
+ * true for samplers which interpolate, the cubic sampler (a smoothing
+ * B-spline by default) changes the pixels even at integer positions.
+ */
+static gboolean
+gegl_transform_allow_exact_copy (OpTransform *transform,
+                                 GeglMatrix3 *matrix)
+{
+  GeglMatrix3 inverse;
+
+  if (transform->sampler == GEGL_SAMPLER_CUBIC ||
+      ! gegl_matrix3_is_affine (matrix))
+    return FALSE;
+
+  gegl_transform_get_level_inverse (matrix, 0, &inverse);
+
+  return gegl_transform_matrix3_is_orthogonal (&inverse);
+}
+
+/*
+ * The inverse of the transformation matrix, in the coordinates of the
+ * given mipmap level.
+ */
+static void
+gegl_transform_get_level_inverse (GeglMatrix3 *matrix,
+                                  gint         level,
+                                  GeglMatrix3 *inverse)
+{
+  gint factor = 1 << level;
+
+  gegl_matrix3_copy_into (inverse, matrix);
+
+  inverse->coeff[0][0] /= factor;
+  inverse->coeff[0][1] /= factor;
+  inverse->coeff[0][2] /= factor;
+  inverse->coeff[1][0] /= factor;
+  inverse->coeff[1][1] /= factor;
+  inverse->coeff[1][2] /= factor;
+
+  gegl_matrix3_invert (inverse);
+}
+
+/*
+ * Size of the output blocks processed at once by the fast paths below,
+ * large enough to amortize gegl_buffer_get/set, small enough for the
+ * input and output of a block to stay in cache.
+ */
+#define TRANSFORM_BLOCK_SIZE 128
+
+/*
+ * Width and height of the input blocks read by transform_scale when
+ * downscaling.
+ */
+#define TRANSFORM_SCALE_INPUT_SIZE 512
+
+/*
+ * Rotations by multiples of 90 degrees and flips: every output pixel
+ * is a copy of an input pixel, so blocks of the input are fetched in
+ * the operation's format and transposed/mirrored into the output
+ * without any resampling or format conversion.
+ */
+static void
+transform_orthogonal (GeglOperation       *operation,
+                      GeglBuffer          *dest,
+                      GeglBuffer          *src,
+                      GeglMatrix3         *matrix,
+                      const GeglRectangle *roi,
+                      gint                 level)
+{
+  const Babl  *format = gegl_operation_get_format (operation, "output");
+  gint         bpp    = babl_format_get_bytes_per_pixel (format);
+  GeglMatrix3  inverse;
+  gint         u_x, u_y, u_0, v_x, v_y, v_0;
+  gint         bx, by;
+  guchar      *src_buf;
+  guchar      *dest_buf;
+
+  gegl_transform_get_level_inverse (matrix, level, &inverse);
+
+  /*
+   * The input pixel copied to output pixel (x,y) is
+   * (u_x * x + u_y * y + u_0, v_x * x + v_y * y + v_0).
+   */
+  u_x = (gint) round (inverse.coeff [0][0]);
+  u_y = (gint) round (inverse.coeff [0][1]);
+  u_0 = (gint) round ((inverse.coeff [0][0] + inverse.coeff [0][1]) * 0.5 +
+                      inverse.coeff [0][2] - 0.5);
+  v_x = (gint) round (inverse.coeff [1][0]);
+  v_y = (gint) round (inverse.coeff [1][1]);
+  v_0 = (gint) round ((inverse.coeff [1][0] + inverse.coeff [1][1]) * 0.5 +
+                      inverse.coeff [1][2] - 0.5);
+
+  src_buf  = gegl_malloc (TRANSFORM_BLOCK_SIZE * TRANSFORM_BLOCK_SIZE * bpp);
+  dest_buf = gegl_malloc (TRANSFORM_BLOCK_SIZE * TRANSFORM_BLOCK_SIZE * bpp);
+
+  for (by = roi->y; by < roi->y + roi->height; by += TRANSFORM_BLOCK_SIZE)
+    for (bx = roi->x; bx < roi->x + roi->width; bx += TRANSFORM_BLOCK_SIZE)
+      {
+        GeglRectangle dest_rect;
+        GeglRectangle src_rect;
+        gint          x_step;
+        gint          x, y;
+        guchar       *dest_ptr = dest_buf;
+
+        dest_rect.x      = bx;
+        dest_rect.y      = by;
+        dest_rect.width  = MIN (TRANSFORM_BLOCK_SIZE, roi->x + roi->width  - bx);
+        dest_rect.height = MIN (TRANSFORM_BLOCK_SIZE, roi->y + roi->height - by);
+
+        /*
+         * The input block is the output block with its extent
+         * rotated/flipped.
+         */
+        src_rect.x = u_0 + u_x * (u_x > 0 ? dest_rect.x :
+                                            dest_rect.x + dest_rect.width - 1) +
+                           u_y * (u_y > 0 ? dest_rect.y :
+                                            dest_rect.y + dest_rect.height - 1);
+        src_rect.y = v_0 + v_x * (v_x > 0 ? dest_rect.x :
+                                            dest_rect.x + dest_rect.width - 1) +
+                           v_y * (v_y > 0 ? dest_rect.y :
+                                            dest_rect.y + dest_rect.height - 1);
+        src_rect.width  = u_x ? dest_rect.width  : dest_rect.height;
+        src_rect.height = u_x ? dest_rect.height : dest_rect.width;
+
+        gegl_buffer_get (src, &src_rect, 1.0 / (1 << level), format, src_buf,
+                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+        x_step = (u_x + v_x * src_rect.width) * bpp;
+
+        for (y = 0; y < dest_rect.height; y++)
+          {
+            const guchar *src_ptr =
+              src_buf +
+              ((u_0 + u_x * dest_rect.x + u_y * (dest_rect.y + y) - src_rect.x) +
+               (v_0 + v_x * dest_rect.x + v_y * (dest_rect.y + y) - src_rect.y) *
+               src_rect.width) * bpp;
+
+            for (x = 0; x < dest_rect.width; x++)
+              {
+                memcpy (dest_ptr, src_ptr, bpp);
+                dest_ptr += bpp;
+                src_ptr  += x_step;
+              }
+          }
+
+        gegl_buffer_set (dest, &dest_rect, level, format, dest_buf,
+                         GEGL_AUTO_ROWSTRIDE);
+      }
+
+  gegl_free (src_buf);
+  gegl_free (dest_buf);
+}
+
+/*
+ * Kernels of the separable scaling path.
+ */
+typedef enum
+{
+  TRANSFORM_KERNEL_NONE,     /* not separable, use the sampler */
+  TRANSFORM_KERNEL_NEAREST,
+  TRANSFORM_KERNEL_BOX,
+  TRANSFORM_KERNEL_TRIANGLE,
+  TRANSFORM_KERNEL_MITCHELL,
+  TRANSFORM_KERNEL_LANCZOS3
+} TransformKernel;
+
+/*
+ * The kernel of the separable scaling path. With the auto filter, the
+ * path is only taken for the samplers it reproduces exactly: nearest,
+ * and linear with an unstretched triangle. Like the samplers, these are
+ * not widened when downscaling, so the output does not depend on which
+ * path is taken.
+ */
+static TransformKernel
+gegl_transform_get_kernel (OpTransform *transform,
+                           gint         level)
+{
+  if (level)
+    return TRANSFORM_KERNEL_NEAREST;
+
+  switch (transform->filter)
+    {
+    case GEGL_TRANSFORM_FILTER_BOX:
+      return TRANSFORM_KERNEL_BOX;
+    case GEGL_TRANSFORM_FILTER_TRIANGLE:
+      return TRANSFORM_KERNEL_TRIANGLE;
+    case GEGL_TRANSFORM_FILTER_MITCHELL:
+      return TRANSFORM_KERNEL_MITCHELL;
+    case GEGL_TRANSFORM_FILTER_LANCZOS3:
+      return TRANSFORM_KERNEL_LANCZOS3;
+    case GEGL_TRANSFORM_FILTER_AUTO:
+    default:
+      break;
+    }
+
+  switch (transform->sampler)
+    {
+    case GEGL_SAMPLER_NEAREST:
+      return TRANSFORM_KERNEL_NEAREST;
+    case GEGL_SAMPLER_LINEAR:
+      return TRANSFORM_KERNEL_TRIANGLE;
+    default:
+      /* the cubic sampler is left to the sampler path, nohalo and lohalo
+       * are not separable
+       */
+      return TRANSFORM_KERNEL_NONE;
+    }
+}
+
+/*
+ * How much the kernel is stretched for the given inverse scale factor.
+ * Explicitly chosen filters are stretched when downscaling, so that they
+ * also act as the antialiasing prefilter.
+ */
+static gdouble
+gegl_transform_get_stretch (OpTransform *transform,
+                            gint         level,
+                            gdouble      scale)
+{
+  if (level || transform->filter == GEGL_TRANSFORM_FILTER_AUTO)
+    return 1.0;
+
+  return MAX (fabs (scale), 1.0);
+}
+
+static gdouble
+transform_kernel_support (TransformKernel kernel)
+{
+  switch (kernel)
+    {
+    case TRANSFORM_KERNEL_BOX:
+      return 0.5;
+    case TRANSFORM_KERNEL_TRIANGLE:
+      return 1.0;
+    case TRANSFORM_KERNEL_MITCHELL:
+      return 2.0;
+    case TRANSFORM_KERNEL_LANCZOS3:
+      return 3.0;
+    default:
+      return 0.0;
+    }
+}
+
+/* The Mitchell-Netravali cubic family */
+static inline gdouble
+transform_kernel_cubic (gdouble x,
+                        gdouble b,
+                        gdouble c)
+{
+  gdouble x2 = x * x;
+
+  if (x < 1.0)
+    return ((12 - 9 * b - 6 * c) * x2 * x +
+            (-18 + 12 * b + 6 * c) * x2 +
+            (6 - 2 * b)) / 6;
+  if (x < 2.0)
+    return ((-b - 6 * c) * x2 * x +
+            (6 * b + 30 * c) * x2 +
+            (-12 * b - 48 * c) * x +
+            (8 * b + 24 * c)) / 6;
+  return 0.0;
+}
+
+static inline gdouble
+transform_kernel_sinc (gdouble x)
+{
+  if (x == 0.0)
+    return 1.0;
+  x *= G_PI;
+  return sin (x) / x;
+}
+
+/* Evaluate kernel at the signed distance x, in input pixels */
+static gdouble
+transform_kernel_eval (TransformKernel kernel,
+                       gdouble         x)
+{
+  switch (kernel)
+    {
+    case TRANSFORM_KERNEL_BOX:
+      /* half open, so that no input pixel is counted twice */
+      return x > -0.5 && x <= 0.5 ? 1.0 : 0.0;
+    case TRANSFORM_KERNEL_TRIANGLE:
+      return MAX (1.0 - fabs (x), 0.0);
+    case TRANSFORM_KERNEL_MITCHELL:
+      return transform_kernel_cubic (fabs (x), 1.0 / 3.0, 1.0 / 3.0);
+    case TRANSFORM_KERNEL_LANCZOS3:
+      if (fabs (x) >= 3.0)
+        return 0.0;
+      return transform_kernel_sinc (x) * transform_kernel_sinc (x / 3.0);
+    default:
+      return 0.0;
+    }
+}
+
+/*
+ * The input context needed around each output pixel: the sampler's
+ * context, or the support of the kernel when the separable scaling
+ * path is used (which is wider when downscaling with an explicitly
+ * chosen filter).
+ */
+static void
+gegl_transform_get_context_rect (OpTransform   *transform,
+                                 GeglMatrix3   *matrix,
+                                 GeglRectangle *context_rect)
+{
+  TransformKernel  kernel = gegl_transform_get_kernel (transform, 0);
+  GeglSampler     *sampler;
+  GeglMatrix3      inverse;
+  gint             margin_x, margin_y;
+
+  sampler = gegl_buffer_sampler_new_at_level (NULL,
+                                     babl_format("RaGaBaA float"),
+                                     transform->sampler,
+                                     0); //XXX: need level?
+  *context_rect = *gegl_sampler_get_context_rect (sampler);
+  g_object_unref (sampler);
+
+  if (kernel == TRANSFORM_KERNEL_NONE || ! gegl_matrix3_is_affine (matrix))
+    return;
+
+  gegl_transform_get_level_inverse (matrix, 0, &inverse);
+
+  if (! gegl_transform_matrix3_is_axis_aligned (&inverse))
+    return;
+
+  margin_x = (gint) ceil (transform_kernel_support (kernel) *
+                          gegl_transform_get_stretch (transform, 0,
+                                                      inverse.coeff [0][0])) + 1;
+  margin_y = (gint) ceil (transform_kernel_support (kernel) *
+                          gegl_transform_get_stretch (transform, 0,
+                                                      inverse.coeff [1][1])) + 1;
+
+  context_rect->x      = MIN (context_rect->x, -margin_x);
+  context_rect->y      = MIN (context_rect->y, -margin_y);
+  context_rect->width  = MAX (context_rect->width,  2 * margin_x + 1);
+  context_rect->height = MAX (context_rect->height, 2 * margin_y + 1);
+}
+
+/*
+ * Separable resampling filter for one axis: each output pixel is a
+ * weighted sum of n_taps consecutive input pixels starting at first.
+ * The weights are computed once per output column (or row) and padded
+ * with zeros to n_taps, so the inner loops have a fixed trip count.
+ */
+typedef struct
+{
+  gint    n_taps;
+  gint   *first;
+  gfloat *weights;
+} TransformFilter;
+
+static void
+transform_filter_init (TransformFilter *filter,
+                       TransformKernel  kernel,
+                       gdouble          stretch,
+                       gdouble          scale,
+                       gdouble          offset,
+                       gint             start,
+                       gint             n)
+{
+  /*
+   * The input position of the center of output pixel x is
+   * scale * (x + 0.5) + offset. The kernel is stretched by stretch,
+   * the scale factor when it also acts as the antialiasing prefilter.
+   */
+  gdouble support = transform_kernel_support (kernel) * stretch;
+  gint    i, k;
+
+  if (kernel == TRANSFORM_KERNEL_NEAREST)
+    filter->n_taps = 1;
+  else
+    filter->n_taps = (gint) ceil ((gdouble) 2.0 * support) + 1;
+
+  filter->first   = g_new (gint, n);
+  filter->weights = g_new0 (gfloat, n * filter->n_taps);
+
+  for (i = 0; i < n; i++)
+    {
+      gdouble  u       = scale * (start + i + (gdouble) 0.5) + offset;
+      gfloat  *weights = filter->weights + i * filter->n_taps;
+      gdouble  sum     = 0.0;
+
+      if (kernel == TRANSFORM_KERNEL_NEAREST)
+        {
+          filter->first[i] = (gint) floor (u);
+          weights[0]       = 1.0;
+          continue;
+        }
+
+      filter->first[i] = (gint) floor (u - (gdouble) 0.5 - support) + 1;
+
+      for (k = 0; k < filter->n_taps; k++)
+        {
+          gdouble x = (filter->first[i] + k + (gdouble) 0.5 - u) / stretch;
+
+          weights[k] = transform_kernel_eval (kernel, x);
+          sum += weights[k];
+        }
+
+      if (sum != (gdouble) 0.0)
+        for (k = 0; k < filter->n_taps; k++)
+          weights[k] /= sum;
+    }
+}
+
+static void
+transform_filter_clear (TransformFilter *filter)
+{
+  g_free (filter->first);
+  g_free (filter->weights);
+}
+
+/* The range of input pixels used by the output pixels start to end */
+static void
+transform_filter_get_range (const TransformFilter *filter,
+                            gint                   start,
+                            gint                   end,
+                            gint                  *first,
+                            gint                  *size)
+{
+  gint min = G_MAXINT;
+  gint max = G_MININT;
+  gint i;
+
+  for (i = start; i < end; i++)
+    {
+      min = MIN (min, filter->first[i]);
+      max = MAX (max, filter->first[i] + filter->n_taps);
+    }
+
+  *first = min;
+  *size  = max - min;
+}
+
+/*
+ * Axis aligned scaling, flipping and subpixel translation, done as two
+ * separable passes with precomputed weights instead of sampling every
+ * output pixel in 2D. The input is processed in blocks of bounded size,
+ * so the memory used does not depend on the size of the input.
+ */
+static void
+transform_scale (GeglOperation       *operation,
+                 GeglBuffer          *dest,
+                 GeglBuffer          *src,
+                 GeglMatrix3         *matrix,
+                 const GeglRectangle *roi,
+                 gint                 level)
+{
+  OpTransform     *transform = (OpTransform *) operation;
+  const Babl      *format    = babl_format ("RaGaBaA float");
+  TransformKernel  kernel    = gegl_transform_get_kernel (transform, level);
+  GeglMatrix3      inverse;
+  TransformFilter  filter_x;
+  TransformFilter  filter_y;
+  gint             block_width, block_height;
+  gint             bx, by;
+  gfloat          *src_buf  = NULL;
+  gfloat          *tmp_buf  = NULL;
+  gfloat          *dest_buf;
+  gint             src_size = 0;
+  gint             tmp_size = 0;
+
+  gegl_transform_get_level_inverse (matrix, level, &inverse);
+
+  transform_filter_init (&filter_x, kernel,
+                         gegl_transform_get_stretch (transform, level,
+                                                     inverse.coeff [0][0]),
+                         inverse.coeff [0][0], inverse.coeff [0][2],
+                         roi->x, roi->width);
+  transform_filter_init (&filter_y, kernel,
+                         gegl_transform_get_stretch (transform, level,
+                                                     inverse.coeff [1][1]),
+                         inverse.coeff [1][1], inverse.coeff [1][2],
+                         roi->y, roi->height);
+
+  /*
+   * Shrink the output blocks when downscaling, so that the input
+   * blocks stay around TRANSFORM_SCALE_INPUT_SIZE pixels across.
+   */
+  block_width  = CLAMP ((gint) ((TRANSFORM_SCALE_INPUT_SIZE - filter_x.n_taps) /
+                                fabs (inverse.coeff [0][0])),
+                        8, TRANSFORM_BLOCK_SIZE);
+  block_height = CLAMP ((gint) ((TRANSFORM_SCALE_INPUT_SIZE - filter_y.n_taps) /
+                                fabs (inverse.coeff [1][1])),
+                        8, TRANSFORM_BLOCK_SIZE);
+
+  dest_buf = gegl_malloc (block_width * block_height * 4 * sizeof (gfloat));
+
+  for (by = 0; by < roi->height; by += block_height)
+    for (bx = 0; bx < roi->width; bx += block_width)
+      {
+        GeglRectangle dest_rect;
+        GeglRectangle src_rect;
+        gint          x, y, k, c;
+
+        dest_rect.x      = roi->x + bx;
+        dest_rect.y      = roi->y + by;
+        dest_rect.width  = MIN (block_width,  roi->width  - bx);
+        dest_rect.height = MIN (block_height, roi->height - by);
+
+        transform_filter_get_range (&filter_x, bx, bx + dest_rect.width,
+                                    &src_rect.x, &src_rect.width);
+        transform_filter_get_range (&filter_y, by, by + dest_rect.height,
+                                    &src_rect.y, &src_rect.height);
+
+        if (src_rect.width * src_rect.height > src_size)
+          {
+            src_size = src_rect.width * src_rect.height;
+            if (src_buf)
+              gegl_free (src_buf);
+            src_buf = gegl_malloc (src_size * 4 * sizeof (gfloat));
+          }
+        if (src_rect.height * dest_rect.width > tmp_size)
+          {
+            tmp_size = src_rect.height * dest_rect.width;
+            if (tmp_buf)
+              gegl_free (tmp_buf);
+            tmp_buf = gegl_malloc (tmp_size * 4 * sizeof (gfloat));
+          }
+
+        gegl_buffer_get (src, &src_rect, 1.0 / (1 << level), format, src_buf,
+                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+        /* horizontal pass, into src_rect.height rows of dest_rect.width */
+        for (y = 0; y < src_rect.height; y++)
+          {
+            const gfloat *src_row = src_buf + y * src_rect.width * 4;
+            gfloat       *tmp_ptr = tmp_buf + y * dest_rect.width * 4;
+
+            for (x = 0; x < dest_rect.width; x++)
+              {
+                const gfloat *weights = filter_x.weights +
+                                        (bx + x) * filter_x.n_taps;
+                const gfloat *src_ptr = src_row +
+                                        (filter_x.first[bx + x] - src_rect.x) * 4;
+                gfloat        sum[4]  = { 0.0, 0.0, 0.0, 0.0 };
+
+                for (k = 0; k < filter_x.n_taps; k++)
+                  for (c = 0; c < 4; c++)
+                    sum[c] += weights[k] * src_ptr[k * 4 + c];
+
+                for (c = 0; c < 4; c++)
+                  *tmp_ptr++ = sum[c];
+              }
+          }
+
+        /* vertical pass */
+        for (y = 0; y < dest_rect.height; y++)
+          {
+            const gfloat *weights  = filter_y.weights +
+                                     (by + y) * filter_y.n_taps;
+            const gfloat *tmp_rows = tmp_buf +
+                                     (filter_y.first[by + y] - src_rect.y) *
+                                     dest_rect.width * 4;
+            gfloat       *dest_ptr = dest_buf + y * dest_rect.width * 4;
+
+            for (x = 0; x < dest_rect.width * 4; x++)
+              dest_ptr[x] = 0.0;
+
+            for (k = 0; k < filter_y.n_taps; k++)
+              {
+                const gfloat *tmp_ptr = tmp_rows + k * dest_rect.width * 4;
+                const gfloat  weight  = weights[k];
+
+                for (x = 0; x < dest_rect.width * 4; x++)
+                  dest_ptr[x] += weight * tmp_ptr[x];
+              }
+          }
+
+        gegl_buffer_set (dest, &dest_rect, level, format, dest_buf,
+                         GEGL_AUTO_ROWSTRIDE);
+      }
+
+  if (src_buf)
+    gegl_free (src_buf);
+  if (tmp_buf)
+    gegl_free (tmp_buf);
+  gegl_free (dest_buf);
+  transform_filter_clear (&filter_x);
+  transform_filter_clear (&filter_y);
+}
+
 static gboolean
 gegl_transform_process (GeglOperation        *operation,
                         GeglOperationContext *context,
@@ -1251,14 +1904,26 @@ gegl_transform_process (GeglOperation        *operation,
     }
   else
     {
-      void (*func) (GeglOperation *operation,
-                    GeglBuffer  *dest,
-                    GeglBuffer  *src,
-                    GeglMatrix3 *matrix,
-                    gint         level) = transform_generic;
+      TransformFunc func = transform_generic;
 
       if (gegl_matrix3_is_affine (&matrix))
-        func = transform_affine;
+        {
+          GeglSamplerType sampler = level ? GEGL_SAMPLER_NEAREST :
+                                            transform->sampler;
+          GeglMatrix3     inverse;
+
+          gegl_transform_get_level_inverse (&matrix, level, &inverse);
+
+          if (sampler != GEGL_SAMPLER_CUBIC &&
+              gegl_transform_matrix3_is_orthogonal (&inverse))
+            func = transform_orthogonal;
+          else if (gegl_transform_get_kernel (transform, level) !=
+                     TRANSFORM_KERNEL_NONE &&
+                   gegl_transform_matrix3_is_axis_aligned (&inverse))
+            func = transform_scale;
+          else
+            func = transform_affine;
+        }
 
       /*
        * For all other cases, do a proper resampling
@@ -1318,7 +1983,7 @@ gegl_transform_process (GeglOperation        *operation,
       }
       else
       {
-        func (operation, output, input, &matrix, level);
+        func (operation, output, input, &matrix, result, level);
       }
 
       if (input != NULL)
@@ -12,6 +12,19 @@ G_BEGIN_DECLS
 #define IS_OP_TRANSFORM_CLASS(klass)    (G_TYPE_CHECK_CLASS_TYPE ((klass),  TYPE_OP_TRANSFORM))
 #define OP_TRANSFORM_GET_CLASS(obj)     (G_TYPE_INSTANCE_GET_CLASS ((obj),  TYPE_OP_TRANSFORM, OpTransformClass))
 
+/* Filters for the separable axis aligned scaling path */
+typedef enum
+{
+  GEGL_TRANSFORM_FILTER_AUTO,
+  GEGL_TRANSFORM_FILTER_BOX,
+  GEGL_TRANSFORM_FILTER_TRIANGLE,
+  GEGL_TRANSFORM_FILTER_MITCHELL,
+  GEGL_TRANSFORM_FILTER_LANCZOS3
+} GeglTransformFilter;
+
+GType gegl_transform_filter_get_type (void) G_GNUC_CONST;
+#define GEGL_TYPE_TRANSFORM_FILTER (gegl_transform_filter_get_type ())
+
 typedef struct _OpTransform OpTransform;
 
 struct _OpTransform
@@ -20,6 +33,7 @@ struct _OpTransform
   gdouble             origin_x;
   gdouble             origin_y;
   GeglSamplerType     sampler;
+  GeglTransformFilter filter;
 };
 
 typedef struct _OpTransformClass OpTransformClass;
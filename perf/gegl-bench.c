@@ -0,0 +1,947 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright 2015 GEGL contributors
+ */
+
+/* A single benchmark runner for the buffer, sampler, tile cache, babl and
+ * operation code paths, and for a set of the compositions in
+ * tests/compositions.
+ *
+ * Every benchmark is run a number of times after some warmup runs, and
+ * its throughput summarized as the median, mean, standard deviation,
+ * minimum and maximum in megabytes/second. Benchmarks which render graphs
+ * are repeated for every thread count given with --threads.
+ *
+ * The results of a run written with --format=tsv can be passed back as
+ * --baseline, to fail when the median throughput of a benchmark dropped
+ * by more than --tolerance percent:
+ *
+ *   GEGL_PATH=../operations ./gegl-bench --format=tsv > baseline.tsv
+ *   ... upgrade ...
+ *   GEGL_PATH=../operations ./gegl-bench --baseline=baseline.tsv
+ *
+ * --costs writes the nanoseconds per pixel the operation benchmarks took,
+ * summed over all threads, for setting as the "cost" keys of operations
+ * used by gegl_node_estimate_cost().
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "test-common.h"
+#include "gegl-config.h"
+
+#ifndef COMPOSITIONS_DIR
+#define COMPOSITIONS_DIR "../tests/compositions/"
+#endif
+
+#define BENCH_WIDTH    1024
+#define BENCH_HEIGHT   1024
+#define BENCH_SAMPLES  (256 * 1024)
+
+typedef struct
+{
+  GeglBuffer   *buffer;
+  GeglBuffer   *buffer2;
+  gpointer      buf;
+  gpointer      buf2;
+  gint         *coords;
+  const Babl   *fish;
+  GeglSampler  *sampler;
+  const gchar  *operation;
+  gint          n_inputs;
+  gchar        *xml;
+  gchar        *path_root;
+  GeglRectangle rect;
+  guint64       old_cache_size;
+  gdouble       bytes;      /* processed by a single run */
+} BenchData;
+
+typedef struct
+{
+  const gchar *name;
+  gboolean   (*setup) (BenchData *data);
+  void       (*run)   (BenchData *data);
+  gboolean     threaded;  /* whether the result depends on the thread count */
+  const gchar *operation;
+  gint         n_inputs;  /* < 0 for sinks, which get the output buffer */
+} Bench;
+
+typedef struct
+{
+  gchar   *name;
+  gint     threads;
+  gint     n;
+  gdouble  median;
+  gdouble  mean;
+  gdouble  stddev;
+  gdouble  min;
+  gdouble  max;
+  gdouble  cost;     /* nanoseconds per pixel of operations, or 0 */
+} BenchResult;
+
+/* buffer access */
+
+static gboolean
+setup_buffer (BenchData *data)
+{
+  data->buffer = test_buffer (BENCH_WIDTH, BENCH_HEIGHT,
+                              babl_format ("RGBA float"));
+  data->rect   = *gegl_buffer_get_extent (data->buffer);
+  data->buf    = g_malloc0 ((gsize) data->rect.width * data->rect.height * 16);
+  data->bytes  = (gdouble) data->rect.width * data->rect.height * 16;
+
+  return TRUE;
+}
+
+static void
+run_buffer_get (BenchData *data)
+{
+  gegl_buffer_get (data->buffer, &data->rect, 1.0, NULL, data->buf,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+}
+
+static void
+run_buffer_get_u8 (BenchData *data)
+{
+  gegl_buffer_get (data->buffer, &data->rect, 1.0,
+                   babl_format ("R'G'B'A u8"), data->buf,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+}
+
+static void
+run_buffer_set (BenchData *data)
+{
+  gegl_buffer_set (data->buffer, &data->rect, 0, NULL, data->buf,
+                   GEGL_AUTO_ROWSTRIDE);
+}
+
+static void
+run_buffer_set_u8 (BenchData *data)
+{
+  gegl_buffer_set (data->buffer, &data->rect, 0,
+                   babl_format ("R'G'B'A u8"), data->buf,
+                   GEGL_AUTO_ROWSTRIDE);
+}
+
+static void
+run_buffer_copy (BenchData *data)
+{
+  GeglBuffer *copy = gegl_buffer_new (&data->rect, babl_format ("RGBA float"));
+
+  /* offset by a pixel, so the tiles can not be shared */
+  GeglRectangle dst = {1, 1, data->rect.width, data->rect.height};
+
+  gegl_buffer_copy (data->buffer, &data->rect, GEGL_ABYSS_NONE, copy, &dst);
+  g_object_unref (copy);
+}
+
+static void
+run_iterator_read (BenchData *data)
+{
+  GeglBufferIterator *iter;
+  gfloat              sum = 0.0;
+
+  iter = gegl_buffer_iterator_new (data->buffer, &data->rect, 0, NULL,
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *in = iter->data[0];
+      gint    i;
+
+      for (i = 0; i < iter->length; i++)
+        sum += in[i * 4];
+    }
+
+  /* keep the loop from being optimized away */
+  *(gfloat *) data->buf = sum;
+}
+
+static void
+run_iterator_readwrite (BenchData *data)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (data->buffer, &data->rect, 0,
+                                   babl_format ("RGBA float"),
+                                   GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *pixel = iter->data[0];
+      gint    i;
+
+      for (i = 0; i < iter->length * 4; i++)
+        pixel[i] = 1.0 - pixel[i];
+    }
+}
+
+/* samplers */
+
+static gboolean
+setup_sampler (BenchData *data, GeglSamplerType type)
+{
+  gint i;
+
+  setup_buffer (data);
+
+  data->sampler = gegl_buffer_sampler_new (data->buffer,
+                                           babl_format ("RGBA float"),
+                                           type);
+  data->coords  = g_new (gint, BENCH_SAMPLES * 2);
+
+  for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+      data->coords[i * 2]     = g_random_int_range (0, data->rect.width);
+      data->coords[i * 2 + 1] = g_random_int_range (0, data->rect.height);
+    }
+
+  data->bytes = (gdouble) BENCH_SAMPLES * 16;
+
+  return TRUE;
+}
+
+static gboolean
+setup_sampler_nearest (BenchData *data)
+{
+  return setup_sampler (data, GEGL_SAMPLER_NEAREST);
+}
+
+static gboolean
+setup_sampler_linear (BenchData *data)
+{
+  return setup_sampler (data, GEGL_SAMPLER_LINEAR);
+}
+
+static gboolean
+setup_sampler_cubic (BenchData *data)
+{
+  return setup_sampler (data, GEGL_SAMPLER_CUBIC);
+}
+
+static gboolean
+setup_sampler_nohalo (BenchData *data)
+{
+  return setup_sampler (data, GEGL_SAMPLER_NOHALO);
+}
+
+static gboolean
+setup_sampler_lohalo (BenchData *data)
+{
+  return setup_sampler (data, GEGL_SAMPLER_LOHALO);
+}
+
+static void
+run_sampler (BenchData *data)
+{
+  GeglSamplerGetFun sampler_get_fun = gegl_sampler_get_fun (data->sampler);
+  gfloat            px[4];
+  gint              i;
+
+  for (i = 0; i < BENCH_SAMPLES; i++)
+    sampler_get_fun (data->sampler,
+                     data->coords[i * 2] + 0.3, data->coords[i * 2 + 1] + 0.6,
+                     NULL, px, GEGL_ABYSS_NONE);
+}
+
+/* tile cache, and swap when the cache is too small for the buffer */
+
+static gboolean
+setup_cache (BenchData *data)
+{
+  gint i;
+
+  setup_buffer (data);
+
+  data->coords = g_new (gint, BENCH_SAMPLES * 2);
+
+  for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+      data->coords[i * 2]     = g_random_int_range (0, data->rect.width);
+      data->coords[i * 2 + 1] = g_random_int_range (0, data->rect.height);
+    }
+
+  data->bytes = (gdouble) BENCH_SAMPLES * 16;
+
+  return TRUE;
+}
+
+static void
+run_cache (BenchData *data)
+{
+  gfloat px[4];
+  gint   i;
+
+  for (i = 0; i < BENCH_SAMPLES; i++)
+    {
+      GeglRectangle rect = {data->coords[i * 2], data->coords[i * 2 + 1], 1, 1};
+
+      gegl_buffer_get (data->buffer, &rect, 1.0, NULL, px,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+}
+
+static gboolean
+setup_swap (BenchData *data)
+{
+  gchar *swap;
+
+  g_object_get (gegl_config (), "swap", &swap, NULL);
+  g_free (swap);
+
+  if (! swap)
+    {
+      g_printerr ("swap is disabled, set GEGL_SWAP to a directory\n");
+      return FALSE;
+    }
+
+  /* a cache of a quarter of the buffer makes most tile fetches go to swap */
+  g_object_get (gegl_config (), "tile-cache-size", &data->old_cache_size, NULL);
+  g_object_set (gegl_config (), "tile-cache-size",
+                (guint64) BENCH_WIDTH * BENCH_HEIGHT * 16 / 4, NULL);
+
+  return setup_buffer (data);
+}
+
+static void
+run_swap (BenchData *data)
+{
+  run_buffer_set (data);
+  run_buffer_get (data);
+}
+
+
+/* babl */
+
+static gboolean
+setup_babl (BenchData   *data,
+            const gchar *source,
+            const gchar *destination)
+{
+  gsize n_pixels = BENCH_WIDTH * BENCH_HEIGHT;
+
+  data->fish  = babl_fish (babl_format (source), babl_format (destination));
+  data->buf   = g_malloc0 (n_pixels * 16);
+  data->buf2  = g_malloc0 (n_pixels * 16);
+  data->bytes = (gdouble) n_pixels * 16;
+
+  memset (data->buf, 0x3f, n_pixels * babl_format_get_bytes_per_pixel (babl_format (source)));
+
+  return TRUE;
+}
+
+static gboolean
+setup_babl_float_to_u8 (BenchData *data)
+{
+  return setup_babl (data, "RGBA float", "R'G'B'A u8");
+}
+
+static gboolean
+setup_babl_u8_to_float (BenchData *data)
+{
+  return setup_babl (data, "R'G'B'A u8", "RGBA float");
+}
+
+static gboolean
+setup_babl_premultiply (BenchData *data)
+{
+  return setup_babl (data, "RGBA float", "RaGaBaA float");
+}
+
+static gboolean
+setup_babl_float_to_y (BenchData *data)
+{
+  return setup_babl (data, "RGBA float", "Y float");
+}
+
+static void
+run_babl (BenchData *data)
+{
+  babl_process (data->fish, data->buf, data->buf2, BENCH_WIDTH * BENCH_HEIGHT);
+}
+
+/* operations, processed from buffers of random data into a new buffer */
+
+static gboolean
+setup_operation (BenchData *data)
+{
+  if (! gegl_has_operation (data->operation))
+    {
+      g_printerr ("operation %s not found\n", data->operation);
+      return FALSE;
+    }
+
+  setup_buffer (data);
+  data->buffer2 = test_buffer (BENCH_WIDTH, BENCH_HEIGHT,
+                               babl_format ("RGBA float"));
+
+  data->bytes *= MAX (data->n_inputs, 1);
+
+  return TRUE;
+}
+
+static void
+run_operation (BenchData *data)
+{
+  static const gchar *pads[] = { "input", "aux", "aux2" };
+  GeglNode   *gegl;
+  GeglNode   *node;
+  GeglNode   *crop;
+  GeglNode   *sink;
+  GeglBuffer *output = NULL;
+  gint        i;
+
+  gegl = gegl_node_new ();
+  node = gegl_node_new_child (gegl, "operation", data->operation, NULL);
+
+  /* sources like gegl:buffer-source read the input buffer themselves */
+  if (data->n_inputs == 0 && gegl_node_find_property (node, "buffer"))
+    gegl_node_set (node, "buffer", data->buffer, NULL);
+
+  for (i = 0; i < MAX (data->n_inputs, -data->n_inputs); i++)
+    {
+      GeglNode *source;
+
+      source = gegl_node_new_child (gegl,
+                                    "operation", "gegl:buffer-source",
+                                    "buffer", i == 1 ? data->buffer2
+                                                     : data->buffer,
+                                    NULL);
+      gegl_node_connect_to (source, "output", node, pads[i]);
+    }
+
+  if (data->n_inputs < 0)
+    {
+      gegl_node_set (node, "buffer", data->buffer2, NULL);
+      gegl_node_process (node);
+      g_object_unref (gegl);
+      return;
+    }
+
+  /* renderers like gegl:checkerboard have an infinite bounding box */
+  crop = gegl_node_new_child (gegl,
+                              "operation", "gegl:crop",
+                              "x",         (gdouble) data->rect.x,
+                              "y",         (gdouble) data->rect.y,
+                              "width",     (gdouble) data->rect.width,
+                              "height",    (gdouble) data->rect.height,
+                              NULL);
+  sink = gegl_node_new_child (gegl,
+                              "operation", "gegl:buffer-sink",
+                              "buffer",    &output,
+                              NULL);
+
+  gegl_node_link_many (node, crop, sink, NULL);
+  gegl_node_process (sink);
+
+  g_object_unref (gegl);
+  if (output)
+    g_object_unref (output);
+}
+
+/* compositions from tests/compositions, parsed anew for every run so
+ * that nothing is served from the caches of the previous run
+ */
+
+static gchar *compositions_dir = NULL;  /* COMPOSITIONS_DIR by default */
+
+static gboolean
+setup_composition (BenchData *data)
+{
+  GeglNode *gegl;
+  gchar    *path;
+  GError   *error = NULL;
+
+  path = g_build_filename (compositions_dir ? compositions_dir
+                                             : COMPOSITIONS_DIR,
+                           data->operation, NULL);
+
+  if (! g_file_get_contents (path, &data->xml, NULL, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_free (path);
+      return FALSE;
+    }
+
+  data->path_root = g_path_get_dirname (path);
+  g_free (path);
+
+  gegl = gegl_node_new_from_xml (data->xml, data->path_root);
+  if (! gegl)
+    return FALSE;
+
+  data->rect = gegl_node_get_bounding_box (gegl);
+  g_object_unref (gegl);
+
+  if (gegl_rectangle_is_infinite_plane (&data->rect) ||
+      data->rect.width <= 0 || data->rect.height <= 0)
+    {
+      g_printerr ("%s has no finite bounding box\n", data->operation);
+      return FALSE;
+    }
+
+  data->bytes = (gdouble) data->rect.width * data->rect.height * 16;
+
+  return TRUE;
+}
+
+static void
+run_composition (BenchData *data)
+{
+  GeglNode *gegl = gegl_node_new_from_xml (data->xml, data->path_root);
+
+  gegl_node_blit_buffer (gegl, NULL, &data->rect);
+  g_object_unref (gegl);
+}
+
+static void
+teardown (BenchData *data)
+{
+  if (data->sampler)
+    g_object_unref (data->sampler);
+  if (data->buffer)
+    g_object_unref (data->buffer);
+  if (data->buffer2)
+    g_object_unref (data->buffer2);
+  if (data->old_cache_size)
+    g_object_set (gegl_config (), "tile-cache-size", data->old_cache_size, NULL);
+
+  g_free (data->buf);
+  g_free (data->buf2);
+  g_free (data->coords);
+  g_free (data->xml);
+  g_free (data->path_root);
+}
+
+static const Bench benchmarks[] =
+{
+  { "buffer/get",                 setup_buffer,           run_buffer_get },
+  { "buffer/get-u8",              setup_buffer,           run_buffer_get_u8 },
+  { "buffer/set",                 setup_buffer,           run_buffer_set },
+  { "buffer/set-u8",              setup_buffer,           run_buffer_set_u8 },
+  { "buffer/copy",                setup_buffer,           run_buffer_copy },
+  { "iterator/read",              setup_buffer,           run_iterator_read },
+  { "iterator/readwrite",         setup_buffer,           run_iterator_readwrite },
+  { "sampler/nearest",            setup_sampler_nearest,  run_sampler },
+  { "sampler/linear",             setup_sampler_linear,   run_sampler },
+  { "sampler/cubic",              setup_sampler_cubic,    run_sampler },
+  { "sampler/nohalo",             setup_sampler_nohalo,   run_sampler },
+  { "sampler/lohalo",             setup_sampler_lohalo,   run_sampler },
+  { "cache/get-1x1",              setup_cache,            run_cache },
+  { "swap/set-get",               setup_swap,             run_swap },
+  { "babl/float-to-u8",           setup_babl_float_to_u8, run_babl },
+  { "babl/u8-to-float",           setup_babl_u8_to_float, run_babl },
+  { "babl/premultiply",           setup_babl_premultiply, run_babl },
+  { "babl/float-to-y",            setup_babl_float_to_y,  run_babl },
+
+  { "op/source",          setup_operation, run_operation, TRUE, "gegl:buffer-source",       0 },
+  { "op/point-render",    setup_operation, run_operation, TRUE, "gegl:checkerboard",        0 },
+  { "op/point-filter",    setup_operation, run_operation, TRUE, "gegl:brightness-contrast", 1 },
+  { "op/point-composer",  setup_operation, run_operation, TRUE, "svg:src-over",             2 },
+  { "op/point-composer3", setup_operation, run_operation, TRUE, "gegl:remap",               3 },
+  { "op/filter",          setup_operation, run_operation, TRUE, "gegl:distance-transform",  1 },
+  { "op/area-filter",     setup_operation, run_operation, TRUE, "gegl:gaussian-blur",       1 },
+  { "op/composer",        setup_operation, run_operation, TRUE, "gegl:map-absolute",        2 },
+  { "op/temporal",        setup_operation, run_operation, TRUE, "gegl:mblur",               1 },
+  { "op/meta",            setup_operation, run_operation, TRUE, "gegl:dropshadow",          1 },
+  { "op/sink",            setup_operation, run_operation, TRUE, "gegl:write-buffer",       -1 },
+
+  { "composition/checkerboard",        setup_composition, run_composition, TRUE, "checkerboard.xml" },
+  { "composition/clones",              setup_composition, run_composition, TRUE, "clones.xml" },
+  { "composition/color-enhance",       setup_composition, run_composition, TRUE, "color-enhance.xml" },
+  { "composition/composite-transform", setup_composition, run_composition, TRUE, "composite-transform.xml" },
+  { "composition/edge-sobel",          setup_composition, run_composition, TRUE, "edge-sobel.xml" },
+  { "composition/gamma",               setup_composition, run_composition, TRUE, "gamma.xml" },
+  { "composition/noise-simplex",       setup_composition, run_composition, TRUE, "noise-simplex.xml" },
+  { "composition/pixelize",            setup_composition, run_composition, TRUE, "pixelize.xml" },
+  { "composition/rotate",              setup_composition, run_composition, TRUE, "rotate.xml" },
+  { "composition/simple-scale",        setup_composition, run_composition, TRUE, "simple-scale.xml" },
+};
+
+/* running and reporting */
+
+static gint         warmup      = 1;
+static gint         repetitions = 5;
+static gchar       *threads_arg = NULL;
+static gchar       *filter      = NULL;
+static gchar       *format      = NULL;
+static gchar       *baseline    = NULL;
+static gdouble      tolerance   = 5.0;
+static gchar       *costs       = NULL;
+static gboolean     list        = FALSE;
+
+static const GOptionEntry entries[] =
+{
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &warmup,
+    "Untimed runs before measuring (default: 1)", "N" },
+  { "repetitions", 'r', 0, G_OPTION_ARG_INT, &repetitions,
+    "Timed runs of every benchmark (default: 5)", "N" },
+  { "threads", 't', 0, G_OPTION_ARG_STRING, &threads_arg,
+    "Comma separated thread counts to run threaded benchmarks with", "N,..." },
+  { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+    "Comma separated patterns of benchmarks to run, e.g. 'op/*'", "PATTERNS" },
+  { "format", 0, 0, G_OPTION_ARG_STRING, &format,
+    "Output format: text, tsv or json (default: text)", "FORMAT" },
+  { "compositions", 'c', 0, G_OPTION_ARG_FILENAME, &compositions_dir,
+    "Directory of the composition benchmarks", "DIR" },
+  { "baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline,
+    "Results of a previous run with --format=tsv to compare against", "FILE" },
+  { "tolerance", 0, 0, G_OPTION_ARG_DOUBLE, &tolerance,
+    "Allowed drop of throughput from the baseline in percent (default: 5)", "PERCENT" },
+  { "costs", 0, 0, G_OPTION_ARG_FILENAME, &costs,
+    "Write the per pixel costs of the operations to FILE", "FILE" },
+  { "list", 'l', 0, G_OPTION_ARG_NONE, &list,
+    "List the benchmarks and exit", NULL },
+  { NULL }
+};
+
+static gboolean
+bench_selected (const Bench  *bench,
+                gchar       **patterns)
+{
+  gint i;
+
+  if (! patterns)
+    return TRUE;
+
+  for (i = 0; patterns[i]; i++)
+    if (g_pattern_match_simple (patterns[i], bench->name))
+      return TRUE;
+
+  return FALSE;
+}
+
+static gint
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+  gdouble x = *(const gdouble *) a;
+  gdouble y = *(const gdouble *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static gint
+compare_threads (gconstpointer a,
+                 gconstpointer b)
+{
+  /* descending, so the thread pools get created at their largest size */
+  return *(const gint *) b - *(const gint *) a;
+}
+
+/* Returns FALSE when the benchmark could not be set up */
+static gboolean
+bench_run (const Bench *bench,
+           gint         threads,
+           BenchResult *result)
+{
+  BenchData  data = { 0, };
+  gdouble   *rates;
+  gdouble    sum = 0.0;
+  gdouble    sum_sq = 0.0;
+  gint       i;
+
+  data.operation = bench->operation;
+  data.n_inputs  = bench->n_inputs;
+
+  if (! bench->setup (&data))
+    {
+      teardown (&data);
+      return FALSE;
+    }
+
+  for (i = 0; i < warmup; i++)
+    bench->run (&data);
+
+  rates = g_new (gdouble, repetitions);
+
+  for (i = 0; i < repetitions; i++)
+    {
+      long ticks;
+
+      test_start ();
+      bench->run (&data);
+      ticks = MAX (babl_ticks () - ticks_start, 1);
+
+      rates[i] = (data.bytes / 1024.0 / 1024.0) / (ticks / 1000000.0);
+      sum     += rates[i];
+      sum_sq  += rates[i] * rates[i];
+    }
+
+  qsort (rates, repetitions, sizeof (gdouble), compare_doubles);
+
+  result->name    = g_strdup (bench->name);
+  result->threads = threads;
+  result->n       = repetitions;
+  result->min     = rates[0];
+  result->max     = rates[repetitions - 1];
+  result->median  = repetitions % 2 ? rates[repetitions / 2]
+                                    : (rates[repetitions / 2 - 1] +
+                                       rates[repetitions / 2]) / 2.0;
+  result->mean    = sum / repetitions;
+  result->stddev  = sqrt (MAX (sum_sq / repetitions -
+                               result->mean * result->mean, 0.0));
+  result->cost    = 0.0;
+
+  if (bench->setup == setup_operation)
+    {
+      gdouble seconds = data.bytes / 1024.0 / 1024.0 / result->median;
+
+      result->cost = seconds * 1000000000.0 * threads /
+                     ((gdouble) data.rect.width * data.rect.height);
+    }
+
+  teardown (&data);
+
+  g_free (rates);
+
+  return TRUE;
+}
+
+static void
+print_result (const BenchResult *result,
+              gboolean           first)
+{
+  if (! g_strcmp0 (format, "tsv"))
+    {
+      if (first)
+        g_print ("# name\tthreads\truns\tmedian\tmean\tstddev\tmin\tmax\n");
+      g_print ("%s\t%d\t%d\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\n",
+               result->name, result->threads, result->n,
+               result->median, result->mean, result->stddev,
+               result->min, result->max);
+    }
+  else if (! g_strcmp0 (format, "json"))
+    {
+      g_print ("%s\n    {\"name\": \"%s\", \"threads\": %d, \"runs\": %d, "
+               "\"median\": %.2f, \"mean\": %.2f, \"stddev\": %.2f, "
+               "\"min\": %.2f, \"max\": %.2f}",
+               first ? "" : ",",
+               result->name, result->threads, result->n,
+               result->median, result->mean, result->stddev,
+               result->min, result->max);
+    }
+  else
+    {
+      g_print ("@ %s (%d threads): %.2f megabytes/second "
+               "(mean %.2f, stddev %.2f, min %.2f, max %.2f)\n",
+               result->name, result->threads, result->median,
+               result->mean, result->stddev, result->min, result->max);
+    }
+}
+
+/* Returns a table of "name\tthreads" to the median throughput of the
+ * results in the tsv file at path.
+ */
+static GHashTable *
+load_baseline (const gchar *path)
+{
+  GHashTable  *table;
+  gchar       *contents;
+  gchar      **lines;
+  GError      *error = NULL;
+  gint         i;
+
+  if (! g_file_get_contents (path, &contents, NULL, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  lines = g_strsplit (contents, "\n", -1);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar **fields;
+
+      if (lines[i][0] == '#' || lines[i][0] == '\0')
+        continue;
+
+      fields = g_strsplit (lines[i], "\t", -1);
+
+      if (g_strv_length (fields) >= 4)
+        {
+          gdouble *median = g_new (gdouble, 1);
+
+          *median = g_ascii_strtod (fields[3], NULL);
+          g_hash_table_insert (table,
+                               g_strdup_printf ("%s\t%s", fields[0], fields[1]),
+                               median);
+        }
+
+      g_strfreev (fields);
+    }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return table;
+}
+
+/* Returns TRUE if result is more than tolerance percent slower than in
+ * the baseline.
+ */
+static gboolean
+check_regression (GHashTable        *baseline_table,
+                  const BenchResult *result)
+{
+  gchar   *key = g_strdup_printf ("%s\t%d", result->name, result->threads);
+  gdouble *median = g_hash_table_lookup (baseline_table, key);
+  gboolean regressed = FALSE;
+
+  g_free (key);
+
+  if (median && result->median < *median * (1.0 - tolerance / 100.0))
+    {
+      g_printerr ("regression: %s (%d threads): %.2f megabytes/second, "
+                  "baseline %.2f (%.1f%%)\n",
+                  result->name, result->threads, result->median, *median,
+                  100.0 * (result->median - *median) / *median);
+      regressed = TRUE;
+    }
+
+  return regressed;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GOptionContext  *context;
+  GError          *error          = NULL;
+  GHashTable      *baseline_table = NULL;
+  gchar          **patterns       = NULL;
+  GArray          *thread_counts;
+  gint             n_results      = 0;
+  gint             n_regressions  = 0;
+  GString         *cost_table     = g_string_new (NULL);
+  gint             t;
+  gint             i;
+
+  gegl_init (&argc, &argv);
+
+  context = g_option_context_new ("- benchmark GEGL");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 2;
+    }
+  g_option_context_free (context);
+
+  if (list)
+    {
+      for (i = 0; i < G_N_ELEMENTS (benchmarks); i++)
+        g_print ("%s\n", benchmarks[i].name);
+      return 0;
+    }
+
+  repetitions = MAX (repetitions, 1);
+  warmup      = MAX (warmup, 0);
+
+  if (filter)
+    patterns = g_strsplit (filter, ",", -1);
+
+  if (baseline && ! (baseline_table = load_baseline (baseline)))
+    return 2;
+
+  thread_counts = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  if (threads_arg)
+    {
+      gchar **counts = g_strsplit (threads_arg, ",", -1);
+
+      for (i = 0; counts[i]; i++)
+        {
+          gint count = CLAMP (atoi (counts[i]), 1, GEGL_MAX_THREADS);
+
+          g_array_append_val (thread_counts, count);
+        }
+      g_strfreev (counts);
+    }
+
+  if (thread_counts->len == 0)
+    {
+      gint count;
+
+      g_object_get (gegl_config (), "threads", &count, NULL);
+      g_array_append_val (thread_counts, count);
+    }
+
+  g_array_sort (thread_counts, compare_threads);
+
+  if (! g_strcmp0 (format, "json"))
+    g_print ("{\n  \"results\": [");
+
+  for (t = 0; t < thread_counts->len; t++)
+    {
+      gint threads = g_array_index (thread_counts, gint, t);
+
+      g_object_set (gegl_config (), "threads", threads, NULL);
+
+      for (i = 0; i < G_N_ELEMENTS (benchmarks); i++)
+        {
+          const Bench *bench = &benchmarks[i];
+          BenchResult  result;
+
+          if (! bench_selected (bench, patterns))
+            continue;
+
+          /* the others only need to run once */
+          if (! bench->threaded && t > 0)
+            continue;
+
+          if (! bench_run (bench, bench->threaded ? threads : 1, &result))
+            continue;
+
+          print_result (&result, n_results++ == 0);
+
+          if (baseline_table && check_regression (baseline_table, &result))
+            n_regressions++;
+
+          /* applied in order, the smallest thread count comes last and wins */
+          if (result.cost > 0.0)
+            g_string_append_printf (cost_table, "%s\t%.2f\n",
+                                    bench->operation, result.cost);
+
+          g_free (result.name);
+        }
+    }
+
+  if (! g_strcmp0 (format, "json"))
+    g_print ("\n  ]\n}\n");
+
+  if (costs && ! g_file_set_contents (costs, cost_table->str, -1, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_clear_error (&error);
+    }
+  g_string_free (cost_table, TRUE);
+
+  g_array_free (thread_counts, TRUE);
+  g_strfreev (patterns);
+  if (baseline_table)
+    g_hash_table_unref (baseline_table);
+
+  gegl_exit ();
+
+  return n_regressions ? 1 : 0;
+}
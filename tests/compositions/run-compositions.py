@@ -3,8 +3,12 @@ from __future__ import print_function
 
 import os
 import sys
+import time
+import hashlib
 import argparse
+import threading
 import subprocess
+import multiprocessing.pool
 
 from glob import glob
 from pprint import pprint
@@ -27,15 +31,63 @@ if ("V" in os.environ and os.environ["V"] != "0") or \
    ("VERBOSE" in os.environ and os.environ["VERBOSE"] != "0"):
   VERBOSE = True
 
+# Differences in run time below this are noise, in seconds
+MIN_TIME_DIFFERENCE = 0.05
+
+def run_timed(args, env):
+  """Runs args, returns the seconds it ran and its peak memory in bytes"""
+  start = time.time()
+  proc = subprocess.Popen(args, env=env)
+  memory = 0
+
+  if hasattr(os, "wait4"):
+    pid, status, usage = os.wait4(proc.pid, 0)
+    if os.WIFEXITED(status):
+      proc.returncode = os.WEXITSTATUS(status)
+    else:
+      proc.returncode = -os.WTERMSIG(status)
+    memory = usage.ru_maxrss
+    if sys.platform != "darwin":
+      memory *= 1024
+  else:
+    proc.wait()
+
+  seconds = time.time() - start
+
+  if proc.returncode:
+    raise subprocess.CalledProcessError(proc.returncode, args)
+
+  return seconds, memory
+
+def file_checksum(path):
+  with open(path, "rb") as f:
+    return hashlib.md5(f.read()).hexdigest()
+
+def load_timings(path):
+  """Returns a dict of test name to (seconds, memory, checksum)"""
+  timings = {}
+  with open(path) as f:
+    for line in f:
+      fields = line.rstrip("\n").split("\t")
+      if line.startswith("#") or len(fields) < 4:
+        continue
+      timings[fields[0]] = (float(fields[1]), int(fields[2]), fields[3])
+  return timings
+
 class Context():
   def __init__(self):
     self.src_dir   = os.path.realpath(os.path.join(os.path.dirname(__file__), "..", ".."))
     self.build_dir = self.src_dir
+    self.baseline  = None
+    self.tolerance = 25.0
 
   def prep(self):
     self.fail_count = 0
     self.pass_count = 0
     self.skip_count = 0
+    self.regression_count = 0
+    self.timings = {}
+    self.lock = threading.Lock()
 
     if sys.platform == "win32":
       exe_suffix = ".exe"
@@ -72,6 +124,36 @@ class Context():
     else:
       raise RuntimeError("Ambiguous reference image for %s" % test_name)
 
+  def report(self, status, result_name_str, count):
+    with self.lock:
+      print(status, result_name_str)
+      sys.stdout.flush() # Keep our ouput in sync with subprocess if redirected
+      setattr(self, count, getattr(self, count) + 1)
+
+  def check_baseline(self, timing_name, seconds, memory, checksum):
+    """Returns False if the test got slower or needs more memory than in the baseline"""
+    if not self.baseline or timing_name not in self.baseline:
+      return True
+
+    base_seconds, base_memory, base_checksum = self.baseline[timing_name]
+    factor = 1.0 + self.tolerance / 100.0
+    result = True
+
+    with self.lock:
+      if seconds > base_seconds * factor and \
+         seconds - base_seconds > MIN_TIME_DIFFERENCE:
+        print ("SLOWER", timing_name, "%.3f seconds, baseline %.3f" % (seconds, base_seconds))
+        result = False
+      if memory > base_memory * factor:
+        print ("MORE MEMORY", timing_name, "%d bytes, baseline %d" % (memory, base_memory))
+        result = False
+      if checksum != base_checksum:
+        print ("CHANGED", timing_name, "output differs from the baseline")
+      if not result:
+        self.regression_count += 1
+
+    return result
+
   def run_xml_test(self, test_xml_filename, use_opencl):
     result_name_str = "%s" % os.path.basename(test_xml_filename)
 
@@ -79,8 +161,7 @@ class Context():
       result_name_str = "%s (OpenCL)" % os.path.basename(test_xml_filename)
 
     if use_opencl and not self.opencl_available:
-      print(SKIP_STR, result_name_str)
-      self.skip_count += 1
+      self.report(SKIP_STR, result_name_str, "skip_count")
       return True
 
     test_env = os.environ.copy()
@@ -96,8 +177,7 @@ class Context():
     if test_name.endswith(".xml"):
       test_name = test_name[:-4]
     else:
-      print (FAIL_STR, "Bad test name: %s" % test_name)
-      self.fail_count += 1
+      self.report(FAIL_STR, "Bad test name: %s" % test_name, "fail_count")
       return False
 
     out_image_name = self.find_reference_image(test_name)
@@ -117,7 +197,7 @@ class Context():
     try:
       if VERBOSE:
         print(" ".join([self.gegl_bin, xml_graph_path, "-o", out_image_path]))
-      subprocess.check_call([self.gegl_bin, xml_graph_path, "-o", out_image_path], env=test_env)
+      seconds, memory = run_timed([self.gegl_bin, xml_graph_path, "-o", out_image_path], test_env)
 
       if VERBOSE:
         print(" ".join([self.img_cmp_bin, ref_image_path, out_image_path]))
@@ -127,13 +207,31 @@ class Context():
     except subprocess.CalledProcessError, e:
       if VERBOSE:
         print (e)
-      print (FAIL_STR, result_name_str)
-      self.fail_count += 1
+      self.report(FAIL_STR, result_name_str, "fail_count")
+      return False
+
+    timing_name = test_name + ("-opencl" if use_opencl else "")
+    checksum = file_checksum(out_image_path)
+    with self.lock:
+      self.timings[timing_name] = (seconds, memory, checksum)
+
+    if not self.check_baseline(timing_name, seconds, memory, checksum):
+      self.report(FAIL_STR, result_name_str, "fail_count")
       return False
-    print (PASS_STR, result_name_str)
-    self.pass_count += 1
+
+    self.report(PASS_STR, result_name_str, "pass_count")
     return True
 
+  def write_timings(self, path):
+    """Adds the timings of this run to the file at path"""
+    timings = load_timings(path) if os.path.isfile(path) else {}
+    timings.update(self.timings)
+    with open(path, "w") as f:
+      f.write("# test\tseconds\tmemory\tchecksum\n")
+      for name in sorted(timings):
+        seconds, memory, checksum = timings[name]
+        f.write("%s\t%.6f\t%d\t%s\n" % (name, seconds, memory, checksum))
+
 def main():
   parser = argparse.ArgumentParser()
   parser.add_argument("--without-opencl",
@@ -145,6 +243,18 @@ def main():
                       help="path to the top build directory")
   parser.add_argument("--src-dir",
                       help="path to the top source directory")
+  parser.add_argument("--jobs", "-j",
+                      type=int, default=multiprocessing.cpu_count(),
+                      help="number of tests run at the same time")
+  parser.add_argument("--timings",
+                      help="file to add the run time, peak memory and output "
+                           "checksum of every test to")
+  parser.add_argument("--baseline",
+                      help="file written with --timings by an earlier run, "
+                           "tests that got slower or need more memory fail")
+  parser.add_argument("--tolerance",
+                      type=float, default=25.0,
+                      help="allowed increase from the baseline in percent")
   parser.add_argument("FILES",
                       nargs="*",
                       help="the composition xml files to run")
@@ -159,6 +269,10 @@ def main():
   if args.build_dir:
     context.build_dir = os.path.realpath(args.build_dir)
 
+  if args.baseline:
+    context.baseline = load_timings(args.baseline)
+  context.tolerance = args.tolerance
+
   run_opencl_tests = not args.without_opencl
 
   tests = args.FILES
@@ -173,23 +287,29 @@ def main():
   if args.xml_dir:
     xml_dir = os.path.join(context.src_dir, "tests", "compositions")
 
-  for testfile in tests:
+  def run_test(testfile):
     if xml_dir:
       testfile = os.path.join(xml_dir, testfile)
 
     context.run_xml_test(testfile, False)
 
-    sys.stdout.flush() # Keep our ouput in sync with subprocess if redirected
-
     if run_opencl_tests:
       context.run_xml_test(testfile, True)
 
-    sys.stdout.flush() # Keep our ouput in sync with subprocess if redirected
+  pool = multiprocessing.pool.ThreadPool(max(args.jobs, 1))
+  pool.map(run_test, tests)
+  pool.close()
+  pool.join()
+
+  if args.timings:
+    context.write_timings(args.timings)
 
   print ("=== Test Results ===")
   print (" tests passed:  %d" % context.pass_count)
   print (" tests skipped: %d" % context.skip_count)
   print (" tests failed:  %d" % context.fail_count)
+  if context.baseline:
+    print (" regressions:   %d" % context.regression_count)
 
   if context.fail_count == 0:
     print ("======  %s  ======" % PASS_STR)
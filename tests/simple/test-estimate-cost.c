@@ -0,0 +1,124 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Estimates the cost of rendering a small graph with
+ * gegl_node_estimate_cost, and checks that the time and memory grow with
+ * the area rendered, and shrink with the mipmap level: rendering a
+ * rectangle at level 1 should cost about as much as rendering a quarter of
+ * it at level 0.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+typedef struct
+{
+  gdouble seconds;
+  guint64 memory;
+} Cost;
+
+static Cost
+estimate (GeglNode *node,
+          gint      size,
+          gint      level)
+{
+  Cost cost;
+
+  gegl_node_estimate_cost (node, GEGL_RECTANGLE (0, 0, size, size), level,
+                           &cost.seconds, &cost.memory, NULL);
+
+  return cost;
+}
+
+/* Checks that a costs about ratio times b, within a factor of 1.5 */
+static gint
+check_ratio (const gchar *what,
+             Cost         a,
+             Cost         b,
+             gdouble      ratio)
+{
+  gdouble seconds_ratio = a.seconds / b.seconds;
+  gdouble memory_ratio  = (gdouble) a.memory / b.memory;
+
+  if (b.seconds <= 0.0 || b.memory == 0)
+    {
+      printf ("%s: nothing estimated\n", what);
+      return FAILURE;
+    }
+
+  if (seconds_ratio < ratio / 1.5 || seconds_ratio > ratio * 1.5 ||
+      memory_ratio  < ratio / 1.5 || memory_ratio  > ratio * 1.5)
+    {
+      printf ("%s: the time ratio is %f and the memory ratio %f, "
+              "expected %f\n", what, seconds_ratio, memory_ratio, ratio);
+      return FAILURE;
+    }
+
+  return SUCCESS;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglNode *ptn, *source, *invert, *blur;
+  gint      result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  ptn    = gegl_node_new ();
+  source = gegl_node_new_child (ptn,
+                                "operation", "gegl:checkerboard",
+                                NULL);
+  invert = gegl_node_new_child (ptn,
+                                "operation", "gegl:invert-linear",
+                                NULL);
+  blur   = gegl_node_new_child (ptn,
+                                "operation", "gegl:box-blur",
+                                "radius", 2,
+                                NULL);
+
+  gegl_node_link_many (source, invert, blur, NULL);
+
+  if (check_ratio ("doubling the size",
+                   estimate (blur, 2048, 0), estimate (blur, 1024, 0), 4.0))
+    result = FAILURE;
+
+  if (check_ratio ("level 1",
+                   estimate (blur, 2048, 1), estimate (blur, 2048, 0), 0.25))
+    result = FAILURE;
+
+  if (check_ratio ("level 2",
+                   estimate (blur, 2048, 2), estimate (blur, 2048, 0), 0.0625))
+    result = FAILURE;
+
+  if (check_ratio ("level 1 and a quarter of the area",
+                   estimate (blur, 2048, 1), estimate (blur, 1024, 0), 1.0))
+    result = FAILURE;
+
+  g_object_unref (ptn);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,175 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Instantiates a graph template twice, and checks that:
+ *
+ * - both graphs render like the graph gegl_node_new_from_xml loads from
+ *   the same document
+ * - the graphs don't share the objects of their property values, changing
+ *   the color of one leaves the other alone
+ * - gegl_graph_template_rebind sets changed properties back to the values
+ *   in the document
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define ROI GEGL_RECTANGLE (0, 0, 64, 48)
+
+static const gchar *xml =
+  "<?xml version='1.0' encoding='UTF-8'?>\n"
+  "<gegl>\n"
+  "  <node operation='gegl:crop'>\n"
+  "    <params>\n"
+  "      <param name='x'>0</param>\n"
+  "      <param name='y'>0</param>\n"
+  "      <param name='width'>64</param>\n"
+  "      <param name='height'>48</param>\n"
+  "    </params>\n"
+  "  </node>\n"
+  "  <node operation='gegl:over'>\n"
+  "    <node operation='gegl:translate'>\n"
+  "      <params>\n"
+  "        <param name='x'>5</param>\n"
+  "        <param name='y'>3</param>\n"
+  "      </params>\n"
+  "    </node>\n"
+  "    <node operation='gegl:opacity'>\n"
+  "      <params>\n"
+  "        <param name='value'>0.5</param>\n"
+  "      </params>\n"
+  "    </node>\n"
+  "    <node operation='gegl:checkerboard' id='board'>\n"
+  "      <params>\n"
+  "        <param name='x'>7</param>\n"
+  "        <param name='y'>5</param>\n"
+  "        <param name='color1'>rgb(0.8, 0.2, 0.1)</param>\n"
+  "      </params>\n"
+  "    </node>\n"
+  "  </node>\n"
+  "  <node operation='gegl:invert-linear'/>\n"
+  "  <clone ref='board'/>\n"
+  "</gegl>\n";
+
+static gfloat *
+render (GeglNode *graph)
+{
+  GeglNode *output = gegl_node_get_output_proxy (graph, "output");
+  gfloat   *pixels = g_new0 (gfloat, ROI->width * ROI->height * 4);
+
+  gegl_node_blit (output, 1.0, ROI, babl_format ("RGBA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  return pixels;
+}
+
+/* Checks whether graph renders like the pixels of expected */
+static gint
+check_render (const gchar  *what,
+              GeglNode     *graph,
+              const gfloat *expected,
+              gboolean      equal)
+{
+  gfloat *pixels = render (graph);
+  gint    result = SUCCESS;
+
+  if (!memcmp (pixels, expected,
+               ROI->width * ROI->height * 4 * sizeof (gfloat)) != equal)
+    {
+      printf ("%s: the graph renders %s\n",
+              what, equal ? "differently" : "the same");
+      result = FAILURE;
+    }
+
+  g_free (pixels);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglGraphTemplate *template;
+  GeglNode          *loaded, *first, *second, *board;
+  GeglColor         *color;
+  gfloat            *expected;
+  gint               result = SUCCESS;
+
+  gegl_init (&argc, &argv);
+
+  template = gegl_graph_template_new_from_xml (xml, "");
+
+  if (!template)
+    {
+      printf ("the template could not be compiled\n");
+      gegl_exit ();
+      return FAILURE;
+    }
+
+  loaded = gegl_node_new_from_xml (xml, "");
+  first  = gegl_graph_template_instantiate (template);
+  second = gegl_graph_template_instantiate (template);
+
+  board = gegl_graph_template_get_node (template, first, "board");
+
+  if (!board ||
+      g_strcmp0 (gegl_node_get_operation (board), "gegl:checkerboard"))
+    {
+      printf ("the node with the id board was not found\n");
+      result = FAILURE;
+    }
+  else
+    {
+      /* changed in place, before anything is rendered and cached */
+      gegl_node_get (board, "color1", &color, NULL);
+      gegl_color_set_rgba (color, 0.1, 0.9, 0.3, 1.0);
+      g_object_unref (color);
+    }
+
+  expected = render (loaded);
+
+  if (check_render ("second instance", second, expected, TRUE) ||
+      check_render ("first instance, color changed", first, expected, FALSE))
+    result = FAILURE;
+
+  if (board)
+    {
+      gegl_node_set (board, "x", 11, NULL);
+      gegl_graph_template_rebind (template, first);
+
+      if (check_render ("first instance, rebound", first, expected, TRUE))
+        result = FAILURE;
+    }
+
+  g_free (expected);
+  g_object_unref (loaded);
+  g_object_unref (first);
+  g_object_unref (second);
+  gegl_graph_template_free (template);
+
+  gegl_exit ();
+
+  return result;
+}
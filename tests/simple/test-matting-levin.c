@@ -0,0 +1,178 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Solves the same small matting problem with the direct UMFPACK solver and
+ * with the conjugate gradient, and checks that the mattes agree.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+#define SKIP     77
+
+#define SIZE      48
+#define TOLERANCE 0.02
+
+static GeglBuffer *
+make_input (void)
+{
+  GeglBuffer *buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                                        babl_format ("R'G'B' float"));
+  gfloat     *pixels = g_new (gfloat, SIZE * SIZE * 3);
+  gint        x, y;
+
+  /* a soft edged disc of one colour over a gradient of another */
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        gfloat *pixel = pixels + (y * SIZE + x) * 3;
+        gfloat  d     = hypotf (x - SIZE / 2, y - SIZE / 2);
+        gfloat  a     = CLAMP ((SIZE / 4 + 2 - d) / 4.0f, 0.0f, 1.0f);
+
+        pixel[0] = a * 0.9f + (1.0f - a) * 0.1f;
+        pixel[1] = a * 0.6f + (1.0f - a) * x / (gfloat) SIZE * 0.5f;
+        pixel[2] = a * 0.2f + (1.0f - a) * 0.8f;
+      }
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("R'G'B' float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_free (pixels);
+
+  return buffer;
+}
+
+static GeglBuffer *
+make_trimap (void)
+{
+  GeglBuffer *buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                                        babl_format ("Y'A float"));
+  gfloat     *pixels = g_new0 (gfloat, SIZE * SIZE * 2);
+  gint        x, y;
+
+  /* foreground in the middle of the disc, background near the borders,
+   * unknown in between
+   */
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        gfloat *pixel = pixels + (y * SIZE + x) * 2;
+        gfloat  d     = hypotf (x - SIZE / 2, y - SIZE / 2);
+
+        if (d < SIZE / 8)
+          {
+            pixel[0] = 1.0f;
+            pixel[1] = 1.0f;
+          }
+        else if (d > SIZE / 2 - 4)
+          {
+            pixel[0] = 0.0f;
+            pixel[1] = 1.0f;
+          }
+      }
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("Y'A float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_free (pixels);
+
+  return buffer;
+}
+
+static gfloat *
+solve (GeglBuffer *input,
+       GeglBuffer *trimap,
+       gint        direct_max_pixels)
+{
+  GeglNode *ptn, *input_node, *trimap_node, *matting;
+  gfloat   *alpha = g_new (gfloat, SIZE * SIZE);
+
+  ptn = gegl_node_new ();
+
+  input_node  = gegl_node_new_child (ptn,
+                                     "operation", "gegl:buffer-source",
+                                     "buffer", input,
+                                     NULL);
+  trimap_node = gegl_node_new_child (ptn,
+                                     "operation", "gegl:buffer-source",
+                                     "buffer", trimap,
+                                     NULL);
+  matting     = gegl_node_new_child (ptn,
+                                     "operation", "gegl:matting-levin",
+                                     "levels", 0,
+                                     "direct-max-pixels", direct_max_pixels,
+                                     NULL);
+
+  gegl_node_connect_to (input_node,  "output", matting, "input");
+  gegl_node_connect_to (trimap_node, "output", matting, "aux");
+
+  gegl_node_blit (matting, 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                  babl_format ("Y' float"), alpha,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (ptn);
+
+  return alpha;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglBuffer *input, *trimap;
+  gfloat     *direct, *iterative;
+  gdouble     max_diff = 0.0;
+  gint        result   = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  /* the operation is only built when UMFPACK is available */
+  if (! gegl_has_operation ("gegl:matting-levin"))
+    {
+      gegl_exit ();
+      return SKIP;
+    }
+
+  input  = make_input ();
+  trimap = make_trimap ();
+
+  direct    = solve (input, trimap, G_MAXINT);
+  iterative = solve (input, trimap, 0);
+
+  for (i = 0; i < SIZE * SIZE; i++)
+    max_diff = MAX (max_diff, fabs (direct[i] - iterative[i]));
+
+  if (max_diff > TOLERANCE)
+    {
+      printf ("direct and iterative mattes differ by %f\n", max_diff);
+      result = FAILURE;
+    }
+
+  g_free (direct);
+  g_free (iterative);
+  g_object_unref (input);
+  g_object_unref (trimap);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,236 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Writes small npy files and loads them with gegl:npy-load, checking:
+ *
+ * - the pixels of a file mapped directly, and of one whose data is not
+ *   aligned for its type, which is copied into memory instead
+ * - that the pixels are still right when a tiny tile cache has evicted
+ *   the tile over them
+ * - that a file declaring a much larger shape than the data it holds
+ *   fails to load, instead of being allocated for
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+#define SKIP     77
+
+#define WIDTH  37
+#define HEIGHT 23
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *descr;    /* npy data type */
+  const gchar *format;   /* the babl format npy-load gives it */
+  gint         channels;
+  gint         data_offset; /* the data is mapped if it is aligned */
+} TestCase;
+
+static const TestCase test_cases[] =
+{
+  { "RGB u8",                "|u1", "RGB u8",   3, 128 },
+  { "YA u8",                 "|u1", "YA u8",    2, 131 },
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  { "Y float",               "<f4", "Y float",  1, 128 },
+  { "Y float, misaligned",   "<f4", "Y float",  1, 130 },
+  { "RGBA u16, misaligned",  "<u2", "RGBA u16", 4, 131 },
+#endif
+};
+
+/* Writes a version 1.0 npy file with the array data starting at
+ * data_offset, and size bytes of data.
+ */
+static void
+write_npy (const gchar  *path,
+           const gchar  *descr,
+           const gchar  *shape,
+           gint          data_offset,
+           const guchar *data,
+           gsize         size)
+{
+  GString *header = g_string_new (NULL);
+  gsize    header_len;
+  FILE    *fp;
+
+  g_string_printf (header,
+                   "{'descr': '%s', 'fortran_order': False, 'shape': %s, }",
+                   descr, shape);
+
+  /* pad with spaces, ending with a newline, like numpy does */
+  header_len = data_offset - 10;
+  while (header->len < header_len - 1)
+    g_string_append_c (header, ' ');
+  g_string_append_c (header, '\n');
+
+  fp = fopen (path, "wb");
+  fwrite ("\223NUMPY\001\000", 1, 8, fp);
+  fputc (header_len & 0xff, fp);
+  fputc (header_len >> 8, fp);
+  fwrite (header->str, 1, header->len, fp);
+  fwrite (data, 1, size, fp);
+  fclose (fp);
+
+  g_string_free (header, TRUE);
+}
+
+static void
+load (const gchar         *path,
+      const GeglRectangle *roi,
+      const Babl          *format,
+      guchar              *pixels,
+      GeglRectangle       *bounds)
+{
+  GeglNode *ptn, *node;
+
+  ptn  = gegl_node_new ();
+  node = gegl_node_new_child (ptn,
+                              "operation", "gegl:npy-load",
+                              "path", path,
+                              NULL);
+
+  *bounds = gegl_node_get_bounding_box (node);
+
+  gegl_node_blit (node, 1.0, roi, format, pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (ptn);
+}
+
+static gint
+test_load (const TestCase *test_case,
+           const gchar    *path)
+{
+  const Babl    *format = babl_format (test_case->format);
+  gint           bpp    = babl_format_get_bytes_per_pixel (format);
+  gsize          size   = WIDTH * HEIGHT * bpp;
+  guchar        *data   = g_malloc (size);
+  guchar        *loaded = g_malloc0 (size);
+  gchar         *shape;
+  GeglRectangle  bounds;
+  gint           result = SUCCESS;
+  gint           i;
+
+  for (i = 0; i < size; i++)
+    data[i] = i % 251;
+
+  if (test_case->channels == 1)
+    shape = g_strdup_printf ("(%d, %d)", HEIGHT, WIDTH);
+  else
+    shape = g_strdup_printf ("(%d, %d, %d)",
+                             HEIGHT, WIDTH, test_case->channels);
+
+  write_npy (path, test_case->descr, shape, test_case->data_offset,
+             data, size);
+
+  load (path, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT), format, loaded, &bounds);
+
+  if (! gegl_rectangle_equal (&bounds, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT)))
+    {
+      printf ("%s: the loaded image has the wrong size\n", test_case->name);
+      result = FAILURE;
+    }
+  else if (memcmp (data, loaded, size))
+    {
+      printf ("%s: the loaded pixels differ\n", test_case->name);
+      result = FAILURE;
+    }
+
+  g_free (shape);
+  g_free (data);
+  g_free (loaded);
+  g_unlink (path);
+
+  return result;
+}
+
+static gint
+test_truncated (const gchar *path)
+{
+  guchar        data[16]   = { 0, };
+  guchar        loaded[16];
+  GeglRectangle bounds;
+  gint          i;
+
+  memset (loaded, 0xff, sizeof (loaded));
+
+  /* 100000 x 100000 pixels declared, 16 bytes present */
+  write_npy (path, "|u1", "(100000, 100000)", 128, data, sizeof (data));
+
+  load (path, GEGL_RECTANGLE (0, 0, 4, 4), babl_format ("Y u8"), loaded,
+        &bounds);
+
+  g_unlink (path);
+
+  /* nothing is loaded, so the blit is left empty */
+  for (i = 0; i < sizeof (loaded); i++)
+    if (loaded[i])
+      {
+        printf ("truncated file: the blit is not empty\n");
+        return FAILURE;
+      }
+
+  return SUCCESS;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gchar *path;
+  gint   result = SUCCESS;
+  gint   i;
+
+  gegl_init (&argc, &argv);
+
+  if (! gegl_has_operation ("gegl:npy-load"))
+    {
+      gegl_exit ();
+      return SKIP;
+    }
+
+  path = g_build_filename (g_get_tmp_dir (), "test-npy-load.npy", NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (test_cases); i++)
+    if (test_load (&test_cases[i], path) != SUCCESS)
+      result = FAILURE;
+
+  /* a cache too small to hold any tile evicts each one as it is inserted */
+  g_object_set (gegl_config (), "tile-cache-size", (guint64) 1, NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (test_cases); i++)
+    if (test_load (&test_cases[i], path) != SUCCESS)
+      result = FAILURE;
+
+  if (test_truncated (path) != SUCCESS)
+    result = FAILURE;
+
+  g_free (path);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,211 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Checks gegl_list_operations_in_category against the categories keys of
+ * every operation listed by gegl_list_operations. The test runs itself
+ * twice with a new module cache: the first run loads every module and
+ * writes the cache, the second one lists the operations of the modules
+ * the cache describes before they are loaded, reading their categories
+ * loads them.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+static gint
+name_compare (gconstpointer a,
+              gconstpointer b)
+{
+  return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* category -> the names of its operations, from their categories keys */
+static GHashTable *
+scan_categories (void)
+{
+  GHashTable  *categories = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free,
+                                                   (GDestroyNotify) g_ptr_array_unref);
+  gchar      **operations;
+  guint        n_operations;
+  gint         i, j;
+
+  operations = gegl_list_operations (&n_operations);
+
+  for (i = 0; i < n_operations; i++)
+    {
+      const gchar  *key = gegl_operation_get_key (operations[i], "categories");
+      gchar       **names;
+
+      if (!key)
+        continue;
+
+      names = g_strsplit (key, ":", 0);
+
+      for (j = 0; names[j]; j++)
+        {
+          GPtrArray *category;
+
+          if (!names[j][0])
+            continue;
+
+          category = g_hash_table_lookup (categories, names[j]);
+          if (!category)
+            {
+              category = g_ptr_array_new_with_free_func (g_free);
+              g_hash_table_insert (categories, g_strdup (names[j]), category);
+            }
+
+          g_ptr_array_add (category, g_strdup (operations[i]));
+        }
+
+      g_strfreev (names);
+    }
+
+  g_free (operations);
+
+  return categories;
+}
+
+static gint
+test_categories (void)
+{
+  GHashTable     *categories = scan_categories ();
+  GHashTableIter  iter;
+  const gchar    *name;
+  GPtrArray      *expected;
+  gchar         **listed;
+  guint           n_listed;
+  gint            result = SUCCESS;
+  gint            i;
+
+  if (!g_hash_table_size (categories))
+    {
+      printf ("no operation has categories\n");
+      result = FAILURE;
+    }
+
+  g_hash_table_iter_init (&iter, categories);
+
+  while (g_hash_table_iter_next (&iter, (gpointer) &name, (gpointer) &expected))
+    {
+      g_ptr_array_sort (expected, name_compare);
+
+      listed = gegl_list_operations_in_category (name, &n_listed);
+
+      if (n_listed != expected->len)
+        {
+          printf ("%s: %u operations listed, %u expected\n",
+                  name, n_listed, expected->len);
+          result = FAILURE;
+        }
+      else
+        {
+          for (i = 0; i < n_listed; i++)
+            if (strcmp (listed[i], g_ptr_array_index (expected, i)))
+              {
+                printf ("%s: %s listed, %s expected\n", name, listed[i],
+                        (gchar *) g_ptr_array_index (expected, i));
+                result = FAILURE;
+                break;
+              }
+        }
+
+      g_free (listed);
+    }
+
+  listed = gegl_list_operations_in_category ("no-such-category", &n_listed);
+
+  if (listed || n_listed)
+    {
+      printf ("operations listed in a category that does not exist\n");
+      result = FAILURE;
+    }
+
+  g_free (listed);
+  g_hash_table_destroy (categories);
+
+  return result;
+}
+
+static gint
+run_self (const gchar *program,
+          const gchar *what)
+{
+  gchar  *argv[] = { (gchar *) program, NULL };
+  GError *error  = NULL;
+  gint    status;
+
+  if (!g_spawn_sync (NULL, argv, NULL, 0, NULL, NULL, NULL, NULL,
+                     &status, &error))
+    {
+      printf ("%s: %s\n", what, error->message);
+      g_error_free (error);
+      return FAILURE;
+    }
+
+  if (!g_spawn_check_exit_status (status, NULL))
+    {
+      printf ("%s: failed\n", what);
+      return FAILURE;
+    }
+
+  return SUCCESS;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint result = SUCCESS;
+
+  if (!g_getenv ("GEGL_MODULE_CACHE"))
+    {
+      gchar *cache = g_build_filename (g_get_tmp_dir (),
+                                       "test-operation-categories.cache",
+                                       NULL);
+
+      g_unlink (cache);
+      g_setenv ("GEGL_MODULE_CACHE", cache, TRUE);
+
+      if (run_self (argv[0], "without a module cache") != SUCCESS ||
+          run_self (argv[0], "with a module cache") != SUCCESS)
+        result = FAILURE;
+
+      g_unlink (cache);
+      g_free (cache);
+
+      return result;
+    }
+
+  gegl_init (&argc, &argv);
+
+  result = test_categories ();
+
+  gegl_exit ();
+
+  return result;
+}
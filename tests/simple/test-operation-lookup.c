@@ -0,0 +1,158 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Registers operation types one at a time, each replacing the index of
+ * the operations, while other threads keep looking up operations and
+ * listing them. Every lookup has to find the operations registered
+ * before it started, and the replaced indices are freed meanwhile.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+#include "operation/gegl-operation-filter.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define N_THREADS 4
+#define N_TYPES   200
+
+static gint registered = 0; /* the number of test types found by name */
+static gint stop       = FALSE;
+static gint failures   = 0;
+
+static void
+test_op_class_init (gpointer klass,
+                    gpointer class_data)
+{
+  gchar *name = g_strdup_printf ("test:lookup-%d", GPOINTER_TO_INT (class_data));
+
+  gegl_operation_class_set_keys (GEGL_OPERATION_CLASS (klass),
+                                 "name",       name,
+                                 "categories", "hidden",
+                                 NULL);
+  g_free (name);
+}
+
+static void
+register_type (gint i)
+{
+  GTypeInfo  info = { 0, };
+  gchar     *type_name = g_strdup_printf ("TestLookupOp%d", i);
+
+  info.class_size    = sizeof (GeglOperationFilterClass);
+  info.class_init    = test_op_class_init;
+  info.class_data    = GINT_TO_POINTER (i);
+  info.instance_size = sizeof (GeglOperationFilter);
+
+  g_type_register_static (GEGL_TYPE_OPERATION_FILTER, type_name, &info, 0);
+  g_free (type_name);
+}
+
+static gpointer
+lookup_thread (gpointer data)
+{
+  while (!g_atomic_int_get (&stop))
+    {
+      gint    n_registered = g_atomic_int_get (&registered);
+      gchar **operations;
+      guint   n_operations;
+      gchar  *name;
+
+      if (!gegl_has_operation ("gegl:nop"))
+        {
+          printf ("gegl:nop was not found\n");
+          g_atomic_int_inc (&failures);
+        }
+
+      if (n_registered)
+        {
+          name = g_strdup_printf ("test:lookup-%d",
+                                  g_random_int_range (0, n_registered));
+
+          if (!gegl_has_operation (name))
+            {
+              printf ("%s was not found\n", name);
+              g_atomic_int_inc (&failures);
+            }
+
+          g_free (name);
+        }
+
+      operations = gegl_list_operations (&n_operations);
+
+      if (n_operations < n_registered)
+        {
+          printf ("%u operations listed, %d registered\n",
+                  n_operations, n_registered);
+          g_atomic_int_inc (&failures);
+        }
+
+      g_free (operations);
+    }
+
+  return NULL;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GThread *threads[N_THREADS];
+  gint     result = SUCCESS;
+  gint     i;
+
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < N_THREADS; i++)
+    threads[i] = g_thread_new ("lookup", lookup_thread, NULL);
+
+  for (i = 0; i < N_TYPES; i++)
+    {
+      gchar *name = g_strdup_printf ("test:lookup-%d", i);
+
+      register_type (i);
+
+      if (!gegl_has_operation (name))
+        {
+          printf ("%s was not found after registering it\n", name);
+          result = FAILURE;
+        }
+      else
+        {
+          g_atomic_int_inc (&registered);
+        }
+
+      g_free (name);
+    }
+
+  g_atomic_int_set (&stop, TRUE);
+
+  for (i = 0; i < N_THREADS; i++)
+    g_thread_join (threads[i]);
+
+  if (g_atomic_int_get (&failures))
+    result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,211 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Feeds numbered frames to a temporal operation with a few history
+ * lengths, and checks the regions gegl_operation_temporal_get_frame_region
+ * reads back: the most recent frames, clamped to the oldest one kept, also
+ * after the history length changed.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include "gegl.h"
+#include "operation/gegl-operation-temporal.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     32
+#define N_FRAMES 10
+
+typedef GeglOperationTemporal      TestTemporal;
+typedef GeglOperationTemporalClass TestTemporalClass;
+
+G_DEFINE_TYPE (TestTemporal, test_temporal, GEGL_TYPE_OPERATION_TEMPORAL)
+
+static gboolean
+test_temporal_process (GeglOperation       *operation,
+                       GeglBuffer          *input,
+                       GeglBuffer          *output,
+                       const GeglRectangle *roi,
+                       gint                 level)
+{
+  return TRUE;
+}
+
+static void
+test_temporal_class_init (TestTemporalClass *klass)
+{
+  klass->process = test_temporal_process;
+}
+
+static void
+test_temporal_init (TestTemporal *self)
+{
+}
+
+static guchar
+pixel_value (gint frame,
+             gint x,
+             gint y)
+{
+  return frame * 20 + (x + 3 * y) % 11;
+}
+
+/* Stores frame number frame in the history of operation */
+static void
+push_frame (GeglOperation *operation,
+            gint           frame)
+{
+  const GeglRectangle *rect   = GEGL_RECTANGLE (0, 0, SIZE, SIZE);
+  GeglBuffer          *input  = gegl_buffer_new (rect, babl_format ("Y u8"));
+  GeglBuffer          *output = gegl_buffer_new (rect, babl_format ("Y u8"));
+  guchar               pixels[SIZE * SIZE];
+  gint                 x, y;
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      pixels[y * SIZE + x] = pixel_value (frame, x, y);
+
+  gegl_buffer_set (input, rect, 0, babl_format ("Y u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  GEGL_OPERATION_FILTER_GET_CLASS (operation)->process (operation,
+                                                         input, output,
+                                                         rect, 0);
+
+  g_object_unref (input);
+  g_object_unref (output);
+}
+
+/* Checks that frame of the history of operation reads as frame number
+ * expected, or as zeros for -1.
+ */
+static gint
+check_frame (GeglOperation *operation,
+             gint           frame,
+             gint           expected)
+{
+  const GeglRectangle *roi = GEGL_RECTANGLE (5, 3, 17, 11);
+  guchar               pixels[17 * 11];
+  gint                 x, y;
+
+  gegl_operation_temporal_get_frame_region (operation, frame, roi,
+                                            babl_format ("Y u8"), pixels,
+                                            GEGL_AUTO_ROWSTRIDE);
+
+  for (y = 0; y < roi->height; y++)
+    for (x = 0; x < roi->width; x++)
+      {
+        guchar value = expected < 0 ? 0 :
+                       pixel_value (expected, roi->x + x, roi->y + y);
+
+        if (pixels[y * roi->width + x] != value)
+          {
+            printf ("frame %d reads as %d at %d,%d, expected %d\n",
+                    frame, pixels[y * roi->width + x],
+                    roi->x + x, roi->y + y, value);
+            return FAILURE;
+          }
+      }
+
+  return SUCCESS;
+}
+
+static gint
+test_history_length (gint history_length)
+{
+  GeglOperation *operation = g_object_new (test_temporal_get_type (), NULL);
+  gint           result    = SUCCESS;
+  gint           pushed, frame;
+
+  gegl_operation_temporal_set_history_length (operation, history_length);
+
+  if (check_frame (operation, 0, -1) != SUCCESS)
+    result = FAILURE;
+
+  for (pushed = 0; pushed < N_FRAMES && result == SUCCESS; pushed++)
+    {
+      gint oldest;
+
+      push_frame (operation, pushed);
+      oldest = MAX (0, pushed + 1 - history_length);
+
+      for (frame = 0; frame >= -history_length - 2; frame--)
+        if (check_frame (operation, frame, MAX (pushed + frame, oldest)) != SUCCESS)
+          {
+            printf ("history length %d, %d frames stored\n",
+                    history_length, pushed + 1);
+            result = FAILURE;
+            break;
+          }
+    }
+
+  /* shrinking the history keeps the most recent frames, growing it
+   * keeps them all
+   */
+  if (result == SUCCESS && history_length > 2)
+    {
+      gint last = N_FRAMES - 1;
+
+      gegl_operation_temporal_set_history_length (operation, 2);
+      gegl_operation_temporal_set_history_length (operation, history_length);
+
+      for (frame = 0; frame >= -history_length; frame--)
+        if (check_frame (operation, frame, MAX (last + frame, last - 1)) != SUCCESS)
+          {
+            printf ("history length %d, after resizing\n", history_length);
+            result = FAILURE;
+            break;
+          }
+
+      push_frame (operation, N_FRAMES);
+
+      if (check_frame (operation, -2, last - 1) != SUCCESS ||
+          check_frame (operation, -3, last - 1) != SUCCESS)
+        {
+          printf ("history length %d, after resizing and storing\n",
+                  history_length);
+          result = FAILURE;
+        }
+    }
+
+  g_object_unref (operation);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint history_lengths[] = { 1, 2, 3, 8, 20 };
+  gint result = SUCCESS;
+  gint i;
+
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (history_lengths); i++)
+    if (test_history_length (history_lengths[i]) != SUCCESS)
+      result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Saves images with gegl:png-save, with one thread (libpng writes the
+ * image data) and with several (the strips are deflated in parallel and
+ * written as separate IDAT chunks), loads them back with gegl:png-load and
+ * checks that the pixels survive unchanged.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+#define SKIP     77
+
+/* not a multiple of the strip height, so that the last strip is partial */
+#define WIDTH  173
+#define HEIGHT 301
+
+typedef struct
+{
+  const gchar *format;
+  gint         bitdepth;
+  gint         compression;
+} TestCase;
+
+static const TestCase test_cases[] =
+{
+  { "R'G'B'A u8",  8, 3 },
+  { "R'G'B' u16", 16, 3 },
+  { "Y' u8",       8, 9 },
+  { "Y'A u16",    16, 0 },
+};
+
+static GeglBuffer *
+make_buffer (const Babl *format)
+{
+  GeglBuffer *buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                                        format);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  guchar     *pixels = g_malloc (WIDTH * HEIGHT * bpp);
+  GRand      *rand   = g_rand_new_with_seed (1);
+  gint        x, y, i;
+
+  /* smooth areas, which the row filters compress well, and noise */
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      for (i = 0; i < bpp; i++)
+        pixels[(y * WIDTH + x) * bpp + i] = x < WIDTH / 2 ? x + y * i :
+                                            g_rand_int_range (rand, 0, 256);
+
+  gegl_buffer_set (buffer, NULL, 0, format, pixels, GEGL_AUTO_ROWSTRIDE);
+
+  g_rand_free (rand);
+  g_free (pixels);
+
+  return buffer;
+}
+
+static gint
+test_save (const TestCase *test_case,
+           gint            threads,
+           const gchar    *path)
+{
+  const Babl    *format   = babl_format (test_case->format);
+  gint           bpp      = babl_format_get_bytes_per_pixel (format);
+  GeglBuffer    *buffer   = make_buffer (format);
+  guchar        *expected = g_malloc (WIDTH * HEIGHT * bpp);
+  guchar        *loaded   = g_malloc0 (WIDTH * HEIGHT * bpp);
+  GeglNode      *ptn, *source, *save, *load;
+  GeglRectangle  bounds;
+  gint           result   = SUCCESS;
+
+  g_object_set (gegl_config (), "threads", threads, NULL);
+
+  ptn    = gegl_node_new ();
+  source = gegl_node_new_child (ptn,
+                                "operation", "gegl:buffer-source",
+                                "buffer", buffer,
+                                NULL);
+  save   = gegl_node_new_child (ptn,
+                                "operation", "gegl:png-save",
+                                "path", path,
+                                "bitdepth", test_case->bitdepth,
+                                "compression", test_case->compression,
+                                NULL);
+
+  gegl_node_link (source, save);
+  gegl_node_process (save);
+
+  g_object_unref (ptn);
+
+  ptn  = gegl_node_new ();
+  load = gegl_node_new_child (ptn,
+                              "operation", "gegl:png-load",
+                              "path", path,
+                              NULL);
+  bounds = gegl_node_get_bounding_box (load);
+
+  if (! gegl_rectangle_equal (&bounds, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT)))
+    {
+      printf ("%s, %d threads: the loaded image has the wrong size\n",
+              test_case->format, threads);
+      result = FAILURE;
+    }
+  else
+    {
+      gegl_buffer_get (buffer, NULL, 1.0, format, expected,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_node_blit (load, 1.0, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                      format, loaded,
+                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+      if (memcmp (expected, loaded, WIDTH * HEIGHT * bpp))
+        {
+          printf ("%s, %d threads: the loaded pixels differ\n",
+                  test_case->format, threads);
+          result = FAILURE;
+        }
+    }
+
+  g_object_unref (ptn);
+  g_object_unref (buffer);
+  g_free (expected);
+  g_free (loaded);
+  g_unlink (path);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint   threads[] = { 1, 4 };
+  gchar *path;
+  gint   result = SUCCESS;
+  gint   i, j;
+
+  gegl_init (&argc, &argv);
+
+  if (! gegl_has_operation ("gegl:png-save") ||
+      ! gegl_has_operation ("gegl:png-load"))
+    {
+      gegl_exit ();
+      return SKIP;
+    }
+
+  path = g_build_filename (g_get_tmp_dir (), "test-png-save.png", NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (test_cases); i++)
+    for (j = 0; j < G_N_ELEMENTS (threads); j++)
+      if (test_save (&test_cases[i], threads[j], path) != SUCCESS)
+        result = FAILURE;
+
+  g_free (path);
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,185 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Fills a buffer many times larger than the tile cache, reads it back,
+ * and checks the tile cache properties of GeglStats: the cache stays
+ * within its size, tiles were evicted to make room, tiles evicted before
+ * miss the cache when they are read again, and a tile read again while it
+ * is cached hits it.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define CACHED_TILES 4
+#define TILES_X      8
+#define TILES_Y      8
+
+typedef struct
+{
+  guint64 total;
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+  gint    buffers;
+} CacheStats;
+
+static CacheStats
+get_stats (void)
+{
+  CacheStats stats;
+
+  g_object_get (gegl_stats (),
+                "tile-cache-total",     &stats.total,
+                "tile-cache-hits",      &stats.hits,
+                "tile-cache-misses",    &stats.misses,
+                "tile-cache-evictions", &stats.evictions,
+                "buffers",              &stats.buffers,
+                NULL);
+
+  return stats;
+}
+
+/* Reads a pixel of tile x, y of buffer */
+static void
+read_tile (GeglBuffer *buffer,
+           gint        tile_width,
+           gint        tile_height,
+           gint        x,
+           gint        y)
+{
+  gfloat pixel[4];
+
+  gegl_buffer_get (buffer,
+                   GEGL_RECTANGLE (x * tile_width, y * tile_height, 1, 1),
+                   1.0, babl_format ("RGBA float"), pixel,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GeglBuffer *buffer;
+  GeglColor  *color;
+  CacheStats  before, filled, read, reread;
+  guint64     cache_size;
+  gint        tile_width, tile_height;
+  gint        result = SUCCESS;
+  gfloat     *pixels;
+
+  gegl_init (&argc, &argv);
+
+  g_object_get (gegl_config (),
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  cache_size = (guint64) CACHED_TILES * tile_width * tile_height *
+               babl_format_get_bytes_per_pixel (babl_format ("RGBA float"));
+  g_object_set (gegl_config (), "tile-cache-size", cache_size, NULL);
+
+  before = get_stats ();
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                            TILES_X * tile_width,
+                                            TILES_Y * tile_height),
+                            babl_format ("RGBA float"));
+  color  = gegl_color_new ("rgb(0.2, 0.4, 0.6)");
+
+  gegl_buffer_set_color (buffer, NULL, color);
+
+  filled = get_stats ();
+
+  if (filled.buffers != before.buffers + 1)
+    {
+      printf ("%d buffers alive, expected %d\n",
+              filled.buffers, before.buffers + 1);
+      result = FAILURE;
+    }
+
+  if (filled.total > cache_size)
+    {
+      printf ("the cache holds %" G_GUINT64_FORMAT " bytes, more than its "
+              "size of %" G_GUINT64_FORMAT "\n", filled.total, cache_size);
+      result = FAILURE;
+    }
+
+  if (filled.evictions < before.evictions +
+                         TILES_X * TILES_Y - CACHED_TILES)
+    {
+      printf ("%" G_GUINT64_FORMAT " tiles evicted filling the buffer\n",
+              filled.evictions - before.evictions);
+      result = FAILURE;
+    }
+
+  /* the first tiles were evicted long ago */
+  pixels = g_new (gfloat, TILES_X * tile_width * TILES_Y * tile_height * 4);
+  gegl_buffer_get (buffer, NULL, 1.0, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  g_free (pixels);
+
+  read = get_stats ();
+
+  if (read.misses <= filled.misses)
+    {
+      printf ("reading the evicted tiles back did not miss the cache\n");
+      result = FAILURE;
+    }
+
+  /* the first tile misses again, then it is still cached when it is
+   * fetched after the second one
+   */
+  read_tile (buffer, tile_width, tile_height, 0, 0);
+  read_tile (buffer, tile_width, tile_height, 1, 0);
+  read_tile (buffer, tile_width, tile_height, 0, 0);
+
+  reread = get_stats ();
+
+  if (reread.hits <= read.hits)
+    {
+      printf ("reading a cached tile again did not hit the cache\n");
+      result = FAILURE;
+    }
+
+  if (reread.total > cache_size)
+    {
+      printf ("the cache holds %" G_GUINT64_FORMAT " bytes after reading, "
+              "more than its size of %" G_GUINT64_FORMAT "\n",
+              reread.total, cache_size);
+      result = FAILURE;
+    }
+
+  g_object_unref (color);
+  g_object_unref (buffer);
+
+  if (get_stats ().buffers != before.buffers)
+    {
+      printf ("the buffer is still counted after it was freed\n");
+      result = FAILURE;
+    }
+
+  gegl_exit ();
+
+  return result;
+}
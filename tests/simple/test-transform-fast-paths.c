@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Compares the fast paths of the transform operations (buffer shifting,
+ * orthogonal copies and separable scaling with the default filter) with
+ * the generic sampler path.
+ * The generic path is forced by adding a shear far too small to move any
+ * pixel noticeably, but large enough for the matrix not to be recognized
+ * as axis aligned.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE      64
+#define SHEAR     0.00001
+#define TOLERANCE 0.001
+
+typedef struct
+{
+  const gchar     *name;
+  gdouble          coeff[6]; /* a b c d e f, as in matrix(a,b,c,d,e,f) */
+  GeglSamplerType  sampler;
+  GeglRectangle    roi;      /* compared area, away from the edges */
+} TestCase;
+
+static const TestCase test_cases[] =
+{
+  { "integer translate",  {  1.0, 0.0,  0.0, 1.0,  3.0, 5.0 },
+    GEGL_SAMPLER_LINEAR,  { 8, 8, 48, 48 } },
+  { "subpixel translate", {  1.0, 0.0,  0.0, 1.0,  3.3, 5.6 },
+    GEGL_SAMPLER_LINEAR,  { 8, 8, 48, 48 } },
+  { "rotate 90 linear",   {  0.0, 1.0, -1.0, 0.0, 64.0, 0.0 },
+    GEGL_SAMPLER_LINEAR,  { 8, 8, 48, 48 } },
+  { "rotate 90 nearest",  {  0.0, 1.0, -1.0, 0.0, 64.0, 0.0 },
+    GEGL_SAMPLER_NEAREST, { 8, 8, 48, 48 } },
+  { "flip",               { -1.0, 0.0,  0.0, 1.0, 64.0, 0.0 },
+    GEGL_SAMPLER_LINEAR,  { 8, 8, 48, 48 } },
+  { "scale 2 linear",     {  2.0, 0.0,  0.0, 2.0,  0.0, 0.0 },
+    GEGL_SAMPLER_LINEAR,  { 8, 8, 112, 112 } },
+  { "scale 2 nearest",    {  2.0, 0.0,  0.0, 2.0,  0.0, 0.0 },
+    GEGL_SAMPLER_NEAREST, { 8, 8, 112, 112 } },
+  { "scale 1.5 x 3",      {  1.5, 0.0,  0.0, 3.0,  0.0, 0.0 },
+    GEGL_SAMPLER_LINEAR,  { 8, 8, 80, 176 } },
+  { "scale 0.5 linear",   {  0.5, 0.0,  0.0, 0.5,  0.0, 0.0 },
+    GEGL_SAMPLER_LINEAR,  { 4, 4, 24, 24 } },
+  { "scale 1/3 linear",   {  1.0 / 3.0, 0.0,  0.0, 1.0 / 3.0,  0.0, 0.0 },
+    GEGL_SAMPLER_LINEAR,  { 2, 2, 16, 16 } },
+  { "scale 1/3 nearest",  {  1.0 / 3.0, 0.0,  0.0, 1.0 / 3.0,  0.0, 0.0 },
+    GEGL_SAMPLER_NEAREST, { 2, 2, 16, 16 } },
+};
+
+static gchar *
+matrix_string (const gdouble *coeff,
+               gdouble        shear)
+{
+  return g_strdup_printf ("matrix(%.8f,%.8f,0,%.8f,%.8f,0,%.8f,%.8f,1)",
+                          coeff[0], coeff[1] + shear,
+                          coeff[2], coeff[3],
+                          coeff[4], coeff[5]);
+}
+
+static gfloat *
+render (const TestCase *test_case,
+        gdouble         shear)
+{
+  GeglNode  *ptn, *gradient, *checkerboard, *over, *crop, *transform;
+  GeglColor *transparent = gegl_color_new ("none");
+  gchar     *matrix      = matrix_string (test_case->coeff, shear);
+  gfloat    *pixels      = g_new (gfloat, test_case->roi.width *
+                                          test_case->roi.height * 4);
+
+  ptn = gegl_node_new ();
+
+  /* a pattern with both hard edges and smooth gradients */
+  gradient     = gegl_node_new_child (ptn,
+                                      "operation", "gegl:linear-gradient",
+                                      "start-x", 0.0,
+                                      "start-y", 0.0,
+                                      "end-x",   (gdouble) SIZE,
+                                      "end-y",   (gdouble) SIZE / 2,
+                                      NULL);
+  checkerboard = gegl_node_new_child (ptn,
+                                      "operation", "gegl:checkerboard",
+                                      "x",      7,
+                                      "y",      5,
+                                      "color2", transparent,
+                                      NULL);
+  over         = gegl_node_new_child (ptn,
+                                      "operation", "gegl:over",
+                                      NULL);
+  crop         = gegl_node_new_child (ptn,
+                                      "operation", "gegl:crop",
+                                      "width",  (gdouble) SIZE,
+                                      "height", (gdouble) SIZE,
+                                      NULL);
+  transform    = gegl_node_new_child (ptn,
+                                      "operation", "gegl:transform",
+                                      "transform", matrix,
+                                      "sampler",   test_case->sampler,
+                                      NULL);
+
+  gegl_node_link_many (gradient, over, crop, transform, NULL);
+  gegl_node_connect_to (checkerboard, "output", over, "aux");
+
+  gegl_node_blit (transform, 1.0, &test_case->roi,
+                  babl_format ("RaGaBaA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (ptn);
+  g_object_unref (transparent);
+  g_free (matrix);
+
+  return pixels;
+}
+
+static gint
+test_transform (const TestCase *test_case)
+{
+  gfloat  *fast    = render (test_case, 0.0);
+  gfloat  *generic = render (test_case, SHEAR);
+  gdouble  max_diff = 0.0;
+  gint     n        = test_case->roi.width * test_case->roi.height * 4;
+  gint     i;
+
+  for (i = 0; i < n; i++)
+    max_diff = MAX (max_diff, fabs (fast[i] - generic[i]));
+
+  g_free (fast);
+  g_free (generic);
+
+  if (max_diff > TOLERANCE)
+    {
+      printf ("%s: fast and generic paths differ by %f\n",
+              test_case->name, max_diff);
+      return FAILURE;
+    }
+
+  return SUCCESS;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint result = SUCCESS;
+  gint i;
+
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (test_cases); i++)
+    if (test_transform (&test_cases[i]) != SUCCESS)
+      result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}
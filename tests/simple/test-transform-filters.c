@@ -0,0 +1,175 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* Scales with each value of the "filter" property of the transform
+ * operations, and checks that:
+ *
+ * - every filter keeps a flat color flat, when upscaling and downscaling
+ * - "auto" is not widened when downscaling, like the linear sampler, so a
+ *   one pixel checkerboard downscaled by 3 keeps its full contrast
+ * - the other filters are widened when downscaling, so the checkerboard
+ *   is mostly averaged away
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE 96
+#define ROI  GEGL_RECTANGLE (4, 4, 16, 16)
+
+static gfloat *
+render (gboolean checkerboard,
+        gint     filter,
+        gdouble  scale)
+{
+  GeglNode  *ptn, *source, *crop, *scale_node;
+  GeglColor *gray   = gegl_color_new ("rgb(0.3, 0.3, 0.3)");
+  gfloat    *pixels = g_new (gfloat, ROI->width * ROI->height * 4);
+
+  ptn = gegl_node_new ();
+
+  if (checkerboard)
+    source   = gegl_node_new_child (ptn,
+                                    "operation", "gegl:checkerboard",
+                                    "x", 1,
+                                    "y", 1,
+                                    NULL);
+  else
+    source   = gegl_node_new_child (ptn,
+                                    "operation", "gegl:color",
+                                    "value", gray,
+                                    NULL);
+  crop       = gegl_node_new_child (ptn,
+                                    "operation", "gegl:crop",
+                                    "width",  (gdouble) SIZE,
+                                    "height", (gdouble) SIZE,
+                                    NULL);
+  scale_node = gegl_node_new_child (ptn,
+                                    "operation", "gegl:scale-ratio",
+                                    "x",       scale,
+                                    "y",       scale,
+                                    "sampler", GEGL_SAMPLER_LINEAR,
+                                    "filter",  filter,
+                                    NULL);
+
+  gegl_node_link_many (source, crop, scale_node, NULL);
+
+  gegl_node_blit (scale_node, 1.0, ROI,
+                  babl_format ("RGBA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (ptn);
+  g_object_unref (gray);
+
+  return pixels;
+}
+
+/* The range of the red channel over the compared area */
+static gdouble
+get_range (const gfloat *pixels)
+{
+  gdouble min = G_MAXDOUBLE;
+  gdouble max = -G_MAXDOUBLE;
+  gint    i;
+
+  for (i = 0; i < ROI->width * ROI->height; i++)
+    {
+      min = MIN (min, pixels[i * 4]);
+      max = MAX (max, pixels[i * 4]);
+    }
+
+  return max - min;
+}
+
+static gint
+test_filter (GEnumValue *filter)
+{
+  gdouble  scales[] = { 2.5, 1.0 / 3.0 };
+  gfloat  *pixels;
+  gdouble  range;
+  gint     result = SUCCESS;
+  gint     i;
+
+  for (i = 0; i < G_N_ELEMENTS (scales); i++)
+    {
+      pixels = render (FALSE, filter->value, scales[i]);
+      range  = get_range (pixels);
+
+      if (range > 0.0001 || fabs (pixels[0] - 0.3) > 0.0001)
+        {
+          printf ("%s: scaling a flat color by %f is not flat\n",
+                  filter->value_nick, scales[i]);
+          result = FAILURE;
+        }
+
+      g_free (pixels);
+    }
+
+  /* every output pixel center falls on an input pixel center */
+  pixels = render (TRUE, filter->value, 1.0 / 3.0);
+  range  = get_range (pixels);
+
+  if (! strcmp (filter->value_nick, "auto") ? range < 0.999 : range > 0.7)
+    {
+      printf ("%s: a downscaled checkerboard has a range of %f\n",
+              filter->value_nick, range);
+      result = FAILURE;
+    }
+
+  g_free (pixels);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GParamSpec *pspec;
+  GEnumClass *filters;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  pspec = gegl_operation_find_property ("gegl:scale-ratio", "filter");
+
+  if (! G_IS_PARAM_SPEC_ENUM (pspec))
+    {
+      printf ("gegl:scale-ratio has no filter property\n");
+      gegl_exit ();
+      return FAILURE;
+    }
+
+  filters = G_PARAM_SPEC_ENUM (pspec)->enum_class;
+
+  for (i = 0; i < filters->n_values; i++)
+    if (test_filter (&filters->values[i]) != SUCCESS)
+      result = FAILURE;
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,255 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2015 GEGL contributors
+ */
+
+/* gegl:warp keeps the displacement of the stroke processed so far, with
+ * checkpoints along it. This builds strokes a point at a time, rendering
+ * the region around the newest point after each one, then moves a point
+ * in the middle of the stroke, which replays it from a checkpoint. The
+ * displacements are compared with those of nodes rendering the whole
+ * strokes in a single pass.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+#define SKIP     77
+
+#define SIZE      200
+#define N_POINTS  24
+#define MOVED     17 /* the point moved after the stroke is complete */
+#define TOLERANCE 0.0001
+
+static const gchar *behaviors[] = { "move", "grow", "swirl-cw", "smooth" };
+
+static void
+get_point (gint     i,
+           gdouble *x,
+           gdouble *y)
+{
+  /* a zigzag reaching out of the image, long enough for a few
+   * checkpoints
+   */
+  *x = -10.0 + i * 9.5;
+  *y = i % 2 ? 40.0 + i * 4.0 : 150.0 - i * 2.0;
+}
+
+static GeglBuffer *
+make_input (void)
+{
+  const Babl *format = babl_format_n (babl_type ("float"), 2);
+  GeglBuffer *buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                                        format);
+  gfloat     *coords = g_new (gfloat, SIZE * SIZE * 2);
+  gint        x, y;
+
+  /* a smooth displacement, for the behaviors depending on it */
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        coords[(y * SIZE + x) * 2]     = sin (x * 0.05) * 3.0;
+        coords[(y * SIZE + x) * 2 + 1] = cos (y * 0.07) * 2.0;
+      }
+
+  gegl_buffer_set (buffer, NULL, 0, format, coords, GEGL_AUTO_ROWSTRIDE);
+  g_free (coords);
+
+  return buffer;
+}
+
+static GeglNode *
+make_warp (GeglNode    *ptn,
+           GeglBuffer  *input,
+           gint         behavior,
+           GeglPath    *stroke)
+{
+  GeglNode *source, *warp;
+
+  source = gegl_node_new_child (ptn,
+                                "operation", "gegl:buffer-source",
+                                "buffer", input,
+                                NULL);
+  warp   = gegl_node_new_child (ptn,
+                                "operation", "gegl:warp",
+                                "behavior", behavior,
+                                "stroke", stroke,
+                                NULL);
+
+  gegl_node_link (source, warp);
+
+  return warp;
+}
+
+static gfloat *
+render (GeglNode            *node,
+        const GeglRectangle *roi)
+{
+  gfloat *coords = g_new (gfloat, roi->width * roi->height * 2);
+
+  gegl_node_blit (node, 1.0, roi, babl_format_n (babl_type ("float"), 2),
+                  coords, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  return coords;
+}
+
+/* Renders the first n_points of the stroke in one pass, with the point
+ * MOVED displaced by moved
+ */
+static gfloat *
+render_single_pass (GeglBuffer *input,
+                    gint        behavior,
+                    gint        n_points,
+                    gdouble     moved)
+{
+  GeglNode *ptn    = gegl_node_new ();
+  GeglPath *stroke = gegl_path_new ();
+  gfloat   *coords;
+  gint      i;
+
+  for (i = 0; i < n_points; i++)
+    {
+      gdouble x, y;
+
+      get_point (i, &x, &y);
+      gegl_path_append (stroke, i ? 'L' : 'M',
+                        x, i == MOVED ? y + moved : y);
+    }
+
+  coords = render (make_warp (ptn, input, behavior, stroke),
+                   GEGL_RECTANGLE (0, 0, SIZE, SIZE));
+
+  g_object_unref (stroke);
+  g_object_unref (ptn);
+
+  return coords;
+}
+
+static gint
+compare (const gchar *behavior,
+         const gchar *what,
+         gfloat      *incremental,
+         gfloat      *single_pass)
+{
+  gdouble max_diff = 0.0;
+  gint    i;
+
+  for (i = 0; i < SIZE * SIZE * 2; i++)
+    max_diff = MAX (max_diff, fabs (incremental[i] - single_pass[i]));
+
+  g_free (incremental);
+  g_free (single_pass);
+
+  if (max_diff > TOLERANCE)
+    {
+      printf ("%s, %s: the displacements differ by %f\n",
+              behavior, what, max_diff);
+      return FAILURE;
+    }
+
+  return SUCCESS;
+}
+
+static gint
+test_behavior (GeglBuffer *input,
+               GEnumValue *behavior)
+{
+  GeglNode *ptn    = gegl_node_new ();
+  GeglPath *stroke = gegl_path_new ();
+  GeglNode *warp   = make_warp (ptn, input, behavior->value, stroke);
+  gint      result = SUCCESS;
+  gint      i;
+
+  /* extend the stroke a point at a time, rendering around the new point */
+  for (i = 0; i < N_POINTS; i++)
+    {
+      gdouble x, y;
+
+      get_point (i, &x, &y);
+      gegl_path_append (stroke, i ? 'L' : 'M', x, y);
+
+      g_free (render (warp, GEGL_RECTANGLE (x - 20, y - 20, 40, 40)));
+
+      if (i == N_POINTS / 2 &&
+          compare (behavior->value_nick, "half the stroke",
+                   render (warp, GEGL_RECTANGLE (0, 0, SIZE, SIZE)),
+                   render_single_pass (input, behavior->value, i + 1, 0.0)))
+        result = FAILURE;
+    }
+
+  if (compare (behavior->value_nick, "the whole stroke",
+               render (warp, GEGL_RECTANGLE (0, 0, SIZE, SIZE)),
+               render_single_pass (input, behavior->value, N_POINTS, 0.0)))
+    result = FAILURE;
+
+  /* move a point, replaying the stroke from a checkpoint before it */
+  {
+    GeglPathItem item;
+
+    gegl_path_get_node (stroke, MOVED, &item);
+    item.point[0].y += 15.0;
+    gegl_path_replace_node (stroke, MOVED, &item);
+  }
+
+  if (compare (behavior->value_nick, "a point moved",
+               render (warp, GEGL_RECTANGLE (0, 0, SIZE, SIZE)),
+               render_single_pass (input, behavior->value, N_POINTS, 15.0)))
+    result = FAILURE;
+
+  g_object_unref (stroke);
+  g_object_unref (ptn);
+
+  return result;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GParamSpec *pspec;
+  GEnumClass *enum_class;
+  GeglBuffer *input;
+  gint        result = SUCCESS;
+  gint        i;
+
+  gegl_init (&argc, &argv);
+
+  if (! gegl_has_operation ("gegl:warp"))
+    {
+      gegl_exit ();
+      return SKIP;
+    }
+
+  pspec      = gegl_operation_find_property ("gegl:warp", "behavior");
+  enum_class = G_PARAM_SPEC_ENUM (pspec)->enum_class;
+  input      = make_input ();
+
+  for (i = 0; i < G_N_ELEMENTS (behaviors); i++)
+    if (test_behavior (input,
+                       g_enum_get_value_by_nick (enum_class, behaviors[i])))
+      result = FAILURE;
+
+  g_object_unref (input);
+
+  gegl_exit ();
+
+  return result;
+}